@@ -0,0 +1,531 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+// Host program (platformio env "native_hub_bench"): connects Lpf2::Hub to a
+// Sim::ScriptedHub loaded from a hub dump over a Sim::HubLoopback and
+// prints how long discovery takes (virtual time, at the loopback's
+// latency), what the host spends per output command and per value
+// notification, and destroys SnapshotBuffers while a second thread
+// delivers values to their port. --motors N attaches N more train motors (ports 0..N-1),
+// --latency the one-way latency in µs, --descriptors registers the
+// library's device descriptors (ports with a known device skip discovery),
+// --check samples one mode of those ports in the background
+// (Hub::setDescriptorCheck()), --cache connects a first Hub to fill a
+// DiscoveryCache (in RAM) and measures a second one restoring from it,
+// like a controller reconnecting after a reset, --window the discovery requests in flight (Hub::setInfoWindow(), 1 asks
+// one at a time), --rate the rate of the simulated joystick loop (output
+// commands per second for one second), --no-coalesce writes every output
+// command right away (Hub::setOutputCoalescing(), every command arrives
+// and the order is not checked), --move-ms the time a
+// simulated move takes (Remote::Port::queueMotion(), buffered on the hub
+// versus one after the other), --hubs N the hubs brought up one after the
+// other and together from a HubPool, --props-ms how often the hub's RSSI
+// and battery change (the hub property updates it sends, with every
+// update enabled and with only what is subscribed) and --info prints
+// Hub::getAllInfoStr() once discovery is done.
+//
+// usage: program [--motors N] [--latency us] [--descriptors] [--check] [--cache] [--window N] [--rate hz] [--no-coalesce] [--move-ms ms] [--hubs N] [--props-ms ms] [--info] [dump]   (default: docs/DeviceModes/Technic_Hub.txt)
+
+#include "Lpf2/Hub.hpp"
+#include "Lpf2/HubPool.hpp"
+#include "Lpf2/Sim/HubLoopback.hpp"
+#include "Lpf2/Sim/Clock.hpp"
+#include "Lpf2/DeviceDescLib.hpp"
+#include "Lpf2/DiscoveryCache.hpp"
+#include "Lpf2/SnapshotBuffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <thread>
+
+using Clock = Lpf2::Sim::Clock;
+
+// Heap allocations, counted to show the receive path makes none.
+static std::atomic<size_t> s_allocations{0};
+
+void *operator new(size_t size)
+{
+    s_allocations++;
+    if (void *p = malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+static constexpr uint32_t DISCOVERY_TIMEOUT_MS = 60000;
+static constexpr int COMMANDS = 20000;
+static constexpr int VALUES = 20000;
+static constexpr int MOVES = 10;
+static constexpr int SNAPSHOT_BUFFERS = 100;
+static constexpr int SNAPSHOT_FLIPS = 5;
+
+struct Options
+{
+    const char *dump = "docs/DeviceModes/Technic_Hub.txt";
+    int motors = 0;
+    uint32_t latencyUs = 7500;
+    int window = LPF2_HUB_INFO_WINDOW;
+    int rate = 200;
+    uint32_t moveMs = 100;
+    int hubs = 4;
+    uint32_t propsMs = 50;
+    bool coalesce = true;
+    bool descriptors = false;
+    bool check = false;
+    bool cache = false;
+    bool info = false;
+};
+
+static bool discovered(Lpf2::Hub &hub, const Lpf2::Sim::ScriptedHub &scripted)
+{
+    if (!hub.infoReady())
+        return false;
+    for (Lpf2::PortNum port : scripted.ports())
+    {
+        if (!hub.getPort(port)->isDeviceConnected())
+            return false;
+    }
+    return true;
+}
+
+// Connect @p hub and run it until discovery is done.
+// @returns the virtual time it took in ms, -1 on timeout
+static double discover(Lpf2::Hub &hub, Lpf2::Sim::HubLoopback &link, Lpf2::Sim::ScriptedHub &scripted)
+{
+    uint64_t startUs = Clock::nowUs();
+    hub.attach(&link);
+    scripted.connect();
+    while (!discovered(hub, scripted) && Clock::nowUs() - startUs < DISCOVERY_TIMEOUT_MS * 1000ull)
+    {
+        link.idle(1);
+        hub.update();
+    }
+    if (!discovered(hub, scripted))
+        return -1;
+    return (Clock::nowUs() - startUs) / 1000.0;
+}
+
+template <typename F>
+static double wallNs(F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    lpf2_log_init();
+    lpf2_set_runtime_log_level(LPF2_LOG_LEVEL_WARN);
+
+    Options opt;
+    int arg = 1;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++)
+    {
+        if (strcmp(argv[arg], "--motors") == 0 && arg + 1 < argc)
+            opt.motors = (int)strtol(argv[++arg], nullptr, 0);
+        else if (strcmp(argv[arg], "--latency") == 0 && arg + 1 < argc)
+            opt.latencyUs = (uint32_t)strtoul(argv[++arg], nullptr, 0);
+        else if (strcmp(argv[arg], "--window") == 0 && arg + 1 < argc)
+            opt.window = (int)strtol(argv[++arg], nullptr, 0);
+        else if (strcmp(argv[arg], "--rate") == 0 && arg + 1 < argc)
+            opt.rate = std::clamp((int)strtol(argv[++arg], nullptr, 0), 1, 1000);
+        else if (strcmp(argv[arg], "--move-ms") == 0 && arg + 1 < argc)
+            opt.moveMs = (uint32_t)strtoul(argv[++arg], nullptr, 0);
+        else if (strcmp(argv[arg], "--props-ms") == 0 && arg + 1 < argc)
+            opt.propsMs = (uint32_t)strtoul(argv[++arg], nullptr, 0);
+        else if (strcmp(argv[arg], "--hubs") == 0 && arg + 1 < argc)
+            opt.hubs = std::clamp((int)strtol(argv[++arg], nullptr, 0), 1, LPF2_HUB_POOL_SIZE);
+        else if (strcmp(argv[arg], "--no-coalesce") == 0)
+            opt.coalesce = false;
+        else if (strcmp(argv[arg], "--descriptors") == 0)
+            opt.descriptors = true;
+        else if (strcmp(argv[arg], "--check") == 0)
+            opt.check = true;
+        else if (strcmp(argv[arg], "--cache") == 0)
+            opt.cache = true;
+        else if (strcmp(argv[arg], "--info") == 0)
+            opt.info = true;
+        else
+        {
+            printf("unknown option %s\n", argv[arg]);
+            return 1;
+        }
+    }
+    if (arg < argc)
+        opt.dump = argv[arg];
+    if (opt.descriptors)
+        Lpf2::DeviceDescRegistry::registerDefault();
+
+    Lpf2::Sim::ScriptedHub scripted;
+    if (scripted.load(opt.dump) != 0)
+    {
+        printf("cannot load %s\n", opt.dump);
+        return 1;
+    }
+    for (int i = 0; i < opt.motors; i++)
+    {
+        if (scripted.attachIO((Lpf2::PortNum)i, Lpf2::DeviceType::TRAIN_MOTOR) != 0)
+        {
+            printf("%s has no train motor (0x02) block\n", opt.dump);
+            return 1;
+        }
+    }
+
+    if (scripted.ports().empty())
+    {
+        printf("%s attaches no ports (no \"Attached IO\" lines), try --motors\n", opt.dump);
+        return 1;
+    }
+
+    printf("%s: %zu ports, latency %.1f ms, window %u\n", opt.dump, scripted.ports().size(), opt.latencyUs / 1000.0,
+           (unsigned)std::clamp(opt.window, 1, LPF2_HUB_INFO_WINDOW));
+
+    Lpf2::MemoryCacheStorage storage;
+    Lpf2::DiscoveryCache cache(storage);
+    if (opt.cache)
+    {
+        Lpf2::Sim::HubLoopback coldLink(scripted, opt.latencyUs);
+        Lpf2::Hub cold;
+        cold.setInfoWindow((uint8_t)opt.window);
+        cold.setDiscoveryCache(&cache);
+        cold.setHubId("bench");
+        double coldMs = discover(cold, coldLink, scripted);
+        cold.update(); // saves the cache
+        std::vector<uint8_t> blob;
+        storage.load("bench", blob);
+        printf("   first connection: %.0f ms, %zu ports cached in %zu bytes\n", coldMs, cache.size(), blob.size());
+        scripted.resetStats();
+    }
+
+    Lpf2::Sim::HubLoopback link(scripted, opt.latencyUs);
+    Lpf2::Hub hub;
+    hub.setInfoWindow((uint8_t)opt.window);
+    hub.setDescriptorCheck(opt.check);
+    hub.setOutputCoalescing(opt.coalesce);
+    if (opt.cache)
+    {
+        hub.setDiscoveryCache(&cache);
+        hub.setHubId("bench");
+    }
+
+    // Discovery
+    double discoveryMs = discover(hub, link, scripted);
+    if (discoveryMs < 0)
+    {
+        printf("   discovery did not finish in %u ms\n", DISCOVERY_TIMEOUT_MS);
+        return 1;
+    }
+    printf("   discovery: %.0f ms, %zu messages to the hub, %zu from it, %u info requests\n",
+           discoveryMs, link.framesWritten(), link.framesDelivered(), scripted.stats().infoRequests);
+    const auto &stats = hub.getDiscoveryStats();
+    printf("   ports: %u discovered, %u from descriptors, %u from the cache (%u requests avoided), %u checked, %u mismatched\n",
+           stats.portsDiscovered, stats.portsFromDescriptor, stats.portsFromCache, stats.requestsAvoided,
+           stats.descriptorChecks, stats.descriptorMismatches);
+
+    // Let the default modes the ports set after discovery settle.
+    for (int i = 0; i < 200; i++)
+    {
+        link.idle(1);
+        hub.update();
+    }
+    if (opt.info)
+        printf("%s\n", hub.getAllInfoStr().c_str());
+
+    // Output commands: Remote::Port::writeData() down to the output queue
+    // (or the transport).
+    Lpf2::PortNum outPort = opt.motors ? 0 : scripted.ports().front();
+    Lpf2::Port *port = hub.getPort(outPort);
+    scripted.resetStats();
+    hub.resetOutputStats();
+    double cmdNs = wallNs([&]
+                          {
+        for (int i = 0; i < COMMANDS; i++)
+            port->writeData(0, {(uint8_t)(i % 10)}); });
+    hub.flushOutput();
+    link.idle(opt.latencyUs / 1000 + 1);
+    printf("   output commands: %.0f ns each (%.0f per second), %u of %d arrived\n",
+           cmdNs / COMMANDS, 1e9 * COMMANDS / cmdNs, scripted.stats().outputCommands, COMMANDS);
+
+    // A joystick loop: one power command every 1/rate s for a second, with
+    // Hub::update() every ms.
+    scripted.resetStats();
+    hub.resetOutputStats();
+    int period = std::max(1, 1000 / opt.rate);
+    for (int ms = 0; ms < 1000; ms++)
+    {
+        if (ms % period == 0)
+            port->writeData(0, {(uint8_t)(ms / period % 100)});
+        link.idle(1);
+        hub.update();
+    }
+    hub.flushOutput();
+    link.idle(opt.latencyUs / 1000 + 1);
+    const auto &out = hub.getOutputStats();
+    printf("   joystick at %d Hz: %u commands, %u sent in %u connection events, %u coalesced, %u dropped, %u arrived\n",
+           1000 / period, out.commands, out.sent, out.flushes, out.coalesced, out.dropped, scripted.stats().outputCommands);
+
+    // Command order: commands of one port issued within one connection
+    // interval go out in the order they were issued, only a repeat of the
+    // last one replacing it.
+    scripted.resetStats();
+    port->presetEncoder(0);
+    port->gotoAbsPosition(90, 100, 100, Lpf2::BrakingStyle::HOLD);
+    port->presetEncoder(0);
+    port->setAccTime(200);
+    port->startSpeedForDegrees(90, 50, 100, Lpf2::BrakingStyle::HOLD, 1);
+    port->setAccTime(300);
+    port->setAccTime(400);
+    hub.flushOutput();
+    link.idle(opt.latencyUs / 1000 + 1);
+    const std::vector<uint8_t> expected = {
+        (uint8_t)Lpf2::PortOutputSubCommand::WRITE_DIRECT_MODE,
+        (uint8_t)Lpf2::PortOutputSubCommand::GOTO_ABS_POS_SINGLE,
+        (uint8_t)Lpf2::PortOutputSubCommand::WRITE_DIRECT_MODE,
+        (uint8_t)Lpf2::PortOutputSubCommand::SET_ACC_TIME,
+        (uint8_t)Lpf2::PortOutputSubCommand::START_SPEED_FOR_DEG_SINGLE,
+        (uint8_t)Lpf2::PortOutputSubCommand::SET_ACC_TIME};
+    printf("   command order: preset, goto, preset, acc time, speed for degrees, acc time x2: %zu arrived, %s\n",
+           scripted.outputLog().size(),
+           !opt.coalesce || scripted.outputLog() == expected ? "in order" : "OUT OF ORDER");
+
+    // Queued moves: MOVES moves of --move-ms each, queued at once (the hub
+    // starts the next from its buffer) and one after the other (the next is
+    // sent when the feedback of the last arrived).
+    scripted.setMoveTimeMs(opt.moveMs);
+    auto *remotePort = static_cast<Lpf2::Remote::Port *>(port);
+    Lpf2::Local::MotionSegment move;
+    move.type = Lpf2::Local::MotionSegment::Type::SPEED_FOR_TIME;
+    move.value = (int32_t)opt.moveMs;
+    auto runMoves = [&](bool buffered, uint8_t completion)
+    {
+        uint64_t startUs = Clock::nowUs();
+        Lpf2::Remote::CommandHandle last;
+        int queued = 0;
+        while (Clock::nowUs() - startUs < DISCOVERY_TIMEOUT_MS * 1000ull)
+        {
+            if (queued < MOVES && (buffered || !last.valid() || last.done()))
+            {
+                last = remotePort->queueMotion(move, Lpf2::STARTUP_BUFFER | completion);
+                if (last.valid())
+                    queued++;
+            }
+            else if (queued == MOVES && last.done())
+            {
+                break;
+            }
+            link.idle(1);
+            hub.update();
+        }
+        return last.state() == Lpf2::Remote::CommandState::COMPLETED ? (Clock::nowUs() - startUs) / 1000.0 : -1.0;
+    };
+    double bufferedMs = runMoves(true, Lpf2::COMPLETION_FEEDBACK);
+    double sequentialMs = runMoves(false, Lpf2::COMPLETION_FEEDBACK);
+    scripted.resetStats();
+    double noFeedbackMs = runMoves(true, Lpf2::COMPLETION_NONE);
+    uint32_t noFeedbackSent = scripted.stats().outputCommands;
+    scripted.setMoveTimeMs(0);
+    printf("   %d moves of %u ms: %.0f ms buffered on the hub, %.0f ms one after the other, %.0f ms buffered without feedback (%u sent)\n",
+           MOVES, opt.moveMs, bufferedMs, sequentialMs, noFeedbackMs, noFeedbackSent);
+
+    // Hub properties: what the hub sends for 10 s with nothing subscribed,
+    // with updates enabled like before subscriptions (name, button,
+    // battery) and with RSSI and the battery polled.
+    if (opt.propsMs)
+    {
+        using Prop = Lpf2::HubPropertyType;
+        scripted.setPropertyUpdateMs(opt.propsMs);
+        auto propertyTraffic = [&]
+        {
+            hub.resetMessageStats();
+            for (int ms = 0; ms < 10000; ms++)
+            {
+                link.idle(1);
+                hub.update();
+            }
+            return std::make_pair(hub.getMessageCount(Lpf2::MessageType::HUB_PROPERTIES),
+                                  hub.getMessageBytes(Lpf2::MessageType::HUB_PROPERTIES));
+        };
+        auto none = propertyTraffic();
+        for (Prop prop : {Prop::ADVERTISING_NAME, Prop::BUTTON, Prop::BATTERY_VOLTAGE})
+            hub.subscribeHubProperty(prop);
+        auto all = propertyTraffic();
+        for (Prop prop : {Prop::ADVERTISING_NAME, Prop::BUTTON, Prop::BATTERY_VOLTAGE})
+            hub.unsubscribeHubProperty(prop);
+        int callbacks = 0;
+        auto count = [&callbacks](Prop, Lpf2::Utils::ByteSpan)
+        { callbacks++; };
+        hub.subscribeHubProperty(Prop::RSSI, 1000, 2, count);
+        hub.subscribeHubProperty(Prop::BATTERY_VOLTAGE, 5000, 0, count);
+        auto polled = propertyTraffic();
+        hub.unsubscribeHubProperty(Prop::RSSI);
+        hub.unsubscribeHubProperty(Prop::BATTERY_VOLTAGE);
+        scripted.setPropertyUpdateMs(0);
+        link.idle(2 * (opt.latencyUs / 1000 + 1)); // the last replies
+        printf("   hub properties in 10 s: %u messages (%u bytes) with none subscribed, %u (%u bytes) with name, button and battery updates, %u (%u bytes, %d callbacks) polling RSSI every 1 s and the battery every 5 s\n",
+               none.first, none.second, all.first, all.second, polled.first, polled.second, callbacks);
+    }
+
+    // Several hubs: brought up one after the other, then together from a
+    // HubPool that services them in one loop.
+    if (opt.hubs > 1)
+    {
+        std::vector<std::unique_ptr<Lpf2::Sim::ScriptedHub>> fleet;
+        for (int i = 0; i < opt.hubs; i++)
+        {
+            fleet.emplace_back(new Lpf2::Sim::ScriptedHub());
+            fleet.back()->load(opt.dump);
+            for (int m = 0; m < opt.motors; m++)
+                fleet.back()->attachIO((Lpf2::PortNum)m, Lpf2::DeviceType::TRAIN_MOTOR);
+        }
+
+        double sequentialMs = 0;
+        for (auto &scriptedHub : fleet)
+        {
+            Lpf2::Sim::HubLoopback fleetLink(*scriptedHub, opt.latencyUs);
+            Lpf2::Hub fleetHub;
+            fleetHub.setInfoWindow((uint8_t)opt.window);
+            double ms = discover(fleetHub, fleetLink, *scriptedHub);
+            sequentialMs = ms < 0 || sequentialMs < 0 ? -1 : sequentialMs + ms;
+            fleetHub.detach();
+        }
+
+        std::vector<std::unique_ptr<Lpf2::Sim::HubLoopback>> links;
+        std::vector<std::unique_ptr<Lpf2::Hub>> hubs;
+        Lpf2::HubPool pool;
+        for (auto &scriptedHub : fleet)
+        {
+            links.emplace_back(new Lpf2::Sim::HubLoopback(*scriptedHub, opt.latencyUs));
+            hubs.emplace_back(new Lpf2::Hub());
+            hubs.back()->setInfoWindow((uint8_t)opt.window);
+            pool.addHub(*hubs.back(), links.back().get());
+        }
+        uint64_t startUs = Clock::nowUs();
+        pool.begin();
+        for (auto &scriptedHub : fleet)
+            scriptedHub->connect();
+        auto fleetDiscovered = [&]
+        {
+            for (size_t i = 0; i < fleet.size(); i++)
+            {
+                if (!discovered(*hubs[i], *fleet[i]))
+                    return false;
+            }
+            return true;
+        };
+        while (!fleetDiscovered() && Clock::nowUs() - startUs < DISCOVERY_TIMEOUT_MS * 1000ull)
+        {
+            Clock::advanceUs(1000);
+            pool.service();
+        }
+        double pooledMs = fleetDiscovered() ? (Clock::nowUs() - startUs) / 1000.0 : -1;
+        uint32_t slowestMs = 0;
+        for (size_t i = 0; i < pool.size(); i++)
+            slowestMs = std::max(slowestMs, pool.getSlotStats(i).readyMs);
+        printf("   %d hubs: %.0f ms one after the other, %.0f ms from a HubPool (slowest hub %u ms, %u info requests, %u passes)\n",
+               opt.hubs, sequentialMs, pooledMs, slowestMs, pool.getDiscoveryStats().infoRequests, pool.getStats().passes);
+    }
+
+    // Value notifications: queued at once, timed while the loopback hands
+    // them to Hub.
+    Lpf2::PortNum valuePort = 0;
+    bool found = false;
+    for (Lpf2::PortNum p : scripted.ports())
+    {
+        if (hub.getPort(p)->getInputModes() && scripted.sendValue(p, 0) == 0)
+        {
+            valuePort = p;
+            found = true;
+            break;
+        }
+    }
+    if (!found)
+    {
+        printf("   no port with an input format set, no values sent\n");
+        return 0;
+    }
+    link.idle(opt.latencyUs / 1000 + 1);
+    for (int i = 0; i < VALUES; i++)
+        scripted.sendValue(valuePort, i);
+    Clock::advanceUs(opt.latencyUs);
+    size_t before = link.framesDelivered();
+    size_t allocations = s_allocations;
+    double valueNs = wallNs([&]
+                            { link.poll(); });
+    allocations = s_allocations - allocations;
+    printf("   value dispatch: %.0f ns per PORT_VALUE_SINGLE (port 0x%02X, %zu delivered, %zu allocations)\n",
+           valueNs / VALUES, (unsigned)valuePort, link.framesDelivered() - before, allocations);
+
+    // Snapshot buffer: another thread delivers values (the notify context)
+    // while this one adds channels, flips and destroys SnapshotBuffers (a
+    // control task), so destruction races the port's callbacks.
+    link.setLatencyUs(0);
+    std::atomic<bool> stop{false};
+    std::atomic<uint32_t> delivered{0};
+    std::thread notifier([&]
+                         {
+        for (int32_t i = 0; !stop.load(std::memory_order_relaxed); i++)
+        {
+            scripted.sendValue(valuePort, i % 100);
+            link.poll();
+            delivered.fetch_add(1, std::memory_order_relaxed);
+        } });
+    Lpf2::Port *snapPort = hub.getPort(valuePort);
+    uint32_t flips = 0, updates = 0;
+    for (int b = 0; b < SNAPSHOT_BUFFERS; b++)
+    {
+        auto snapshot = std::make_unique<Lpf2::SnapshotBuffer<16>>();
+        for (uint8_t mode = 0; mode < snapPort->getModeCount(); mode++)
+        {
+            if (snapPort->getInputModes() & (1u << mode))
+                snapshot->addChannel(*snapPort, mode, 0);
+        }
+        for (int f = 0; f < SNAPSHOT_FLIPS; f++)
+        {
+            // A tick: let the other thread deliver at least one value.
+            uint32_t seen = delivered.load();
+            while (delivered.load() == seen)
+                std::this_thread::yield();
+            snapshot->flip();
+            flips++;
+            for (size_t ch = 0; ch < snapshot->channelCount(); ch++)
+                updates += snapshot->updated(ch);
+        }
+        // Destroyed here, most likely while the other thread is inside
+        // the port's callbacks.
+    }
+    stop = true;
+    notifier.join();
+    printf("   snapshot: %d buffers flipped %u times and destroyed while another thread delivered %u values (%u channel updates seen)\n",
+           SNAPSHOT_BUFFERS, flips, delivered.load(), updates);
+    return 0;
+}
@@ -73,6 +73,24 @@ void loop()
 
     portA.update();
 
+#if defined(LPF2_PID_PROFILE)
+    // Motor controller cost per tick, build with -DLPF2_PID_PROFILE
+    // (and -DLPF2_PID_FIXED to compare the fixed-point controller).
+    static uint32_t lastProfile = 0;
+    if (millis() - lastProfile >= 1000)
+    {
+        lastProfile = millis();
+        const auto &profile = portA.getPidProfile();
+        if (profile.ticks)
+        {
+            Serial.printf("updateMotorPID(): %u ticks, mean %u cycles, max %u\n",
+                          (unsigned)profile.ticks, (unsigned)(profile.cycles / profile.ticks),
+                          (unsigned)profile.maxCycles);
+        }
+        portA.resetPidProfile();
+    }
+#endif
+
     static bool firstTime = true;
 
     if (auto *dev = portA.device())
@@ -0,0 +1,571 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+// Host program (platformio env "native_motor_sim"): runs a scripted set of
+// moves against simulated encoder motors and prints settling time,
+// overshoot and steady-state error of Local::Port's motor controller.
+// With --autotune the script runs again after Port::startAutoTune(), with
+// --heavy the motors drive a load of three times their own inertia and with
+// --scurve position moves use the S-curve with the limits below. --group
+// runs two motors through the same move, once started one by one and once
+// as a Local::MotionGroup. --model sets the feed-forward model from the
+// simulated motor, --supply the battery voltage. --trace writes the
+// port's control trace of the script to PREFIX_<type>.bin, see
+// scripts/control_trace_to_csv.py. --hold runs motors whose friction is
+// off the table values through short moves, with fixed and with adaptive
+// friction compensation (Port::setFrictionAdaptation()), and counts how
+// often they hunt around the target. --queue runs a path of relative
+// moves three ways: polled by the application, queued on the port
+// (Port::queueMotion()) and queued with blending.
+// Built with LPF2_PID_PROFILE (env "native_pid_bench*"), it also prints the
+// cycles per controller tick.
+//
+// usage: program [--autotune] [--heavy] [--scurve] [--group] [--model] [--supply mV] [--trace PREFIX] [--hold] [--queue] [device type, e.g. 0x2E]   (default: every motor with MotorSettings)
+
+#include "Lpf2/Sim/MotorBench.hpp"
+#include "Lpf2/Sim/Clock.hpp"
+#include "Lpf2/Local/MotionGroup.hpp"
+#include "Lpf2/DeviceDescLib.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using Bench = Lpf2::Sim::MotorBench;
+using Move = Bench::Move;
+
+static const Move SCRIPT[] = {
+    {"pos +90 @50%", Move::Type::POSITION, 90, 50, 100, 1500, 2.0f},
+    {"pos +450 @100%", Move::Type::POSITION, 450, 100, 100, 2000, 2.0f},
+    {"pos -180 @30%", Move::Type::POSITION, -180, 30, 100, 4000, 2.0f},
+    {"pos +5 @50%", Move::Type::POSITION, -175, 50, 100, 1000, 1.0f},
+    {"speed 50%", Move::Type::SPEED, 50, 0, 100, 1500, 5.0f},
+    {"speed -20%", Move::Type::SPEED, -20, 0, 100, 1500, 5.0f},
+    {"speed 80%", Move::Type::SPEED, 80, 0, 100, 1500, 5.0f},
+};
+
+static const Lpf2::DeviceType MOTORS[] = {
+    Lpf2::DeviceType::MEDIUM_LINEAR_MOTOR,
+    Lpf2::DeviceType::TECHNIC_LARGE_LINEAR_MOTOR,
+    Lpf2::DeviceType::TECHNIC_XLARGE_LINEAR_MOTOR,
+    Lpf2::DeviceType::TECHNIC_MEDIUM_ANGULAR_MOTOR,
+    Lpf2::DeviceType::TECHNIC_LARGE_ANGULAR_MOTOR,
+    Lpf2::DeviceType::TECHNIC_MEDIUM_ANGULAR_MOTOR_GREY,
+    Lpf2::DeviceType::TECHNIC_LARGE_ANGULAR_MOTOR_GREY,
+};
+
+static void printAutoTune(Bench &bench)
+{
+    const auto &r = bench.port().getAutoTuneResult();
+    printf("   auto-tune: breakaway %.1f%%, kinetic floor %.1f%%, gain %.3f, tau %.1f ms, dead time %.1f ms\n",
+           r.breakaway_pct, r.kinetic_floor_pct, r.gain, r.timeConstantMs, r.deadTimeMs);
+    printf("   gains: speed_ksp %.3f speed_ksi %.3f pos_kp %.3f pos_kd %.4f\n",
+           r.speed_ksp, r.speed_ksi, r.pos_kp, r.pos_kd);
+}
+
+// Load inertia of --heavy, in rotor inertias.
+static constexpr float HEAVY_LOAD = 3.0f;
+
+// S-curve limits of --scurve, mdeg/s² and mdeg/s³.
+static constexpr double SCURVE_ACCEL = 6.0e6;
+static constexpr double SCURVE_JERK = 6.0e7;
+
+// Targets of the --group move, degrees.
+static const int32_t GROUP_TARGETS[2] = {450, 90};
+static constexpr float GROUP_BAND = 2.0f;
+
+struct Options
+{
+    bool autoTune = false;
+    bool heavy = false;
+    bool sCurve = false;
+    bool group = false;
+    bool model = false;
+    uint16_t supplyMv = 0; // 0 = the bench's default
+    const char *tracePrefix = nullptr;
+    bool hold = false;
+    bool queue = false;
+};
+
+// Records per control trace; holds the longest move of the script at the
+// bench's 1 ms control period.
+static constexpr size_t TRACE_CAPACITY = 8192;
+
+// Append the records of @p port's control trace from @p cursor on to @p f.
+static void drainTrace(const Lpf2::Local::Port &port, uint32_t &cursor, FILE *f)
+{
+    uint8_t buf[64 * sizeof(Lpf2::Local::ControlTrace::Record)];
+    size_t n;
+    while ((n = port.getControlTrace()->dump(cursor, buf, sizeof(buf))) > 0)
+        fwrite(buf, 1, n, f);
+}
+
+static int runBench(Lpf2::DeviceType type, const Options &opt)
+{
+    printf("== device 0x%02X%s%s%s%s", (int)type, opt.autoTune ? ", auto-tuned" : "",
+           opt.heavy ? ", heavy load" : "", opt.sCurve ? ", S-curve" : "", opt.model ? ", model feed-forward" : "");
+    if (opt.supplyMv)
+        printf(", %u mV", (unsigned)opt.supplyMv);
+    printf("\n");
+    if (!Lpf2::DeviceDescRegistry::instance().getDescriptor(type))
+    {
+        printf("   no descriptor, skipped\n");
+        return 0;
+    }
+
+    Bench::Config config;
+    config.type = type;
+    if (opt.supplyMv)
+        config.supplyMv = opt.supplyMv;
+    Lpf2::Sim::MotorModel model;
+    const Lpf2::Local::MotorSettings *settings = Lpf2::Local::lookupMotorSettings(type);
+    if (opt.heavy && settings)
+    {
+        model = Lpf2::Sim::MotorModel::fromSettings(*settings);
+        model.load_inertia_kgm2 = HEAVY_LOAD * model.inertia_kgm2;
+        config.model = &model;
+    }
+    // Every run starts at the same virtual time, whatever ran before.
+    Lpf2::Sim::Clock::setUs(0);
+    Bench bench(config);
+
+    auto wallStart = std::chrono::steady_clock::now();
+    uint64_t simStart = bench.timeMs();
+
+    if (!bench.connect())
+    {
+        printf("   handshake failed\n");
+        return 1;
+    }
+    printf("   connected after %llu ms (simulated)\n", (unsigned long long)(bench.timeMs() - simStart));
+    if (opt.autoTune)
+    {
+        uint64_t tuneStart = bench.timeMs();
+        if (!bench.autoTune())
+        {
+            printf("   auto-tune failed\n");
+            return 1;
+        }
+        printf("   auto-tune took %llu ms (simulated)\n", (unsigned long long)(bench.timeMs() - tuneStart));
+        printAutoTune(bench);
+    }
+    if (opt.model)
+    {
+        Lpf2::Local::MotorSettings s = *bench.port().getMotorSettings();
+        bench.plant().model().applyFeedForward(s);
+        bench.port().setMotorSettings(s);
+    }
+    if (opt.sCurve)
+    {
+        Lpf2::Local::MotorSettings s = *bench.port().getMotorSettings();
+        s.pos_accel_mdps2 = SCURVE_ACCEL;
+        s.pos_jerk_mdps3 = SCURVE_JERK;
+        bench.port().setMotorSettings(s);
+    }
+#if defined(LPF2_PID_PROFILE)
+    bench.port().resetPidProfile();
+#endif
+    FILE *trace = nullptr;
+    uint32_t traceCursor = 0;
+    if (opt.tracePrefix)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "%s_%02X.bin", opt.tracePrefix, (int)type);
+        trace = fopen(path, "wb");
+        if (!trace)
+        {
+            printf("   cannot write %s\n", path);
+            return 1;
+        }
+        uint8_t header[Lpf2::Local::ControlTrace::HEADER_SIZE];
+        fwrite(header, 1, Lpf2::Local::ControlTrace::writeHeader(header, sizeof(header)), trace);
+        bench.port().enableControlTrace(TRACE_CAPACITY);
+        traceCursor = bench.port().getControlTrace()->head();
+        printf("   control trace: %s\n", path);
+    }
+    printf("   %-16s %8s %10s %10s %10s %9s %8s\n", "move", "settle", "overshoot", "ss error", "load err", "obs lag",
+           "obs spd");
+
+    for (const Move &move : SCRIPT)
+    {
+        auto r = bench.runMove(move);
+        if (trace)
+            drainTrace(bench.port(), traceCursor, trace);
+        const char *unit = move.type == Move::Type::POSITION ? "deg" : "%";
+        char settle[16];
+        if (r.settled)
+            snprintf(settle, sizeof(settle), "%u ms", (unsigned)r.settleMs);
+        else
+            snprintf(settle, sizeof(settle), "-");
+        printf("   %-16s %8s %6.2f %-3s %6.2f %-3s", move.name, settle, r.overshoot, unit, r.steadyStateError, unit);
+        if (move.type == Move::Type::POSITION)
+            printf(" %6.2f deg", r.loadError);
+        else
+            printf(" %10s", "");
+        printf(" %6.1f ms %6.2f %%\n", r.observerLagMs, r.observerSpeedError);
+    }
+
+#if defined(LPF2_PID_PROFILE)
+    const auto &profile = bench.port().getPidProfile();
+    printf("   updateMotorPID(): %u ticks, mean %.0f cycles, max %u (%s)\n",
+           (unsigned)profile.ticks, profile.ticks ? (double)profile.cycles / profile.ticks : 0.0,
+           (unsigned)profile.maxCycles,
+#if defined(LPF2_PID_FIXED)
+           "fixed point"
+#else
+           "float"
+#endif
+    );
+#endif
+
+    if (trace)
+        fclose(trace);
+
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+    double simMs = (double)(bench.timeMs() - simStart);
+    printf("   %.0f ms simulated in %.0f ms (%.0fx real time)\n", simMs, wallMs, simMs / wallMs);
+    return 0;
+}
+
+// Step both benches on one clock for @p ms. Returns per axis when it last
+// was outside GROUP_BAND of its target, ms from the start, and the largest
+// difference of the axes' progress (fraction of the way to the target).
+static void runAxes(Bench *axes[2], Lpf2::Local::MotionGroup *group, uint32_t ms, uint32_t settleMs[2],
+                    float &maxSkew)
+{
+    const Bench::Config &config = axes[0]->config();
+    uint64_t startUs = Lpf2::Sim::Clock::nowUs();
+    uint64_t endUs = startUs + (uint64_t)ms * 1000;
+    uint64_t nextControlUs = startUs;
+    settleMs[0] = settleMs[1] = 0;
+    maxSkew = 0.0f;
+    while (Lpf2::Sim::Clock::nowUs() < endUs)
+    {
+        Lpf2::Sim::Clock::advanceUs(config.physicsStepUs);
+        axes[0]->tick();
+        axes[1]->tick();
+        uint64_t now = Lpf2::Sim::Clock::nowUs();
+        if (now < nextControlUs)
+            continue;
+        nextControlUs = now + config.controlPeriodUs;
+        if (group)
+            group->update();
+        for (int i = 0; i < 2; i++)
+        {
+            if (std::abs(GROUP_TARGETS[i] - axes[i]->plant().angleDeg()) > GROUP_BAND)
+                settleMs[i] = (uint32_t)((now - startUs) / 1000);
+        }
+        float skew = axes[0]->plant().angleDeg() / GROUP_TARGETS[0] -
+                     axes[1]->plant().angleDeg() / GROUP_TARGETS[1];
+        maxSkew = std::max(maxSkew, std::abs(skew));
+    }
+}
+
+static int runGroup(Lpf2::DeviceType type, const Options &opt)
+{
+    printf("== 2 x device 0x%02X, to %d / %d deg%s%s\n", (int)type, (int)GROUP_TARGETS[0], (int)GROUP_TARGETS[1],
+           opt.sCurve ? ", S-curve" : "", opt.model ? ", model feed-forward" : "");
+    if (!Lpf2::DeviceDescRegistry::instance().getDescriptor(type))
+    {
+        printf("   no descriptor, skipped\n");
+        return 0;
+    }
+
+    Bench::Config config;
+    config.type = type;
+    if (opt.supplyMv)
+        config.supplyMv = opt.supplyMv;
+    Lpf2::Sim::Clock::setUs(0);
+    Bench a(config), b(config);
+    Bench *axes[2] = {&a, &b};
+    uint32_t settle[2];
+    float skew;
+    runAxes(axes, nullptr, 1000, settle, skew);
+    if (!a.port().isDeviceConnected() || !b.port().isDeviceConnected())
+    {
+        printf("   handshake failed\n");
+        return 1;
+    }
+    for (Bench *axis : axes)
+    {
+        if (!opt.model && !opt.sCurve)
+            break;
+        Lpf2::Local::MotorSettings s = *axis->port().getMotorSettings();
+        if (opt.model)
+            axis->plant().model().applyFeedForward(s);
+        if (opt.sCurve)
+        {
+            s.pos_accel_mdps2 = SCURVE_ACCEL;
+            s.pos_jerk_mdps3 = SCURVE_JERK;
+        }
+        axis->port().setMotorSettings(s);
+    }
+
+    printf("   %-16s %10s %10s %8s %9s\n", "start", "axis 0", "axis 1", "spread", "max skew");
+    auto print = [](const char *name, const uint32_t settle[2], float skew)
+    {
+        printf("   %-16s %7u ms %7u ms %5u ms %7.1f %%\n", name, (unsigned)settle[0], (unsigned)settle[1],
+               (unsigned)(std::max(settle[0], settle[1]) - std::min(settle[0], settle[1])), skew * 100.0f);
+    };
+
+    for (int i = 0; i < 2; i++)
+        axes[i]->port().gotoAbsPosition(GROUP_TARGETS[i], 100, 100, Lpf2::BrakingStyle::HOLD);
+    runAxes(axes, nullptr, 2000, settle, skew);
+    print("one by one", settle, skew);
+
+    // Back to the start, then the same move as a group.
+    for (int i = 0; i < 2; i++)
+        axes[i]->port().gotoAbsPosition(0, 100, 100, Lpf2::BrakingStyle::HOLD);
+    runAxes(axes, nullptr, 2000, settle, skew);
+
+    Lpf2::Local::MotionGroup group;
+    group.add(a.port());
+    group.add(b.port());
+    uint32_t cursor[2];
+    for (int i = 0; i < 2; i++)
+    {
+        axes[i]->port().enableControlTrace(TRACE_CAPACITY);
+        cursor[i] = axes[i]->port().getControlTrace()->head();
+    }
+    uint64_t startUs = Lpf2::Sim::Clock::nowUs();
+    if (group.moveTo({GROUP_TARGETS[0], GROUP_TARGETS[1]}, 100) != 0)
+    {
+        printf("   MotionGroup::moveTo() failed\n");
+        return 1;
+    }
+    runAxes(axes, &group, 2000, settle, skew);
+    print("MotionGroup", settle, skew);
+
+    // The same band on each axis' profile, from the ticks' reference
+    // position: where the axes would settle on the plan.
+    uint32_t planned[2] = {0, 0};
+    for (int i = 0; i < 2; i++)
+    {
+        axes[i]->port().getControlTrace()->forEach(cursor[i], [&](uint32_t, const Lpf2::Local::ControlTrace::Record &r)
+        {
+            if (std::abs(GROUP_TARGETS[i] - r.rampMdeg / 1000.0) > GROUP_BAND)
+                planned[i] = (uint32_t)((r.timeUs - startUs) / 1000);
+        });
+    }
+    print("profile", planned, 0.0f);
+    printf("   planned duration %u ms\n", (unsigned)group.durationMs());
+    return 0;
+}
+
+// --hold: friction of the simulated unit relative to the one the type's
+// MotorSettings assume, and the move that is repeated.
+static const float HOLD_FRICTION[] = {0.6f, 1.0f, 1.4f};
+static const Move HOLD_MOVES[2] = {
+    {"to 30", Move::Type::POSITION, 30, 50, 100, 1500, 2.0f},
+    {"to 0", Move::Type::POSITION, 0, 50, 100, 1500, 2.0f},
+};
+static constexpr int HOLD_LEARN_MOVES = 20; // before counting
+static constexpr int HOLD_COUNT_MOVES = 20;
+
+static int runHold(Lpf2::DeviceType type, const Options &opt)
+{
+    printf("== device 0x%02X, hunting in HOLD after %d moves, %d more counted\n", (int)type, HOLD_LEARN_MOVES,
+           HOLD_COUNT_MOVES);
+    const Lpf2::Local::MotorSettings *settings = Lpf2::Local::lookupMotorSettings(type);
+    if (!Lpf2::DeviceDescRegistry::instance().getDescriptor(type) || !settings)
+    {
+        printf("   no descriptor, skipped\n");
+        return 0;
+    }
+    printf("   %-9s %-9s %10s %10s %14s\n", "friction", "comp", "reversals", "ss error", "breakaway/floor");
+
+    for (float friction : HOLD_FRICTION)
+    {
+        for (bool adapt : {false, true})
+        {
+            Lpf2::Sim::MotorModel model = Lpf2::Sim::MotorModel::fromSettings(*settings);
+            model.coulomb_nm *= friction;
+            model.stiction_nm *= friction;
+            Bench::Config config;
+            config.type = type;
+            config.model = &model;
+            if (opt.supplyMv)
+                config.supplyMv = opt.supplyMv;
+            Lpf2::Sim::Clock::setUs(0);
+            Bench bench(config);
+            if (!bench.connect())
+            {
+                printf("   handshake failed\n");
+                return 1;
+            }
+            bench.port().setFrictionAdaptation(adapt);
+
+            uint32_t reversals = 0;
+            float ssError = 0.0f;
+            for (int i = 0; i < HOLD_LEARN_MOVES + HOLD_COUNT_MOVES; i++)
+            {
+                auto r = bench.runMove(HOLD_MOVES[i % 2]);
+                if (i < HOLD_LEARN_MOVES)
+                    continue;
+                reversals += r.reversals;
+                ssError += r.steadyStateError / HOLD_COUNT_MOVES;
+            }
+            auto e = bench.port().getFrictionEstimate();
+            printf("   %7.0f %%  %-9s %10u %6.2f deg %6.1f / %4.1f %%\n", friction * 100.0f,
+                   adapt ? "adaptive" : "fixed", (unsigned)reversals, ssError, e.breakawayPct, e.kineticFloorPct);
+        }
+    }
+    return 0;
+}
+
+// --queue: the path, relative degrees at pct of rated speed, and how often
+// the polling application checks whether the port is idle.
+static const struct
+{
+    uint32_t degrees;
+    int8_t speed;
+} QUEUE_PATH[] = {{90, 50}, {180, 80}, {90, 40}, {90, 50}};
+static constexpr uint32_t QUEUE_POLL_MS = 10;
+static constexpr uint32_t QUEUE_TIMEOUT_MS = 10000;
+
+static int runQueue(Lpf2::DeviceType type, const Options &opt)
+{
+    printf("== device 0x%02X, path of %u moves\n", (int)type, (unsigned)(sizeof(QUEUE_PATH) / sizeof(QUEUE_PATH[0])));
+    if (!Lpf2::DeviceDescRegistry::instance().getDescriptor(type))
+    {
+        printf("   no descriptor, skipped\n");
+        return 0;
+    }
+    printf("   %-12s %9s %11s %10s %9s\n", "start", "duration", "min speed", "end error", "callbacks");
+
+    constexpr size_t n = sizeof(QUEUE_PATH) / sizeof(QUEUE_PATH[0]);
+    int32_t total = 0;
+    for (const auto &seg : QUEUE_PATH)
+        total += (int32_t)seg.degrees;
+
+    for (const char *mode : {"polled", "queued", "blended"})
+    {
+        Bench::Config config;
+        config.type = type;
+        if (opt.supplyMv)
+            config.supplyMv = opt.supplyMv;
+        Lpf2::Sim::Clock::setUs(0);
+        Bench bench(config);
+        if (!bench.connect())
+        {
+            printf("   handshake failed\n");
+            return 1;
+        }
+        Lpf2::Local::Port &port = bench.port();
+        port.presetEncoder(0);
+
+        bool polled = strcmp(mode, "polled") == 0;
+        size_t done = 0, next = 0;
+        auto onDone = [&done](const Lpf2::Local::MotionSegment &, Lpf2::Local::MotionResult result)
+        {
+            if (result == Lpf2::Local::MotionResult::COMPLETED)
+                done++;
+        };
+        if (!polled)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                Lpf2::Local::MotionSegment seg;
+                seg.type = Lpf2::Local::MotionSegment::Type::SPEED_FOR_DEGREES;
+                seg.value = (int32_t)QUEUE_PATH[i].degrees;
+                seg.speed = QUEUE_PATH[i].speed;
+                seg.blend = strcmp(mode, "blended") == 0 && i + 1 < n;
+                seg.onDone = onDone;
+                port.queueMotion(seg);
+            }
+        }
+
+        // Slowest speed between the first move getting up to speed and the
+        // last one starting: 0 where the path stops between moves.
+        float minSpeed = 1000.0f;
+        bool moving = false;
+        uint32_t t = 0;
+        for (; t < QUEUE_TIMEOUT_MS && done < n; t++)
+        {
+            if (polled && t % QUEUE_POLL_MS == 0 && (port.getMotionFeedback() & Lpf2::FEEDBACK_IDLE))
+            {
+                if (next > 0)
+                    done++;
+                if (next < n)
+                {
+                    port.startSpeedForDegrees(QUEUE_PATH[next].degrees, QUEUE_PATH[next].speed);
+                    next++;
+                }
+            }
+            bench.run(1);
+            float speed = std::abs(bench.speedPct());
+            if (speed >= 0.8f * QUEUE_PATH[0].speed)
+                moving = true;
+            if (moving && done < n - 1)
+                minSpeed = std::min(minSpeed, speed);
+        }
+        float err = std::abs((float)port.getObservedAngleMdeg() / 1000.0f - (float)total);
+        printf("   %-12s %6u ms %8.1f %% %6.2f deg %9u\n", mode, (unsigned)t, minSpeed, err,
+               polled ? 0u : (unsigned)done);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    lpf2_log_init();
+    lpf2_set_runtime_log_level(LPF2_LOG_LEVEL_WARN);
+    Lpf2::DeviceDescRegistry::registerDefault();
+
+    Options opt;
+    int arg = 1;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++)
+    {
+        if (strcmp(argv[arg], "--autotune") == 0)
+            opt.autoTune = true;
+        else if (strcmp(argv[arg], "--heavy") == 0)
+            opt.heavy = true;
+        else if (strcmp(argv[arg], "--scurve") == 0)
+            opt.sCurve = true;
+        else if (strcmp(argv[arg], "--group") == 0)
+            opt.group = true;
+        else if (strcmp(argv[arg], "--model") == 0)
+            opt.model = true;
+        else if (strcmp(argv[arg], "--supply") == 0 && arg + 1 < argc)
+            opt.supplyMv = (uint16_t)strtol(argv[++arg], nullptr, 0);
+        else if (strcmp(argv[arg], "--trace") == 0 && arg + 1 < argc)
+            opt.tracePrefix = argv[++arg];
+        else if (strcmp(argv[arg], "--hold") == 0)
+            opt.hold = true;
+        else if (strcmp(argv[arg], "--queue") == 0)
+            opt.queue = true;
+        else
+        {
+            printf("unknown option %s\n", argv[arg]);
+            return 1;
+        }
+    }
+
+    auto run = opt.queue ? runQueue : opt.hold ? runHold : opt.group ? runGroup : runBench;
+    if (arg < argc)
+    {
+        return run((Lpf2::DeviceType)strtol(argv[arg], nullptr, 0), opt);
+    }
+
+    int rc = 0;
+    for (auto type : MOTORS)
+    {
+        rc |= run(type, opt);
+    }
+    return rc;
+}
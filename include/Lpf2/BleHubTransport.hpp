@@ -0,0 +1,51 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/HubTransport.hpp"
+#include "NimBLEDevice.h"
+
+namespace Lpf2
+{
+    /**
+     * @brief HubTransport over the LWP characteristic of a connected hub,
+     * used by Hub::connectHub().
+     */
+    class BleHubTransport : public HubTransport
+    {
+    public:
+        /**
+         * @brief Subscribe to the notifications of @p characteristic, frames
+         * are delivered from the NimBLE task.
+         * @returns false if the characteristic cannot notify
+         */
+        bool begin(NimBLERemoteCharacteristic *characteristic);
+        void end();
+
+        bool write(const uint8_t *data, size_t length) override;
+        void idle(uint32_t ms) override;
+
+        /**
+         * @brief The interval negotiated for the connection.
+         */
+        uint32_t connectionIntervalUs() override;
+
+    private:
+        NimBLERemoteCharacteristic *m_characteristic = nullptr;
+    };
+}; // namespace Lpf2
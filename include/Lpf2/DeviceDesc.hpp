@@ -31,5 +31,16 @@ namespace Lpf2
         Version fwVersion = {};
         Version hwVersion = {};
         std::vector<Mode> modes;
+
+        /**
+         * @brief true if this describes a device of @p deviceType reporting
+         * @p fw and @p hw, a zero version in the descriptor matches any.
+         */
+        bool matches(DeviceType deviceType, const Version &fw, const Version &hw) const
+        {
+            return deviceType == type &&
+                   (fwVersion == Version() || fwVersion == fw) &&
+                   (hwVersion == Version() || hwVersion == hw);
+        }
     };
 }; // namespace Lpf2
\ No newline at end of file
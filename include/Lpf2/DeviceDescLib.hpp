@@ -19,6 +19,7 @@
 
 #include "Lpf2/config.hpp"
 #include "Lpf2/DeviceDesc.hpp"
+#include <cassert>
 
 namespace Lpf2
 {
@@ -75,6 +76,22 @@ namespace Lpf2
             return nullptr;
         }
 
+        /**
+         * @brief The first descriptor of @p type that matches the versions the
+         * device reported (DeviceDescriptor::matches()), nullptr if none does.
+         */
+        const DeviceDescriptor *getDescriptor(DeviceType type, const Version &fw, const Version &hw)
+        {
+            for (size_t i = 0; i < m_descriptorCount; i++)
+            {
+                if (m_descriptors[i]._type == type && m_descriptors[i]._desc->matches(type, fw, hw))
+                {
+                    return m_descriptors[i]._desc;
+                }
+            }
+            return nullptr;
+        }
+
         size_t count() const
         {
             return m_descriptorCount;
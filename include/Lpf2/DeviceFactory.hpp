@@ -2,6 +2,7 @@
 #include "Lpf2/config.hpp"
 #include "Lpf2/Port.hpp"
 #include <map>
+#include <cassert>
 
 namespace Lpf2
 {
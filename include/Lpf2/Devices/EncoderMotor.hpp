@@ -104,15 +104,15 @@ namespace Lpf2::Devices
 
         /**
          * @brief get absolute position of the encoder
-         * @returns absolute position of the encoder
+         * @returns absolute position of the encoder in degrees
          */
-        virtual float getAbsPosition() = 0;
+        virtual int32_t getAbsPosition() = 0;
 
         /**
          * @brief get speed measured by the encoder
-         * @returns speed measured by the encoder
+         * @returns speed measured by the encoder, -100..100 (% of rated speed)
          */
-        virtual float getSpeed() = 0;
+        virtual int8_t getSpeed() = 0;
     };
 
     class EncoderMotor : public PortDevice, public EncoderMotorControl, public BasicMotorControl
@@ -213,15 +213,15 @@ namespace Lpf2::Devices
 
         /**
          * @brief get absolute position of the encoder
-         * @returns absolute position of the encoder
+         * @returns absolute position of the encoder in degrees
          */
-        float getAbsPosition() override;
+        int32_t getAbsPosition() override;
 
         /**
          * @brief get speed measured by the encoder
-         * @returns speed measured by the encoder
+         * @returns speed measured by the encoder, -100..100 (% of rated speed)
          */
-        float getSpeed() override;
+        int8_t getSpeed() override;
     };
 
     class EncoderMotorFactory : public DeviceFactory
@@ -0,0 +1,140 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include "Lpf2/DeviceDesc.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Lpf2
+{
+    /**
+     * @brief Where a DiscoveryCache keeps its data, one blob per hub.
+     */
+    class CacheStorage
+    {
+    public:
+        virtual ~CacheStorage() = default;
+
+        /**
+         * @returns 0, -1 if nothing is stored under @p key
+         */
+        virtual int load(const std::string &key, std::vector<uint8_t> &data) = 0;
+
+        /**
+         * @returns 0, -1 if it could not be written
+         */
+        virtual int store(const std::string &key, const std::vector<uint8_t> &data) = 0;
+
+        virtual void erase(const std::string &key) = 0;
+    };
+
+    /**
+     * @brief CacheStorage in RAM, survives a reconnect but not a reset.
+     */
+    class MemoryCacheStorage : public CacheStorage
+    {
+    public:
+        int load(const std::string &key, std::vector<uint8_t> &data) override;
+        int store(const std::string &key, const std::vector<uint8_t> &data) override;
+        void erase(const std::string &key) override { m_blobs.erase(key); }
+
+    private:
+        std::unordered_map<std::string, std::vector<uint8_t>> m_blobs;
+    };
+
+#if !defined(LPF2_NATIVE)
+    /**
+     * @brief CacheStorage in NVS (Arduino Preferences, namespace "lpf2cache").
+     * The key is the hub id without ':' and cut to 15 characters, so a BLE
+     * address fits.
+     */
+    class PreferencesCacheStorage : public CacheStorage
+    {
+    public:
+        int load(const std::string &key, std::vector<uint8_t> &data) override;
+        int store(const std::string &key, const std::vector<uint8_t> &data) override;
+        void erase(const std::string &key) override;
+    };
+#endif
+
+    /**
+     * @brief What Hub discovered about the ports of one hub (mode tables,
+     * combos, capabilities), kept as one DeviceDescriptor per port and
+     * stored in a compact binary form.
+     *
+     * Hub::setDiscoveryCache() loads the hub's entries when it connects,
+     * sets up a port from its entry if the attached device has the same
+     * type and versions, and saves once discovery is done.
+     */
+    class DiscoveryCache
+    {
+    public:
+        explicit DiscoveryCache(CacheStorage &storage) : m_storage(storage) {}
+
+        /**
+         * @brief Forget the entries and read those of @p hubId.
+         * @returns 0, -1 if nothing is stored, -2 if the stored data is
+         * unusable (it is erased)
+         */
+        int load(const std::string &hubId);
+
+        /**
+         * @brief Write the entries if they changed since load().
+         * @returns 0, -1 if the storage failed
+         */
+        int save();
+
+        /**
+         * @brief Forget the entries, stored ones included.
+         */
+        void clear();
+
+        /**
+         * @returns the entry of @p port if it describes this device, nullptr otherwise
+         */
+        const DeviceDescriptor *find(PortNum port, DeviceType type, const Version &fw, const Version &hw) const;
+
+        void put(PortNum port, const DeviceDescriptor &desc);
+
+        bool dirty() const { return m_dirty; }
+        size_t size() const { return m_entries.size(); }
+        const std::string &hubId() const { return m_hubId; }
+
+        /**
+         * @brief The binary form: "L2DC", format version, port count, then
+         * per port the port, type, versions, caps, masks, combos and modes,
+         * and an XOR checksum.
+         */
+        static void encode(const std::unordered_map<PortNum, DeviceDescriptor> &entries, std::vector<uint8_t> &out);
+
+        /**
+         * @returns 0, -1 if @p data is not a valid encoding (@p entries is
+         * left empty)
+         */
+        static int decode(const uint8_t *data, size_t length, std::unordered_map<PortNum, DeviceDescriptor> &entries);
+
+    private:
+        CacheStorage &m_storage;
+        std::string m_hubId;
+        std::unordered_map<PortNum, DeviceDescriptor> m_entries;
+        bool m_dirty = false;
+    };
+}; // namespace Lpf2
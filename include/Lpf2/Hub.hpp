@@ -20,20 +20,84 @@
 
 #include "Lpf2/config.hpp"
 #include "Lpf2/LWPConst.hpp"
-#include "Lpf2/Util/RateLimiter.hpp"
 #include "Lpf2/Remote/Port.hpp"
-
-#include "NimBLEDevice.h"
+#include "Lpf2/HubTransport.hpp"
+#include "Lpf2/DiscoveryCache.hpp"
+#include "Lpf2/Util/ByteSpan.hpp"
+#include "Lpf2/Util/PortTable.hpp"
+
+#if !defined(LPF2_NATIVE)
+#include "Lpf2/BleHubTransport.hpp"
+#endif
 #include "unordered_map"
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
 
 namespace Lpf2
 {
+    /**
+     * @brief Client side of the LEGO Wireless Protocol: connects to a hub,
+     * discovers its ports and modes and drives them through Remote::Port.
+     *
+     * The protocol logic only talks to a HubTransport. connectHub() uses the
+     * BLE transport to the hub init() found, attach() any other transport
+     * (e.g. Sim::HubLoopback on a host build).
+     */
     class Hub
     {
         friend class HubClientCallback;
         friend class Lpf2HubAdvertisedDeviceCallbacks;
         friend class Remote::Port;
+        friend class HubPool;
     private:
+        /**
+         * @brief A discovery request: HUB_ALERTS / HUB_PROPERTIES (id = alert
+         * or property, info = operation), PORT_INFORMATION_REQUEST (id =
+         * port, info = type) or PORT_MODE_INFORMATION_REQUEST (id = port).
+         */
+        struct InfoRequest
+        {
+            MessageType type;
+            uint8_t id;
+            uint8_t mode;
+            uint8_t info;
+        };
+
+        enum class InfoSlotState : uint8_t
+        {
+            FREE,
+            SENT,
+            ANSWERED,
+            FAILED,
+            RESEND
+        };
+
+        /**
+         * @brief One in-flight info request. update() fills a FREE slot and
+         * publishes it as SENT; the message handlers (the notify context)
+         * only move a SENT slot on, with a compare-exchange, after they
+         * applied the reply. `key` and `seq` are what the handlers read.
+         */
+        struct InfoSlot
+        {
+            InfoRequest request;
+            std::atomic<InfoSlotState> state{InfoSlotState::FREE};
+            std::atomic<uint32_t> key{0};
+            std::atomic<uint32_t> seq{0}; // send order, errors answer the oldest request of a type
+            uint8_t tries = 0;
+            size_t sentTime = 0;
+        };
+
+        struct PortDiscovery
+        {
+            DeviceType device;
+            uint16_t outstanding; // requests queued or in flight
+            bool check = false;  // only checking the descriptor the port was set up from
+            bool failed = false; // a request got an error or no reply
+        };
+
         void updateHubProperty(HubPropertyType propId, std::vector<uint8_t> data, bool sendUpdate);
         void sendHubPropertyUpdate(HubPropertyType propId);
         void enableHubProperty(HubPropertyType propId);
@@ -43,17 +107,56 @@ namespace Lpf2
 
         void setHubNameProp(std::string name);
 
-        void handleHubPropertyMessage(const std::vector<uint8_t> &message);
-        void handleGenericErrorMessage(const std::vector<uint8_t> &message);
-        void handleAttachedIOMessage(const std::vector<uint8_t> &message);
-        void handlePortInfoMessage(const std::vector<uint8_t> &message);
-        void handlePortModeInfoMessage(const std::vector<uint8_t> &message);
-        void handlePortInputFormatSingleMessage(const std::vector<uint8_t> &message);
-        void handlePortValueSingleMessage(const std::vector<uint8_t> &message);
-        void handlePortInputFormatCombinedModeMessage(const std::vector<uint8_t> &message);
-        void handlePortValueCombinedModeMessage(const std::vector<uint8_t> &message);
+        void handleHubPropertyMessage(Utils::ByteSpan message);
+        void handleGenericErrorMessage(Utils::ByteSpan message);
+        void handleAttachedIOMessage(Utils::ByteSpan message);
+        void handlePortInfoMessage(Utils::ByteSpan message);
+        void handlePortModeInfoMessage(Utils::ByteSpan message);
+        void handlePortInputFormatSingleMessage(Utils::ByteSpan message);
+        void handlePortValueSingleMessage(Utils::ByteSpan message);
+        void handlePortInputFormatCombinedModeMessage(Utils::ByteSpan message);
+        void handlePortValueCombinedModeMessage(Utils::ByteSpan message);
+        void handlePortOutputCommandFeedbackMessage(Utils::ByteSpan message);
 
+        /**
+         * @brief Poll the subscribed properties that are due and run the
+         * callbacks of those that changed, called from update().
+         */
+        void updatePropertySubscriptions();
+
+        /**
+         * @brief Enable or disable the hub's updates of @p prop to match its
+         * subscription, if connected.
+         */
+        void applyPropertySubscription(HubPropertyType prop);
+
+        /**
+         * @brief Discovery: reap answered and timed out requests, resend the
+         * missing ones and fill the window from the queue.
+         */
         void requestInfos();
+        void resetDiscovery();
+        void queueHubRequests();
+        void queuePortRequests(PortNum portNum);
+        void queueModeRequests(PortNum portNum);
+        void queueDescriptorCheck(PortNum portNum);
+        void finishDescriptorCheck(Remote::Port *port, const PortDiscovery &discovery);
+        void queueInfoRequest(MessageType type, uint8_t id, uint8_t mode = 0, uint8_t info = 0);
+        void sendInfoRequest(InfoSlot &slot);
+        void infoRequestDone(const InfoSlot &slot);
+
+        /**
+         * @brief Mark the in-flight request a reply answers, called from the
+         * message handlers (the notify context) once the reply is applied;
+         * update() does the rest.
+         */
+        void infoReplied(MessageType type, uint8_t id, uint8_t mode, uint8_t info);
+
+        /**
+         * @brief The hub answered the oldest in-flight request of @p type
+         * with an error, @p retry if it is worth sending again.
+         */
+        void infoFailed(MessageType type, bool retry);
 
         /**
          * @biref returns true if another request is still pending, and writes a warning message to the log.
@@ -65,31 +168,128 @@ namespace Lpf2
 
         Remote::Port *_getPort(PortNum portNum);
 
+        /**
+         * @brief Forget what is known about the device on @p port.
+         */
+        void clearPortInfo(Remote::Port *port);
+
+        /**
+         * @brief The descriptor (DeviceDescRegistry, then the discovery
+         * cache) a port with this device can be set up from, nullptr if none.
+         */
+        const DeviceDescriptor *findDescriptor(PortNum portNum, DeviceType type, const Version &fw, const Version &hw, bool *cached = nullptr);
+        DeviceDescriptor describePort(Remote::Port *port);
+
         /**
          * @brief check the lenght of a message, and prints an error to the log
          * @returns true if the message is smaller than the given length
          */
-        bool checkLenght(const std::vector<uint8_t> &message, size_t lenght);
+        bool checkLenght(Utils::ByteSpan message, size_t lenght);
 
         void onDisconnect();
+
+        /**
+         * @brief Detach if the BLE link went down (m_linkLost, set from the
+         * NimBLE task), called from update() on the task owning the state.
+         */
+        void handleLinkLoss();
+
         void writeValue(MessageType type, const std::vector<uint8_t> &data);
-        void notifyCallback(NimBLERemoteCharacteristic *pBLERemoteCharacteristic, uint8_t *pData, size_t length, bool isNotify);
+
+        /**
+         * @brief Queue a PORT_OUTPUT_COMMAND (@p payload starts with the
+         * port) for the next connection event. It replaces a queued command
+         * of the same class on the port (see outputKey()).
+         * @returns 0, -1 if the port's queue is full or the hub is not connected
+         */
+        int writeOutput(const std::vector<uint8_t> &payload);
+        void dropOutput();
+
+        /**
+         * @brief Called by the transport with every message the hub sends,
+         * dispatches it without copying.
+         */
+        void onNotify(const uint8_t *data, size_t length);
+
+        using Handler = void (Hub::*)(Utils::ByteSpan message);
+        using HandlerTable = std::array<Handler, 256>;
+
+        /**
+         * @brief Hub's own handlers, indexed by MessageType (constexpr, in Hub.cpp).
+         */
+        static const HandlerTable s_handlers;
+        void delay(uint32_t ms);
+
+#if !defined(LPF2_NATIVE)
+        /**
+         * @brief Reset the connection state and set the LWP UUIDs, before a
+         * scan (init(), HubPool::begin()).
+         */
+        void setupBle();
+
+        /**
+         * @returns true if @p device advertises the LWP service (and has the
+         * requested address, if one was given)
+         */
+        bool matchAdvertisement(const NimBLEAdvertisedDevice *device) const;
+
+        /**
+         * @brief Take the address, name and hub type from a matching advertisement.
+         */
+        void acceptAdvertisement(const NimBLEAdvertisedDevice *device);
+
+        /**
+         * @brief Connect (or reconnect) a client to the discovered hub.
+         * With @p async it returns once the connection is initiated, see
+         * NimBLEClient::connect().
+         * @returns the client, nullptr on failure
+         */
+        NimBLEClient *connectClient(bool async);
+
+        /**
+         * @brief Find the LWP characteristic on the connected @p client,
+         * attach the BLE transport and subscribe.
+         */
+        bool setupClient(NimBLEClient *client);
+#endif
 
     public:
+        /**
+         * @brief Handler of a message type, @p message is the whole message
+         * (common header included) and only valid during the call.
+         */
+        using MessageHandler = std::function<void(Utils::ByteSpan message)>;
+
         Hub();
         ~Hub();
 
+#if !defined(LPF2_NATIVE)
         void init();
         void init(uint32_t scanDuration);
         void init(std::string deviceAddress);
         void init(std::string deviceAddress, uint32_t scanDuration);
+#endif
 
         void update();
 
+        /**
+         * @brief Start talking to a hub over @p transport: discovery restarts
+         * and the hub counts as connected until detach().
+         */
+        void attach(HubTransport *transport);
+
+        /**
+         * @brief Forget the transport, the hub counts as disconnected.
+         */
+        void detach();
+
+#if !defined(LPF2_NATIVE)
         bool connectHub();
+        bool isScanning();
+        NimBLEAddress getHubAddress();
+#endif
         bool isConnected();
         bool isConnecting();
-        bool isScanning();
 
         void shutDownHub();
 
@@ -102,6 +302,125 @@ namespace Lpf2
          */
         bool infoReady();
 
+        /**
+         * @brief Handle messages of @p type with @p handler, in place of
+         * Hub's own handler if it has one. nullptr removes the handler.
+         * The handler is called from the transport's context (the NimBLE task
+         * for BLE). Register before attach() / connectHub(): the handlers
+         * cannot change while a transport is attached.
+         * @returns 0 on success, -1 while a transport is attached
+         */
+        int registerMessageHandler(MessageType type, MessageHandler handler);
+
+        /**
+         * @brief Discovery requests kept in flight at once, 1 to
+         * LPF2_HUB_INFO_WINDOW (1 asks one at a time).
+         */
+        void setInfoWindow(uint8_t window);
+        uint8_t getInfoWindow() const { return m_infoWindow; }
+
+        struct DiscoveryStats
+        {
+            uint32_t portsDiscovered = 0;      // ports set up by asking the hub
+            uint32_t infoRequests = 0;         // port and mode information requests sent, resends included
+            uint32_t portsFromDescriptor = 0;  // ports set up from a DeviceDescRegistry descriptor
+            uint32_t portsFromCache = 0;       // ports set up from the discovery cache
+            uint32_t requestsAvoided = 0;      // requests discovering those ports would have sent
+            uint32_t descriptorChecks = 0;     // background checks sent
+            uint32_t descriptorMismatches = 0; // checks that sent the port to discovery
+        };
+
+        /**
+         * @brief Keep what discovery finds in @p cache (nullptr: none): it is
+         * loaded for the hub id on attach(), ports whose device matches an
+         * entry skip discovery, and it is saved once discovery is done.
+         */
+        void setDiscoveryCache(DiscoveryCache *cache) { m_discoveryCache = cache; }
+
+        /**
+         * @brief The key of the hub in the discovery cache, connectHub() sets
+         * it to the hub's BLE address. Set it before attach() for any other
+         * transport.
+         */
+        void setHubId(const std::string &id) { m_hubId = id; }
+        const std::string &getHubId() const { return m_hubId; }
+
+        /**
+         * @brief Sample one mode (the NAME of the highest) of every port set
+         * up from a descriptor or the discovery cache, in the background, and discover the port if
+         * the hub disagrees. Off by default.
+         */
+        void setDescriptorCheck(bool enable) { m_descriptorCheck = enable; }
+
+        const DiscoveryStats &getDiscoveryStats() const { return m_discoveryStats; }
+        void resetDiscoveryStats() { m_discoveryStats = DiscoveryStats(); }
+
+        /**
+         * @brief Queue the output commands of the ports (motor speed, power,
+         * writeData() ...) and send them once per connection event
+         * (HubTransport::connectionIntervalUs()) from update(), a newer
+         * command replacing a queued one of the same class: the same
+         * sub command, or for writeData() the same mode. Relative moves
+         * (startSpeedForTime(), startSpeedForDegrees()) never replace each
+         * other. On by default, off writes every command right away.
+         */
+        void setOutputCoalescing(bool enable);
+
+        /**
+         * @brief Send the queued output commands now.
+         */
+        void flushOutput();
+
+        struct OutputStats
+        {
+            uint32_t commands = 0;  // output commands the ports issued
+            uint32_t sent = 0;      // written to the transport
+            uint32_t coalesced = 0; // replaced by a newer one before being sent
+            uint32_t dropped = 0;   // not sent: the queue was full, or the hub disconnected
+            uint32_t flushes = 0;   // connection events that sent commands
+        };
+
+        const OutputStats &getOutputStats() const { return m_outputStats; }
+        void resetOutputStats() { m_outputStats = OutputStats(); }
+
+        /**
+         * @brief Called from update() with the value of a hub property (the
+         * bytes after the operation), only valid during the call.
+         */
+        using PropertyCallback = std::function<void(HubPropertyType prop, Utils::ByteSpan value)>;
+
+        /**
+         * @brief Keep @p prop up to date. Discovery reads every property
+         * once; only subscribed properties are updated after that. With
+         * @p intervalMs 0 the hub's updates are enabled and the hub sends the
+         * value whenever it changes (ADVERTISING_NAME, BUTTON, RSSI and
+         * BATTERY_VOLTAGE only). Otherwise the property is requested every
+         * @p intervalMs once discovery is done. @p callback runs when the
+         * value moved by at least @p threshold (dBm for RSSI, % for the
+         * battery; any change for the other properties). The first value
+         * always calls it. Subscribing again replaces the subscription.
+         * @returns 0, -1 if @p prop is invalid or the hub cannot send its updates
+         */
+        int subscribeHubProperty(HubPropertyType prop, uint32_t intervalMs = 0, uint8_t threshold = 0, PropertyCallback callback = nullptr);
+        void unsubscribeHubProperty(HubPropertyType prop);
+
+        /**
+         * @returns the messages of @p type received since the last
+         * resetMessageStats(), counted in the transport's context
+         */
+        uint32_t getMessageCount(MessageType type) const { return m_messageCounts[(uint8_t)type]; }
+
+        /**
+         * @returns the bytes (headers included) of the messages of @p type received
+         */
+        uint32_t getMessageBytes(MessageType type) const { return m_messageBytes[(uint8_t)type]; }
+
+        /**
+         * @returns the HUB_PROPERTIES updates of @p prop received
+         */
+        uint32_t getPropertyUpdateCount(HubPropertyType prop) const { return prop < HubPropertyType::END ? m_propertyUpdates[(uint8_t)prop] : 0; }
+        void resetMessageStats();
+
         /**
          * @brief returns all available information sent by the hub (Hub properties, port modes ...)
          */
@@ -109,26 +428,23 @@ namespace Lpf2
         std::string getHubPropStr(HubPropertyType propId);
         static std::string getHubPropStr(HubPropertyType propId, std::vector<uint8_t> prop);
 
+        /**
+         * @brief Buffer versions of getAllInfoStr() / getHubPropStr(), they never allocate.
+         * snprintf() semantics: at most @p size bytes are written (NUL-terminated),
+         * the return value is the length of the full output.
+         */
+        size_t getAllInfoStr(char *buf, size_t size);
+        size_t getHubPropStr(char *buf, size_t size, HubPropertyType propId);
+        static size_t getHubPropStr(char *buf, size_t size, HubPropertyType propId, const uint8_t *prop, size_t len);
+
         std::string getName();
         BatteryType getBatteryType();
-        NimBLEAddress getHubAddress();
         HubType getHubType();
         void setName(std::string name);
 
     private:
-        std::unordered_map<PortNum, Remote::Port *> m_remotePorts;
-        std::unordered_map<PortNum, DeviceType> m_attachedPortsDevice; // Ports with attached devices
-
         std::vector<uint8_t> m_hubProperty[(unsigned int)HubPropertyType::END];
 
-        enum class DataRequestingState
-        {
-            HUB_ALERTS,
-            HUB_PROP,
-            PORT_INFO,
-            PORT_MODE
-        };
-
         class PendingRequest
         {
         public:
@@ -137,19 +453,24 @@ namespace Lpf2
             MessageType msgType;
         } m_pendingRequest;
 
+        HubTransport *m_transport = nullptr;
+
+#if !defined(LPF2_NATIVE)
         BLEUUID m_bleHubServiceUuid;
         BLEUUID m_bleHubCharachteristicUuid;
         BLEAddress *m_bleServerAddress = nullptr;
         BLEAddress *m_bleRequestedDeviceAddress = nullptr;
-        BLERemoteCharacteristic *m_bleHubCharacteristic = nullptr;
         BLEScan *m_bleScan = nullptr;
         NimBLEScanCallbacks *m_bleAdvertiseDeviceCallback = nullptr;
-    
+        BleHubTransport m_bleTransport;
+
         uint32_t m_bleScanDuration = 10;
+#endif
         bool m_connecting = false;
         bool m_connected = false;
+        std::atomic<bool> m_linkLost{false}; // set by the BLE disconnect callback, handled by update()
 
-        HubType m_hubType;
+        HubType m_hubType = HubType::UNKNOWNHUB;
 
         struct PortInputFormatSingle
         {
@@ -159,27 +480,101 @@ namespace Lpf2
             bool notify;
         };
 
-        std::unordered_map<PortNum, PortInputFormatSingle> m_portInputFormatMap;
-
         struct PortCombinedFormat {
             uint8_t comboIndex;
             std::vector<uint8_t> nibblePairs;
         };
-        std::unordered_map<PortNum, PortCombinedFormat> m_portCombinedFormatMap;
 
-        struct
+        /**
+         * @brief A PORT_OUTPUT_COMMAND waiting for the next connection event.
+         */
+        struct OutputCommand
         {
-            union
-            {
-                HubPropertyType propId;
-                PortNum portNum;
-            };
-            uint8_t mode;
-            uint8_t info;
-            DataRequestingState state;
-            bool finishedRequests = false;
-        } m_dataRequestState;
+            int16_t key = -1; // commands of a port with the same key replace each other, -1: never
+            std::vector<uint8_t> payload;
+        };
+
+        /**
+         * @brief Everything Hub keeps about one port, created when the hub
+         * first mentions the port.
+         */
+        struct PortState
+        {
+            explicit PortState(Hub *hub) : port(hub) {}
+
+            Remote::Port port;
+            DeviceType attached = DeviceType::UNKNOWNDEVICE; // device of the last ATTACHED_IO
+            bool hasInputFormat = false;
+            PortInputFormatSingle inputFormat;
+            bool hasCombinedFormat = false;
+            PortCombinedFormat combinedFormat;
+            OutputCommand output[LPF2_HUB_OUTPUT_QUEUE]; // oldest first, the buffers are reused
+            uint8_t outputCount = 0;
+        };
+        Utils::PortTable<PortState> m_ports;
+
+        PortState &_getPortState(PortNum portNum);
+
+        std::deque<InfoRequest> m_infoQueue;
+        InfoSlot m_infoSlots[LPF2_HUB_INFO_WINDOW];
+        uint8_t m_infoWindow = LPF2_HUB_INFO_WINDOW;
+        uint32_t m_infoSeq = 0;
+        std::unordered_map<PortNum, PortDiscovery> m_portDiscovery;
+        bool m_descriptorCheck = false;
+        DiscoveryStats m_discoveryStats;
+        DiscoveryCache *m_discoveryCache = nullptr;
+        std::string m_hubId;
+
+        bool m_outputCoalescing = true;
+        uint32_t m_outputQueued = 0; // commands in the ports' output queues
+        uint64_t m_lastFlushUs = 0;
+        OutputStats m_outputStats;
+
+        struct PropertySubscription
+        {
+            bool active = false;
+            bool enabled = false; // the hub's updates are enabled
+            uint32_t intervalMs = 0;
+            uint8_t threshold = 0;
+            PropertyCallback callback;
+            uint64_t lastPoll = 0;
+            bool hasLast = false;
+            uint8_t lastLength = 0;
+            uint8_t last[LPF2_HUB_PROPERTY_SIZE] = {}; // value of the last callback
+        };
+
+        /**
+         * @brief A property value handed from the notify context to
+         * update(): the writer makes seq odd while it copies, the reader
+         * retries if seq changed or was odd during its copy.
+         */
+        struct PropertySlot
+        {
+            std::atomic<uint32_t> seq{0}; // 0: no value yet
+            std::atomic<uint8_t> length{0};
+            std::atomic<uint8_t> data[LPF2_HUB_PROPERTY_SIZE] = {};
+        };
+
+        /**
+         * @brief Store @p value in the property's slot, from the notify context.
+         */
+        void storeProperty(uint8_t prop, Utils::ByteSpan value);
+
+        /**
+         * @brief Copy the property's slot to @p out (LPF2_HUB_PROPERTY_SIZE bytes).
+         * @returns the length, -1 if a write kept overlapping the copy
+         */
+        int loadProperty(uint8_t prop, uint8_t *out) const;
+
+        PropertySubscription m_propSubs[(unsigned int)HubPropertyType::END];
+        PropertySlot m_propSlots[(unsigned int)HubPropertyType::END];
+        std::atomic<uint32_t> m_propChanged{0}; // properties updated since the last update(), by bit
+
+        uint32_t m_messageCounts[256] = {};
+        uint32_t m_messageBytes[256] = {};
+        uint32_t m_propertyUpdates[(unsigned int)HubPropertyType::END] = {};
 
-        Utils::RateLimiter m_rateLimiter;
+        std::vector<std::pair<uint8_t, MessageHandler>> m_customHandlers;
+        uint32_t m_customTypes[8] = {}; // bitmap of the types in m_customHandlers
     };
 }; // namespace Lpf2
\ No newline at end of file
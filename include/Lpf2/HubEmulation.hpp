@@ -19,9 +19,12 @@
 
 #include "Lpf2/config.hpp"
 #include "Lpf2/LWPConst.hpp"
+#include "Lpf2/Util/PortTable.hpp"
 #include <NimBLEDevice.h>
 #include <unordered_map>
 #include <list>
+#include <atomic>
+#include <memory>
 
 namespace Lpf2
 {
@@ -70,19 +73,12 @@ namespace Lpf2
 
         HubType m_hubType = HubType::UNKNOWNHUB;
 
-        std::unordered_map<PortNum, Port*> m_attachedPorts;
         /**
          * @brief ports that are owned by this class, they will be destructed in the destructor.
          */
         std::unordered_map<PortNum, Virtual::Port*> m_ownedPorts;
         std::vector<Virtual::GenericDevice*> m_ownedDevices;
 
-        /**
-         * @brief a map that contains if a port has a device attached,
-         * used to determine when to send IO attached/detached messages
-         */
-        std::unordered_map<PortNum, bool> m_connectedDevices;
-
         bool m_useBuiltInDevices = false;
 
         bool m_updateHubPropertyEnabled[(unsigned int)HubPropertyType::END] = {false};
@@ -107,10 +103,13 @@ namespace Lpf2
             uint32_t delta;
             bool notify;
 
-            std::vector<uint8_t> lastRaw;
+            // Port::subscribe() ids, one per dataset of the mode
+            std::vector<int> subscriptions;
+            // No free subscription slot: checkPort() compares the values
+            // (polledLast, one per dataset) itself.
+            bool polled = false;
+            std::vector<float> polledLast;
         };
-        // map<PortNum, map<ModeNum, Setup>>
-        std::unordered_map<PortNum, std::unordered_map<uint8_t, PortInputSetupSingle>> m_portSetupSingle;
 
         struct PortInputSetupCombined
         {
@@ -123,11 +122,54 @@ namespace Lpf2
             std::vector<uint8_t> modeDatasetPairs;
             // per-pair delta thresholds (same order as modeDatasetPairs)
             std::vector<float> deltas;
-            // per-mode snapshot of rawData used for delta comparisons
-            std::unordered_map<uint8_t, std::vector<uint8_t>> lastRawPerMode;
+            // Port::subscribe() ids, one per pair (multi-update only)
+            std::vector<int> subscriptions;
+            // No free subscription slot: checkPort() compares the values
+            // (polledLast, one per pair) itself.
+            bool polled = false;
+            std::vector<float> polledLast;
+        };
+
+        /**
+         * @brief Set by the port's value subscriptions (on the port's task),
+         * consumed by checkPort().
+         */
+        struct PortValuePending
+        {
+            std::atomic<uint16_t> singleModes{0}; // bitmask of modes with a value to send
+            std::atomic<bool> combined{false};
+        };
+
+        /**
+         * @brief Everything kept about one attached port. Created by
+         * attachPort() and kept as long as this object, the subscriptions
+         * capture its address.
+         */
+        struct PortState
+        {
+            Port *port = nullptr;
+            bool deviceConnected = false; // last state reported (IO attached / detached)
+            uint16_t singleModes = 0;     // modes with a setup in single
+            PortInputSetupSingle single[16];
+            bool hasCombined = false;
+            PortInputSetupCombined combined;
+            PortValuePending pending;
         };
-        // map<PortNum, active combined setup>
-        std::unordered_map<PortNum, PortInputSetupCombined> m_portSetupCombined;
+        Utils::PortTable<PortState> m_ports;
+
+        /**
+         * @returns the state of @p portNum if a port is attached there, nullptr otherwise
+         */
+        PortState *attachedPort(PortNum portNum) const;
+        void clearPortSetups(PortState &state);
+
+        void unsubscribeAll(Port *port, std::vector<int> &subscriptions);
+
+        /**
+         * @returns true if the dataset moved by @p delta since @p last (any
+         * change for 0), @p last is updated then
+         */
+        static bool pollMoved(Port *port, uint8_t modeNum, uint8_t dataSet, float delta, float &last);
 
         void sendHubAlertUpdate(HubAlertType alert);
         void resetHubAlerts();
@@ -139,9 +181,9 @@ namespace Lpf2
         void handlePortInputFormatSetupCombinedMessage(std::vector<uint8_t> message);
         void handlePortOutputCommandMessage(std::vector<uint8_t> message);
 
-        void checkPort(PortNum portNum, Port* port);
-        void checkPortModeValueSingle(PortInputSetupSingle &setup, Port* port);
-        void checkPortModeValueCombined(PortInputSetupCombined &setup, Port* port);
+        void checkPort(PortNum portNum, PortState &state);
+        void checkPortModeValueSingle(PortState &state, PortInputSetupSingle &setup);
+        void checkPortModeValueCombined(PortState &state);
 
         void sendPortValueSingle(PortInputSetupSingle &setup, Port* port);
         void sendPortValueCombined(PortInputSetupCombined &setup, Port* port);
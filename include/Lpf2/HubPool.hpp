@@ -0,0 +1,193 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include "Lpf2/Hub.hpp"
+#include <atomic>
+#include <string>
+
+namespace Lpf2
+{
+    /**
+     * @brief Runs several Hub instances from one controller: one BLE scan
+     * matches the advertisements to the hubs still waiting, the links are
+     * set up one after the other without waiting for the discovery of the
+     * ones before, and service() updates every hub from one task.
+     *
+     * Bring-up takes about the time of the slowest hub's discovery plus a
+     * link setup per hub, instead of the sum of all discoveries. The hubs
+     * are owned by the application and must outlive the pool; do not call
+     * their init(), connectHub() or update() while the pool runs them.
+     */
+    class HubPool
+    {
+    public:
+        enum class SlotState : uint8_t
+        {
+            WAITING,    // no advertisement matched yet
+            MATCHED,    // address known, waiting for its turn to connect
+            CONNECTING, // link being established
+            CONNECTED,  // discovery running
+            READY,      // Hub::infoReady()
+        };
+
+        /**
+         * @brief Bring-up and service times of one hub.
+         */
+        struct SlotStats
+        {
+            uint32_t connects = 0;        // links set up
+            uint32_t connectFailures = 0; // connection attempts that failed or timed out
+            uint32_t disconnects = 0;
+            uint32_t connectMs = 0;       // begin() (or the disconnect) to the link being up, last time
+            uint32_t readyMs = 0;         // begin() (or the disconnect) to Hub::infoReady(), last time
+            uint64_t serviceUs = 0;       // time spent in the hub's update()
+            uint32_t maxServiceUs = 0;    // longest single update()
+        };
+
+        struct Stats
+        {
+            uint32_t scans = 0;          // scans started
+            uint32_t advertisements = 0; // LWP advertisements seen
+            uint32_t matched = 0;        // advertisements given to a waiting hub
+            uint32_t passes = 0;         // service() calls
+            uint32_t maxPassUs = 0;      // longest service() call
+            uint32_t bringUpMs = 0;      // begin() to every hub ready the first time, 0 until then
+        };
+
+        HubPool() = default;
+        ~HubPool();
+
+        HubPool(const HubPool &) = delete;
+        HubPool &operator=(const HubPool &) = delete;
+
+#if !defined(LPF2_NATIVE)
+        /**
+         * @brief Add a hub to be found by the pool's scan: the first LWP hub
+         * advertising with @p address, or any hub not taken by another slot
+         * if @p address is empty.
+         * @returns the slot, -1 if the pool is full
+         */
+        int addHub(Hub &hub, const std::string &address = "");
+#endif
+
+        /**
+         * @brief Add a hub reached through @p transport (e.g.
+         * Sim::HubLoopback), attached by begin().
+         * @returns the slot, -1 if the pool is full
+         */
+        int addHub(Hub &hub, HubTransport *transport);
+
+        /**
+         * @brief Attach the transport hubs and start the scan for the BLE ones.
+         * @param scanMs duration of each scan, the pool scans again while a
+         * hub is still waiting
+         */
+        void begin(uint32_t scanMs = 10000);
+
+        /**
+         * @brief One pass: bookkeeping of the scan and the connections, then
+         * Hub::update() of every connected hub, starting with a different
+         * hub each pass so none is always served last.
+         */
+        void service();
+
+#if !defined(LPF2_NATIVE)
+        /**
+         * @brief Call service() from a task of its own every @p periodMs.
+         */
+        void startTask(uint32_t periodMs = 1);
+        void stopTask();
+#endif
+
+        size_t size() const { return m_size; }
+        Hub *getHub(size_t slot) const { return slot < m_size ? m_slots[slot].hub : nullptr; }
+        SlotState getState(size_t slot) const { return m_slots[slot].state.load(std::memory_order_acquire); }
+
+        /**
+         * @returns true if every hub is connected and done with discovery
+         */
+        bool allReady() const;
+
+        const Stats &getStats() const { return m_stats; }
+        const SlotStats &getSlotStats(size_t slot) const { return m_slots[slot].stats; }
+        void resetStats();
+
+        /**
+         * @brief Hub::getDiscoveryStats() / getOutputStats() summed over the hubs.
+         */
+        Hub::DiscoveryStats getDiscoveryStats() const;
+        Hub::OutputStats getOutputStats() const;
+
+        /**
+         * @brief How long a link may take to come up before the attempt is
+         * cancelled and the hub waits for its next turn.
+         */
+        static constexpr uint32_t CONNECT_TIMEOUT_MS = 5000;
+
+    private:
+#if !defined(LPF2_NATIVE)
+        friend class HubPoolScanCallbacks;
+
+        /**
+         * @brief Give an advertisement to the first waiting hub it matches,
+         * called from the NimBLE task.
+         */
+        void onAdvertisement(const NimBLEAdvertisedDevice *device);
+        void serviceBle();
+        void startScan();
+        void startConnect(size_t slot);
+        void checkConnect(size_t slot);
+        void connectFailed(size_t slot);
+        void taskLoop();
+
+        static void taskEntry(void *param);
+#endif
+        void serviceSlot(size_t slot);
+
+        struct Slot
+        {
+            Hub *hub = nullptr;
+            HubTransport *transport = nullptr; // nullptr: BLE
+            std::atomic<SlotState> state{SlotState::WAITING};
+            uint64_t sinceUs = 0; // start of the current bring-up
+            uint64_t connectUs = 0; // start of the current connection attempt, or of the wait after a failed one
+            SlotStats stats;
+#if !defined(LPF2_NATIVE)
+            NimBLEClient *client = nullptr;
+#endif
+        };
+
+        Slot m_slots[LPF2_HUB_POOL_SIZE];
+        size_t m_size = 0;
+        size_t m_next = 0; // first slot of the next pass
+        uint64_t m_beginUs = 0;
+        Stats m_stats;
+
+#if !defined(LPF2_NATIVE)
+        uint32_t m_scanMs = 10000;
+        NimBLEScanCallbacks *m_scanCallbacks = nullptr;
+        std::atomic<uint32_t> m_advertisements{0};
+        std::atomic<uint32_t> m_matched{0};
+        TaskHandle_t m_taskHandle = nullptr;
+        uint32_t m_taskPeriodMs = 1;
+        volatile bool m_taskShouldQuit = false;
+#endif
+    };
+}; // namespace Lpf2
@@ -0,0 +1,76 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include <functional>
+
+namespace Lpf2
+{
+    /**
+     * @brief The link between Lpf2::Hub and a hub's LWP characteristic.
+     *
+     * Hub writes whole frames (common header included) with write(), the
+     * transport hands every frame the hub sends to the receiver set with
+     * setReceiver(). The BLE transport (BleHubTransport) delivers from the
+     * NimBLE task, transports that queue frames deliver them from poll().
+     */
+    class HubTransport
+    {
+    public:
+        using Receiver = std::function<void(const uint8_t *data, size_t length)>;
+
+        virtual ~HubTransport() = default;
+
+        /**
+         * @brief Send one frame to the hub.
+         * @returns false if it could not be sent
+         */
+        virtual bool write(const uint8_t *data, size_t length) = 0;
+
+        /**
+         * @brief Deliver the frames that arrived since the last call, called
+         * by Hub::update().
+         */
+        virtual void poll() {}
+
+        /**
+         * @brief Block for @p ms while frames keep being delivered (Hub waits
+         * for replies with this).
+         */
+        virtual void idle(uint32_t ms) = 0;
+
+        /**
+         * @brief Time between two connection events in µs, 0 if the link
+         * has none (Hub then sends queued output commands on every update()).
+         */
+        virtual uint32_t connectionIntervalUs() { return 0; }
+
+        void setReceiver(Receiver receiver) { m_receiver = std::move(receiver); }
+
+    protected:
+        void deliver(const uint8_t *data, size_t length)
+        {
+            if (m_receiver)
+                m_receiver(data, length);
+        }
+
+    private:
+        Receiver m_receiver;
+    };
+}; // namespace Lpf2
@@ -40,6 +40,12 @@ namespace Lpf2
         int Minor = 0;
         int Bugfix = 0;
         int Build = 0;
+
+        bool operator==(const Version &other) const
+        {
+            return Major == other.Major && Minor == other.Minor && Bugfix == other.Bugfix && Build == other.Build;
+        }
+        bool operator!=(const Version &other) const { return !(*this == other); }
     };
 
     enum class HubType
@@ -312,6 +318,26 @@ namespace Lpf2
         WRITE_DIRECT_MODE = 0x51
     };
 
+    // Startup and completion byte of a port output command: startup in the
+    // high nibble, completion in the low one.
+    enum StartupAndCompletion : uint8_t
+    {
+        STARTUP_BUFFER = 0x00,    // buffer if necessary
+        STARTUP_IMMEDIATE = 0x10, // discard the current and buffered commands
+        COMPLETION_NONE = 0x00,
+        COMPLETION_FEEDBACK = 0x01,
+    };
+
+    // Bits of a PORT_OUTPUT_COMMAND_FEEDBACK message.
+    enum PortOutputFeedback : uint8_t
+    {
+        FEEDBACK_BUFFER_EMPTY_IN_PROGRESS = 0x01,
+        FEEDBACK_BUFFER_EMPTY_COMPLETED = 0x02,
+        FEEDBACK_DISCARDED = 0x04,
+        FEEDBACK_IDLE = 0x08,
+        FEEDBACK_BUSY_FULL = 0x10,
+    };
+
     enum class DuploTrainBaseSound
     {
         BRAKE = 3,
@@ -513,4 +539,10 @@ namespace Lpf2
     using AccelerationProfile = uint8_t;
 
     using ValueChangeCallback = std::function<void(uint8_t modeNum)>;
+
+    /**
+     * @brief Callback of a value subscription (see Port::subscribe()).
+     * @param value the decoded value, same as getValue(modeNum, dataSet)
+     */
+    using ValueSubscriber = std::function<void(uint8_t modeNum, uint8_t dataSet, float value)>;
 }; // namespace Lpf2
\ No newline at end of file
@@ -0,0 +1,152 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+
+namespace Lpf2::Local
+{
+    struct MotorSettings;
+
+    struct AutoTuneConfig
+    {
+        uint8_t maxPower = 70;       // power of the high step, pct
+        float rampPctPerS = 10.0f;   // friction ramp slope
+        float bandwidthHz = 3.0f;    // target closed-loop bandwidth (capped by the measured dead time)
+        uint32_t stepMs = 500;       // length of each step of the step response, max 800
+        int32_t travelLimitDeg = 0;  // abort if the motor gets further than this from the start, 0 = no limit
+    };
+
+    struct AutoTuneResult
+    {
+        float breakaway_pct = 0.0f;     // power at which the motor started to turn (max of both directions)
+        float kinetic_floor_pct = 0.0f; // power at which it stopped again (mean of both directions)
+        float gain = 0.0f;              // speed pct per power pct
+        float timeConstantMs = 0.0f;
+        float deadTimeMs = 0.0f;
+        uint16_t supplyMv = 0;          // battery voltage during the run, the gains are only valid around it
+
+        float speed_ksp = 0.0f;
+        float speed_ksi = 0.0f;
+        float pos_kp = 0.0f;
+        float pos_kd = 0.0f;
+    };
+
+    /**
+     * @brief Motor auto-tuning state machine, stepped by Local::Port::updateMotorPID().
+     *
+     * 1. Friction: slow power ramp in each direction. The power at which the
+     *    motor starts to turn is the breakaway, the power at which it stops
+     *    again on the way down is the kinetic floor.
+     * 2. Plant: a step between two powers above the kinetic floor, in each
+     *    direction. The speed response gives the gain, the time constant and
+     *    the dead time (two-point method, 28% / 63% of the step).
+     * 3. Gains: IMC PI for the speed loop, PD with the derivative cancelling
+     *    the plant pole for the fine position loop, both for the target
+     *    bandwidth.
+     *
+     * The motor must be free to turn: a run takes a few seconds and up to
+     * about two turns each way (see AutoTuneConfig::travelLimitDeg).
+     */
+    class AutoTuner
+    {
+    public:
+        enum class State : uint8_t
+        {
+            IDLE,
+            RUNNING,
+            DONE,
+            FAILED,
+        };
+
+        /**
+         * @param ratedMaxSpeed deg/s, MotorSettings::rated_max_speed
+         */
+        void start(const AutoTuneConfig &config, int32_t ratedMaxSpeed, uint64_t nowMs, int64_t angleMdeg);
+
+        /**
+         * @brief Advance by one control tick.
+         * @param speedPct speed reported by the motor, pct of rated
+         * @returns power to apply, pct. Check state() afterwards, 0 once it is not RUNNING.
+         */
+        float step(uint64_t nowMs, int64_t angleMdeg, float speedPct, uint16_t supplyMv);
+
+        void abort();
+
+        State state() const { return m_state; }
+        bool running() const { return m_state == State::RUNNING; }
+        const AutoTuneResult &result() const { return m_result; }
+
+        /**
+         * @brief Write the identified friction floors and gains into @p settings.
+         * @returns false if no run finished
+         */
+        bool apply(MotorSettings &settings) const;
+
+    private:
+        enum class Phase : uint8_t
+        {
+            RAMP_UP,
+            RAMP_DOWN,
+            REST,
+            STEP_LOW,
+            STEP_HIGH,
+        };
+
+        static constexpr uint32_t SAMPLE_MS = 5;
+        static constexpr size_t MAX_SAMPLES = 160;
+
+        void fail(const char *reason);
+        void enterPhase(Phase phase, uint64_t nowMs);
+        bool analyseStep();
+        void computeGains();
+
+        State m_state = State::IDLE;
+        Phase m_phase = Phase::RAMP_UP;
+        AutoTuneConfig m_config;
+        AutoTuneResult m_result;
+        int32_t m_ratedMaxSpeed = 0;
+
+        int8_t m_dir = 1;
+        uint64_t m_phaseStartMs = 0;
+        int64_t m_startAngleMdeg = 0;
+        int64_t m_phaseAngleMdeg = 0;
+        float m_power = 0.0f;
+
+        // Stop detection: angle at the start of the current window.
+        uint64_t m_windowStartMs = 0;
+        int64_t m_windowAngleMdeg = 0;
+
+        float m_breakaway[2] = {};
+        float m_kinetic[2] = {};
+
+        float m_lowPower = 0.0f;
+        float m_lowSpeedSum = 0.0f;
+        uint32_t m_lowSpeedCount = 0;
+        int16_t m_samples[MAX_SAMPLES];
+        size_t m_sampleCount = 0;
+        uint64_t m_nextSampleMs = 0;
+        float m_gain[2] = {};
+        float m_tauMs[2] = {};
+        float m_deadMs[2] = {};
+        uint8_t m_ramps = 0; // friction ramps done
+        uint8_t m_steps = 0; // step responses done
+        uint32_t m_supplySum = 0;
+        uint32_t m_supplyCount = 0;
+    };
+}; // namespace Lpf2::Local
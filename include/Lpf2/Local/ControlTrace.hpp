@@ -0,0 +1,235 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+namespace Lpf2::Local
+{
+    /**
+     * @brief Fixed-capacity ring of motor controller ticks, one record each.
+     *
+     * Written by Port::updateMotorPID() on every tick that drives the motor,
+     * read from any task; same rules as Utils::SampleRing (one writer,
+     * lapped reads are dropped, never torn, indices are 32-bit and wrap).
+     * A record is a 64 byte POD, kept in the slot as 16 relaxed atomic
+     * words under the slot's sequence.
+     *
+     * dump() serializes records for a host: the stream is the 8 byte header
+     * (writeHeader()) followed by the raw records, little-endian as in memory
+     * (ESP32 and x86). scripts/control_trace_to_csv.py turns it into CSV.
+     */
+    class ControlTrace
+    {
+    public:
+        static constexpr uint8_t FORMAT_VERSION = 1;
+        static constexpr size_t HEADER_SIZE = 8;
+
+        // Same values as the port's controller modes.
+        enum class Mode : uint8_t
+        {
+            SPEED = 1,
+            POSITION = 2,
+            HOLD = 3,
+            AUTOTUNE = 4,
+        };
+
+        enum class SubMode : uint8_t
+        {
+            NONE,     // SPEED, AUTOTUNE
+            COARSE,   // speed loop on the ramp speed
+            FINE,     // P + I + D on the position error
+            TRACKING, // fine, to a MotionGroup profile
+        };
+
+        /**
+         * @brief One controller tick. Terms are in 1/1000 pct of power; their
+         * sum is the output before friction compensation and the power caps.
+         * SPEED ticks have no position targets (0).
+         */
+        struct Record
+        {
+            uint64_t timeUs;        // LPF2_GET_TIME_US() of the tick
+            int64_t targetMdeg;     // final position
+            int64_t rampMdeg;       // ramp / profile position
+            int64_t measuredMdeg;   // encoder
+            int32_t speedMdegps;    // observer
+            int32_t refSpeedMdegps; // speed setpoint (ramp speed in POSITION / HOLD)
+            int32_t ff;             // feed-forward
+            int32_t p;
+            int32_t i;
+            int32_t d;
+            int16_t power;          // applied, pct
+            uint16_t dtMs;
+            Mode mode;
+            SubMode subMode;
+            uint8_t reserved[2];
+        };
+        static_assert(sizeof(Record) == 64, "ControlTrace::Record is a wire format");
+
+        explicit ControlTrace(size_t capacity)
+            : m_slots(new Slot[capacity ? capacity : 1]), m_capacity(capacity ? capacity : 1)
+        {
+        }
+
+        ControlTrace(const ControlTrace &) = delete;
+        ControlTrace &operator=(const ControlTrace &) = delete;
+
+        size_t capacity() const { return m_capacity; }
+
+        /**
+         * @returns index of the next record to be written (number of records pushed so far)
+         */
+        uint32_t head() const { return m_head.load(std::memory_order_acquire); }
+
+        /**
+         * @returns index of the oldest record still held
+         */
+        uint32_t oldest() const
+        {
+            uint32_t h = head();
+            return m_full.load(std::memory_order_relaxed) ? h - (uint32_t)m_capacity : 0;
+        }
+
+        /**
+         * @brief Append a record. Writer side only.
+         */
+        void push(const Record &record)
+        {
+            uint32_t idx = m_head.load(std::memory_order_relaxed);
+            Slot &slot = m_slots[idx % m_capacity];
+            uint32_t words[WORDS];
+            std::memcpy(words, &record, sizeof(Record));
+            uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+            slot.seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.index.store(idx, std::memory_order_relaxed);
+            for (size_t i = 0; i < WORDS; i++)
+                slot.words[i].store(words[i], std::memory_order_relaxed);
+            slot.seq.store(seq + 2, std::memory_order_release);
+            if (idx + 1 == (uint32_t)m_capacity)
+                m_full.store(true, std::memory_order_relaxed);
+            m_head.store(idx + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Copy the record with absolute index @p index.
+         * @returns false if it is not written yet or was overwritten
+         */
+        bool read(uint32_t index, Record &out) const
+        {
+            if ((int32_t)(index - head()) >= 0)
+                return false;
+            const Slot &slot = m_slots[index % m_capacity];
+            uint32_t before = slot.seq.load(std::memory_order_acquire);
+            if ((before & 1) || slot.index.load(std::memory_order_relaxed) != index)
+                return false;
+            uint32_t words[WORDS];
+            for (size_t i = 0; i < WORDS; i++)
+                words[i] = slot.words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != before)
+                return false;
+            std::memcpy(&out, words, sizeof(Record));
+            return true;
+        }
+
+        /**
+         * @brief Call fn(index, record) for every record from @p from up to head().
+         * A cursor outside [oldest(), head()] starts at oldest().
+         * @returns the cursor to pass as @p from on the next call
+         */
+        template <typename Fn>
+        uint32_t forEach(uint32_t from, Fn &&fn) const
+        {
+            uint32_t h = head();
+            from = clampCursor(from, h);
+            Record r;
+            for (; from != h; from++)
+            {
+                if (read(from, r))
+                    fn(from, r);
+            }
+            return h;
+        }
+
+        /**
+         * @brief Write the stream header: "LPCT", version, record size, 0, 0.
+         * @returns bytes written, 0 if @p len is below HEADER_SIZE
+         */
+        static size_t writeHeader(uint8_t *out, size_t len)
+        {
+            if (len < HEADER_SIZE)
+                return 0;
+            const uint8_t header[HEADER_SIZE] = {'L', 'P', 'C', 'T', FORMAT_VERSION, (uint8_t)sizeof(Record), 0, 0};
+            std::memcpy(out, header, HEADER_SIZE);
+            return HEADER_SIZE;
+        }
+
+        /**
+         * @brief Copy as many whole records from @p from on as fit in @p out.
+         * Records overwritten before they could be read are skipped.
+         * @param from cursor, advanced past the records written
+         * @returns bytes written, 0 once the cursor reached head()
+         */
+        size_t dump(uint32_t &from, uint8_t *out, size_t len) const
+        {
+            uint32_t h = head();
+            from = clampCursor(from, h);
+            size_t n = 0;
+            Record r;
+            for (; from != h && len - n >= sizeof(Record); from++)
+            {
+                if (!read(from, r))
+                    continue;
+                std::memcpy(out + n, &r, sizeof(Record));
+                n += sizeof(Record);
+            }
+            return n;
+        }
+
+    private:
+        static constexpr size_t WORDS = sizeof(Record) / sizeof(uint32_t);
+
+        // seq is odd while the slot is written; index tells a reader which
+        // record the slot holds once the 32-bit indices wrapped.
+        struct Slot
+        {
+            std::atomic<uint32_t> seq{0};
+            std::atomic<uint32_t> index{0};
+            std::atomic<uint32_t> words[WORDS] = {};
+        };
+
+        // A cursor outside [oldest, h] (stale, or never set) starts at oldest.
+        uint32_t clampCursor(uint32_t from, uint32_t h) const
+        {
+            uint32_t first = m_full.load(std::memory_order_relaxed) ? h - (uint32_t)m_capacity : 0;
+            if ((int32_t)(from - first) < 0 || (int32_t)(h - from) < 0)
+                return first;
+            return from;
+        }
+
+        std::unique_ptr<Slot[]> m_slots;
+        size_t m_capacity;
+        std::atomic<uint32_t> m_head{0};
+        std::atomic<bool> m_full{false}; // head() has passed the capacity once
+    };
+}; // namespace Lpf2::Local
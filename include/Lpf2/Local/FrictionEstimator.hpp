@@ -0,0 +1,115 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+
+namespace Lpf2::Local
+{
+    /**
+     * @brief Online estimate of a motor's friction floors, stepped by
+     * Local::Port's controller with the outcome of its friction compensation.
+     *
+     * Both floors follow a staircase, judged by the encoder (the speed
+     * estimate is not reliable between counts at creeping speed):
+     * - Breakaway: a stiction kick that moves the encoder within
+     *   BREAKAWAY_WAIT_MS lowers the estimate by 1/64, a kick that does not
+     *   raises it by 1/16. It settles where about 4 of 5 kicks succeed.
+     * - Kinetic floor: every FLOOR_RUN_MS of output on the floor lowers it
+     *   by 1/64, FLOOR_STALL_MS without a count in the pushed direction
+     *   raises it by 1/16. A run that moved and is answered by a push the
+     *   other way within FLOOR_STALL_MS overshot the target, which lowers it
+     *   by 1/64 as well.
+     *
+     * The estimates stay within [1/2, 3/2] of the values reset() was given
+     * (the type's MotorSettings), and the kinetic floor stays at or below the
+     * breakaway. Integer only (Q16 pct), so it costs the same in the float
+     * and the fixed-point controller.
+     */
+    class FrictionEstimator
+    {
+    public:
+        static constexpr int Q_SHIFT = 16;             // 1 pct = 65536
+        static constexpr int32_t BREAKAWAY_WAIT_MS = 60;
+        static constexpr int32_t FLOOR_RUN_MS = 100;
+        static constexpr int32_t FLOOR_STALL_MS = 150;
+
+        // What the friction compensation did in a tick.
+        enum class Comp : uint8_t
+        {
+            NONE,
+            KICK,  // stuck, output raised to the breakaway
+            FLOOR, // moving, output raised to the kinetic floor
+        };
+
+        struct Estimate
+        {
+            float breakawayPct = 0.0f;
+            float kineticFloorPct = 0.0f;
+            uint32_t raised = 0;  // staircase steps up
+            uint32_t lowered = 0; // staircase steps down
+        };
+
+        /**
+         * @brief Start over from the given floors (pct).
+         */
+        void reset(float breakawayPct, float kineticFloorPct);
+
+        /**
+         * @brief One controller tick.
+         * @param comp what the friction compensation did
+         * @param dir sign of the output (-1, 0, 1)
+         * @param encoderDeg encoder position, whole degrees
+         */
+        void step(Comp comp, int32_t dir, int64_t encoderDeg, int32_t dtMs);
+
+        int32_t breakawayQ() const { return m_breakaway; }
+        int32_t kineticFloorQ() const { return m_kineticFloor; }
+
+        Estimate estimate() const;
+
+    private:
+        void raise(int32_t &value, int32_t max);
+        void lower(int32_t &value, int32_t min);
+        void endFloorRun();
+
+        int32_t m_breakaway = 0;    // Q16 pct
+        int32_t m_kineticFloor = 0; // Q16 pct
+        int32_t m_breakawayMin = 0, m_breakawayMax = 0;
+        int32_t m_floorMin = 0, m_floorMax = 0;
+
+        // Current kick: direction (0 = none), how long it has pushed and
+        // the encoder where it started.
+        int8_t m_kickDir = 0;
+        int32_t m_kickMs = 0;
+        int64_t m_kickStartDeg = 0;
+        // Current run at the floor: direction (0 = none), time on the floor,
+        // time since the last count and the encoder at that count.
+        int8_t m_floorDir = 0;
+        int32_t m_floorMs = 0;
+        int32_t m_floorIdleMs = 0;
+        int64_t m_floorDeg = 0;
+        bool m_floorMoved = false;
+        // Last run that counted, and the time since it ended.
+        int8_t m_lastRunDir = 0;
+        int32_t m_lastRunMs = 0;
+
+        uint32_t m_raised = 0;
+        uint32_t m_lowered = 0;
+    };
+}; // namespace Lpf2::Local
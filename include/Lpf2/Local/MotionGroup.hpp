@@ -0,0 +1,82 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include "Lpf2/Local/Port.hpp"
+
+namespace Lpf2::Local
+{
+    /**
+     * @brief Synchronized position moves on several Local::Ports, e.g. the
+     * axes of an XY table.
+     *
+     * moveTo() plans one profile (SCurve) per unit of distance, within
+     * every axis' MotorSettings, and runs it on every axis scaled to its
+     * distance from one start time: all axes are the same fraction of the
+     * way at any time and arrive together, as LWP does for virtual ports.
+     * update() ticks the controllers of every axis with the same time;
+     * while a port is in a group its own update() leaves the controller
+     * alone. A port that is destroyed leaves its group.
+     */
+    class MotionGroup
+    {
+    public:
+        MotionGroup() = default;
+        MotionGroup(const MotionGroup &) = delete;
+        MotionGroup &operator=(const MotionGroup &) = delete;
+        ~MotionGroup();
+
+        /**
+         * @returns 0, or -1 if the port already is in a group
+         */
+        int add(Port &port);
+        void remove(Port &port);
+        void clear();
+        size_t size() const { return m_axes.size(); }
+
+        /**
+         * @brief Move every axis to its target, all arriving at the same time.
+         * @param targetsDeg absolute position of each axis, in the order they were added
+         * @param speed % of each axis' rated speed, one of the limits of the shared profile
+         * @returns 0, or -1 if the number of targets is wrong or an axis has no motor
+         */
+        int moveTo(const std::vector<int32_t> &targetsDeg, uint8_t speed = 100, uint8_t maxPower = 100,
+                   BrakingStyle endState = BrakingStyle::HOLD);
+
+        /**
+         * @brief Tick the controller of every axis. Call at the control rate,
+         * it replaces the ticks in the ports' update().
+         */
+        void update();
+
+        /**
+         * @returns true while an axis has not reached its target yet
+         */
+        bool busy() const;
+
+        /**
+         * @brief Planned duration of the last move, ms.
+         */
+        uint32_t durationMs() const { return m_durationMs; }
+
+    private:
+        std::vector<Port *> m_axes;
+        uint32_t m_durationMs = 0;
+    };
+}; // namespace Lpf2::Local
@@ -0,0 +1,123 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include "Lpf2/LWPConst.hpp"
+#include <array>
+#include <utility>
+
+namespace Lpf2::Local
+{
+    enum class MotionResult : uint8_t
+    {
+        COMPLETED, // ended (or, blended, handed over to the next segment)
+        DISCARDED, // replaced by an immediate command before it ended
+    };
+
+    struct MotionSegment;
+
+    /**
+     * @brief Called from Port::update() when a queued segment ends, or from
+     * the call that discarded it. May queue further segments.
+     */
+    using MotionCallback = std::function<void(const MotionSegment &segment, MotionResult result)>;
+
+    /**
+     * @brief One queued motor command, see Port::queueMotion().
+     */
+    struct MotionSegment
+    {
+        enum class Type : uint8_t
+        {
+            SPEED_FOR_TIME,    // startSpeedForTime(value ms, speed, ...)
+            SPEED_FOR_DEGREES, // startSpeedForDegrees(value deg, speed, ...)
+            GOTO_ABS_POS,      // gotoAbsPosition(value deg, speed, ...)
+        };
+
+        Type type = Type::GOTO_ABS_POS;
+        int32_t value = 0;
+        int8_t speed = 100;     // pct, the sign is the direction of the speed segments
+        uint8_t maxPower = 100;
+        BrakingStyle endState = BrakingStyle::HOLD; // unless blended
+        // Run into the next queued segment without stopping: a position
+        // segment hands over once its ramp reaches the end, not once the
+        // motor settled, and decelerates only as far as the next one needs.
+        bool blend = false;
+        uint16_t tag = 0; // free for the application
+        MotionCallback onDone;
+    };
+
+    /**
+     * @brief Fixed-capacity FIFO of buffered segments (LWP "buffer if
+     * necessary"). No allocation after construction, apart from what the
+     * callbacks hold.
+     */
+    class MotionQueue
+    {
+    public:
+        static constexpr size_t CAPACITY = 8;
+
+        struct Entry
+        {
+            MotionSegment segment;
+            bool feedback = false; // COMPLETION_FEEDBACK: call segment.onDone
+        };
+
+        bool empty() const { return m_count == 0; }
+        bool full() const { return m_count == CAPACITY; }
+        size_t size() const { return m_count; }
+
+        /**
+         * @returns false if the queue is full
+         */
+        bool push(const MotionSegment &segment, bool feedback)
+        {
+            if (full())
+                return false;
+            Entry &e = m_entries[(m_first + m_count) % CAPACITY];
+            e.segment = segment;
+            e.feedback = feedback;
+            m_count++;
+            return true;
+        }
+
+        const Entry &front() const { return m_entries[m_first]; }
+
+        Entry pop()
+        {
+            Entry e = std::move(m_entries[m_first]);
+            m_entries[m_first] = Entry();
+            m_first = (m_first + 1) % CAPACITY;
+            m_count--;
+            return e;
+        }
+
+        void swap(MotionQueue &other)
+        {
+            std::swap(m_entries, other.m_entries);
+            std::swap(m_first, other.m_first);
+            std::swap(m_count, other.m_count);
+        }
+
+    private:
+        std::array<Entry, CAPACITY> m_entries;
+        size_t m_first = 0;
+        size_t m_count = 0;
+    };
+}; // namespace Lpf2::Local
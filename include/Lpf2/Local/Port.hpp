@@ -21,6 +21,11 @@
 #include "Lpf2/Port.hpp"
 #include "Lpf2/Local/Serial.hpp"
 #include "Lpf2/Local/SerialDef.hpp"
+#include "Lpf2/Local/AutoTune.hpp"
+#include "Lpf2/Local/SCurve.hpp"
+#include "Lpf2/Local/ControlTrace.hpp"
+#include "Lpf2/Local/FrictionEstimator.hpp"
+#include "Lpf2/Local/MotionQueue.hpp"
 #include "Lpf2/Util/mutex.hpp"
 
 #define MEASUREMENTS 20
@@ -43,18 +48,54 @@ namespace Lpf2::Local
         // POSITION/HOLD pct-domain PID (fine sub-mode).
         float pos_kp;              // power_pct per deg
         float pos_ki;              // power_pct per (deg·s)
-        float pos_kd;              // power_pct per (deg/s) — true derivative on pos err
+        float pos_kd;              // power_pct per (deg/s) — derivative on pos err (observer speed)
         float pos_int_clamp;
         float pos_deadband_deg;
-        double pos_decel_mdps2;    // trapezoidal decel cap
+        double pos_accel_mdps2;    // S-curve accel limit, 0 = trapezoid (no accel limit)
+        double pos_decel_mdps2;    // decel limit (trapezoid and S-curve)
+        double pos_jerk_mdps3;     // S-curve jerk limit, 0 = trapezoid
         float pos_handoff_deg;     // |remaining| under which fine sub-mode engages
 
         // Friction comp (pct).
         float breakaway_pct;       // stiction kick
         float kinetic_floor_pct;   // sustained drive floor
+
+        // Feed-forward model, at the output shaft. The feed-forward duty is
+        // the voltage it needs over the battery voltage; with ff_ke_mv_per_dps
+        // 0 it is the speed in pct of rated.
+        float ff_ke_mv_per_dps;    // back-EMF constant, mV per deg/s
+        float ff_resistance_ohm;   // winding resistance
+        float ff_friction_ma;      // current the friction takes while turning
     };
 
-    // Per-motor tuning singletons. Mutable at runtime; PID loop reads on tick.
+#if defined(LPF2_PID_FIXED)
+    // MotorSettings converted for the fixed-point controller (LPF2_PID_FIXED),
+    // see loadPidGains() in PortPID.cpp.
+    struct MotorGainsFx
+    {
+        int32_t speed_div;          // rated_max_speed * 10: mdeg/s per pct
+        int32_t speed_ksp;          // Q16
+        int32_t speed_ksi;          // per pct·ms, << KI_SHIFT
+        int64_t speed_int_clamp;    // Q16 pct·ms
+        int32_t speed_deadband;     // Q16 pct
+        int32_t pos_kp;             // per mdeg, << KP_SHIFT
+        int32_t pos_ki;             // per mdeg·ms, << KIP_SHIFT
+        int32_t pos_kd;             // per mdeg/s, << KP_SHIFT
+        int32_t track_kp;           // pos_kp, pos_kd while tracking a MotionGroup profile
+        int32_t track_kd;
+        int64_t pos_int_clamp;      // mdeg·ms
+        int32_t pos_deadband_mdeg;
+        int32_t pos_handoff_mdeg;
+        int64_t pos_decel_x2;       // 2 * pos_decel_mdps2
+        int32_t breakaway;          // Q16 pct
+        int32_t kinetic_floor;      // Q16 pct
+        int32_t ff_ke;              // mV per mdeg/s, << FF_KE_SHIFT, 0 = pct feed-forward
+        int32_t ff_friction_mv;
+    };
+#endif
+
+    // Per-motor tuning singletons. Mutable at runtime; PID loop reads on tick
+    // (LPF2_PID_FIXED: when the next motor command starts).
     extern MotorSettings MS_MEDIUM_LINEAR_MOTOR;
     extern MotorSettings MS_TECHNIC_LARGE_LINEAR_MOTOR;
     extern MotorSettings MS_TECHNIC_XLARGE_LINEAR_MOTOR;
@@ -63,11 +104,20 @@ namespace Lpf2::Local
     extern MotorSettings MS_TECHNIC_MEDIUM_ANGULAR_MOTOR_GREY;
     extern MotorSettings MS_TECHNIC_LARGE_ANGULAR_MOTOR_GREY;
 
+    // Settings singleton of a motor type, nullptr if the type has none.
+    const MotorSettings *lookupMotorSettings(DeviceType id);
+
+    class MotionGroup;
+
     class Port : public Lpf2::Port
     {
+        friend class MotionGroup;
+
     public:
         Port() = delete;
         Port(IO &IO) : m_IO(IO), m_serial(m_IO.getUart()), m_pwm(m_IO.getPWM()) {};
+        // Leaves its MotionGroup, if any.
+        ~Port() override;
 
         void init(
 #if defined(LPF2_USE_FREERTOS)
@@ -122,7 +172,125 @@ namespace Lpf2::Local
         void gotoAbsPosition(int32_t absPos, uint8_t speed = 100, uint8_t maxPower = 100, BrakingStyle endState = BrakingStyle::HOLD, uint8_t useProfile = 0) override;
         void presetEncoder(int32_t pos) override;
 
-        void updateMotorPID();
+        /**
+         * @brief One motor controller tick. Called from update(), except
+         * while the port is in a MotionGroup: then MotionGroup::update() ticks it.
+         */
+        void updateMotorPID() { updateMotorPID(LPF2_GET_TIME()); }
+
+        /**
+         * @brief Observer estimate of the motor angle (mdeg, relative to the
+         * preset encoder) and speed (mdeg/s) at the last controller tick.
+         */
+        int64_t getObservedAngleMdeg() const { return m_obsAngleMdeg; }
+        int32_t getObservedSpeedMdegps() const { return m_obsSpeedMdegps; }
+
+        /**
+         * @brief Record every motor controller tick in a ring of @p capacity
+         * records (see ControlTrace). Allocated here once, opt-in.
+         * Call from the task that runs update(), or before it starts.
+         * @returns 0 if succesful
+         */
+        int enableControlTrace(size_t capacity);
+
+        /**
+         * @brief Drop the control trace. Same threading rule as
+         * enableControlTrace(), readers must not hold the ring.
+         */
+        void disableControlTrace() { m_trace.reset(); }
+
+        /**
+         * @returns the control trace, nullptr if not enabled. Reading from it
+         * is lock-free and safe from any task.
+         */
+        const ControlTrace *getControlTrace() const { return m_trace.get(); }
+
+        /**
+         * @brief Settings the motor controller of this port uses, nullptr if no motor is attached.
+         */
+        const MotorSettings *getMotorSettings() const { return m_settings; }
+
+        /**
+         * @brief Use a per-port copy of the motor settings instead of the
+         * type's singleton (e.g. a stored auto-tune result). Applies whenever
+         * a motor of type @p settings.id is attached.
+         */
+        void setMotorSettings(const MotorSettings &settings);
+
+        /**
+         * @brief Go back to the motor type's settings singleton.
+         */
+        void resetMotorSettings();
+
+        /**
+         * @brief Start auto-tuning the attached motor (see AutoTuner).
+         * Runs in updateMotorPID(), check getAutoTuneState(). Any other motor
+         * command aborts it. On success the result is written into the
+         * per-port settings copy (setMotorSettings()) and the motor brakes.
+         * @returns 0 if started, -1 if no motor with settings is attached
+         */
+        int startAutoTune(const AutoTuneConfig &config = AutoTuneConfig());
+
+        AutoTuner::State getAutoTuneState() const { return m_autoTune.state(); }
+        const AutoTuneResult &getAutoTuneResult() const { return m_autoTune.result(); }
+
+        /**
+         * @brief Estimate the friction floors of this motor while it runs
+         * (see FrictionEstimator) and compensate with the estimates instead
+         * of breakaway_pct / kinetic_floor_pct. Enabling or disabling starts
+         * over from the settings, as does any change of the settings.
+         */
+        void setFrictionAdaptation(bool enable);
+        bool getFrictionAdaptation() const { return m_frictionAdapt; }
+
+        /**
+         * @returns the friction floors in use: the estimates while adapting,
+         * the settings otherwise
+         */
+        FrictionEstimator::Estimate getFrictionEstimate() const;
+
+        /**
+         * @brief Queue a motor command, with the startup and completion
+         * semantics of an LWP port output command. STARTUP_BUFFER starts it
+         * when the current command ends (right away if the motor is idle or
+         * holding), STARTUP_IMMEDIATE discards the current and the buffered
+         * commands first. With COMPLETION_FEEDBACK, segment.onDone is called
+         * when it ends or is discarded. The direct commands (startSpeed(),
+         * gotoAbsPosition(), ...) are immediate, without feedback.
+         * Call from the task that runs update().
+         * @returns 0 if queued, -1 if no motor is attached, -2 if the queue is full
+         */
+        int queueMotion(const MotionSegment &segment,
+                        uint8_t startupAndCompletion = STARTUP_BUFFER | COMPLETION_FEEDBACK);
+
+        /**
+         * @brief Discard the buffered segments, the current command runs on.
+         */
+        void clearMotionQueue();
+
+        size_t getQueuedMotionCount() const { return m_motionQueue.size(); }
+
+        /**
+         * @returns the command state as PORT_OUTPUT_COMMAND_FEEDBACK bits
+         * (PortOutputFeedback)
+         */
+        uint8_t getMotionFeedback() const;
+
+#if defined(LPF2_PID_PROFILE)
+        struct PidProfile
+        {
+            uint32_t ticks = 0;     // updateMotorPID() calls that ran the controller
+            uint64_t cycles = 0;    // LPF2_GET_CYCLES() spent in them
+            uint32_t maxCycles = 0;
+        };
+
+        /**
+         * @brief Cycles spent in updateMotorPID() on ticks with an active
+         * motor command (ticks with no command are not counted).
+         */
+        const PidProfile &getPidProfile() const { return m_pidProfile; }
+        void resetPidProfile() { m_pidProfile = PidProfile(); }
+#endif
 
     private:
 #if defined(LPF2_USE_FREERTOS)
@@ -171,6 +339,11 @@ namespace Lpf2::Local
          */
         uint64_t m_startRec = 0;
 
+        /**
+         * Time the last data frame was received (LPF2_GET_TIME_US()).
+         */
+        uint64_t m_dataRecUs = 0;
+
         /**
          * Time of the start of the current operation (millis since startup).
          */
@@ -194,14 +367,16 @@ namespace Lpf2::Local
         int32_t getMotorPos() const
         {
             if (m_activeCombo >= 0)
-                return (int32_t)getValue(2, 0); // POS mode (mode 2), whole degrees, accumulates
-            return (int32_t)(getValue((uint8_t)ModeNum::MOTOR__CALIB, 0) / 1024.0f * 360.0f);
+                return getRaw<int32_t>(2, 0); // POS mode (mode 2), whole degrees, accumulates
+            return getRaw<int32_t>((uint8_t)ModeNum::MOTOR__CALIB, 0) * 360 / 1024;
         }
 
         int64_t m_currentRelPos = 0;
         int32_t m_lastMotorPos = 0;
 
-        enum class PidMode : uint8_t { NONE, SPEED, POSITION, HOLD };
+        enum class PidMode : uint8_t { NONE, SPEED, POSITION, HOLD, AUTOTUNE };
+        static_assert((uint8_t)PidMode::AUTOTUNE == (uint8_t)ControlTrace::Mode::AUTOTUNE,
+                      "ControlTrace::Mode mirrors PidMode");
 
         PidMode m_pidMode = PidMode::NONE;
         // m_pidTarget in mdeg
@@ -214,7 +389,25 @@ namespace Lpf2::Local
         // Per-motor-type settings (resolved on device attach).
         const MotorSettings *m_settings = nullptr;
 
-        // Observer state.
+        // Per-port settings copy, used instead of the singleton when its id matches.
+        MotorSettings m_portSettings = {};
+        bool m_hasPortSettings = false;
+
+        AutoTuner m_autoTune;
+
+        // Online friction floors, see setFrictionAdaptation().
+        FrictionEstimator m_friction;
+        bool m_frictionAdapt = false;
+        void resetFrictionEstimate();
+
+        // Motion queue, see queueMotion(). m_motionCurrent is the segment
+        // the controller runs while m_motionActive is set.
+        MotionQueue m_motionQueue;
+        MotionSegment m_motionCurrent;
+        bool m_motionActive = false;
+        bool m_motionFeedback = false;
+
+        // Observer estimate, predicted to the current controller tick.
         int64_t m_obsAngleMdeg = 0;
         int32_t m_obsSpeedMdegps = 0;
         int32_t m_lastVoltageMv = 0;
@@ -227,20 +420,125 @@ namespace Lpf2::Local
         int64_t m_pidPositionFinal = 0;     // mdeg
         int32_t m_pidPositionRampMdegps = 0; // |ramp speed|
 
-        // Previous encoder reading (mdeg) for speed derivation.
-        int64_t m_obsPrevMeasMdeg = 0;
-        bool m_obsPrevValid = false;
+        // Speed (mdeg/s) the trapezoid may still have at m_pidPositionFinal:
+        // the next segment's entry speed when blending into it, 0 otherwise.
+        int32_t m_pidJunctionMdegps = 0;
+
+        // S-curve of the current move (pos_jerk_mdps3 > 0), replaces the
+        // trapezoid while active.
+        SCurve m_pidPlan;
+        uint64_t m_pidPlanStartMs = 0;
+
+        // Group that ticks this port's controller, see MotionGroup.
+        MotionGroup *m_motionGroup = nullptr;
+
+        // Observer angle at the receive time of the last motor frame, and
+        // the model input (profile speed of a MotionGroup axis) then.
+        int64_t m_obsSampleMdeg = 0;
+        uint64_t m_obsSampleUs = 0;
+        int32_t m_obsInputMdegps = 0;
 
         // Integral accumulator (units depend on mode/sub-mode).
+#if defined(LPF2_PID_FIXED)
+        int64_t m_pidIntegral = 0; // Q16, pct·ms (speed) or mdeg·ms (position)
+#else
         double m_pidIntegral = 0.0;
+#endif
         uint64_t m_pidLastMs = 0;
 
         // POSITION fine sub-mode state.
-        float m_pidPrevPosErrDeg = 0.0f;
-        bool m_pidPrevPosErrValid = false;
         bool m_pidPosFineActive = false;
 
+#if defined(LPF2_PID_FIXED)
+        MotorGainsFx m_gainsFx = {}; // *m_settings converted, see loadPidGains()
+        // Supply voltage the feed-forward scales were computed for, and the
+        // scales: 100 pct << 32 / m_ffSupplyMv (0 = no model) and
+        // max_voltage_mv / m_ffSupplyMv in Q16 for the friction floors.
+        int32_t m_ffSupplyMv = 0;
+        int64_t m_ffScale = 0;
+        int32_t m_ffFrictionScale = 0;
+#endif
+
+#if defined(LPF2_PID_PROFILE)
+        PidProfile m_pidProfile;
+#endif
+
+        // Opt-in tick recorder, see enableControlTrace(). While it is
+        // enabled, pidStep() leaves its terms in m_pidTerms (1/1000 pct).
+        std::unique_ptr<ControlTrace> m_trace;
+        struct PidTerms
+        {
+            int32_t ff, p, i, d;
+            ControlTrace::SubMode subMode;
+        };
+        PidTerms m_pidTerms = {};
+
+        /**
+         * @brief One controller tick of the SPEED / POSITION / HOLD modes.
+         * Float or fixed point (LPF2_PID_FIXED), both in PortPID.cpp.
+         * @param supplyMv battery voltage, for the feed-forward model
+         * @param power_pct set to the power to apply, before the voltage and max power caps
+         * @returns false if the command ended in this tick (applyEndState() was called)
+         */
+        bool pidStep(const MotorSettings &s, uint64_t now, int32_t dt_ms, int32_t supplyMv, int32_t &power_pct);
+
+        void updateMotorPID(uint64_t now);
+
+        /**
+         * @brief Start a POSITION command to @p finalMdeg (no profile planned yet).
+         */
+        void startPosition(int64_t finalMdeg, int32_t rampMdegps, uint8_t maxPower, BrakingStyle endState);
+
+        /**
+         * @brief Plan the S-curve from the current angle to m_pidPositionFinal,
+         * leaves m_pidPlan inactive (trapezoid) if the settings have no jerk limit.
+         */
+        void planPosition();
+
+        /**
+         * @brief Set m_pidTarget and m_pidSpeedSetpointMdegps from m_pidPlan.
+         * @returns the direction the reference still moves in, 0 once it arrived
+         */
+        int32_t followPlan(uint64_t now);
+
+        /**
+         * @brief Re-derive the fixed-point gains from *m_settings. Called when
+         * the settings change and when a motor command starts.
+         */
+#if defined(LPF2_PID_FIXED)
+        void loadPidGains();
+#else
+        void loadPidGains() {}
+#endif
+
         void applyPower(int8_t pw);
         void applyEndState(BrakingStyle style);
+
+        /**
+         * @brief Called by pidStep() when the command ended, or when a
+         * blended segment reached its end: applies the end state (unless
+         * blending), completes the queued segment and starts the next one.
+         */
+        void finishCommand();
+
+        /**
+         * @returns true if the current segment hands over to a queued one
+         * without stopping
+         */
+        bool blendPending() const
+        {
+            return m_motionActive && m_motionCurrent.blend && !m_motionQueue.empty();
+        }
+
+        bool motionBusy() const;
+        void startNextMotion(bool blended);
+        void startSegment(const MotionSegment &segment, bool blended);
+        void updateJunctionSpeed();
+
+        /**
+         * @brief Drop the current segment and the buffered ones, calling
+         * their callbacks with DISCARDED. Called by every immediate command.
+         */
+        void discardMotion();
     };
 }; // namespace Lpf2::Local
\ No newline at end of file
@@ -0,0 +1,95 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+
+namespace Lpf2::Local
+{
+    /**
+     * @brief Jerk-limited (S-curve) point-to-point profile, rest to rest.
+     *
+     * plan() computes seven segments once: jerk up, constant acceleration,
+     * jerk down, cruise, and the same three for the deceleration. A move too
+     * short to reach the speed or the acceleration limit gets shorter
+     * constant parts. sample() evaluates the profile in constant time.
+     * Without a jerk limit the profile is a trapezoid.
+     */
+    class SCurve
+    {
+    public:
+        struct Limits
+        {
+            float speed; // mdeg/s
+            float accel; // mdeg/s²
+            float decel; // mdeg/s²
+            float jerk;  // mdeg/s³, 0 = no limit
+
+            /**
+             * @brief Limits of the same profile over @p r times the distance,
+             * in the same time.
+             */
+            Limits scaled(float r) const;
+        };
+
+        struct Sample
+        {
+            int64_t positionMdeg;
+            int32_t speedMdegps;
+            bool done; // past the end, positionMdeg is the end point
+        };
+
+        /**
+         * @brief Plan a move from @p startMdeg to @p endMdeg.
+         * @returns false (and inactive) if a limit other than the jerk is not positive
+         */
+        bool plan(int64_t startMdeg, int64_t endMdeg, const Limits &limits);
+
+        /**
+         * @param tMs time since the start of the move
+         */
+        Sample sample(uint32_t tMs) const;
+
+        void clear() { m_active = false; }
+        bool active() const { return m_active; }
+        /**
+         * @brief Length of the planned move, also valid after clear().
+         */
+        float durationMs() const;
+
+    private:
+        static constexpr int SEGMENTS = 7;
+
+        // State at the start of a segment, distance from the start point.
+        struct Segment
+        {
+            float t0; // ms
+            float p0; // mdeg
+            float v0; // mdeg/ms
+            float a0; // mdeg/ms²
+            float j;  // mdeg/ms³
+        };
+
+        Segment m_seg[SEGMENTS] = {};
+        float m_lastDuration = 0.0f; // ms
+        int64_t m_startMdeg = 0;
+        int64_t m_endMdeg = 0;
+        int8_t m_dir = 1;
+        bool m_active = false;
+    };
+}; // namespace Lpf2::Local
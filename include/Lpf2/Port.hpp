@@ -21,7 +21,11 @@
 #include "Lpf2/LWPConst.hpp"
 #include "Lpf2/Device.hpp"
 #include "Lpf2/DeviceDesc.hpp"
+#include "Lpf2/Util/SampleRing.hpp"
+#include <array>
+#include <atomic>
 #include <memory>
+#include <type_traits>
 
 namespace Lpf2
 {
@@ -193,14 +197,60 @@ namespace Lpf2
 
         virtual bool isDeviceConnected() = 0;
 
+        static float getValue(const Mode &modeData, const uint8_t *raw, size_t len, uint8_t dataSet);
         static float getValue(const Mode &modeData, const std::vector<uint8_t> &raw, uint8_t dataSet);
         static float getValue(const Mode &modeData, uint8_t dataSet);
         float getValue(uint8_t modeNum, const std::vector<uint8_t> &raw, uint8_t dataSet) const;
         float getValue(uint8_t modeNum, uint8_t dataSet) const;
+
+        /**
+         * @brief Integer value of a dataset, without the decimals scaling of getValue().
+         * DATA8/16/32 are sign-extended, DATAF is truncated towards zero.
+         * @tparam T integer type to return, the value is cast (not clamped) to it
+         * @returns 0 if the mode/dataset does not exist or has no data yet
+         */
+        template <typename T = int32_t>
+        T getRaw(uint8_t modeNum, uint8_t dataSet) const
+        {
+            static_assert(std::is_integral_v<T>, "getRaw<T>: T must be an integer type");
+            if (modeNum >= m_modeData.size())
+                return 0;
+            const auto &raw = m_modeData[modeNum].rawData;
+            return (T)getRawValue(m_modeData[modeNum], raw.data(), raw.size(), dataSet);
+        }
+
+        /**
+         * @brief Value of a dataset as a fixed-point integer with @p decimals decimals,
+         * computed in integer arithmetic (DATAF modes excepted).
+         * e.g. raw 123 of a mode with 1 decimal (12.3) -> getScaled(m, 0, 2) == 1230
+         * @returns the value, truncated towards zero and clamped to int32_t
+         */
+        int32_t getScaled(uint8_t modeNum, uint8_t dataSet, uint8_t decimals) const;
+
+        /**
+         * @brief Integer values (as getRaw()) of every dataset of a mode.
+         * @returns number of values written, min(data_sets, @p maxCount)
+         */
+        size_t getRawBatch(uint8_t modeNum, int32_t *out, size_t maxCount) const;
+
+        static int32_t getRawValue(const Mode &modeData, const uint8_t *raw, size_t len, uint8_t dataSet);
+
         static std::string formatValue(float value, const Mode &modeData);
         static std::string getValueStr(const Mode &modeData);
         std::string getValueStr(uint8_t modeNum) const;
 
+        /**
+         * @brief Buffer versions of formatValue() / getValueStr() / getInfoStr().
+         * They never allocate and follow snprintf() rules: at most @p size bytes
+         * are written (always NUL-terminated), and the return value is the
+         * length the full output needs, so a result >= @p size means truncation.
+         * @p buf may be nullptr when @p size is 0, to only measure.
+         */
+        static size_t formatValue(char *buf, size_t size, float value, const Mode &modeData);
+        static size_t getValueStr(char *buf, size_t size, const Mode &modeData);
+        size_t getValueStr(char *buf, size_t size, uint8_t modeNum) const;
+        size_t getInfoStr(char *buf, size_t size) const;
+
         DeviceType getDeviceType() const { return m_deviceType; }
         uint8_t getModeCount() const { return m_modeData.size(); }
         uint8_t getViewCount() const { return m_viewCount; }
@@ -319,6 +369,65 @@ namespace Lpf2
             m_valueChangeCallback = callback;
         }
 
+        /**
+         * @brief Subscribe to a dataset of a mode.
+         *
+         * Evaluated once per incoming frame of the mode: the dataset is decoded
+         * once and shared by every subscriber of it. The callback runs on the
+         * task that runs update(), when the value moved by >= @p delta since the
+         * last call (0 = every frame) and at least @p minIntervalMs passed.
+         * The first frame after subscribing always calls it.
+         * @param modeNum mode number (0-15)
+         * @param dataSet dataset index (0-31)
+         * @param delta minimum change of the decoded value
+         * @param minIntervalMs minimum time between two calls
+         * @returns subscription id (>= 0), -1 if the table is full or the arguments are invalid
+         */
+        int subscribe(uint8_t modeNum, uint8_t dataSet, float delta, uint32_t minIntervalMs, ValueSubscriber callback);
+
+        /**
+         * @brief Remove a subscription.
+         * Waits for a call of the port's subscribers in progress on another
+         * task, so what the callback captures can be destroyed on return.
+         * Called from a subscriber of this port, it returns at once and the
+         * callback must not destroy its own captures.
+         */
+        void unsubscribe(int id);
+
+        /**
+         * @brief Keep the last @p capacity samples of a mode, timestamped on receive.
+         * Opt-in, the ring is allocated here once and never resized afterwards.
+         * Call from the task that runs update() (or before it starts).
+         * @param modeNum mode number (0-15)
+         * @param capacity number of samples to keep
+         * @returns 0 if succesful
+         */
+        int enableHistory(uint8_t modeNum, size_t capacity);
+
+        /**
+         * @brief Drop the history ring of a mode.
+         * Same threading rule as enableHistory(), readers must not hold the ring.
+         */
+        void disableHistory(uint8_t modeNum);
+
+        /**
+         * @returns the history ring of a mode, nullptr if not enabled.
+         * Reading from it is lock-free and safe from any task.
+         */
+        const Utils::SampleRing *getHistory(uint8_t modeNum) const
+        {
+            return modeNum < m_history.size() ? m_history[modeNum].get() : nullptr;
+        }
+
+        /**
+         * @brief Value of a dataset at @p timeUs, linearly interpolated between
+         * the two history samples around it. Past the newest sample the newest
+         * value is returned (no extrapolation).
+         * @param timeUs time in the LPF2_GET_TIME_US() time base
+         * @returns false if history is disabled or @p timeUs is older than the ring
+         */
+        bool getValueAt(uint8_t modeNum, uint8_t dataSet, uint64_t timeUs, float &value) const;
+
     public:
         static uint8_t getDataSize(uint8_t format);
     protected:
@@ -352,6 +461,16 @@ namespace Lpf2
          */
         void fireValueChangeCallback(uint8_t modeNum);
 
+        /**
+         * @brief Hand freshly stored rawData of a mode to its consumers:
+         * the history ring (if enabled) and the value subscriptions.
+         * Called by the subclasses right after new mode data was stored.
+         */
+        void publishModeData(uint8_t modeNum);
+
+        void recordSample(uint8_t modeNum);
+        void notifySubscribers(uint8_t modeNum);
+
         /// Parse a signed 8-bit integer from raw bytes
         static float parseData8(const uint8_t *ptr);
 
@@ -403,6 +522,31 @@ namespace Lpf2
         std::vector<float> m_deltas;
         /// Per-mode previous raw snapshot used by fireValueChangeCallback for delta comparison.
         std::vector<std::vector<uint8_t>> m_prevRaw;
+
+        /// Opt-in per-mode sample history (see enableHistory()).
+        std::array<std::unique_ptr<Utils::SampleRing>, 16> m_history;
+
+        struct Subscription
+        {
+            ValueSubscriber callback;
+            float delta = 1.0f;
+            float lastValue = 0.0f;
+            uint64_t lastTime = 0;
+            uint32_t minIntervalMs = 0;
+            uint8_t mode = 0;
+            uint8_t dataSet = 0;
+            bool hasLast = false;
+        };
+        static_assert(LPF2_MAX_SUBSCRIBERS <= 32, "subscriber slots are tracked in 32-bit masks");
+
+        /// Fixed subscription table, slots are claimed/released through the bitmasks below.
+        std::array<Subscription, LPF2_MAX_SUBSCRIBERS> m_subs;
+        std::atomic<uint32_t> m_subUsed{0};
+        /// Per-mode bitmask of the slots subscribed to that mode.
+        std::array<std::atomic<uint32_t>, 16> m_subsByMode{};
+        /// Odd while notifySubscribers() runs, unsubscribe() waits for that call.
+        std::atomic<uint32_t> m_notifySeq{0};
+        static thread_local const Port *t_notifyingPort;
     };
 
     class PortDevice : public Lpf2::Device
@@ -19,6 +19,8 @@
 
 #include "Lpf2/config.hpp"
 #include "Lpf2/Port.hpp"
+#include "Lpf2/Local/MotionQueue.hpp"
+#include <atomic>
 #include <memory>
 
 namespace Lpf2
@@ -28,6 +30,43 @@ namespace Lpf2
 
 namespace Lpf2::Remote
 {
+    class Port;
+
+    enum class CommandState : uint8_t
+    {
+        UNKNOWN,     // not a command of the port, or older than the last HISTORY ones
+        QUEUED,      // waiting for room in the hub's command buffer
+        SENT,        // on its way, or buffered on the hub
+        IN_PROGRESS, // the hub runs it
+        COMPLETED,
+        DISCARDED, // replaced by an immediate command, or never sent (queue full, disconnect)
+    };
+
+    /**
+     * @brief The state of one command queued with Port::queueMotion().
+     * Cheap to copy, it only names the command.
+     */
+    class CommandHandle
+    {
+    public:
+        CommandHandle() = default;
+
+        bool valid() const { return m_port != nullptr; }
+        CommandState state() const;
+
+        /**
+         * @returns true once the command completed or was discarded
+         */
+        bool done() const;
+
+    private:
+        friend class Port;
+        CommandHandle(const Port *port, uint32_t id) : m_port(port), m_id(id) {}
+
+        const Port *m_port = nullptr;
+        uint32_t m_id = 0;
+    };
+
     class Port : public Lpf2::Port
     {
         friend class Lpf2::Hub;
@@ -50,13 +89,112 @@ namespace Lpf2::Remote
         void gotoAbsPosition(int32_t absPos, uint8_t speed = 100, uint8_t maxPower = 100, BrakingStyle endState = BrakingStyle::HOLD, uint8_t useProfile = 0) override;
         void presetEncoder(int32_t pos) override;
 
+        /**
+         * @brief Send a motor command with the startup and completion
+         * semantics of an LWP port output command, like
+         * Local::Port::queueMotion(). STARTUP_BUFFER lets it wait in the
+         * hub's command buffer behind the current command, so the next move
+         * starts without a round trip; at most HUB_BUFFER commands are on
+         * their way or on the hub, the others wait here. STARTUP_IMMEDIATE
+         * discards the current and the queued commands first. With
+         * COMPLETION_FEEDBACK the hub's PORT_OUTPUT_COMMAND_FEEDBACK
+         * messages track it: segment.onDone is called from update() when it
+         * completes or is discarded. Buffered commands are always sent with
+         * feedback, so they are paced to the hub's buffer and their handle
+         * reports their state either way; an immediate one without
+         * COMPLETION_FEEDBACK stays SENT. A command the hub refuses with a
+         * full buffer is sent again when the running one ends.
+         * segment.blend is ignored.
+         * The direct commands (startSpeed(), writeData(), ...) are immediate
+         * and discard the queued commands as well.
+         * Call from the task that runs Hub::update().
+         * @returns an invalid handle if no device is attached or the queue is full
+         */
+        CommandHandle queueMotion(const Local::MotionSegment &segment,
+                                  uint8_t startupAndCompletion = STARTUP_BUFFER | COMPLETION_FEEDBACK);
+
+        /**
+         * @brief Discard the commands that wait here, those on the hub run on.
+         */
+        void clearMotionQueue();
+
+        size_t getQueuedMotionCount() const { return m_motionQueue.size(); }
+
+        /**
+         * @returns the last PORT_OUTPUT_COMMAND_FEEDBACK bits (PortOutputFeedback)
+         * the hub sent for the port
+         */
+        uint8_t getMotionFeedback() const { return m_lastFeedback.load(std::memory_order_relaxed); }
+
         PortNum getPortNum() const { return m_portNum; }
 
+        /**
+         * @brief Commands on their way to or on the hub at once: the running
+         * one and one buffered.
+         */
+        static constexpr uint8_t HUB_BUFFER = 2;
+
+        /**
+         * @brief Finished commands whose state a CommandHandle can still report.
+         */
+        static constexpr uint32_t HISTORY = 32;
+
     protected:
         Hub *m_remote;
         DeviceType m_lastDevType = DeviceType::UNKNOWNDEVICE;
         PortNum m_portNum = 0;
+        bool m_fromDescriptor = false;    // set up from a DeviceDescRegistry descriptor
+        bool m_descriptorChecked = false; // the hub confirmed the descriptor (Hub::setDescriptorCheck())
+
+        static inline const uint8_t startupAndCompletion = STARTUP_IMMEDIATE | COMPLETION_NONE;
+
+    private:
+        friend class CommandHandle;
+
+        struct InFlight
+        {
+            Local::MotionSegment segment;
+            uint32_t id = 0;
+            bool running = false;
+            bool feedback = true; // asked for by the caller, segment.onDone is called
+            bool refused = false; // FEEDBACK_BUSY_FULL, sent again when a command ends
+        };
+
+        /**
+         * @brief Called from Hub's message handler (the notify context) with
+         * the feedback byte of this port, update() handles it.
+         */
+        void onFeedback(uint8_t feedback);
+
+        /**
+         * @brief Discard every command, from the next update() (called on
+         * detach and disconnect, possibly from the notify context).
+         */
+        void resetMotion() { m_motionReset.store(true, std::memory_order_release); }
+
+        /**
+         * @brief Handle the feedback that arrived and send what fits into the
+         * hub's buffer, called from update().
+         */
+        void updateMotion();
+        void applyFeedback(uint8_t feedback);
+        int sendMotion(const Local::MotionSegment &segment, uint8_t startupAndCompletion, uint8_t useProfile = 0);
+        void finishMotion(const Local::MotionSegment &segment, uint32_t id, bool feedback, CommandState state);
+        void finishInFlight(uint8_t count, CommandState state);
+        void discardMotion();
+        CommandState commandState(uint32_t id) const;
+
+        Local::MotionQueue m_motionQueue; // waiting for room in the hub's buffer
+        InFlight m_inFlight[HUB_BUFFER];  // oldest first
+        uint8_t m_inFlightCount = 0;
+        uint32_t m_nextCommandId = 1;      // 0 is never used
+        CommandState m_history[HISTORY] = {}; // by id % HISTORY, finished commands
 
-        static inline const uint8_t startupAndCompletion = 0x10;
+        // Feedback bytes from the notify context, consumed by updateMotion().
+        uint8_t m_feedbackRing[8] = {};
+        std::atomic<uint8_t> m_feedbackHead{0};
+        std::atomic<uint8_t> m_feedbackTail{0};
+        std::atomic<uint8_t> m_lastFeedback{0};
+        std::atomic<bool> m_motionReset{false};
     };
 }; // namespace Lpf2::Remote
\ No newline at end of file
@@ -0,0 +1,37 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include <cstdint>
+
+namespace Lpf2::Sim
+{
+    /**
+     * @brief Virtual clock for host builds (LPF2_NATIVE).
+     *
+     * LPF2_GET_TIME() / LPF2_GET_TIME_US() read this clock, so the library
+     * only sees time pass when the simulation advances it. Starts at 0.
+     */
+    class Clock
+    {
+    public:
+        static uint64_t nowUs();
+        static void setUs(uint64_t us);
+        static void advanceUs(uint64_t us);
+    };
+}; // namespace Lpf2::Sim
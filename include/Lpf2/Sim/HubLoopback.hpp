@@ -0,0 +1,84 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/HubTransport.hpp"
+#include "Lpf2/Sim/ScriptedHub.hpp"
+#include <deque>
+
+namespace Lpf2::Sim
+{
+    /**
+     * @brief HubTransport to a Sim::ScriptedHub in the same process.
+     *
+     * Messages arrive at the other end after the one-way latency, measured
+     * on the virtual clock (Sim::Clock), in the order they were sent. The
+     * default is half of a 15 ms BLE connection interval.
+     */
+    class HubLoopback : public HubTransport
+    {
+    public:
+        explicit HubLoopback(ScriptedHub &hub, uint32_t latencyUs = 7500);
+        HubLoopback(const HubLoopback &) = delete;
+        HubLoopback &operator=(const HubLoopback &) = delete;
+
+        bool write(const uint8_t *data, size_t length) override;
+
+        /**
+         * @brief Hand the messages that arrived by now to the hub and to Hub.
+         */
+        void poll() override;
+
+        /**
+         * @brief Advance the virtual clock by @p ms, 1 ms at a time, polling
+         * in between.
+         */
+        void idle(uint32_t ms) override;
+
+        /**
+         * @brief Twice the latency.
+         */
+        uint32_t connectionIntervalUs() override { return 2 * m_latencyUs; }
+
+        void setLatencyUs(uint32_t latencyUs) { m_latencyUs = latencyUs; }
+        uint32_t latencyUs() const { return m_latencyUs; }
+
+        size_t framesWritten() const { return m_framesWritten; }
+        size_t framesDelivered() const { return m_framesDelivered; }
+        size_t bytesWritten() const { return m_bytesWritten; }
+        size_t bytesDelivered() const { return m_bytesDelivered; }
+
+    private:
+        struct Frame
+        {
+            uint64_t arrivalUs;
+            std::vector<uint8_t> data;
+        };
+
+        void queue(std::deque<Frame> &queue, const uint8_t *data, size_t length);
+
+        ScriptedHub &m_hub;
+        uint32_t m_latencyUs;
+        std::deque<Frame> m_toHub;
+        std::deque<Frame> m_toClient;
+        size_t m_framesWritten = 0;
+        size_t m_framesDelivered = 0;
+        size_t m_bytesWritten = 0;
+        size_t m_bytesDelivered = 0;
+    };
+}; // namespace Lpf2::Sim
@@ -0,0 +1,140 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include "Lpf2/Local/IO/IO.hpp"
+#include <deque>
+
+namespace Lpf2::Sim
+{
+    class UartLink;
+
+    /**
+     * @brief One end of an in-memory UART link (Local::Uart stand-in).
+     *
+     * Bytes written on one end arrive at the other end after their
+     * transmission time at the writer's baudrate (10 bits per byte),
+     * measured on the virtual clock.
+     */
+    class Uart : public Local::Uart
+    {
+    public:
+        void end() override {}
+        void setBaudrate(uint32_t baudrate) override { m_baud = baudrate ? baudrate : 1; }
+        size_t write(const uint8_t *data, size_t length) override;
+        int read() override;
+        size_t read(uint8_t *data, size_t length) override;
+        int available() override;
+        void flush() override {}
+        void discardRxFiFo() override { m_rx.clear(); }
+        void setUartPinsState(bool highZ) override { m_highZ = highZ; }
+
+        /**
+         * @brief Analog ID lines. ID2 (ch 1) of the host end toggles like the
+         * TX line of a device that sends data, so Local::Port detects a UART device.
+         */
+        float readCh(uint8_t ch) override;
+        void writeCh(uint8_t, bool) override {}
+
+        uint32_t baudrate() const { return m_baud; }
+        size_t bytesWritten() const { return m_bytesWritten; }
+
+    private:
+        friend class UartLink;
+
+        struct Byte
+        {
+            uint64_t arrivalUs;
+            uint8_t value;
+        };
+
+        Uart *m_peer = nullptr;
+        std::deque<Byte> m_rx;
+        uint64_t m_txFreeUs = 0; // end of the last queued transmission
+        uint32_t m_baud = 115200;
+        bool m_highZ = false;
+        bool m_idToggle = false;
+        size_t m_bytesWritten = 0;
+    };
+
+    /**
+     * @brief Two Sim::Uart ends connected to each other.
+     */
+    class UartLink
+    {
+    public:
+        UartLink();
+        UartLink(const UartLink &) = delete;
+        UartLink &operator=(const UartLink &) = delete;
+
+        Uart &host() { return m_host; }
+        Uart &device() { return m_device; }
+
+    private:
+        Uart m_host;
+        Uart m_device;
+    };
+
+    /**
+     * @brief Local::PWM stand-in, keeps the last H-bridge output.
+     */
+    class PWM : public Local::PWM
+    {
+    public:
+        void out(uint8_t ch1, uint8_t ch2) override
+        {
+            m_ch1 = ch1;
+            m_ch2 = ch2;
+        }
+
+        uint8_t ch1() const { return m_ch1; }
+        uint8_t ch2() const { return m_ch2; }
+
+        /**
+         * @returns average drive in [-1, 1], positive = forward (ch2)
+         */
+        float duty() const { return ((float)m_ch2 - (float)m_ch1) / 255.0f; }
+
+        /// Both outputs low: the bridge is open, the motor coasts.
+        bool coasting() const { return m_ch1 == 0 && m_ch2 == 0; }
+
+    private:
+        uint8_t m_ch1 = 0;
+        uint8_t m_ch2 = 0;
+    };
+
+    /**
+     * @brief Local::IO stand-in, the host end of a UartLink plus a Sim::PWM.
+     */
+    class IO : public Local::IO
+    {
+    public:
+        explicit IO(Uart &uart) : m_uart(uart) {}
+
+        Local::Uart *getUart() override { return &m_uart; }
+        Local::PWM *getPWM() override { return &m_pwm; }
+        bool ready() const override { return true; }
+
+        PWM &pwm() { return m_pwm; }
+
+    private:
+        Uart &m_uart;
+        PWM m_pwm;
+    };
+}; // namespace Lpf2::Sim
@@ -0,0 +1,150 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include "Lpf2/Local/Port.hpp"
+#include "Lpf2/Local/EmulatedPort.hpp"
+#include "Lpf2/Virtual/Device.hpp"
+#include "Lpf2/Sim/IO.hpp"
+#include "Lpf2/Sim/MotorPlant.hpp"
+#include <memory>
+
+namespace Lpf2::Sim
+{
+    /**
+     * @brief A simulated LPF2 encoder motor wired to a Local::Port.
+     *
+     * The motor side is a Local::EmulatedPort serving the motor's descriptor
+     * (DeviceDescLib) over an in-memory UART link. It answers the real
+     * handshake and, once the port selected combo 0, sends SPEED / POS / APOS
+     * frames computed from a MotorPlant driven by the port's PWM output.
+     * Local::Port runs unmodified, including updateMotorPID().
+     *
+     * Everything runs on the virtual clock (Sim::Clock), so a bench runs as
+     * fast as the host can step it. Results depend on the time the
+     * bench starts at: set the clock to the same time (Clock::setUs(0))
+     * before creating the benches of a run to get the same results
+     * whatever ran before. Host builds only (LPF2_NATIVE).
+     */
+    class MotorBench
+    {
+    public:
+        struct Config
+        {
+            DeviceType type = DeviceType::TECHNIC_LARGE_LINEAR_MOTOR;
+            const MotorModel *model = nullptr; // nullptr = MotorModel::fromSettings() of the type
+            uint16_t supplyMv = 8400;          // battery voltage (Battery::setCurrentVoltage())
+            uint32_t physicsStepUs = 50;
+            uint32_t controlPeriodUs = 1000;   // Local::Port::update() period
+            uint32_t framePeriodUs = 10000;    // motor data frame period
+        };
+
+        struct Move
+        {
+            enum class Type
+            {
+                POSITION, // gotoAbsPosition(target, speed, maxPower, HOLD)
+                SPEED,    // startSpeed(target, maxPower)
+            };
+            const char *name = "";
+            Type type = Type::POSITION;
+            int32_t target = 0;        // degrees (POSITION) or % of rated speed (SPEED)
+            uint8_t speed = 50;        // POSITION ramp speed, % of rated speed
+            uint8_t maxPower = 100;
+            uint32_t durationMs = 2000; // observation window
+            float band = 2.0f;         // settling band, degrees or %
+        };
+
+        struct MoveResult
+        {
+            bool settled = false;
+            uint32_t settleMs = 0;        // time until the error stayed inside the band
+            float overshoot = 0.0f;       // past the target in the direction of the move (degrees or %)
+            float steadyStateError = 0.0f; // |error| averaged over the last 100 ms of the window
+            float loadError = 0.0f;       // POSITION: |target - load angle| at the end (backlash)
+            float observerLagMs = 0.0f;   // how far the port's angle estimate trails the motor, in time
+            float observerSpeedError = 0.0f; // RMS error of the port's speed estimate, % of rated speed
+            uint32_t reversals = 0;       // POSITION: motor direction changes after first reaching the band (hunting)
+        };
+
+        explicit MotorBench(const Config &config);
+        ~MotorBench();
+
+        /**
+         * @brief Run until the port finished the handshake and receives combo frames.
+         * @returns false if that did not happen within @p timeoutMs
+         */
+        bool connect(uint32_t timeoutMs = 5000);
+
+        /**
+         * @brief Advance the simulation by @p ms of virtual time.
+         */
+        void run(uint32_t ms);
+
+        /**
+         * @brief One physics step at the current time, without advancing the
+         * clock. To run several benches on one clock, advance Sim::Clock by
+         * Config::physicsStepUs, then tick() each of them.
+         */
+        void tick();
+
+        /**
+         * @brief Start @p move, run its observation window and measure it.
+         */
+        MoveResult runMove(const Move &move);
+
+        /**
+         * @brief Run Local::Port::startAutoTune() to completion.
+         * @returns true if it finished and the port now uses the tuned settings
+         */
+        bool autoTune(const Local::AutoTuneConfig &config = Local::AutoTuneConfig(), uint32_t timeoutMs = 30000);
+
+        /**
+         * @returns the speed the motor reports, % of rated speed
+         */
+        float speedPct() const;
+
+        Local::Port &port() { return m_port; }
+        MotorPlant &plant() { return m_plant; }
+        PWM &pwm() { return m_io.pwm(); }
+        const Config &config() const { return m_config; }
+
+        /// Simulated time since the bench was created, ms.
+        uint64_t timeMs() const;
+
+    private:
+        void step();
+        void publishFrame();
+
+        Config m_config;
+        const Local::MotorSettings *m_settings;
+        UartLink m_link;
+        IO m_io;
+        Local::Port m_port;
+        std::unique_ptr<Virtual::GenericDevice> m_device;
+        Local::EmulatedPort m_emulated;
+        MotorPlant m_plant;
+
+        uint64_t m_startUs;
+        uint64_t m_nextControlUs = 0;
+        uint64_t m_nextFrameUs = 0;
+        double m_frameAngleDeg = 0.0;
+        float m_reportedPct = 0.0f;
+    };
+}; // namespace Lpf2::Sim
@@ -0,0 +1,103 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include "Lpf2/Local/Port.hpp"
+
+namespace Lpf2::Sim
+{
+    /**
+     * @brief DC gear motor parameters, referred to the output shaft (SI units).
+     */
+    struct MotorModel
+    {
+        float resistance_ohm;     // winding resistance
+        float ke_vs_per_rad;      // back-EMF constant, also the torque constant (N·m/A)
+        float inertia_kgm2;       // rotor + gearbox inertia seen at the output shaft
+        float viscous_nms;        // viscous friction (N·m·s/rad)
+        float coulomb_nm;         // kinetic (sliding) friction
+        float stiction_nm;        // breakaway friction, >= coulomb_nm
+
+        // Load coupled to the output shaft through a backlash gap.
+        float backlash_deg;       // total play, 0 = rigid
+        float load_inertia_kgm2;  // 0 = no load
+        float load_friction_nm;   // kinetic friction of the load
+        float load_torque_nm;     // constant external torque on the load (e.g. gravity)
+
+        /**
+         * @brief Rough model matching a motor's tuning constants: no-load speed
+         * slightly above rated_max_speed at max_voltage_mv, friction around the
+         * breakaway / kinetic floors, 50 ms mechanical time constant and a small
+         * load behind 1.5° of backlash. A starting point, not a measured motor.
+         */
+        static MotorModel fromSettings(const Local::MotorSettings &s);
+
+        /**
+         * @brief Write this motor's feed-forward model into @p s
+         * (ff_ke_mv_per_dps, ff_resistance_ohm, ff_friction_ma). The viscous
+         * friction is folded into the back-EMF constant, the load's friction
+         * into the friction current.
+         */
+        void applyFeedForward(Local::MotorSettings &s) const;
+    };
+
+    /**
+     * @brief Motor plant: inertia, back-EMF, viscous / Coulomb friction with
+     * stiction, and a load behind gear backlash.
+     *
+     * The electrical time constant is neglected (current follows voltage).
+     * The backlash is a dead zone with a stiff spring-damper contact.
+     */
+    class MotorPlant
+    {
+    public:
+        explicit MotorPlant(const MotorModel &model) : m_model(model) {}
+
+        /**
+         * @brief Advance the plant.
+         * @param volts average terminal voltage
+         * @param open true if the bridge is open (coasting, no current flows)
+         * @param dt step in seconds, keep it <= 100 µs with backlash enabled
+         */
+        void step(float volts, bool open, float dt);
+
+        void reset(double angleDeg = 0.0);
+
+        /// Output shaft (encoder) angle, degrees.
+        double angleDeg() const;
+        /// Output shaft speed, degrees / s.
+        double speedDps() const;
+        /// Load angle, degrees (equals angleDeg() without a load).
+        double loadAngleDeg() const;
+
+        /// Motor current of the last step, A.
+        float current() const { return m_current; }
+
+        const MotorModel &model() const { return m_model; }
+        MotorModel &model() { return m_model; }
+
+    private:
+        MotorModel m_model;
+        double m_angle = 0.0;     // rad
+        double m_speed = 0.0;     // rad/s
+        double m_loadAngle = 0.0; // rad
+        double m_loadSpeed = 0.0; // rad/s
+        float m_current = 0.0f;
+    };
+}; // namespace Lpf2::Sim
@@ -0,0 +1,192 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include "Lpf2/LWPConst.hpp"
+#include <functional>
+#include <istream>
+
+namespace Lpf2::Sim
+{
+    /**
+     * @brief Fake LWP hub for host builds, answers Lpf2::Hub from a dump of
+     * Hub::getAllInfoStr() (docs/DeviceModes/Technic_Hub.txt).
+     *
+     * The dump gives the hub properties, the device blocks and, from the
+     * "Attached IO" log lines, the ports. The hub answers property, port
+     * information and mode information requests and input format setups,
+     * acknowledges output commands (with feedback if asked for, moves take
+     * time with setMoveTimeMs()) and sends
+     * values on request of the application (sendValue()). A port is
+     * described by the first device block of its type.
+     */
+    class ScriptedHub
+    {
+    public:
+        using Sender = std::function<void(const uint8_t *data, size_t length)>;
+
+        struct Stats
+        {
+            uint32_t received = 0;       // messages from the client
+            uint32_t sent = 0;           // messages to the client
+            uint32_t infoRequests = 0;   // port and mode information requests
+            uint32_t outputCommands = 0; // PORT_OUTPUT_COMMAND
+            uint32_t propertyUpdates = 0; // HUB_PROPERTIES updates sent on their own (setPropertyUpdateMs())
+            uint32_t errors = 0;         // GENERIC_ERROR_MESSAGES sent
+        };
+
+        /**
+         * @returns 0, -1 if the file cannot be read, -2 if it describes no device
+         */
+        int load(const char *path);
+        int load(std::istream &in);
+
+        /**
+         * @brief Attach a device described in the dump to one more port,
+         * before connect().
+         * @returns 0, -1 if the dump has no block for @p type
+         */
+        int attachIO(PortNum port, DeviceType type, Version hw = Version(), Version fw = Version());
+
+        /**
+         * @brief Where messages to the client go (Sim::HubLoopback).
+         */
+        void setSender(Sender sender) { m_sender = std::move(sender); }
+
+        /**
+         * @brief Send HUB_ATTACHED_IO for every port, like a hub does after
+         * the client subscribed.
+         */
+        void connect();
+
+        /**
+         * @brief A message from the client (common header included).
+         */
+        void receive(const uint8_t *data, size_t length);
+
+        /**
+         * @brief Send PORT_VALUE_SINGLE for @p port in the mode its input
+         * format is set to, every data set set to @p value.
+         * @returns 0, -1 if no input format is set up on the port
+         */
+        int sendValue(PortNum port, int32_t value);
+
+        /**
+         * @brief Let every move (speed for time / degrees, go to position)
+         * run for @p ms, with the command buffer of a hub: one command runs,
+         * one waits, an immediate one discards both. 0 (the default)
+         * completes every command at once.
+         */
+        void setMoveTimeMs(uint32_t ms) { m_moveUs = ms * 1000ull; }
+
+        /**
+         * @brief Let RSSI and the battery voltage change every @p ms, each
+         * sent if its updates are enabled, like a hub does. 0 (the default)
+         * keeps them still.
+         */
+        void setPropertyUpdateMs(uint32_t ms) { m_propertyUs = ms * 1000ull; }
+
+        /**
+         * @brief End the moves whose time ran out and send the property
+         * updates that are due (Sim::HubLoopback::poll()).
+         */
+        void tick(uint64_t nowUs);
+
+        const std::vector<PortNum> &ports() const { return m_portOrder; }
+        const Stats &stats() const { return m_stats; }
+        void resetStats()
+        {
+            m_stats = Stats();
+            m_outputLog.clear();
+        }
+
+        /**
+         * @brief The sub commands of the output commands received since
+         * resetStats(), in arrival order.
+         */
+        const std::vector<uint8_t> &outputLog() const { return m_outputLog; }
+
+    private:
+        struct ModeInfo
+        {
+            std::string name;
+            std::string unit;
+            float raw[2] = {};
+            float pct[2] = {};
+            float si[2] = {};
+            uint8_t dataSets = 1;
+            uint8_t format = 0;
+            uint8_t figures = 0;
+            uint8_t decimals = 0;
+            uint8_t in = 0;
+            uint8_t out = 0;
+            uint8_t flags[6] = {}; // Mode::flags.bytes
+        };
+
+        struct DeviceInfo
+        {
+            DeviceType type = DeviceType::UNKNOWNDEVICE;
+            uint16_t inModes = 0;
+            uint16_t outModes = 0;
+            uint8_t caps = 0;
+            std::vector<uint16_t> combos;
+            std::vector<ModeInfo> modes;
+        };
+
+        struct PortState
+        {
+            const DeviceInfo *device = nullptr;
+            Version hw;
+            Version fw;
+            bool inputSet = false;
+            uint8_t inputMode = 0;
+            // Command buffer (setMoveTimeMs())
+            bool running = false;
+            bool runningFeedback = false;
+            uint64_t runningEndUs = 0;
+            bool buffered = false;
+            bool bufferedFeedback = false;
+        };
+
+        const DeviceInfo *findDevice(DeviceType type) const;
+        void send(MessageType type, const std::vector<uint8_t> &payload);
+        void sendError(MessageType type, GenericErrorType error);
+        void handleProperty(const uint8_t *msg, size_t length);
+        void handlePortInfo(const uint8_t *msg, size_t length);
+        void handleModeInfo(const uint8_t *msg, size_t length);
+        void handleInputFormat(const uint8_t *msg, size_t length);
+        void handleOutputCommand(const uint8_t *msg, size_t length);
+        void sendFeedback(PortNum port, uint8_t feedback);
+        void sendProperty(HubPropertyType prop);
+
+        std::vector<DeviceInfo> m_devices;
+        std::vector<uint8_t> m_props[(unsigned int)HubPropertyType::END];
+        std::vector<PortNum> m_portOrder;
+        PortState m_ports[256];
+        uint64_t m_moveUs = 0;
+        uint64_t m_propertyUs = 0;
+        uint64_t m_nextPropertyUs = 0;
+        uint32_t m_propertyTicks = 0;
+        uint32_t m_propUpdates = 0; // properties with updates enabled, by bit
+        uint64_t m_nowUs = 0;
+        Sender m_sender;
+        Stats m_stats;
+        std::vector<uint8_t> m_outputLog;
+    };
+}; // namespace Lpf2::Sim
@@ -0,0 +1,171 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include "Lpf2/Port.hpp"
+#include <atomic>
+
+namespace Lpf2
+{
+    /**
+     * @brief Double-buffered snapshot of decoded values from any number of ports.
+     *
+     * Each channel is one (port, mode, dataset). Ports publish into the live
+     * buffer as frames arrive (through Port::subscribe(), on the port's own
+     * task). The consumer calls flip() at its tick boundary, which copies the
+     * live buffer into the front frame: contiguous structure-of-arrays
+     * value / timestamp blocks that stay unchanged until the next flip().
+     *
+     * Fixed capacity, no allocation after addChannel(). The ports must outlive
+     * the buffer; flip() and the front-frame accessors belong to one consumer task.
+     * clear() and the destructor wait for a publish in progress on a port's
+     * task (Port::unsubscribe()), so the buffer can be destroyed while the
+     * ports keep receiving frames, but not from one of its own callbacks.
+     *
+     * @tparam N maximum number of channels
+     */
+    template <size_t N>
+    class SnapshotBuffer
+    {
+    public:
+        SnapshotBuffer() = default;
+        SnapshotBuffer(const SnapshotBuffer &) = delete;
+        SnapshotBuffer &operator=(const SnapshotBuffer &) = delete;
+
+        ~SnapshotBuffer() { clear(); }
+
+        /**
+         * @brief Add a channel, published on every frame of the mode.
+         * @returns channel index, -1 if the buffer is full or the port has no free subscription slot
+         */
+        int addChannel(Port &port, uint8_t modeNum, uint8_t dataSet)
+        {
+            if (m_count >= N)
+                return -1;
+            size_t ch = m_count;
+            int id = port.subscribe(modeNum, dataSet, 0.0f, 0,
+                [this, ch](uint8_t, uint8_t, float value)
+                {
+                    publish(ch, value, LPF2_GET_TIME_US());
+                });
+            if (id < 0)
+                return -1;
+            m_ports[ch] = &port;
+            m_subIds[ch] = id;
+            m_count++;
+            return (int)ch;
+        }
+
+        /**
+         * @brief Remove every channel (unsubscribes from the ports).
+         */
+        void clear()
+        {
+            for (size_t ch = 0; ch < m_count; ch++)
+                m_ports[ch]->unsubscribe(m_subIds[ch]);
+            m_count = 0;
+        }
+
+        size_t channelCount() const { return m_count; }
+
+        /**
+         * @brief Take the latest published values as the new front frame.
+         * Channels that did not get a frame since the last flip keep their value.
+         */
+        void flip()
+        {
+            for (size_t ch = 0; ch < m_count; ch++)
+            {
+                const Live &live = m_live[ch];
+                m_prevUpdates[ch] = m_updates[ch];
+                // Per-channel seqlock: odd = write in progress, retry a few times.
+                for (int attempt = 0; attempt < 4; attempt++)
+                {
+                    uint32_t before = live.seq.load(std::memory_order_acquire);
+                    if (before & 1)
+                        continue;
+                    float value = live.value.load(std::memory_order_relaxed);
+                    uint64_t timeUs = live.timeLo.load(std::memory_order_relaxed) |
+                                      (uint64_t)live.timeHi.load(std::memory_order_relaxed) << 32;
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (live.seq.load(std::memory_order_relaxed) != before)
+                        continue;
+                    m_values[ch] = value;
+                    m_timesUs[ch] = timeUs;
+                    m_updates[ch] = before >> 1;
+                    break;
+                }
+            }
+            m_flipTimeUs = LPF2_GET_TIME_US();
+        }
+
+        /// Front frame values, indexed by channel.
+        const float *values() const { return m_values; }
+
+        /// Front frame receive timestamps (LPF2_GET_TIME_US()), indexed by channel.
+        const uint64_t *timesUs() const { return m_timesUs; }
+
+        float value(size_t ch) const { return ch < m_count ? m_values[ch] : 0.0f; }
+
+        /**
+         * @returns true if the channel got at least one frame between the last two flips
+         */
+        bool updated(size_t ch) const { return ch < m_count && m_updates[ch] != m_prevUpdates[ch]; }
+
+        /// Time of the last flip() (LPF2_GET_TIME_US()).
+        uint64_t flipTimeUs() const { return m_flipTimeUs; }
+
+    private:
+        // Relaxed atomics under the seqlock, the 64-bit time in two halves
+        // so that every field stays lock-free on 32-bit targets.
+        struct Live
+        {
+            std::atomic<uint32_t> seq{0};
+            std::atomic<float> value{0.0f};
+            std::atomic<uint32_t> timeLo{0};
+            std::atomic<uint32_t> timeHi{0};
+        };
+
+        // Producer side, one writer per channel (its port's task).
+        void publish(size_t ch, float value, uint64_t timeUs)
+        {
+            Live &live = m_live[ch];
+            uint32_t seq = live.seq.load(std::memory_order_relaxed);
+            live.seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            live.value.store(value, std::memory_order_relaxed);
+            live.timeLo.store((uint32_t)timeUs, std::memory_order_relaxed);
+            live.timeHi.store((uint32_t)(timeUs >> 32), std::memory_order_relaxed);
+            live.seq.store(seq + 2, std::memory_order_release);
+        }
+
+        Live m_live[N];
+
+        // Front frame, structure of arrays.
+        float m_values[N] = {};
+        uint64_t m_timesUs[N] = {};
+        uint32_t m_updates[N] = {};
+        uint32_t m_prevUpdates[N] = {};
+        uint64_t m_flipTimeUs = 0;
+
+        Port *m_ports[N] = {};
+        int m_subIds[N] = {};
+        size_t m_count = 0;
+    };
+}; // namespace Lpf2
@@ -0,0 +1,56 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Lpf2::Utils
+{
+    /**
+     * @brief Non-owning view of bytes (std::span<const uint8_t> is not in
+     * every toolchain the library builds with).
+     */
+    class ByteSpan
+    {
+    public:
+        constexpr ByteSpan() = default;
+        constexpr ByteSpan(const uint8_t *data, size_t size) : m_data(data), m_size(size) {}
+        ByteSpan(const std::vector<uint8_t> &data) : m_data(data.data()), m_size(data.size()) {}
+
+        constexpr const uint8_t *data() const { return m_data; }
+        constexpr size_t size() const { return m_size; }
+        constexpr bool empty() const { return m_size == 0; }
+        constexpr uint8_t operator[](size_t i) const { return m_data[i]; }
+        constexpr const uint8_t *begin() const { return m_data; }
+        constexpr const uint8_t *end() const { return m_data + m_size; }
+
+        /**
+         * @brief The bytes from @p offset on, empty if @p offset is past the end.
+         */
+        constexpr ByteSpan subspan(size_t offset) const
+        {
+            return offset < m_size ? ByteSpan(m_data + offset, m_size - offset) : ByteSpan();
+        }
+
+    private:
+        const uint8_t *m_data = nullptr;
+        size_t m_size = 0;
+    };
+}; // namespace Lpf2::Utils
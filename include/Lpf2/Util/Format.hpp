@@ -0,0 +1,107 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace Lpf2::Utils
+{
+    /**
+     * @brief snprintf-style appender over a caller-provided buffer.
+     *
+     * Never allocates. Output that does not fit is dropped but still counted,
+     * so length() is what snprintf() would return: the number of characters
+     * a large enough buffer would hold, without the terminating NUL.
+     * The buffer is always NUL-terminated (if size > 0); buf may be nullptr
+     * when size == 0, to only measure.
+     */
+    class StrBuf
+    {
+    public:
+        StrBuf(char *buf, size_t size) : m_buf(buf), m_size(buf ? size : 0)
+        {
+            if (m_size)
+                m_buf[0] = '\0';
+        }
+
+        void printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+        {
+            va_list args;
+            va_start(args, fmt);
+            int n = vsnprintf(m_len < m_size ? m_buf + m_len : nullptr,
+                              m_len < m_size ? m_size - m_len : 0, fmt, args);
+            va_end(args);
+            if (n > 0)
+                m_len += n;
+        }
+
+        void append(const char *str, size_t len)
+        {
+            if (m_len < m_size)
+            {
+                size_t n = std::min(len, m_size - m_len - 1);
+                std::memcpy(m_buf + m_len, str, n);
+                m_buf[m_len + n] = '\0';
+            }
+            m_len += len;
+        }
+
+        void append(const char *str) { append(str, std::strlen(str)); }
+
+        /**
+         * @brief Account for @p len characters written directly at the end of
+         * the buffer by another snprintf-style formatter.
+         */
+        void skip(size_t len) { m_len += len; }
+
+        /// Length of the full output, see class description.
+        size_t length() const { return m_len; }
+
+    private:
+        char *m_buf;
+        size_t m_size;
+        size_t m_len = 0;
+    };
+
+    /**
+     * @brief Produce a std::string from a buffer formatter.
+     * Used to keep the std::string APIs as thin wrappers around the buffer ones.
+     * The formatter runs once if the output fits in @p sizeHint, twice otherwise.
+     * @param format callable with signature size_t(char *buf, size_t size)
+     */
+    template <typename Fn>
+    std::string formatToString(Fn &&format, size_t sizeHint = 64)
+    {
+        std::string str(sizeHint, '\0');
+        size_t len = format(str.data(), str.size() + 1);
+        if (len > sizeHint)
+        {
+            str.resize(len);
+            format(str.data(), str.size() + 1);
+        }
+        else
+        {
+            str.resize(len);
+        }
+        return str;
+    }
+}; // namespace Lpf2::Utils
@@ -0,0 +1,115 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/LWPConst.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace Lpf2::Utils
+{
+    /**
+     * @brief Per-port state indexed by port number: one pointer per
+     * possible PortNum and an occupancy bitmap.
+     *
+     * find() is a single indexed load. Entries are allocated once, when a
+     * port is first seen, and keep their address until erase() / clear(),
+     * so they can be referenced from callbacks. forEach() visits the used
+     * ports in ascending order by walking the bitmap.
+     */
+    template <typename T>
+    class PortTable
+    {
+    public:
+        static constexpr size_t PORTS = 256;
+
+        PortTable() = default;
+        ~PortTable() { clear(); }
+
+        PortTable(const PortTable &) = delete;
+        PortTable &operator=(const PortTable &) = delete;
+
+        /**
+         * @returns the entry of @p port, nullptr if there is none
+         */
+        T *find(PortNum port) const { return m_entries[port]; }
+
+        bool contains(PortNum port) const { return m_used[port >> 5] & (1u << (port & 31)); }
+
+        /**
+         * @brief The entry of @p port, constructed from @p args if there is none.
+         */
+        template <typename... Args>
+        T &get(PortNum port, Args &&...args)
+        {
+            T *entry = m_entries[port];
+            if (!entry)
+            {
+                entry = new T(std::forward<Args>(args)...);
+                m_entries[port] = entry;
+                m_used[port >> 5] |= 1u << (port & 31);
+                m_size++;
+            }
+            return *entry;
+        }
+
+        void erase(PortNum port)
+        {
+            if (!m_entries[port])
+                return;
+            delete m_entries[port];
+            m_entries[port] = nullptr;
+            m_used[port >> 5] &= ~(1u << (port & 31));
+            m_size--;
+        }
+
+        void clear()
+        {
+            forEach([this](PortNum port, T &)
+                    { erase(port); });
+        }
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+        /**
+         * @brief Call @p f(PortNum, T &) for every entry, in port order.
+         * @p f may erase the entry it was called with.
+         */
+        template <typename F>
+        void forEach(F &&f) const
+        {
+            for (size_t word = 0; word < PORTS / 32; word++)
+            {
+                uint32_t bits = m_used[word];
+                while (bits)
+                {
+                    PortNum port = (PortNum)(word * 32 + __builtin_ctz(bits));
+                    bits &= bits - 1;
+                    f(port, *m_entries[port]);
+                }
+            }
+        }
+
+    private:
+        T *m_entries[PORTS] = {};
+        uint32_t m_used[PORTS / 32] = {};
+        size_t m_size = 0;
+    };
+}; // namespace Lpf2::Utils
@@ -0,0 +1,203 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#pragma once
+
+#include "Lpf2/config.hpp"
+#include <atomic>
+#include <memory>
+
+namespace Lpf2::Utils
+{
+    /**
+     * @brief Fixed-capacity ring of timestamped raw mode samples.
+     *
+     * One writer (the task that runs the port's update()), any number of
+     * readers. Storage is allocated once in the constructor, push() never
+     * allocates. Every slot is a seqlock over relaxed atomics, so a reader
+     * that was lapped by the writer while copying a slot drops that sample
+     * instead of returning torn data. Readers never block the writer.
+     *
+     * Samples are addressed by their absolute index (0 = first sample ever
+     * pushed); the ring holds the indices [oldest(), head()). Indices are
+     * 32-bit and wrap (after 49 days at 1 kHz): compare them by their
+     * difference, `(int32_t)(a - b) < 0`, not with `<`. forEach() and
+     * bracket() do.
+     */
+    class SampleRing
+    {
+    public:
+        static constexpr size_t RAW_SIZE = LPF2_SAMPLE_RAW_SIZE;
+
+        struct Sample
+        {
+            uint64_t timeUs = 0; // receive time (LPF2_GET_TIME_US())
+            uint8_t len = 0;     // valid bytes in raw
+            uint8_t raw[RAW_SIZE] = {};
+        };
+
+        explicit SampleRing(size_t capacity)
+            : m_slots(new Slot[capacity ? capacity : 1]), m_capacity(capacity ? capacity : 1)
+        {
+        }
+
+        SampleRing(const SampleRing &) = delete;
+        SampleRing &operator=(const SampleRing &) = delete;
+
+        size_t capacity() const { return m_capacity; }
+
+        /**
+         * @returns index of the next sample to be written (number of samples pushed so far, wrapping)
+         */
+        uint32_t head() const { return m_head.load(std::memory_order_acquire); }
+
+        /**
+         * @returns index of the oldest sample still held by the ring
+         */
+        uint32_t oldest() const
+        {
+            uint32_t h = head();
+            return m_full.load(std::memory_order_relaxed) ? h - (uint32_t)m_capacity : 0;
+        }
+
+        /**
+         * @brief Append a sample. Writer side only.
+         * Bytes beyond RAW_SIZE are dropped.
+         */
+        void push(const uint8_t *data, size_t len, uint64_t timeUs)
+        {
+            uint32_t idx = m_head.load(std::memory_order_relaxed);
+            Slot &slot = m_slots[idx % m_capacity];
+            uint8_t n = (uint8_t)(data ? (len < RAW_SIZE ? len : RAW_SIZE) : 0);
+            uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+            slot.seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.index.store(idx, std::memory_order_relaxed);
+            slot.timeLo.store((uint32_t)timeUs, std::memory_order_relaxed);
+            slot.timeHi.store((uint32_t)(timeUs >> 32), std::memory_order_relaxed);
+            slot.len.store(n, std::memory_order_relaxed);
+            for (uint8_t i = 0; i < n; i++)
+                slot.raw[i].store(data[i], std::memory_order_relaxed);
+            slot.seq.store(seq + 2, std::memory_order_release);
+            if (idx + 1 == (uint32_t)m_capacity)
+                m_full.store(true, std::memory_order_relaxed);
+            m_head.store(idx + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Copy the sample with absolute index @p index.
+         * @returns false if the sample is not written yet or was overwritten
+         */
+        bool read(uint32_t index, Sample &out) const
+        {
+            if ((int32_t)(index - head()) >= 0)
+                return false;
+            const Slot &slot = m_slots[index % m_capacity];
+            uint32_t before = slot.seq.load(std::memory_order_acquire);
+            if ((before & 1) || slot.index.load(std::memory_order_relaxed) != index)
+                return false;
+            out.timeUs = slot.timeLo.load(std::memory_order_relaxed) |
+                         (uint64_t)slot.timeHi.load(std::memory_order_relaxed) << 32;
+            out.len = slot.len.load(std::memory_order_relaxed);
+            for (uint8_t i = 0; i < out.len; i++)
+                out.raw[i] = slot.raw[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return slot.seq.load(std::memory_order_relaxed) == before;
+        }
+
+        /**
+         * @brief Read the most recent sample.
+         * @returns false if the ring is empty
+         */
+        bool latest(Sample &out) const
+        {
+            uint32_t h = head();
+            return (h || m_full.load(std::memory_order_relaxed)) && read(h - 1, out);
+        }
+
+        /**
+         * @brief Call fn(index, sample) for every sample from @p from up to head().
+         * Samples that were overwritten before they could be read are skipped,
+         * a cursor outside [oldest(), head()] starts at oldest().
+         * @returns the cursor to pass as @p from on the next call
+         */
+        template <typename Fn>
+        uint32_t forEach(uint32_t from, Fn &&fn) const
+        {
+            uint32_t h = head();
+            uint32_t first = m_full.load(std::memory_order_relaxed) ? h - (uint32_t)m_capacity : 0;
+            if ((int32_t)(from - first) < 0 || (int32_t)(h - from) < 0)
+                from = first;
+            Sample s;
+            for (; from != h; from++)
+            {
+                if (read(from, s))
+                    fn(from, s);
+            }
+            return h;
+        }
+
+        /**
+         * @brief Find the two samples that bracket @p timeUs.
+         * @param before newest sample with timeUs <= @p timeUs
+         * @param after oldest sample with timeUs > @p timeUs, equals before if
+         * @p timeUs is at or past the newest sample
+         * @returns false if @p timeUs is older than everything held
+         */
+        bool bracket(uint64_t timeUs, Sample &before, Sample &after) const
+        {
+            uint32_t hi = head();
+            uint32_t first = m_full.load(std::memory_order_relaxed) ? hi - (uint32_t)m_capacity : 0;
+            uint32_t lo = first;
+            Sample s;
+            // Binary search for the first sample newer than timeUs. A failed
+            // read means the slot was just overwritten, i.e. it is old.
+            while (lo != hi)
+            {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (!read(mid, s) || s.timeUs <= timeUs)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if (lo == first || !read(lo - 1, before) || before.timeUs > timeUs)
+                return false;
+            if (!read(lo, after))
+                after = before;
+            return true;
+        }
+
+    private:
+        // seq is odd while the slot is written. The payload is relaxed
+        // atomics under it, the 64-bit time in two halves so that every
+        // field stays lock-free on 32-bit targets.
+        struct Slot
+        {
+            std::atomic<uint32_t> seq{0};
+            std::atomic<uint32_t> index{0};
+            std::atomic<uint32_t> timeLo{0};
+            std::atomic<uint32_t> timeHi{0};
+            std::atomic<uint8_t> len{0};
+            std::atomic<uint8_t> raw[RAW_SIZE] = {};
+        };
+
+        std::unique_ptr<Slot[]> m_slots;
+        size_t m_capacity;
+        std::atomic<uint32_t> m_head{0};
+        std::atomic<bool> m_full{false}; // head() has passed the capacity once
+    };
+}; // namespace Lpf2::Utils
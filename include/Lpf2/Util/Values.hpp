@@ -28,6 +28,17 @@ namespace Lpf2::Utils
     std::string bytes_to_hexString(const std::string &data);
     std::string byte_to_hexString(uint8_t data);
 
+    /**
+     * @brief Write "0xAA, 0xBB, ..." into @p buf without allocating.
+     * snprintf() semantics: returns the length of the full output,
+     * at most @p size bytes are written (NUL-terminated).
+     */
+    size_t bytes_to_hexString(char *buf, size_t size, const uint8_t *data, size_t len);
+
     std::vector<uint8_t> packVersion(Version version);
     Version unPackVersion(std::vector<uint8_t> version);
+    /**
+     * @brief Unpack from 4 bytes (no size check).
+     */
+    Version unPackVersion(const uint8_t *version);
 } // namespace Lpf2Utils
\ No newline at end of file
@@ -187,12 +187,18 @@ namespace Lpf2::Virtual
             m_userData = data;
         }
 
-        void setModeData(uint8_t modeNum, const std::vector<uint8_t> &data)
+        /**
+         * @brief set the raw data of a mode
+         * @param notify call the value change callback, pass false when
+         * updating several modes that are sent together (combined mode)
+         * and notify only on the last one
+         */
+        void setModeData(uint8_t modeNum, const std::vector<uint8_t> &data, bool notify = true)
         {
             if (modeNum < m_modes.size())
             {
                 m_modes[modeNum].rawData = data;
-                if (m_valueChangeCallback)
+                if (notify && m_valueChangeCallback)
                 {
                     m_valueChangeCallback(modeNum);
                 }
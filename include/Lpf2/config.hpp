@@ -17,12 +17,100 @@
 
 #pragma once
 
-#include <esp_timer.h>
 #include <string>
 #include <vector>
+#include <cstdint>
+
+/**
+ * Time source (microseconds since startup). Can be overridden by defining
+ * LPF2_GET_TIME_US() before this header is included (e.g. with a build flag).
+ * Host builds (LPF2_NATIVE) read lpf2_host_time_us(), provided by the
+ * simulator's virtual clock (Lpf2::Sim::Clock).
+ */
+#ifndef LPF2_GET_TIME_US
+#if defined(LPF2_NATIVE)
+extern "C" uint64_t lpf2_host_time_us(void);
+#define LPF2_GET_TIME_US() (lpf2_host_time_us())
+#else
+#include <esp_timer.h>
+#define LPF2_GET_TIME_US() ((uint64_t)esp_timer_get_time())
+#endif
+#endif
+
+#define LPF2_GET_TIME() ((size_t)(LPF2_GET_TIME_US() / 1000))
+
+/**
+ * Local::Port's motor controller (updateMotorPID()) runs in float by
+ * default. Define LPF2_PID_FIXED to build the fixed-point version instead:
+ * integer observer, position ramp and PID, no float or double per tick.
+ * See docs/motor-tuning.md.
+ */
+
+/**
+ * Define LPF2_PID_PROFILE to count the cycles Local::Port::updateMotorPID()
+ * takes (Port::getPidProfile()). LPF2_GET_CYCLES() is the cycle counter and
+ * can be overridden like LPF2_GET_TIME_US(). Host builds read
+ * lpf2_host_cycles() (the TSC on x86).
+ */
+#if defined(LPF2_PID_PROFILE) && !defined(LPF2_GET_CYCLES)
+#if defined(LPF2_NATIVE)
+extern "C" uint32_t lpf2_host_cycles(void);
+#define LPF2_GET_CYCLES() (lpf2_host_cycles())
+#else
+#include <xtensa/hal.h>
+#define LPF2_GET_CYCLES() ((uint32_t)xthal_get_ccount())
+#endif
+#endif
+
 #include "Lpf2/log/log.h"
 #include "Lpf2/Util/Utils.hpp"
 
-#define LPF2_GET_TIME() (((size_t)esp_timer_get_time() / 1000))
+/**
+ * Bytes of raw data kept per sample in a port's history ring
+ * (Lpf2::Utils::SampleRing), longer mode payloads are truncated.
+ */
+#ifndef LPF2_SAMPLE_RAW_SIZE
+#define LPF2_SAMPLE_RAW_SIZE 16
+#endif
+
+/**
+ * Value subscription slots per port (Lpf2::Port::subscribe()), max 32.
+ */
+#ifndef LPF2_MAX_SUBSCRIBERS
+#define LPF2_MAX_SUBSCRIBERS 16
+#endif
+
+/**
+ * Discovery requests (hub properties, port and mode information) Lpf2::Hub
+ * keeps in flight at once, Hub::setInfoWindow() can lower it at run time.
+ */
+#ifndef LPF2_HUB_INFO_WINDOW
+#define LPF2_HUB_INFO_WINDOW 8
+#endif
+
+/**
+ * Output commands Lpf2::Hub queues per port between two connection events
+ * (after coalescing), further ones are dropped.
+ */
+#ifndef LPF2_HUB_OUTPUT_QUEUE
+#define LPF2_HUB_OUTPUT_QUEUE 8
+#endif
+
+/**
+ * Bytes of a hub property value handed to Lpf2::Hub's property
+ * subscriptions (Hub::subscribeHubProperty()), longer values are truncated.
+ */
+#ifndef LPF2_HUB_PROPERTY_SIZE
+#define LPF2_HUB_PROPERTY_SIZE 16
+#endif
+
+/**
+ * Hubs one Lpf2::HubPool can hold. Over BLE, NimBLE's
+ * CONFIG_BT_NIMBLE_MAX_CONNECTIONS has to allow as many connections.
+ */
+#ifndef LPF2_HUB_POOL_SIZE
+#define LPF2_HUB_POOL_SIZE 4
+#endif
 
-#define HUB_EMULATION_MSG_RECEIVE_TASK_PRIORITY 6
\ No newline at end of file
+#define HUB_EMULATION_MSG_RECEIVE_TASK_PRIORITY 6
+#define HUB_POOL_TASK_PRIORITY 5
\ No newline at end of file
@@ -211,7 +211,11 @@ uint16_t lpf2_get_runtime_log_level();
 void lpf2_set_runtime_log_level(uint16_t level);
 
 int lpf2_log_printf(const char *fmt, ...);
+#if defined(LPF2_NATIVE)
+int lpf2_log_init(void);
+#else
 esp_err_t lpf2_log_init(void);
+#endif
 
 #ifdef __cplusplus
 }
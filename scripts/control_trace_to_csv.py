@@ -0,0 +1,72 @@
+# Copyright (C) 2026 - Rbel12b
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+# Decodes a Lpf2::Local::ControlTrace dump (ControlTrace::writeHeader()
+# followed by ControlTrace::dump() output) into CSV.
+
+import struct
+import sys
+
+HEADER = struct.Struct("<4sBBxx")
+# ControlTrace::Record, see include/Lpf2/Local/ControlTrace.hpp
+RECORD = struct.Struct("<QqqqiiiiiihHBB2x")
+
+MODES = {1: "SPEED", 2: "POSITION", 3: "HOLD", 4: "AUTOTUNE"}
+SUB_MODES = {0: "", 1: "COARSE", 2: "FINE", 3: "TRACKING"}
+
+COLUMNS = [
+    "time_ms", "dt_ms", "mode", "sub_mode",
+    "target_deg", "ramp_deg", "measured_deg",
+    "speed_dps", "ref_speed_dps",
+    "ff_pct", "p_pct", "i_pct", "d_pct", "power_pct",
+]
+
+def decode(data: bytes):
+    if len(data) < HEADER.size:
+        raise ValueError("no header")
+    magic, version, size = HEADER.unpack_from(data, 0)
+    if magic != b"LPCT":
+        raise ValueError("not a control trace")
+    if version != 1 or size != RECORD.size:
+        raise ValueError(f"unsupported format version {version}, record size {size}")
+
+    rows = []
+    for off in range(HEADER.size, len(data) - RECORD.size + 1, RECORD.size):
+        (time_us, target, ramp, measured, speed, ref_speed,
+         ff, p, i, d, power, dt, mode, sub) = RECORD.unpack_from(data, off)
+        rows.append([
+            f"{time_us / 1000:.3f}", dt, MODES.get(mode, mode), SUB_MODES.get(sub, sub),
+            f"{target / 1000:.3f}", f"{ramp / 1000:.3f}", f"{measured / 1000:.3f}",
+            f"{speed / 1000:.3f}", f"{ref_speed / 1000:.3f}",
+            f"{ff / 1000:.3f}", f"{p / 1000:.3f}", f"{i / 1000:.3f}", f"{d / 1000:.3f}", power,
+        ])
+    return rows
+
+def main(path_in, out):
+    with open(path_in, "rb") as f:
+        rows = decode(f.read())
+    out.write(",".join(COLUMNS) + "\n")
+    for row in rows:
+        out.write(",".join(str(v) for v in row) + "\n")
+
+if __name__ == "__main__":
+    if len(sys.argv) not in (2, 3):
+        print("Usage: python control_trace_to_csv.py trace.bin [out.csv]")
+        sys.exit(1)
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], "w") as f:
+            main(sys.argv[1], f)
+    else:
+        main(sys.argv[1], sys.stdout)
@@ -18,14 +18,18 @@
 #include "Lpf2/Battery.hpp"
 #include "Lpf2/log/log.h"
 
-#if defined(ARDUINO)
+#if defined(LPF2_NATIVE)
+// Host build: no ADC, the voltage is set with setCurrentVoltage().
+#elif defined(ARDUINO)
 #include <Arduino.h>
 #else
 #include <esp_adc/adc_oneshot.h>
 #include <esp_adc/adc_cali.h>
 #include <esp_adc/adc_cali_scheme.h>
 #endif
+#if !defined(LPF2_NATIVE)
 #include <esp_err.h>
+#endif
 
 namespace Lpf2::Battery
 {
@@ -55,7 +59,8 @@ namespace Lpf2::Battery
         float   g_divider_ratio = 1.0f; // (Rt+Rb)/Rb
         uint8_t g_adc_samples = 8;
 
-#ifndef ARDUINO
+#if defined(LPF2_NATIVE)
+#elif !defined(ARDUINO)
         // ESP-IDF ADC state.
         adc_oneshot_unit_handle_t g_adc_handle = nullptr;
         adc_cali_handle_t         g_cali_handle = nullptr;
@@ -94,7 +99,10 @@ namespace Lpf2::Battery
         g_divider_ratio =
             (cfg.r_top_ohms + cfg.r_bottom_ohms) / cfg.r_bottom_ohms;
 
-#ifndef ARDUINO
+#if defined(LPF2_NATIVE)
+        (void)cfg.vref_mv;
+        return false;
+#elif !defined(ARDUINO)
         // Tear down any prior init (idempotent reconfigure).
         if (g_cali_handle)
         {
@@ -173,6 +181,9 @@ namespace Lpf2::Battery
 
     uint16_t readBatteryVoltage()
     {
+#if defined(LPF2_NATIVE)
+        return 0;
+#else
 #ifndef ARDUINO
         if (!g_adc_handle)
             return 0;
@@ -229,5 +240,6 @@ namespace Lpf2::Battery
         uint16_t v_batt = (uint16_t)v_batt_f;
         setCurrentVoltage(v_batt);
         return v_batt;
+#endif // LPF2_NATIVE
     }
 }; // namespace Lpf2::Battery
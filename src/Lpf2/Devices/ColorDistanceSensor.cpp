@@ -76,7 +76,7 @@ namespace Lpf2::Devices
             setMode(MODE_COLOR);
         }
 
-        return ColorIDX((int)m_port.getValue(MODE_COLOR, 0));
+        return ColorIDX(m_port.getRaw<uint8_t>(MODE_COLOR, 0));
     }
 
     float ColorDistanceSensor::getDistance()
@@ -116,9 +116,9 @@ namespace Lpf2::Devices
             setMode(MODE_RGB);
         }
 
-        r = static_cast<uint16_t>(m_port.getValue(MODE_RGB, 0));
-        g = static_cast<uint16_t>(m_port.getValue(MODE_RGB, 1));
-        b = static_cast<uint16_t>(m_port.getValue(MODE_RGB, 2));
+        r = m_port.getRaw<uint16_t>(MODE_RGB, 0);
+        g = m_port.getRaw<uint16_t>(MODE_RGB, 1);
+        b = m_port.getRaw<uint16_t>(MODE_RGB, 2);
     }
 
     void ColorDistanceSensor::setIrTx(uint16_t value)
@@ -71,7 +71,7 @@ namespace Lpf2::Devices
             setMode(MODE_COLOR);
         }
 
-        return ColorIDX((int)m_port.getValue(MODE_COLOR, 0));
+        return ColorIDX(m_port.getRaw<uint8_t>(MODE_COLOR, 0));
     }
 
     float TechnicColorSensor::getReflectivity()
@@ -101,9 +101,9 @@ namespace Lpf2::Devices
             setMode(MODE_RGB);
         }
 
-        r = (uint16_t)m_port.getValue(MODE_RGB, 0);
-        g = (uint16_t)m_port.getValue(MODE_RGB, 1);
-        b = (uint16_t)m_port.getValue(MODE_RGB, 2);
+        r = m_port.getRaw<uint16_t>(MODE_RGB, 0);
+        g = m_port.getRaw<uint16_t>(MODE_RGB, 1);
+        b = m_port.getRaw<uint16_t>(MODE_RGB, 2);
     }
 
     void TechnicColorSensor::getHSV(uint16_t &h, uint16_t &s, uint16_t &v)
@@ -113,9 +113,9 @@ namespace Lpf2::Devices
             setMode(MODE_HSV);
         }
 
-        h = (uint16_t)m_port.getValue(MODE_HSV, 0);
-        s = (uint16_t)m_port.getValue(MODE_HSV, 1);
-        v = (uint16_t)m_port.getValue(MODE_HSV, 2);
+        h = m_port.getRaw<uint16_t>(MODE_HSV, 0);
+        s = m_port.getRaw<uint16_t>(MODE_HSV, 1);
+        v = m_port.getRaw<uint16_t>(MODE_HSV, 2);
     }
 
     void TechnicColorSensor::setLight(uint8_t l1, uint8_t l2, uint8_t l3)
@@ -103,15 +103,15 @@ namespace Lpf2::Devices
         m_port.presetEncoder(pos);
     }
 
-    float EncoderMotor::getAbsPosition()
+    int32_t EncoderMotor::getAbsPosition()
     {
         // 2 -> POS mode
-        return m_port.getValue(2, 0);
+        return m_port.getRaw<int32_t>(2, 0);
     }
 
-    float EncoderMotor::getSpeed()
+    int8_t EncoderMotor::getSpeed()
     {
         // 1 -> SPEED mode
-        return m_port.getValue(1, 0);
+        return m_port.getRaw<int8_t>(1, 0);
     }
 }; // namespace Lpf2::Devices
\ No newline at end of file
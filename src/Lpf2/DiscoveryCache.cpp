@@ -0,0 +1,337 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#include "Lpf2/DiscoveryCache.hpp"
+#include "Lpf2/Util/Values.hpp"
+#include "Lpf2/log/log.h"
+#include <algorithm>
+#include <cstring>
+
+#if !defined(LPF2_NATIVE)
+#include <Preferences.h>
+#endif
+
+namespace Lpf2
+{
+    static constexpr uint8_t MAGIC[4] = {'L', '2', 'D', 'C'};
+    static constexpr uint8_t FORMAT_VERSION = 1;
+
+    int MemoryCacheStorage::load(const std::string &key, std::vector<uint8_t> &data)
+    {
+        auto it = m_blobs.find(key);
+        if (it == m_blobs.end())
+            return -1;
+        data = it->second;
+        return 0;
+    }
+
+    int MemoryCacheStorage::store(const std::string &key, const std::vector<uint8_t> &data)
+    {
+        m_blobs[key] = data;
+        return 0;
+    }
+
+#if !defined(LPF2_NATIVE)
+    static std::string nvsKey(const std::string &key)
+    {
+        std::string out;
+        for (char c : key)
+        {
+            if (c != ':' && out.size() < 15)
+                out.push_back(c);
+        }
+        return out;
+    }
+
+    int PreferencesCacheStorage::load(const std::string &key, std::vector<uint8_t> &data)
+    {
+        Preferences prefs;
+        if (!prefs.begin("lpf2cache", true))
+            return -1;
+        std::string k = nvsKey(key);
+        size_t length = prefs.getBytesLength(k.c_str());
+        if (length == 0)
+        {
+            prefs.end();
+            return -1;
+        }
+        data.resize(length);
+        length = prefs.getBytes(k.c_str(), data.data(), data.size());
+        prefs.end();
+        return length == data.size() ? 0 : -1;
+    }
+
+    int PreferencesCacheStorage::store(const std::string &key, const std::vector<uint8_t> &data)
+    {
+        Preferences prefs;
+        if (!prefs.begin("lpf2cache", false))
+            return -1;
+        size_t written = prefs.putBytes(nvsKey(key).c_str(), data.data(), data.size());
+        prefs.end();
+        return written == data.size() ? 0 : -1;
+    }
+
+    void PreferencesCacheStorage::erase(const std::string &key)
+    {
+        Preferences prefs;
+        if (!prefs.begin("lpf2cache", false))
+            return;
+        prefs.remove(nvsKey(key).c_str());
+        prefs.end();
+    }
+#endif
+
+    int DiscoveryCache::load(const std::string &hubId)
+    {
+        m_entries.clear();
+        m_dirty = false;
+        m_hubId = hubId;
+        if (hubId.empty())
+            return -1;
+
+        std::vector<uint8_t> data;
+        if (m_storage.load(hubId, data) != 0)
+            return -1;
+        if (decode(data.data(), data.size(), m_entries) != 0)
+        {
+            LPF2_LOG_W("Discovery cache of %s is unusable, dropped.", hubId.c_str());
+            m_storage.erase(hubId);
+            return -2;
+        }
+        LPF2_LOG_D("Discovery cache of %s: %u ports.", hubId.c_str(), (unsigned)m_entries.size());
+        return 0;
+    }
+
+    int DiscoveryCache::save()
+    {
+        if (!m_dirty || m_hubId.empty())
+            return 0;
+        // Not retried: the next discovery marks it dirty again.
+        m_dirty = false;
+        std::vector<uint8_t> data;
+        encode(m_entries, data);
+        if (m_storage.store(m_hubId, data) != 0)
+        {
+            LPF2_LOG_E("Saving the discovery cache of %s failed.", m_hubId.c_str());
+            return -1;
+        }
+        LPF2_LOG_D("Saved the discovery cache of %s: %u ports, %u bytes.",
+                   m_hubId.c_str(), (unsigned)m_entries.size(), (unsigned)data.size());
+        return 0;
+    }
+
+    void DiscoveryCache::clear()
+    {
+        m_entries.clear();
+        m_dirty = false;
+        if (!m_hubId.empty())
+            m_storage.erase(m_hubId);
+    }
+
+    const DeviceDescriptor *DiscoveryCache::find(PortNum port, DeviceType type, const Version &fw, const Version &hw) const
+    {
+        auto it = m_entries.find(port);
+        if (it == m_entries.end() || it->second.type != type || it->second.fwVersion != fw || it->second.hwVersion != hw)
+            return nullptr;
+        return &it->second;
+    }
+
+    void DiscoveryCache::put(PortNum port, const DeviceDescriptor &desc)
+    {
+        DeviceDescriptor &entry = m_entries[port] = desc;
+        for (auto &mode : entry.modes)
+            mode.rawData.clear();
+        m_dirty = true;
+    }
+
+    static void putU16(std::vector<uint8_t> &out, uint16_t value)
+    {
+        out.push_back(value & 0xFF);
+        out.push_back(value >> 8);
+    }
+
+    static void putString(std::vector<uint8_t> &out, const std::string &str)
+    {
+        size_t length = std::min<size_t>(strnlen(str.c_str(), str.size()), 255);
+        out.push_back((uint8_t)length);
+        out.insert(out.end(), str.begin(), str.begin() + length);
+    }
+
+    static void putFloat(std::vector<uint8_t> &out, float value)
+    {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &value, 4);
+        out.insert(out.end(), bytes, bytes + 4);
+    }
+
+    void DiscoveryCache::encode(const std::unordered_map<PortNum, DeviceDescriptor> &entries, std::vector<uint8_t> &out)
+    {
+        out.assign(MAGIC, MAGIC + sizeof(MAGIC));
+        out.push_back(FORMAT_VERSION);
+        out.push_back((uint8_t)entries.size());
+        for (const auto &[port, desc] : entries)
+        {
+            out.push_back(port);
+            putU16(out, (uint16_t)desc.type);
+            auto fw = Utils::packVersion(desc.fwVersion);
+            auto hw = Utils::packVersion(desc.hwVersion);
+            out.insert(out.end(), fw.begin(), fw.end());
+            out.insert(out.end(), hw.begin(), hw.end());
+            out.push_back(desc.caps);
+            putU16(out, desc.inModesMask);
+            putU16(out, desc.outModesMask);
+            out.push_back((uint8_t)desc.combos.size());
+            for (uint16_t combo : desc.combos)
+                putU16(out, combo);
+            out.push_back((uint8_t)desc.modes.size());
+            for (const auto &mode : desc.modes)
+            {
+                putString(out, mode.name);
+                putString(out, mode.unit);
+                for (float value : {mode.min, mode.max, mode.PCTmin, mode.PCTmax, mode.SImin, mode.SImax})
+                    putFloat(out, value);
+                out.push_back(mode.in.val);
+                out.push_back(mode.out.val);
+                out.push_back(mode.motor_bias);
+                out.insert(out.end(), mode.flags.bytes, mode.flags.bytes + 6);
+                out.push_back(mode.data_sets);
+                out.push_back(mode.format);
+                out.push_back(mode.figures);
+                out.push_back(mode.decimals);
+            }
+        }
+        uint8_t checksum = 0xFF;
+        for (uint8_t b : out)
+            checksum ^= b;
+        out.push_back(checksum);
+    }
+
+    namespace
+    {
+        class Reader
+        {
+        public:
+            Reader(const uint8_t *data, size_t length) : m_data(data), m_length(length) {}
+
+            bool ok() const { return m_ok; }
+
+            const uint8_t *take(size_t n)
+            {
+                if (!m_ok || m_length - m_pos < n)
+                {
+                    m_ok = false;
+                    return nullptr;
+                }
+                const uint8_t *p = m_data + m_pos;
+                m_pos += n;
+                return p;
+            }
+
+            uint8_t u8()
+            {
+                const uint8_t *p = take(1);
+                return p ? p[0] : 0;
+            }
+
+            uint16_t u16()
+            {
+                const uint8_t *p = take(2);
+                return p ? (uint16_t)(p[0] | (p[1] << 8)) : 0;
+            }
+
+            float f32()
+            {
+                float value = 0.0f;
+                if (const uint8_t *p = take(4))
+                    std::memcpy(&value, p, 4);
+                return value;
+            }
+
+            std::string str()
+            {
+                uint8_t length = u8();
+                const uint8_t *p = take(length);
+                return p ? std::string((const char *)p, length) : std::string();
+            }
+
+        private:
+            const uint8_t *m_data;
+            size_t m_length;
+            size_t m_pos = 0;
+            bool m_ok = true;
+        };
+    }; // namespace
+
+    int DiscoveryCache::decode(const uint8_t *data, size_t length, std::unordered_map<PortNum, DeviceDescriptor> &entries)
+    {
+        entries.clear();
+        if (length < sizeof(MAGIC) + 3 || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || data[sizeof(MAGIC)] != FORMAT_VERSION)
+            return -1;
+        uint8_t checksum = 0xFF;
+        for (size_t i = 0; i < length; i++)
+            checksum ^= data[i];
+        if (checksum != 0)
+            return -1;
+
+        Reader in(data + sizeof(MAGIC) + 1, length - sizeof(MAGIC) - 2);
+        uint8_t portCount = in.u8();
+        for (uint8_t i = 0; i < portCount && in.ok(); i++)
+        {
+            PortNum port = in.u8();
+            DeviceDescriptor desc;
+            desc.type = (DeviceType)in.u16();
+            if (const uint8_t *fw = in.take(4))
+                desc.fwVersion = Utils::unPackVersion(fw);
+            if (const uint8_t *hw = in.take(4))
+                desc.hwVersion = Utils::unPackVersion(hw);
+            desc.caps = in.u8();
+            desc.inModesMask = in.u16();
+            desc.outModesMask = in.u16();
+            desc.combos.resize(in.u8());
+            for (auto &combo : desc.combos)
+                combo = in.u16();
+            desc.modes.resize(in.u8());
+            for (auto &mode : desc.modes)
+            {
+                mode.name = in.str();
+                mode.unit = in.str();
+                mode.min = in.f32();
+                mode.max = in.f32();
+                mode.PCTmin = in.f32();
+                mode.PCTmax = in.f32();
+                mode.SImin = in.f32();
+                mode.SImax = in.f32();
+                mode.in.val = in.u8();
+                mode.out.val = in.u8();
+                mode.motor_bias = in.u8();
+                if (const uint8_t *flags = in.take(6))
+                    std::memcpy(mode.flags.bytes, flags, 6);
+                mode.data_sets = in.u8();
+                mode.format = in.u8();
+                mode.figures = in.u8();
+                mode.decimals = in.u8();
+            }
+            entries[port] = std::move(desc);
+        }
+        if (!in.ok() || in.take(1))
+        {
+            entries.clear();
+            return -1;
+        }
+        return 0;
+    }
+}; // namespace Lpf2
@@ -18,123 +18,29 @@
 
 #include "Lpf2/Hub.hpp"
 #include "Lpf2/Util/Values.hpp"
+#include "Lpf2/Util/Format.hpp"
 #include "Lpf2/log/log.h"
 #include "Lpf2/DeviceDescLib.hpp"
-#include <sstream>
-#include <iomanip>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
 
 namespace Lpf2
 {
-    /**
-     * Derived class which could be added as an instance to the BLEClient for callback handling
-     * The current hub is given as a parameter in the constructor to be able to set the
-     * status flags on a disconnect event accordingly
-     */
-    class HubClientCallback : public BLEClientCallbacks
-    {
-
-        Hub *_lpf2Hub;
-
-    public:
-        HubClientCallback(Hub *lpf2Hub) : BLEClientCallbacks()
-        {
-            _lpf2Hub = lpf2Hub;
-        }
-
-        void onConnect(BLEClient *bleClient) override
-        {
-        }
-
-        void onDisconnect(BLEClient *bleClient, int reason) override
-        {
-            _lpf2Hub->m_connecting = false;
-            _lpf2Hub->m_connected = false;
-            _lpf2Hub->onDisconnect();
-            LPF2_LOG_D("Disconnected client, reason: %i", reason);
-        }
-    };
-
-    /**
-     * Scan for BLE servers and find the first one that advertises the service we are looking for.
-     */
-    class Lpf2HubAdvertisedDeviceCallbacks : public BLEAdvertisedDeviceCallbacks
-    {
-        Hub *_lpf2Hub;
-
-    public:
-        Lpf2HubAdvertisedDeviceCallbacks(Hub *lpf2Hub) : BLEAdvertisedDeviceCallbacks()
-        {
-            _lpf2Hub = lpf2Hub;
-        }
-
-        void onScanEnd(const NimBLEScanResults &results, int reason) override
-        {
-            LPF2_LOG_D("Scan Ended reason: %d\nNumber of devices: %d", reason, results.getCount());
-            for (int i = 0; i < results.getCount(); i++)
-            {
-                LPF2_LOG_D("device[%d]: %s", i, results.getDevice(i)->toString().c_str());
-            }
-        }
+    static constexpr size_t INFO_TIMEOUT_MS = 200;
+    static constexpr uint8_t INFO_TRIES = 3;
 
-        void onResult(const NimBLEAdvertisedDevice *advertisedDevice) override
-        {
-            // Found a device, check if the service is contained and optional if address fits requested address
-            LPF2_LOG_D("advertised device: %s", advertisedDevice->toString().c_str());
-
-            if (advertisedDevice->haveServiceUUID() && advertisedDevice->getServiceUUID().equals(_lpf2Hub->m_bleHubServiceUuid) && (_lpf2Hub->m_bleRequestedDeviceAddress == nullptr || (_lpf2Hub->m_bleRequestedDeviceAddress && advertisedDevice->getAddress().equals(*_lpf2Hub->m_bleRequestedDeviceAddress))))
-            {
-                advertisedDevice->getScan()->stop();
-                _lpf2Hub->m_bleServerAddress = new BLEAddress(advertisedDevice->getAddress());
-                _lpf2Hub->setHubNameProp(advertisedDevice->getName());
-
-                if (advertisedDevice->haveManufacturerData())
-                {
-                    LPF2_LOG_D("advertisement payload: %s", Utils::bytes_to_hexString(advertisedDevice->getPayload()).c_str());
-                    LPF2_LOG_D("manufacturer data: %s", Utils::bytes_to_hexString(advertisedDevice->getManufacturerData()).c_str());
-                    uint8_t *manufacturerData = (uint8_t *)advertisedDevice->getManufacturerData().data();
-                    uint8_t manufacturerDataLength = advertisedDevice->getManufacturerData().length();
-                    if (manufacturerDataLength >= 3)
-                    {
-                        LPF2_LOG_D("manufacturer data hub type: %x", manufacturerData[3]);
-                        // check device type ID
-                        switch (manufacturerData[3])
-                        {
-                        case DUPLO_TRAIN_HUB_ID:
-                            _lpf2Hub->m_hubType = HubType::DUPLO_TRAIN_HUB;
-                            break;
-                        case BOOST_MOVE_HUB_ID:
-                            _lpf2Hub->m_hubType = HubType::BOOST_MOVE_HUB;
-                            break;
-                        case POWERED_UP_HUB_ID:
-                            _lpf2Hub->m_hubType = HubType::POWERED_UP_HUB;
-                            break;
-                        case POWERED_UP_REMOTE_ID:
-                            _lpf2Hub->m_hubType = HubType::POWERED_UP_REMOTE;
-                            break;
-                        case CONTROL_PLUS_HUB_ID:
-                            _lpf2Hub->m_hubType = HubType::CONTROL_PLUS_HUB;
-                            break;
-                        case MARIO_HUB_ID:
-                            _lpf2Hub->m_hubType = HubType::MARIO_HUB;
-                            break;
-                        default:
-                            _lpf2Hub->m_hubType = HubType::UNKNOWNHUB;
-                            break;
-                        }
-                    }
-                }
-                _lpf2Hub->m_connecting = true;
-            }
-        }
-    };
+    // Mode information discovery asks for, per mode.
+    static constexpr ModeInfoType MODE_INFOS[] = {ModeInfoType::NAME, ModeInfoType::RAW, ModeInfoType::PCT, ModeInfoType::SI,
+                                                  ModeInfoType::SYMBOL, ModeInfoType::MAPPING, ModeInfoType::VALUE};
 
     /**
-     * @brief Write value to the remote characteristic
+     * @brief Send a message to the hub, @p data is everything after the message type.
      */
     void Hub::writeValue(MessageType type, const std::vector<uint8_t> &data)
     {
-        if (!m_connected || !m_bleHubCharacteristic)
+        if (!m_connected || !m_transport)
             return;
         size_t size = data.size();
         std::vector<uint8_t> fullData;
@@ -142,81 +48,171 @@ namespace Lpf2
         fullData.push_back((uint8_t)type);
         fullData.insert(fullData.end(), data.begin(), data.end());
         LPF2_LOG_D("write value: %s", Utils::bytes_to_hexString(fullData).c_str());
-        m_bleHubCharacteristic->writeValue(fullData, false);
+        m_transport->write(fullData.data(), fullData.size());
     }
 
     /**
-     * @brief Callback function for notifications of a specific characteristic
-     * @param [in] pBLERemoteCharacteristic The pointer to the characteristic
-     * @param [in] pData The pointer to the received data
-     * @param [in] length The length of the data array
-     * @param [in] isNotify
+     * @returns the class of an output command (@p payload: port, startup
+     * and completion, sub command, parameters), -1 if it must not be
+     * replaced by a newer one
      */
-    void Hub::notifyCallback(
-        NimBLERemoteCharacteristic *pBLERemoteCharacteristic,
-        uint8_t *pData,
-        size_t length,
-        bool isNotify)
+    static int16_t outputKey(const std::vector<uint8_t> &payload)
     {
-        LPF2_LOG_D("notify callback, value: %s", Utils::bytes_to_hexString(std::vector<uint8_t>(pData, pData + length)).c_str());
-
-        std::vector<uint8_t> data(pData, pData + length);
-
-        if (data.size() < 3)
-            return;
-
-        switch ((MessageType)data[2])
-        {
-        case MessageType::HUB_PROPERTIES:
-        {
-            handleHubPropertyMessage(data);
-            break;
-        }
-        case MessageType::GENERIC_ERROR_MESSAGES:
-        {
-            handleGenericErrorMessage(data);
-            break;
+        // Buffered commands and those with feedback are tracked one by one.
+        if (payload.size() < 3 || payload[1] != (STARTUP_IMMEDIATE | COMPLETION_NONE))
+            return -1;
+        switch ((PortOutputSubCommand)payload[2])
+        {
+        case PortOutputSubCommand::WRITE_DIRECT_MODE:
+            return payload.size() > 3 ? 0x100 | payload[3] : -1; // one class per mode
+        case PortOutputSubCommand::SET_ACC_TIME:
+        case PortOutputSubCommand::SET_DEC_TIME:
+        case PortOutputSubCommand::START_SPEED_SINGLE:
+        case PortOutputSubCommand::GOTO_ABS_POS_SINGLE:
+            return payload[2];
+        default:
+            // Relative moves add up, every one of them is sent.
+            return -1;
         }
-        case MessageType::HUB_ATTACHED_IO:
+    }
+
+    int Hub::writeOutput(const std::vector<uint8_t> &payload)
+    {
+        if (!m_connected || !m_transport || payload.empty())
+            return -1;
+        m_outputStats.commands++;
+        if (!m_outputCoalescing)
         {
-            handleAttachedIOMessage(data);
-            break;
+            writeValue(MessageType::PORT_OUTPUT_COMMAND, payload);
+            m_outputStats.sent++;
+            return 0;
         }
-        case MessageType::PORT_INFORMATION:
+
+        PortState &state = _getPortState(payload[0]);
+        OutputCommand *queue = state.output;
+        int16_t key = outputKey(payload);
+        // Only the port's last command is replaced: one further back would
+        // overtake the commands issued since (preset, goto, preset).
+        if (key >= 0 && state.outputCount && queue[state.outputCount - 1].key == key)
         {
-            handlePortInfoMessage(data);
-            break;
+            queue[state.outputCount - 1].payload.assign(payload.begin(), payload.end());
+            m_outputStats.coalesced++;
+            return 0;
         }
-        case MessageType::PORT_MODE_INFORMATION:
+        if (state.outputCount == LPF2_HUB_OUTPUT_QUEUE)
         {
-            handlePortModeInfoMessage(data);
-            break;
+            LPF2_LOG_W("Port 0x%02X: output queue full, command dropped.", (int)payload[0]);
+            m_outputStats.dropped++;
+            return -1;
         }
-        case MessageType::PORT_INPUT_FORMAT_SINGLE:
+        OutputCommand &command = queue[state.outputCount++];
+        command.key = key;
+        command.payload.assign(payload.begin(), payload.end());
+        m_outputQueued++;
+        return 0;
+    }
+
+    void Hub::flushOutput()
+    {
+        m_lastFlushUs = LPF2_GET_TIME_US();
+        if (!m_outputQueued)
+            return;
+        m_ports.forEach([this](PortNum, PortState &state)
+                        {
+            for (uint8_t i = 0; i < state.outputCount; i++)
+                writeValue(MessageType::PORT_OUTPUT_COMMAND, state.output[i].payload);
+            m_outputStats.sent += state.outputCount;
+            state.outputCount = 0; });
+        m_outputQueued = 0;
+        m_outputStats.flushes++;
+    }
+
+    void Hub::dropOutput()
+    {
+        m_ports.forEach([](PortNum, PortState &state)
+                        { state.outputCount = 0; });
+        m_outputStats.dropped += m_outputQueued;
+        m_outputQueued = 0;
+    }
+
+    void Hub::setOutputCoalescing(bool enable)
+    {
+        if (!enable)
+            flushOutput();
+        m_outputCoalescing = enable;
+    }
+
+    constexpr Hub::HandlerTable Hub::s_handlers = []
+    {
+        HandlerTable table{};
+        table[(uint8_t)MessageType::HUB_PROPERTIES] = &Hub::handleHubPropertyMessage;
+        table[(uint8_t)MessageType::GENERIC_ERROR_MESSAGES] = &Hub::handleGenericErrorMessage;
+        table[(uint8_t)MessageType::HUB_ATTACHED_IO] = &Hub::handleAttachedIOMessage;
+        table[(uint8_t)MessageType::PORT_INFORMATION] = &Hub::handlePortInfoMessage;
+        table[(uint8_t)MessageType::PORT_MODE_INFORMATION] = &Hub::handlePortModeInfoMessage;
+        table[(uint8_t)MessageType::PORT_INPUT_FORMAT_SINGLE] = &Hub::handlePortInputFormatSingleMessage;
+        table[(uint8_t)MessageType::PORT_VALUE_SINGLE] = &Hub::handlePortValueSingleMessage;
+        table[(uint8_t)MessageType::PORT_INPUT_FORMAT_COMBINEDMODE] = &Hub::handlePortInputFormatCombinedModeMessage;
+        table[(uint8_t)MessageType::PORT_VALUE_COMBINEDMODE] = &Hub::handlePortValueCombinedModeMessage;
+        table[(uint8_t)MessageType::PORT_OUTPUT_COMMAND_FEEDBACK] = &Hub::handlePortOutputCommandFeedbackMessage;
+        return table;
+    }();
+
+    void Hub::onNotify(const uint8_t *data, size_t length)
+    {
+        LPF2_LOG_D("notify callback, value: %s", Utils::bytes_to_hexString(std::vector<uint8_t>(data, data + length)).c_str());
+
+        if (length < 3)
+            return;
+
+        uint8_t type = data[(uint8_t)MessageHeader::MESSAGE_TYPE];
+        m_messageCounts[type]++;
+        m_messageBytes[type] += length;
+        Utils::ByteSpan message(data, length);
+        if (m_customTypes[type >> 5] & (1u << (type & 31)))
         {
-            handlePortInputFormatSingleMessage(data);
-            break;
+            for (auto &[customType, handler] : m_customHandlers)
+            {
+                if (customType == type)
+                {
+                    handler(message);
+                    return;
+                }
+            }
         }
-        case MessageType::PORT_VALUE_SINGLE:
+        if (Handler handler = s_handlers[type])
         {
-            handlePortValueSingleMessage(data);
-            break;
+            (this->*handler)(message);
+            return;
         }
-        case MessageType::PORT_INPUT_FORMAT_COMBINEDMODE:
+        LPF2_LOG_E("Unimplemented: %i", type);
+    }
+
+    int Hub::registerMessageHandler(MessageType type, MessageHandler handler)
+    {
+        // onNotify() walks the table without a lock, on the transport's
+        // context: it may only change while no transport is attached.
+        if (m_transport)
         {
-            handlePortInputFormatCombinedModeMessage(data);
-            break;
+            LPF2_LOG_E("registerMessageHandler: register before attach() / connectHub().");
+            return -1;
         }
-        case MessageType::PORT_VALUE_COMBINEDMODE:
+        uint8_t t = (uint8_t)type;
+        auto it = std::find_if(m_customHandlers.begin(), m_customHandlers.end(),
+                               [t](const std::pair<uint8_t, MessageHandler> &entry)
+                               { return entry.first == t; });
+        if (it != m_customHandlers.end())
+            m_customHandlers.erase(it);
+        if (handler)
         {
-            handlePortValueCombinedModeMessage(data);
-            break;
+            m_customHandlers.emplace_back(t, std::move(handler));
+            m_customTypes[t >> 5] |= 1u << (t & 31);
         }
-        default:
+        else
         {
-            LPF2_LOG_E("Unimplemented: %i", data[2]);
-        }
+            m_customTypes[t >> 5] &= ~(1u << (t & 31));
         }
+        return 0;
     }
 
     void Hub::updateHubProperty(HubPropertyType propId, std::vector<uint8_t> data, bool sendUpdate)
@@ -264,7 +260,7 @@ namespace Lpf2
         payload.push_back((uint8_t)propId);
         payload.push_back((uint8_t)HubPropertyOperation::ENABLE_UPDATES_DOWNSTREAM);
         writeValue(MessageType::HUB_PROPERTIES, payload);
-        LPF2_LOG_D("Enabled prop update: %i", (uint8_t)m_dataRequestState.propId);
+        LPF2_LOG_D("Enabled prop update: %i", (uint8_t)propId);
     }
 
     void Hub::disableHubProperty(HubPropertyType propId)
@@ -313,7 +309,7 @@ namespace Lpf2
         writeValue(MessageType::HUB_PROPERTIES, payload);
     }
 
-    void Hub::handleHubPropertyMessage(const std::vector<uint8_t> &message)
+    void Hub::handleHubPropertyMessage(Utils::ByteSpan message)
     {
         if (checkLenght(message, 5))
         {
@@ -338,8 +334,12 @@ namespace Lpf2
         case HubPropertyOperation::UPDATE_UPSTREAM:
         {
             prop.assign(message.begin() + 5, message.end());
-            LPF2_LOG_D("Updating hub prop: %i, message: %s",
-                       (int)propId, Utils::bytes_to_hexString(message).c_str());
+            storeProperty((uint8_t)propId, message.subspan(5));
+            m_propertyUpdates[(uint8_t)propId]++;
+            m_propChanged.fetch_or(1u << (uint8_t)propId, std::memory_order_release);
+            infoReplied(MessageType::HUB_PROPERTIES, (uint8_t)propId, 0, (uint8_t)HubPropertyOperation::REQUEST_UPDATE_DOWNSTREAM);
+            LPF2_LOG_D("Updating hub prop: %i, value: %s",
+                       (int)propId, Utils::bytes_to_hexString(prop).c_str());
             break;
         }
         default:
@@ -351,7 +351,7 @@ namespace Lpf2
         return;
     }
 
-    void Hub::handleGenericErrorMessage(const std::vector<uint8_t> &message)
+    void Hub::handleGenericErrorMessage(Utils::ByteSpan message)
     {
         if (checkLenght(message, 5))
         {
@@ -365,6 +365,11 @@ namespace Lpf2
             m_pendingRequest.valid = false;
         }
 
+        if (errorType != GenericErrorType::ACK)
+        {
+            infoFailed(msgType, errorType == GenericErrorType::BUFFER_OVERFLOW || errorType == GenericErrorType::TIMEOUT);
+        }
+
         switch (errorType)
         {
         case GenericErrorType::ACK:
@@ -386,7 +391,7 @@ namespace Lpf2
         return;
     }
 
-    void Hub::handleAttachedIOMessage(const std::vector<uint8_t> &message)
+    void Hub::handleAttachedIOMessage(Utils::ByteSpan message)
     {
         if (checkLenght(message, 5))
         {
@@ -406,56 +411,51 @@ namespace Lpf2
             // Some hubs omit DETACHED_IO on device swap; treat a new ATTACHED_IO
             // for an already-occupied port as an implicit detach + re-attach so
             // the new device gets its info queried (or descriptor re-applied).
-            if (m_attachedPortsDevice.count(portNum) && m_attachedPortsDevice[portNum] != DeviceType::UNKNOWNDEVICE)
+            PortState &state = _getPortState(portNum);
+            if (state.attached != DeviceType::UNKNOWNDEVICE)
             {
                 LPF2_LOG_D("Port 0x%02X: implicit detach before re-attach.", (int)portNum);
-                m_attachedPortsDevice[portNum] = DeviceType::UNKNOWNDEVICE;
-                auto prevPort = _getPort(portNum);
-                prevPort->m_deviceType = DeviceType::UNKNOWNDEVICE;
-                prevPort->m_modeData.clear();
-                prevPort->m_modeCount = 0;
-                prevPort->m_inModesMask = 0;
-                prevPort->m_outModesMask = 0;
-                prevPort->m_modeCombos.clear();
-                prevPort->m_comboNum = 0;
-                prevPort->m_capabilities = 0;
+                state.attached = DeviceType::UNKNOWNDEVICE;
+                clearPortInfo(&state.port);
             }
             DeviceType devType = (DeviceType)message[5]; // | message[6] << 8;
-            std::vector<uint8_t> raw;
-            Version HWRew;
-            raw.assign(message.begin() + 7, message.end());
-            HWRew = Utils::unPackVersion(raw);
-            Version FWRew;
-            raw.assign(message.begin() + 11, message.end());
-            FWRew = Utils::unPackVersion(raw);
+            Version HWRew = Utils::unPackVersion(message.data() + 7);
+            Version FWRew = Utils::unPackVersion(message.data() + 11);
             LPF2_LOG_D("Attached IO: HWRew: %u.%u.%u.%u, FWRew: %u.%u.%u.%u, Port: 0x%02X, DevType: 0x%02X",
                        HWRew.Major, HWRew.Minor, HWRew.Bugfix, HWRew.Build,
                        FWRew.Major, FWRew.Minor, FWRew.Bugfix, FWRew.Build,
                        (int)portNum, (int)devType);
 
-            m_attachedPortsDevice[portNum] = devType;
-            auto port = _getPort(portNum);
+            state.attached = devType;
+            auto port = &state.port;
             port->m_fwVersion = FWRew;
             port->m_hwVersion = HWRew;
-            if (auto desc = DeviceDescRegistry::instance().getDescriptor(devType))
+            bool cached = false;
+            if (auto desc = findDescriptor(portNum, devType, FWRew, HWRew, &cached))
             {
                 port->m_deviceType = devType;
                 port->setFromDesc(desc);
+                port->m_fwVersion = FWRew;
+                port->m_hwVersion = HWRew;
+                port->m_fromDescriptor = true;
+                port->m_descriptorChecked = false;
+                if (cached)
+                    m_discoveryStats.portsFromCache++;
+                else
+                    m_discoveryStats.portsFromDescriptor++;
+                m_discoveryStats.requestsAvoided += 2 + port->m_modeCount * std::size(MODE_INFOS);
+            }
+            else if (DeviceDescRegistry::instance().getDescriptor(devType))
+            {
+                LPF2_LOG_D("Port 0x%02X: no descriptor for 0x%02X matches its version, discovering.", (int)portNum, (int)devType);
             }
             break;
         }
         case IOEvent::DETACHED_IO:
         {
-            m_attachedPortsDevice[portNum] = DeviceType::UNKNOWNDEVICE;
-            auto port = _getPort(portNum);
-            port->m_deviceType = DeviceType::UNKNOWNDEVICE;
-            port->m_modeData.clear();
-            port->m_modeCount = 0;
-            port->m_inModesMask = 0;
-            port->m_outModesMask = 0;
-            port->m_modeCombos.clear();
-            port->m_comboNum = 0;
-            port->m_capabilities = 0;
+            PortState &state = _getPortState(portNum);
+            state.attached = DeviceType::UNKNOWNDEVICE;
+            clearPortInfo(&state.port);
             break;
         }
         default:
@@ -467,7 +467,7 @@ namespace Lpf2
         return;
     }
 
-    void Hub::handlePortInfoMessage(const std::vector<uint8_t> &message)
+    void Hub::handlePortInfoMessage(Utils::ByteSpan message)
     {
         if (checkLenght(message, 5))
         {
@@ -480,7 +480,6 @@ namespace Lpf2
         {
             m_pendingRequest.valid = false;
         }
-
         auto &port = *_getPort(portNum);
 
         LPF2_LOG_D("Received port info: portNum: 0x%02X, infoType: %i", (int)portNum, infoType);
@@ -491,7 +490,7 @@ namespace Lpf2
         {
             if (checkLenght(message, 11))
             {
-                return;
+                break;
             }
             port.m_capabilities = message[5];
 
@@ -512,13 +511,16 @@ namespace Lpf2
         default:
             goto unimplemented;
         }
+        // Last: update() reads the port as soon as the request is answered.
+        infoReplied(MessageType::PORT_INFORMATION_REQUEST, (uint8_t)portNum, 0, infoType);
         return;
     unimplemented:
         LPF2_LOG_E("Unimplemented!");
+        infoReplied(MessageType::PORT_INFORMATION_REQUEST, (uint8_t)portNum, 0, infoType);
         return;
     }
 
-    void Hub::handlePortModeInfoMessage(const std::vector<uint8_t> &message)
+    void Hub::handlePortModeInfoMessage(Utils::ByteSpan message)
     {
         if (checkLenght(message, 6))
         {
@@ -532,7 +534,6 @@ namespace Lpf2
         {
             m_pendingRequest.valid = false;
         }
-
         auto &port = *_getPort(portNum);
         if (port.m_modeData.size() <= modeNum)
         {
@@ -605,7 +606,7 @@ namespace Lpf2
         {
             if (checkLenght(message, 7))
             {
-                return;
+                break;
             }
             mode.motor_bias = message[6];
             break;
@@ -639,13 +640,16 @@ namespace Lpf2
         default:
             goto unimplemented;
         }
+        // Last: the last reply of a port lets update() copy its modes.
+        infoReplied(MessageType::PORT_MODE_INFORMATION_REQUEST, (uint8_t)portNum, modeNum, (uint8_t)infoType);
         return;
     unimplemented:
         LPF2_LOG_E("Unimplemented!");
+        infoReplied(MessageType::PORT_MODE_INFORMATION_REQUEST, (uint8_t)portNum, modeNum, (uint8_t)infoType);
         return;
     }
 
-    void Hub::handlePortInputFormatSingleMessage(const std::vector<uint8_t> &message)
+    void Hub::handlePortInputFormatSingleMessage(Utils::ByteSpan message)
     {
         if (checkLenght(message, 10))
         {
@@ -664,31 +668,34 @@ namespace Lpf2
         std::memcpy(&inputFormat.delta, message.data() + 5, 4);
         inputFormat.notify = message[9];
 
-        m_portInputFormatMap[inputFormat.portNum] = inputFormat;
+        PortState &state = _getPortState(inputFormat.portNum);
+        state.inputFormat = inputFormat;
+        state.hasInputFormat = true;
 
         return;
     }
 
-    void Hub::handlePortValueSingleMessage(const std::vector<uint8_t> &message)
+    void Hub::handlePortValueSingleMessage(Utils::ByteSpan message)
     {
         if (checkLenght(message, 5))
         {
             return;
         }
 
-        PortNum portNum = (PortNum)message[(uint16_t)MessageByte::PORT_ID];
-        if (!m_portInputFormatMap.count(portNum))
+        PortState *state = m_ports.find((PortNum)message[(uint16_t)MessageByte::PORT_ID]);
+        if (!state || !state->hasInputFormat)
         {
             return;
         }
-        auto &port = *_getPort(portNum);
-        uint8_t mode = m_portInputFormatMap[portNum].mode;
+        auto &port = state->port;
+        uint8_t mode = state->inputFormat.mode;
         auto &modeData = port.m_modeData;
         if (modeData.size() <= mode)
         {
             return;
         }
         modeData[mode].rawData.assign(message.begin() + 4, message.end());
+        port.publishModeData(mode);
 
         if (port.m_valueChangeCallback)
         {
@@ -697,146 +704,264 @@ namespace Lpf2
         return;
     }
 
-    void Hub::requestInfos()
+    static bool expectsReply(MessageType type, uint8_t info)
     {
-        if (m_pendingRequest.valid)
-            return;
+        if (type == MessageType::HUB_ALERTS)
+            return false;
+        if (type == MessageType::HUB_PROPERTIES)
+            return info == (uint8_t)HubPropertyOperation::REQUEST_UPDATE_DOWNSTREAM;
+        return true;
+    }
 
-        if (!m_rateLimiter.okayToSend())
-            return;
+    static uint32_t infoKey(MessageType type, uint8_t id, uint8_t mode, uint8_t info)
+    {
+        return (uint32_t)type | (uint32_t)id << 8 | (uint32_t)mode << 16 | (uint32_t)info << 24;
+    }
 
-        m_rateLimiter.reset();
+    void Hub::resetDiscovery()
+    {
+        m_infoQueue.clear();
+        for (auto &slot : m_infoSlots)
+            slot.state.store(InfoSlotState::FREE, std::memory_order_relaxed);
+        m_portDiscovery.clear();
+    }
 
-        switch (m_dataRequestState.state)
-        {
-        case DataRequestingState::HUB_ALERTS:
-        {
-            if (m_dataRequestState.mode >= 4)
-            {
-                m_dataRequestState.mode = 0;
-                m_dataRequestState.state = DataRequestingState::HUB_PROP;
-            }
-            else
-            {
-                m_dataRequestState.mode++;
-                std::vector<uint8_t> payload;
-                payload.push_back((uint8_t)m_dataRequestState.mode);
-                payload.push_back(0x01);
-                writeValue(MessageType::HUB_ALERTS, payload);
-            }
-            break;
+    void Hub::queueHubRequests()
+    {
+        for (uint8_t alert = 1; alert <= 4; alert++)
+            queueInfoRequest(MessageType::HUB_ALERTS, alert, 0, 0x01);
+        // Hubs usually don't reply to HARDWARE_NETWORK_FAMILY and above.
+        for (uint8_t prop = (uint8_t)HubPropertyType::ADVERTISING_NAME; prop < (uint8_t)HubPropertyType::HARDWARE_NETWORK_FAMILY; prop++)
+            queueInfoRequest(MessageType::HUB_PROPERTIES, prop, 0, (uint8_t)HubPropertyOperation::REQUEST_UPDATE_DOWNSTREAM);
+        // Updates only for the subscribed properties (subscribeHubProperty()).
+        for (uint8_t prop = 0; prop < (uint8_t)HubPropertyType::END; prop++)
+        {
+            PropertySubscription &sub = m_propSubs[prop];
+            sub.enabled = sub.active && sub.intervalMs == 0;
+            if (sub.enabled)
+                queueInfoRequest(MessageType::HUB_PROPERTIES, prop, 0, (uint8_t)HubPropertyOperation::ENABLE_UPDATES_DOWNSTREAM);
         }
+    }
+
+    void Hub::queuePortRequests(PortNum portNum)
+    {
+        LPF2_LOG_D("Starting requests for: port: 0x%02X, dev: 0x%02X",
+                   (int)portNum, (int)_getPortState(portNum).attached);
+        m_portDiscovery[portNum] = {_getPortState(portNum).attached, 0};
+        queueInfoRequest(MessageType::PORT_INFORMATION_REQUEST, (uint8_t)portNum, 0, 0x01);
+        queueInfoRequest(MessageType::PORT_INFORMATION_REQUEST, (uint8_t)portNum, 0, 0x02);
+    }
 
-        case DataRequestingState::HUB_PROP:
+    void Hub::queueModeRequests(PortNum portNum)
+    {
+        uint8_t modeCount = _getPort(portNum)->getModeCount();
+        for (uint8_t mode = 0; mode < modeCount; mode++)
         {
-            if (m_dataRequestState.propId >= HubPropertyType::HARDWARE_NETWORK_FAMILY) // Hub usually don't reply to this
-            {
-                m_dataRequestState.finishedRequests = true;
-            }
-            else
-            {
-                if (m_dataRequestState.mode == 0)
-                {
-                    requestHubPropertyUpdate(m_dataRequestState.propId);
-                    LPF2_LOG_D("Requested prop update: %i", (uint8_t)m_dataRequestState.propId);
-                    m_dataRequestState.mode++;
-                }
-                else
-                {
-                    m_dataRequestState.mode = 0;
-                    if (m_dataRequestState.propId != HubPropertyType::RSSI)
-                        enableHubProperty(m_dataRequestState.propId);
-                    m_dataRequestState.propId = HubPropertyType((uint8_t)m_dataRequestState.propId + 1);
-                }
-            }
-            break;
+            for (ModeInfoType info : MODE_INFOS)
+                queueInfoRequest(MessageType::PORT_MODE_INFORMATION_REQUEST, (uint8_t)portNum, mode, (uint8_t)info);
         }
+    }
 
-        case DataRequestingState::PORT_INFO:
+    void Hub::queueDescriptorCheck(PortNum portNum)
+    {
+        auto port = _getPort(portNum);
+        if (port->m_modeCount == 0)
         {
-            if (isPending_warn())
-                break;
-
-            LPF2_LOG_D("Requesting port info: infoType: %i, portNum: 0x%02X",
-                       m_dataRequestState.mode + 1, (int)m_dataRequestState.portNum);
+            port->m_descriptorChecked = true;
+            return;
+        }
+        LPF2_LOG_D("Checking descriptor: port: 0x%02X, dev: 0x%02X", (int)portNum, (int)port->m_deviceType);
+        m_discoveryStats.descriptorChecks++;
+        m_portDiscovery[portNum] = {port->m_deviceType, 0, true};
+        queueInfoRequest(MessageType::PORT_MODE_INFORMATION_REQUEST, (uint8_t)portNum, port->m_modeCount - 1, (uint8_t)ModeInfoType::NAME);
+    }
 
-            if (m_dataRequestState.mode == 0)
-            {
-                std::vector<uint8_t> payload;
-                payload.push_back((uint8_t)m_dataRequestState.portNum);
-                payload.push_back(0x01);
-                pending(MessageType::PORT_INFORMATION_REQUEST);
-                writeValue(MessageType::PORT_INFORMATION_REQUEST, payload);
-                m_dataRequestState.mode = 1;
-            }
-            else if (m_dataRequestState.mode == 1)
-            {
-                std::vector<uint8_t> payload;
-                payload.push_back((uint8_t)m_dataRequestState.portNum);
-                payload.push_back(0x02);
-                pending(MessageType::PORT_INFORMATION_REQUEST);
-                writeValue(MessageType::PORT_INFORMATION_REQUEST, payload);
-                m_dataRequestState.mode = 0;
-                m_dataRequestState.info = 0;
-                m_dataRequestState.state = DataRequestingState::PORT_MODE;
-            }
-            break;
+    void Hub::finishDescriptorCheck(Remote::Port *port, const PortDiscovery &discovery)
+    {
+        port->m_descriptorChecked = true;
+        auto desc = findDescriptor(port->m_portNum, discovery.device, port->m_fwVersion, port->m_hwVersion);
+        uint8_t mode = port->m_modeCount - 1;
+        if (!discovery.failed && desc && mode < desc->modes.size() && mode < port->m_modeData.size() &&
+            strcmp(desc->modes[mode].name.c_str(), port->m_modeData[mode].name.c_str()) == 0)
+        {
+            return;
         }
+        LPF2_LOG_W("Port 0x%02X: the hub disagrees with the descriptor for 0x%02X, discovering.",
+                   (int)port->m_portNum, (int)discovery.device);
+        m_discoveryStats.descriptorMismatches++;
+        clearPortInfo(port);
+    }
 
-        case DataRequestingState::PORT_MODE:
+    const DeviceDescriptor *Hub::findDescriptor(PortNum portNum, DeviceType type, const Version &fw, const Version &hw, bool *cached)
+    {
+        const DeviceDescriptor *desc = DeviceDescRegistry::instance().getDescriptor(type, fw, hw);
+        if (!desc && m_discoveryCache)
         {
-            if (isPending_warn())
-                break;
+            desc = m_discoveryCache->find(portNum, type, fw, hw);
+            if (cached)
+                *cached = desc != nullptr;
+        }
+        return desc;
+    }
 
-            LPF2_LOG_D("Requesting port mode info: mode: %i, infoType: %i, portNum: 0x%02X",
-                       m_dataRequestState.mode, m_dataRequestState.info, (int)m_dataRequestState.portNum);
+    DeviceDescriptor Hub::describePort(Remote::Port *port)
+    {
+        DeviceDescriptor desc;
+        desc.type = port->m_deviceType;
+        desc.inModesMask = port->m_inModesMask;
+        desc.outModesMask = port->m_outModesMask;
+        desc.caps = port->m_capabilities;
+        desc.combos = port->m_modeCombos;
+        desc.fwVersion = port->m_fwVersion;
+        desc.hwVersion = port->m_hwVersion;
+        desc.modes = port->m_modeData;
+        return desc;
+    }
 
-            std::vector<uint8_t> payload;
-            payload.push_back((uint8_t)m_dataRequestState.portNum);
-            payload.push_back(m_dataRequestState.mode);
-            payload.push_back(m_dataRequestState.info);
-            pending(MessageType::PORT_MODE_INFORMATION_REQUEST);
-            writeValue(MessageType::PORT_MODE_INFORMATION_REQUEST, payload);
+    void Hub::queueInfoRequest(MessageType type, uint8_t id, uint8_t mode, uint8_t info)
+    {
+        m_infoQueue.push_back({type, id, mode, info});
+        if (type == MessageType::PORT_INFORMATION_REQUEST || type == MessageType::PORT_MODE_INFORMATION_REQUEST)
+            m_portDiscovery[(PortNum)id].outstanding++;
+    }
 
-            if (m_dataRequestState.info == 0x80)
-            {
-                m_dataRequestState.mode++;
-            }
+    void Hub::sendInfoRequest(InfoSlot &slot)
+    {
+        const InfoRequest &request = slot.request;
+        LPF2_LOG_D("Requesting info: msgType: %i, id: 0x%02X, mode: %i, info: %i",
+                   (int)request.type, request.id, request.mode, request.info);
+        slot.tries++;
+        slot.key.store(infoKey(request.type, request.id, request.mode, request.info), std::memory_order_relaxed);
+        slot.seq.store(m_infoSeq++, std::memory_order_relaxed);
+        if (request.type == MessageType::PORT_INFORMATION_REQUEST || request.type == MessageType::PORT_MODE_INFORMATION_REQUEST)
+            m_discoveryStats.infoRequests++;
+        slot.sentTime = LPF2_GET_TIME();
+        slot.state.store(InfoSlotState::SENT, std::memory_order_release);
+        if (request.type == MessageType::PORT_MODE_INFORMATION_REQUEST)
+            writeValue(request.type, {request.id, request.mode, request.info});
+        else
+            writeValue(request.type, {request.id, request.info});
+    }
 
-            auto &port = *_getPort(m_dataRequestState.portNum);
-            if (m_dataRequestState.mode >= port.getModeCount())
+    void Hub::infoRequestDone(const InfoSlot &slot)
+    {
+        const InfoRequest &request = slot.request;
+        if (request.type != MessageType::PORT_INFORMATION_REQUEST && request.type != MessageType::PORT_MODE_INFORMATION_REQUEST)
+            return;
+        auto it = m_portDiscovery.find((PortNum)request.id);
+        if (it == m_portDiscovery.end())
+            return;
+        if (slot.state.load(std::memory_order_relaxed) == InfoSlotState::FAILED)
+            it->second.failed = true;
+        if (it->second.outstanding)
+            it->second.outstanding--;
+    }
+
+    void Hub::infoReplied(MessageType type, uint8_t id, uint8_t mode, uint8_t info)
+    {
+        uint32_t key = infoKey(type, id, mode, info);
+        for (auto &slot : m_infoSlots)
+        {
+            // Release: update() reads what the handler wrote once it sees
+            // ANSWERED. The exchange fails if update() timed the slot out
+            // in the meantime, the resend then gets answered instead.
+            InfoSlotState sent = InfoSlotState::SENT;
+            if (slot.state.load(std::memory_order_acquire) == InfoSlotState::SENT &&
+                slot.key.load(std::memory_order_relaxed) == key &&
+                slot.state.compare_exchange_strong(sent, InfoSlotState::ANSWERED, std::memory_order_release,
+                                                   std::memory_order_relaxed))
             {
-                port.m_deviceType = m_attachedPortsDevice[m_dataRequestState.portNum];
-                m_dataRequestState.mode = 0;
-                m_dataRequestState.info = 0;
-                m_dataRequestState.finishedRequests = true;
+                return;
             }
+        }
+    }
 
-            if (m_dataRequestState.info == 0x80)
+    void Hub::infoFailed(MessageType type, bool retry)
+    {
+        // The hub answers in order, so an error belongs to the oldest
+        // request of its type.
+        InfoSlot *oldest = nullptr;
+        uint32_t oldestSeq = 0;
+        for (auto &slot : m_infoSlots)
+        {
+            if (slot.state.load(std::memory_order_acquire) != InfoSlotState::SENT)
+                continue;
+            uint32_t key = slot.key.load(std::memory_order_relaxed);
+            uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+            if ((MessageType)(key & 0xFF) == type && expectsReply(type, (uint8_t)(key >> 24)) &&
+                (!oldest || (int32_t)(seq - oldestSeq) < 0))
             {
-                m_dataRequestState.info = 0;
-                break;
+                oldest = &slot;
+                oldestSeq = seq;
             }
+        }
+        InfoSlotState sent = InfoSlotState::SENT;
+        if (oldest)
+            oldest->state.compare_exchange_strong(sent, retry ? InfoSlotState::RESEND : InfoSlotState::FAILED,
+                                                  std::memory_order_release, std::memory_order_relaxed);
+    }
 
-            if (m_dataRequestState.info == 0x08)
+    void Hub::requestInfos()
+    {
+        size_t now = LPF2_GET_TIME();
+        uint8_t inFlight = 0;
+        for (auto &slot : m_infoSlots)
+        {
+            const InfoRequest &request = slot.request;
+            // Acquire: pairs with the handlers' exchange, the reply is in.
+            InfoSlotState state = slot.state.load(std::memory_order_acquire);
+            if (state == InfoSlotState::SENT && now - slot.sentTime >= INFO_TIMEOUT_MS)
             {
-                m_dataRequestState.info = 0x80;
+                // A reply racing the timeout wins, state then holds it.
+                if (slot.state.compare_exchange_strong(state, InfoSlotState::RESEND, std::memory_order_acquire))
+                    state = InfoSlotState::RESEND;
             }
-            else if (m_dataRequestState.info == 0x05)
+            if (state == InfoSlotState::RESEND && slot.tries >= INFO_TRIES)
             {
-                // Skip these
-                m_dataRequestState.info = 0x80;
+                LPF2_LOG_E("Info request unanswered: msgType: %i, id: 0x%02X, mode: %i, info: %i",
+                           (int)request.type, request.id, request.mode, request.info);
+                state = InfoSlotState::FAILED;
+                slot.state.store(state, std::memory_order_relaxed);
             }
-            else
+
+            switch (state)
             {
-                m_dataRequestState.info++;
+            case InfoSlotState::ANSWERED:
+                if (request.type == MessageType::PORT_INFORMATION_REQUEST && request.info == 0x01)
+                    queueModeRequests((PortNum)request.id);
+                // fall through
+            case InfoSlotState::FAILED:
+                infoRequestDone(slot);
+                slot.state.store(InfoSlotState::FREE, std::memory_order_relaxed);
+                break;
+            case InfoSlotState::RESEND:
+                LPF2_LOG_W("Resending info request: msgType: %i, id: 0x%02X, mode: %i, info: %i",
+                           (int)request.type, request.id, request.mode, request.info);
+                sendInfoRequest(slot);
+                inFlight++;
+                break;
+            case InfoSlotState::SENT:
+                inFlight++;
+                break;
+            default:
+                break;
             }
-            break;
         }
 
-        default:
-            m_dataRequestState.finishedRequests = true;
-            break;
+        for (auto &slot : m_infoSlots)
+        {
+            while (slot.state.load(std::memory_order_relaxed) == InfoSlotState::FREE && inFlight < m_infoWindow &&
+                   !m_infoQueue.empty())
+            {
+                slot.request = m_infoQueue.front();
+                slot.tries = 0;
+                m_infoQueue.pop_front();
+                sendInfoRequest(slot);
+                if (expectsReply(slot.request.type, slot.request.info))
+                    inFlight++;
+                else
+                    slot.state.store(InfoSlotState::FREE, std::memory_order_relaxed);
+            }
         }
     }
 
@@ -860,8 +985,8 @@ namespace Lpf2
     bool Hub::waitPending(uint32_t timeoutMs)
     {
         uint64_t deadline = LPF2_GET_TIME() + timeoutMs;
-        while (m_pendingRequest.valid && LPF2_GET_TIME() < deadline)
-            vTaskDelay(1);
+        while (m_pendingRequest.valid && LPF2_GET_TIME() < deadline && m_transport)
+            delay(1);
         if (m_pendingRequest.valid)
         {
             LPF2_LOG_E("waitPending timed out: msgType: %i", (int)m_pendingRequest.msgType);
@@ -871,29 +996,39 @@ namespace Lpf2
         return true;
     }
 
-    Remote::Port *Hub::_getPort(PortNum portNum)
+    Hub::PortState &Hub::_getPortState(PortNum portNum)
     {
-        if (!m_remotePorts.count(portNum))
+        if (PortState *state = m_ports.find(portNum))
         {
-            m_remotePorts[portNum] = nullptr;
-            LPF2_LOG_D("Adding new NULL port.");
+            return *state;
         }
-        Remote::Port *pPort = m_remotePorts[portNum];
-        if (pPort == nullptr)
-        {
-            pPort = new Remote::Port(this);
-            if (!pPort)
-            {
-                LPF2_LOG_E("Failed to allocate port.");
-            }
-            LPF2_LOG_D("Initializing port.");
-            pPort->m_portNum = portNum;
-            m_remotePorts[portNum] = pPort;
-        }
-        return pPort;
+        LPF2_LOG_D("Initializing port.");
+        PortState &state = m_ports.get(portNum, this);
+        state.port.m_portNum = portNum;
+        return state;
+    }
+
+    Remote::Port *Hub::_getPort(PortNum portNum)
+    {
+        return &_getPortState(portNum).port;
+    }
+
+    void Hub::clearPortInfo(Remote::Port *port)
+    {
+        port->resetMotion();
+        port->m_deviceType = DeviceType::UNKNOWNDEVICE;
+        port->m_modeData.clear();
+        port->m_modeCount = 0;
+        port->m_inModesMask = 0;
+        port->m_outModesMask = 0;
+        port->m_modeCombos.clear();
+        port->m_comboNum = 0;
+        port->m_capabilities = 0;
+        port->m_fromDescriptor = false;
+        port->m_descriptorChecked = false;
     }
 
-    bool Hub::checkLenght(const std::vector<uint8_t> &message, size_t lenght)
+    bool Hub::checkLenght(Utils::ByteSpan message, size_t lenght)
     {
         if (message.size() < lenght)
         {
@@ -905,7 +1040,40 @@ namespace Lpf2
 
     void Hub::onDisconnect()
     {
-        m_attachedPortsDevice.clear();
+        dropOutput();
+        m_ports.forEach([](PortNum, PortState &state)
+                        { state.port.resetMotion(); });
+        m_ports.forEach([](PortNum, PortState &state)
+                        { state.attached = DeviceType::UNKNOWNDEVICE; });
+    }
+
+    void Hub::delay(uint32_t ms)
+    {
+        if (m_transport)
+            m_transport->idle(ms);
+    }
+
+    void Hub::attach(HubTransport *transport)
+    {
+        if (m_discoveryCache)
+            m_discoveryCache->load(m_hubId);
+        m_transport = transport;
+        m_transport->setReceiver([this](const uint8_t *data, size_t length)
+                                 { onNotify(data, length); });
+        m_connected = true;
+        m_pendingRequest.valid = false;
+        resetDiscovery();
+        queueHubRequests();
+    }
+
+    void Hub::detach()
+    {
+        if (m_transport)
+            m_transport->setReceiver(nullptr);
+        m_transport = nullptr;
+        m_connected = false;
+        resetDiscovery();
+        onDisconnect();
     }
 
     void Hub::setHubNameProp(std::string name)
@@ -917,149 +1085,244 @@ namespace Lpf2
      * @brief Constructor
      */
     Hub::Hub()
-        : m_rateLimiter(5)
     {
     }
 
     Hub::~Hub()
     {
-        std::for_each(m_remotePorts.begin(), m_remotePorts.end(), [](std::pair<PortNum, Port *> pair)
-                      { delete pair.second; });
+#if !defined(LPF2_NATIVE)
         if (m_bleAdvertiseDeviceCallback)
         {
             delete m_bleAdvertiseDeviceCallback;
             m_bleAdvertiseDeviceCallback = nullptr;
         }
+#endif
     };
 
-    /**
-     * @brief Init function set the UUIDs and scan for the Hub
-     */
-    void Hub::init()
+    void Hub::handleLinkLoss()
     {
-        m_dataRequestState.finishedRequests = false;
-        m_connected = false;
-        m_connecting = false;
-        m_bleHubServiceUuid = BLEUUID(LPF2_UUID);
-        m_bleHubCharachteristicUuid = BLEUUID(LPF2_CHARACHTERISTIC);
-        m_hubType = HubType::UNKNOWNHUB;
+        if (!m_linkLost.exchange(false, std::memory_order_acquire))
+            return;
+        detach();
+#if !defined(LPF2_NATIVE)
+        m_bleTransport.end();
+#endif
+    }
 
-        BLEDevice::init("");
-        m_bleScan = BLEDevice::getScan();
+    void Hub::update()
+    {
+        handleLinkLoss();
+        if (!isConnected())
+        {
+            // Discards the ports' queued commands after a disconnect.
+            m_ports.forEach([](PortNum, PortState &state)
+                            { state.port.updateMotion(); });
+            return;
+        }
 
-        m_bleAdvertiseDeviceCallback = new Lpf2HubAdvertisedDeviceCallbacks(this);
+        m_transport->poll();
 
-        if (m_bleAdvertiseDeviceCallback == nullptr)
+        m_ports.forEach([](PortNum, PortState &state)
+                        { state.port.update(); });
+
+        if (m_outputQueued && LPF2_GET_TIME_US() - m_lastFlushUs >= m_transport->connectionIntervalUs())
         {
-            LPF2_LOG_E("failed to create advertise device callback");
-            return;
+            flushOutput();
+        }
+
+        if (m_pendingRequest.valid && LPF2_GET_TIME() - m_pendingRequest.sentTime >= 200)
+        {
+            LPF2_LOG_E("Request timed out: msgType: %i", (int)m_pendingRequest.msgType);
+            m_pendingRequest.valid = false;
+        }
+
+        // Discovery does not use m_pendingRequest, requests of several
+        // ports share the window.
+        m_ports.forEach([this](PortNum portNum, PortState &state)
+                        {
+            if (state.attached == DeviceType::UNKNOWNDEVICE || m_portDiscovery.count(portNum))
+            {
+                return;
+            }
+            if (!state.port.isDeviceConnected())
+            {
+                queuePortRequests(portNum);
+            }
+            else if (m_descriptorCheck && state.port.m_fromDescriptor && !state.port.m_descriptorChecked)
+            {
+                queueDescriptorCheck(portNum);
+            } });
+
+        requestInfos();
+
+        for (auto it = m_portDiscovery.begin(); it != m_portDiscovery.end();)
+        {
+            if (it->second.outstanding)
+            {
+                ++it;
+                continue;
+            }
+            Remote::Port *pPort = _getPort(it->first);
+            // A device swapped meanwhile is discovered again.
+            bool current = _getPortState(it->first).attached == it->second.device;
+            if (current && it->second.check)
+            {
+                finishDescriptorCheck(pPort, it->second);
+            }
+            else if (current)
+            {
+                pPort->m_deviceType = it->second.device;
+                m_discoveryStats.portsDiscovered++;
+                if (m_discoveryCache)
+                    m_discoveryCache->put(it->first, describePort(pPort));
+            }
+            it = m_portDiscovery.erase(it);
         }
 
-        m_bleScan->setScanCallbacks(m_bleAdvertiseDeviceCallback);
+        if (m_discoveryCache && m_discoveryCache->dirty() && infoReady())
+        {
+            m_discoveryCache->save();
+        }
 
-        m_bleScan->setActiveScan(true);
-        // start method with callback function to enforce the non blocking scan. If no callback function is used,
-        // the scan starts in a blocking manner
-        m_bleScan->start(m_bleScanDuration);
+        updatePropertySubscriptions();
     }
 
-    /**
-     * @brief Init function set the UUIDs and scan for the Hub
-     * @param [in] deviceAddress to which the arduino should connect represented by a hex string of the format: 00:00:00:00:00:00
-     */
-    void Hub::init(std::string deviceAddress)
+    static bool canEnableUpdates(HubPropertyType prop)
     {
-        m_bleRequestedDeviceAddress = new BLEAddress(deviceAddress, 0);
-        init();
+        return prop == HubPropertyType::ADVERTISING_NAME || prop == HubPropertyType::BUTTON ||
+               prop == HubPropertyType::RSSI || prop == HubPropertyType::BATTERY_VOLTAGE;
     }
 
-    /**
-     * @brief Init function set the BLE scan duration (default value 5s)
-     * @param [in] BLE scan durtation in unit seconds
-     */
-    void Hub::init(uint32_t scanDuration)
+    int Hub::subscribeHubProperty(HubPropertyType prop, uint32_t intervalMs, uint8_t threshold, PropertyCallback callback)
     {
-        m_bleScanDuration = scanDuration;
-        init();
+        if (prop >= HubPropertyType::END || (intervalMs == 0 && !canEnableUpdates(prop)))
+        {
+            LPF2_LOG_E("Hub property %i cannot send updates, poll it.", (int)prop);
+            return -1;
+        }
+        PropertySubscription &sub = m_propSubs[(uint8_t)prop];
+        sub.active = true;
+        sub.intervalMs = intervalMs;
+        sub.threshold = threshold;
+        sub.callback = std::move(callback);
+        sub.lastPoll = LPF2_GET_TIME();
+        sub.hasLast = false;
+        applyPropertySubscription(prop);
+        // The callback gets the value known so far.
+        if (m_propSlots[(uint8_t)prop].seq.load(std::memory_order_acquire))
+            m_propChanged.fetch_or(1u << (uint8_t)prop, std::memory_order_release);
+        return 0;
     }
 
-    /**
-     * @brief Init function set the BLE scan duration (default value 5s)
-     * @param [in] deviceAddress to which the arduino should connect represented by a hex string of the format: 00:00:00:00:00:00
-     * @param [in] BLE scan durtation in unit seconds
-     */
-    void Hub::init(std::string deviceAddress, uint32_t scanDuration)
+    void Hub::unsubscribeHubProperty(HubPropertyType prop)
     {
-        m_bleRequestedDeviceAddress = new BLEAddress(deviceAddress, 0);
-        m_bleScanDuration = scanDuration;
-        init();
+        if (prop >= HubPropertyType::END)
+            return;
+        PropertySubscription &sub = m_propSubs[(uint8_t)prop];
+        sub.active = false;
+        sub.callback = nullptr;
+        applyPropertySubscription(prop);
     }
 
-    void Hub::update()
+    void Hub::applyPropertySubscription(HubPropertyType prop)
     {
-        if (!isConnected())
+        PropertySubscription &sub = m_propSubs[(uint8_t)prop];
+        bool enable = sub.active && sub.intervalMs == 0;
+        // Not connected: queueHubRequests() enables it on attach().
+        if (!isConnected() || enable == sub.enabled)
             return;
+        sub.enabled = enable;
+        if (enable)
+            enableHubProperty(prop);
+        else
+            disableHubProperty(prop);
+    }
 
-        for (auto &[_, port] : m_remotePorts)
-        {
-            port->update();
-        }
-
-        if (m_pendingRequest.valid && LPF2_GET_TIME() - m_pendingRequest.sentTime >= 200)
-        {
-            LPF2_LOG_E("Request timed out: msgType: %i", (int)m_pendingRequest.msgType);
-            m_pendingRequest.valid = false;
-        }
-
-        if (m_pendingRequest.valid)
-            return;
+    void Hub::storeProperty(uint8_t prop, Utils::ByteSpan value)
+    {
+        PropertySlot &slot = m_propSlots[prop];
+        size_t length = std::min<size_t>(value.size(), LPF2_HUB_PROPERTY_SIZE);
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < length; i++)
+            slot.data[i].store(value[i], std::memory_order_relaxed);
+        slot.length.store((uint8_t)length, std::memory_order_relaxed);
+        slot.seq.store(seq + 2, std::memory_order_release);
+    }
 
-        if (!m_dataRequestState.finishedRequests)
+    int Hub::loadProperty(uint8_t prop, uint8_t *out) const
+    {
+        const PropertySlot &slot = m_propSlots[prop];
+        for (int attempt = 0; attempt < 4; attempt++)
         {
-            requestInfos();
-        }
+            uint32_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq & 1)
+                continue;
+            uint8_t length = slot.length.load(std::memory_order_relaxed);
+            for (uint8_t i = 0; i < length; i++)
+                out[i] = slot.data[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == seq)
+                return length;
+        }
+        return -1;
+    }
 
-        // Kick off info-request sequence for a newly-attached port that has no
-        // cached descriptor. Break after first kickoff — the state machine is
-        // single-port-at-a-time; remaining ports get picked up on next update().
-        for (auto &attachedPort : m_attachedPortsDevice)
+    void Hub::updatePropertySubscriptions()
+    {
+        bool ready = infoReady();
+        size_t now = LPF2_GET_TIME();
+        uint32_t changed = m_propChanged.exchange(0, std::memory_order_acquire);
+        for (uint8_t prop = 0; prop < (uint8_t)HubPropertyType::END; prop++)
         {
-            Remote::Port *pPort = _getPort(attachedPort.first);
-            if (!m_dataRequestState.finishedRequests)
+            PropertySubscription &sub = m_propSubs[prop];
+            if (!sub.active)
+                continue;
+            if (ready && sub.intervalMs && now - sub.lastPoll >= sub.intervalMs)
             {
-                break;
+                sub.lastPoll = now;
+                writeValue(MessageType::HUB_PROPERTIES, {prop, (uint8_t)HubPropertyOperation::REQUEST_UPDATE_DOWNSTREAM});
             }
-            if (attachedPort.second == DeviceType::UNKNOWNDEVICE)
+            if (!(changed & (1u << prop)) || !sub.callback)
+                continue;
+
+            // The notify context may be storing a newer value meanwhile.
+            uint8_t value[LPF2_HUB_PROPERTY_SIZE];
+            int length = loadProperty(prop, value);
+            if (length < 0)
             {
+                // Kept being rewritten, try again on the next update().
+                m_propChanged.fetch_or(1u << prop, std::memory_order_relaxed);
                 continue;
             }
-            if (pPort->isDeviceConnected())
+            bool report = !sub.hasLast;
+            if (!report && (prop == (uint8_t)HubPropertyType::RSSI || prop == (uint8_t)HubPropertyType::BATTERY_VOLTAGE ||
+                            prop == (uint8_t)HubPropertyType::BUTTON))
             {
-                continue;
+                // One byte: RSSI in dBm (signed), battery in %, button state.
+                int a = !length ? 0 : (prop == (uint8_t)HubPropertyType::RSSI ? (int8_t)value[0] : value[0]);
+                int b = !sub.lastLength ? 0 : (prop == (uint8_t)HubPropertyType::RSSI ? (int8_t)sub.last[0] : sub.last[0]);
+                report = std::abs(a - b) >= std::max<int>(sub.threshold, 1);
             }
-            LPF2_LOG_D("Starting requests for: port: 0x%02X, dev: 0x%02X",
-                       (int)attachedPort.first, (int)attachedPort.second);
-            m_dataRequestState.portNum = attachedPort.first;
-            m_dataRequestState.state = DataRequestingState::PORT_INFO;
-            m_dataRequestState.finishedRequests = false;
-            m_dataRequestState.mode = 0;
-            m_dataRequestState.info = 0;
-            break;
+            else if (!report)
+            {
+                report = length != sub.lastLength || memcmp(value, sub.last, length) != 0;
+            }
+            if (!report)
+                continue;
+            sub.hasLast = true;
+            sub.lastLength = (uint8_t)length;
+            memcpy(sub.last, value, length);
+            sub.callback((HubPropertyType)prop, Utils::ByteSpan(sub.last, sub.lastLength));
         }
     }
 
-    /**
-     * @brief Get the address of the HUB (server address)
-     * @return HUB Address
-     */
-    NimBLEAddress Hub::getHubAddress()
+    void Hub::resetMessageStats()
     {
-        if (!m_bleServerAddress)
-        {
-            return NimBLEAddress();
-        }
-        NimBLEAddress pAddress = *m_bleServerAddress;
-        return pAddress;
+        std::fill(std::begin(m_messageCounts), std::end(m_messageCounts), 0);
+        std::fill(std::begin(m_messageBytes), std::end(m_messageBytes), 0);
+        std::fill(std::begin(m_propertyUpdates), std::end(m_propertyUpdates), 0);
     }
 
     /**
@@ -1092,11 +1355,13 @@ namespace Lpf2
 
     int Hub::setPortModeCombo(PortNum portNum, uint8_t comboIdx, const std::vector<uint8_t> &nibblePairs, const std::vector<uint32_t> &deltasPerMode)
     {
-        m_portCombinedFormatMap[portNum] = {comboIdx, nibblePairs};
+        PortState &state = _getPortState(portNum);
+        state.combinedFormat = {comboIdx, nibblePairs};
+        state.hasCombinedFormat = true;
 
         writeValue(MessageType::PORT_INPUT_FORMAT_SETUP_COMBINEDMODE, {portNum, 0x02});
 
-        vTaskDelay(10);
+        delay(10);
 
         for (size_t i = 0; i < nibblePairs.size(); i++)
         {
@@ -1119,12 +1384,24 @@ namespace Lpf2
 
         writeValue(MessageType::PORT_INPUT_FORMAT_SETUP_COMBINEDMODE, {portNum, 0x03});
 
-        vTaskDelay(50);
+        delay(50);
 
         return 0;
     }
 
-    void Hub::handlePortInputFormatCombinedModeMessage(const std::vector<uint8_t> &message)
+    void Hub::handlePortOutputCommandFeedbackMessage(Utils::ByteSpan message)
+    {
+        if (checkLenght(message, 5))
+            return;
+        // One port / feedback pair per port the message is about.
+        for (size_t i = 3; i + 1 < message.size(); i += 2)
+        {
+            if (PortState *state = m_ports.find((PortNum)message[i]))
+                state->port.onFeedback(message[i + 1]);
+        }
+    }
+
+    void Hub::handlePortInputFormatCombinedModeMessage(Utils::ByteSpan message)
     {
         if (checkLenght(message, 5))
             return;
@@ -1136,22 +1413,22 @@ namespace Lpf2
         LPF2_LOG_D("Port 0x%02X combined mode format confirmed", (int)portNum);
     }
 
-    void Hub::handlePortValueCombinedModeMessage(const std::vector<uint8_t> &message)
+    void Hub::handlePortValueCombinedModeMessage(Utils::ByteSpan message)
     {
         // Real hub format: portNum, comboIndex, bitMask(1B), values...
         if (checkLenght(message, 6))
             return;
 
-        PortNum portNum = (PortNum)message[(uint8_t)MessageByte::PORT_ID];
-
-        if (!m_portCombinedFormatMap.count(portNum))
+        PortState *state = m_ports.find((PortNum)message[(uint8_t)MessageByte::PORT_ID]);
+        if (!state || !state->hasCombinedFormat)
             return;
 
         uint8_t bitMask = message[5];
-        auto &setup = m_portCombinedFormatMap[portNum];
-        auto &port = *_getPort(portNum);
+        auto &setup = state->combinedFormat;
+        auto &port = state->port;
 
         size_t valueOffset = 6;
+        uint16_t updatedModes = 0;
         for (size_t i = 0; i < setup.nibblePairs.size(); i++)
         {
             if (!(bitMask & (1u << i)))
@@ -1177,15 +1454,35 @@ namespace Lpf2
                       message.begin() + valueOffset + dataSize,
                       mode.rawData.begin() + byteOffset);
             valueOffset += dataSize;
+            updatedModes |= (1u << modeNum);
 
             if (port.m_valueChangeCallback)
                 port.m_valueChangeCallback(modeNum);
         }
+
+        // Publish once per mode, after all of its datasets were copied.
+        for (uint8_t m = 0; updatedModes; m++, updatedModes >>= 1)
+        {
+            if (updatedModes & 1)
+                port.publishModeData(m);
+        }
     }
 
     bool Hub::infoReady()
     {
-        return m_dataRequestState.finishedRequests && !m_pendingRequest.valid;
+        if (m_pendingRequest.valid || !m_infoQueue.empty() || !m_portDiscovery.empty())
+            return false;
+        for (const auto &slot : m_infoSlots)
+        {
+            if (slot.state.load(std::memory_order_relaxed) != InfoSlotState::FREE)
+                return false;
+        }
+        return true;
+    }
+
+    void Hub::setInfoWindow(uint8_t window)
+    {
+        m_infoWindow = std::clamp<uint8_t>(window, 1, LPF2_HUB_INFO_WINDOW);
     }
 
     /**
@@ -1202,103 +1499,6 @@ namespace Lpf2
         sendHubPropertyUpdate(HubPropertyType::ADVERTISING_NAME);
     }
 
-    /**
-     * @brief Connect to the HUB, get a reference to the characteristic and register for notifications
-     */
-    bool Hub::connectHub()
-    {
-        if (!m_bleServerAddress)
-        {
-            LPF2_LOG_W("connectHub: no hub discovered yet");
-            return false;
-        }
-        BLEAddress pAddress = *m_bleServerAddress;
-        NimBLEClient *pClient = nullptr;
-
-        LPF2_LOG_D("number of ble clients: %d", NimBLEDevice::getCreatedClientCount());
-
-        /** Check if we have a client we should reuse first **/
-        if (NimBLEDevice::getCreatedClientCount())
-        {
-            /** Special case when we already know this device, we send false as the
-             *  second argument in connect() to prevent refreshing the service database.
-             *  This saves considerable time and power.
-             */
-            pClient = NimBLEDevice::getClientByPeerAddress(pAddress);
-            if (pClient)
-            {
-                if (!pClient->connect(pAddress, false))
-                {
-                    LPF2_LOG_E("reconnect failed");
-                    return false;
-                }
-                LPF2_LOG_D("reconnect client");
-            }
-            /** We don't already have a client that knows this device,
-             *  we will check for a client that is disconnected that we can use.
-             */
-            else
-            {
-                pClient = NimBLEDevice::getDisconnectedClient();
-            }
-        }
-
-        /** No client to reuse? Create a new one. */
-        if (!pClient)
-        {
-            if (NimBLEDevice::getCreatedClientCount() >= MYNEWT_VAL(BLE_MAX_CONNECTIONS))
-            {
-                LPF2_LOG_W("max clients reached - no more connections available: %d", NimBLEDevice::getCreatedClientCount());
-                return false;
-            }
-
-            pClient = NimBLEDevice::createClient();
-        }
-
-        if (!pClient->isConnected())
-        {
-            if (!pClient->connect(pAddress))
-            {
-                LPF2_LOG_E("failed to connect");
-                return false;
-            }
-        }
-
-        LPF2_LOG_D("connected to: %s, RSSI: %d", pClient->getPeerAddress().toString().c_str(), pClient->getRssi());
-        BLERemoteService *pRemoteService = pClient->getService(m_bleHubServiceUuid);
-        if (pRemoteService == nullptr)
-        {
-            LPF2_LOG_E("failed to get ble client");
-            return false;
-        }
-
-        m_bleHubCharacteristic = pRemoteService->getCharacteristic(m_bleHubCharachteristicUuid);
-        if (m_bleHubCharacteristic == nullptr)
-        {
-            LPF2_LOG_E("failed to get ble service");
-            return false;
-        }
-
-        // register notifications (callback function) for the characteristic
-        if (m_bleHubCharacteristic->canNotify())
-        {
-            m_bleHubCharacteristic->subscribe(true, std::bind(&Hub::notifyCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4), true);
-        }
-
-        // add callback instance to get notified if a disconnect event appears
-        pClient->setClientCallbacks(new HubClientCallback(this));
-
-        // Set states
-        m_connected = true;
-        m_connecting = false;
-        m_dataRequestState.finishedRequests = false;
-        m_dataRequestState.propId = HubPropertyType::ADVERTISING_NAME;
-        m_dataRequestState.mode = 0;
-        m_dataRequestState.state = DataRequestingState::HUB_ALERTS;
-        vTaskDelay(200);
-        return true;
-    }
-
     /**
      * @brief Retrieve the connection state. The BLE client (ESP32) has found a service with the desired UUID (HUB)
      * If this state is available, you can try to connect to the Hub
@@ -1309,20 +1509,11 @@ namespace Lpf2
     }
 
     /**
-     * @brief Retrieve the connection state. The BLE client (ESP32) is connected to the server (HUB)
+     * @brief Retrieve the connection state: a transport to the hub is attached (connectHub() or attach())
      */
     bool Hub::isConnected()
     {
-        return m_connected;
-    }
-
-    /**
-     * @brief Determine the scanning status
-     * @return Scanning status
-     */
-    bool Hub::isScanning()
-    {
-        return m_bleScan->isScanning();
+        return m_connected && !m_linkLost.load(std::memory_order_acquire);
     }
 
     /**
@@ -1336,82 +1527,129 @@ namespace Lpf2
 
     std::string Hub::getAllInfoStr()
     {
-        std::ostringstream oss;
-        oss << "Advertising Name: " << getHubPropStr(HubPropertyType::ADVERTISING_NAME) << "\n";
-        oss << "Manufacturer Name: " << getHubPropStr(HubPropertyType::MANUFACTURER_NAME) << "\n";
-        oss << "HW version: " << getHubPropStr(HubPropertyType::HW_VERSION) << "\n";
-        oss << "FW version: " << getHubPropStr(HubPropertyType::FW_VERSION) << "\n";
-        oss << "LWP version: " << getHubPropStr(HubPropertyType::LEGO_WIRELESS_PROTOCOL_VERSION) << "\n";
-        oss << "Radio FW version: " << getHubPropStr(HubPropertyType::RADIO_FIRMWARE_VERSION) << "\n";
-        oss << "Primary MAC: " << getHubPropStr(HubPropertyType::PRIMARY_MAC_ADDRESS) << "\n";
-        oss << "Secondary MAC: " << getHubPropStr(HubPropertyType::SECONDARY_MAC_ADDRESS) << "\n";
-        oss << "HW network id: " << getHubPropStr(HubPropertyType::HW_NETWORK_ID) << "\n";
-        oss << "System type ID: " << getHubPropStr(HubPropertyType::SYSTEM_TYPE_ID) << "\n";
-        oss << "HW network family: " << getHubPropStr(HubPropertyType::HARDWARE_NETWORK_FAMILY) << "\n";
-        oss << "RSSI: " << getHubPropStr(HubPropertyType::RSSI) << "\n";
-        oss << "Battery type: " << getHubPropStr(HubPropertyType::BATTERY_TYPE) << "\n";
-        oss << "Battery voltage: " << getHubPropStr(HubPropertyType::BATTERY_VOLTAGE) << "\n";
-        oss << "Button state: " << getHubPropStr(HubPropertyType::BUTTON) << "\n";
-        oss << "Devices:" << "\n";
-        std::for_each(m_remotePorts.begin(), m_remotePorts.end(), [&oss](std::pair<PortNum, Port *> pair)
-                      {
-        oss << pair.second->getInfoStr();
-        oss << "\n"; });
-        return oss.str();
+        return Utils::formatToString([this](char *buf, size_t size)
+                                     { return getAllInfoStr(buf, size); },
+                                     1024 + 3072 * m_ports.size());
     }
 
     std::string Hub::getHubPropStr(HubPropertyType propId)
+    {
+        return Utils::formatToString([this, propId](char *buf, size_t size)
+                                     { return getHubPropStr(buf, size, propId); });
+    }
+
+    std::string Hub::getHubPropStr(HubPropertyType propId, std::vector<uint8_t> prop)
+    {
+        return Utils::formatToString([propId, &prop](char *buf, size_t size)
+                                     { return getHubPropStr(buf, size, propId, prop.data(), prop.size()); });
+    }
+
+    size_t Hub::getAllInfoStr(char *buf, size_t size)
+    {
+        static const struct
+        {
+            const char *label;
+            HubPropertyType propId;
+        } props[] = {
+            {"Advertising Name: ", HubPropertyType::ADVERTISING_NAME},
+            {"Manufacturer Name: ", HubPropertyType::MANUFACTURER_NAME},
+            {"HW version: ", HubPropertyType::HW_VERSION},
+            {"FW version: ", HubPropertyType::FW_VERSION},
+            {"LWP version: ", HubPropertyType::LEGO_WIRELESS_PROTOCOL_VERSION},
+            {"Radio FW version: ", HubPropertyType::RADIO_FIRMWARE_VERSION},
+            {"Primary MAC: ", HubPropertyType::PRIMARY_MAC_ADDRESS},
+            {"Secondary MAC: ", HubPropertyType::SECONDARY_MAC_ADDRESS},
+            {"HW network id: ", HubPropertyType::HW_NETWORK_ID},
+            {"System type ID: ", HubPropertyType::SYSTEM_TYPE_ID},
+            {"HW network family: ", HubPropertyType::HARDWARE_NETWORK_FAMILY},
+            {"RSSI: ", HubPropertyType::RSSI},
+            {"Battery type: ", HubPropertyType::BATTERY_TYPE},
+            {"Battery voltage: ", HubPropertyType::BATTERY_VOLTAGE},
+            {"Button state: ", HubPropertyType::BUTTON},
+        };
+
+        Utils::StrBuf out(buf, size);
+        // Sub-formatters write straight into the unused tail of the buffer.
+        auto tail = [&](size_t &tailSize) -> char *
+        {
+            size_t len = out.length();
+            tailSize = len < size ? size - len : 0;
+            return tailSize ? buf + len : nullptr;
+        };
+        size_t tailSize;
+        for (const auto &p : props)
+        {
+            out.append(p.label);
+            char *t = tail(tailSize);
+            out.skip(getHubPropStr(t, tailSize, p.propId));
+            out.append("\n", 1);
+        }
+        out.append("Devices:\n");
+        m_ports.forEach([&](PortNum, PortState &state)
+                        {
+            char *t = tail(tailSize);
+            out.skip(state.port.getInfoStr(t, tailSize));
+            out.append("\n", 1); });
+        return out.length();
+    }
+
+    size_t Hub::getHubPropStr(char *buf, size_t size, HubPropertyType propId)
     {
         if (propId >= HubPropertyType::END)
         {
             LPF2_LOG_E("Invalid HUB property.");
-            return "";
+            if (size)
+                buf[0] = '\0';
+            return 0;
         }
         auto &prop = m_hubProperty[(uint8_t)propId];
-        return getHubPropStr(propId, prop);
+        return getHubPropStr(buf, size, propId, prop.data(), prop.size());
     }
 
-    std::string Hub::getHubPropStr(HubPropertyType propId, std::vector<uint8_t> prop)
+    size_t Hub::getHubPropStr(char *buf, size_t size, HubPropertyType propId, const uint8_t *prop, size_t len)
     {
-        std::string str;
+        Utils::StrBuf out(buf, size);
+        // Fixed-size properties read missing bytes as 0.
+        uint8_t fixed[6] = {};
+        if (prop && len)
+            std::memcpy(fixed, prop, std::min(len, sizeof(fixed)));
         switch (propId)
         {
         case HubPropertyType::ADVERTISING_NAME:
+        case HubPropertyType::MANUFACTURER_NAME:
+        case HubPropertyType::RADIO_FIRMWARE_VERSION:
         {
-            str.assign(prop.begin(), prop.end());
+            out.append(reinterpret_cast<const char *>(prop), len);
             break;
         }
         case HubPropertyType::BATTERY_TYPE:
         {
-            prop.resize(1);
-            str = prop[0] == (uint8_t)BatteryType::NORMAL ? "Normal" : "Rechargeable";
+            out.append(fixed[0] == (uint8_t)BatteryType::NORMAL ? "Normal" : "Rechargeable");
             break;
         }
         case HubPropertyType::BATTERY_VOLTAGE:
         {
-            prop.resize(1);
-            str = std::to_string(prop[0]);
+            out.printf("%u", (unsigned int)fixed[0]);
             break;
         }
         case HubPropertyType::BUTTON:
         {
-            prop.resize(1);
-            switch ((ButtonState)prop[0])
+            switch ((ButtonState)fixed[0])
             {
             case ButtonState::RELEASED:
-                str = "Released";
+                out.append("Released");
                 break;
 
             case ButtonState::DOWN:
-                str = "Down";
+                out.append("Down");
                 break;
 
             case ButtonState::UP:
-                str = "Up";
+                out.append("Up");
                 break;
 
             case ButtonState::STOP:
-                str = "Stop";
+                out.append("Stop");
                 break;
 
             default:
@@ -1420,76 +1658,41 @@ namespace Lpf2
             break;
         }
         case HubPropertyType::FW_VERSION:
+        case HubPropertyType::HW_VERSION:
         {
-            prop.resize(4);
-            Version version = Utils::unPackVersion(prop);
-            str = std::to_string(version.Major) + "." + std::to_string(version.Minor) + "." + std::to_string(version.Bugfix) + "." + std::to_string(version.Build);
+            Version version = Utils::unPackVersion(fixed);
+            out.printf("%d.%d.%d.%d", version.Major, version.Minor, version.Bugfix, version.Build);
             break;
         }
         case HubPropertyType::HARDWARE_NETWORK_FAMILY:
-        {
-            prop.resize(1);
-            str = Utils::bytes_to_hexString(prop);
-            break;
-        }
         case HubPropertyType::HW_NETWORK_ID:
+        case HubPropertyType::SYSTEM_TYPE_ID:
         {
-            prop.resize(1);
-            str = Utils::bytes_to_hexString(prop);
-            break;
-        }
-        case HubPropertyType::HW_VERSION:
-        {
-            prop.resize(4);
-            Version version = Utils::unPackVersion(prop);
-            str = std::to_string(version.Major) + "." + std::to_string(version.Minor) + "." + std::to_string(version.Bugfix) + "." + std::to_string(version.Build);
+            out.printf("0x%02x", (unsigned int)fixed[0]);
             break;
         }
         case HubPropertyType::LEGO_WIRELESS_PROTOCOL_VERSION:
         {
-            prop.resize(2);
-            str = Utils::bytes_to_hexString(prop);
-            break;
-        }
-        case HubPropertyType::MANUFACTURER_NAME:
-        {
-            str.insert(str.begin(), prop.begin(), prop.end());
+            out.printf("0x%02x, 0x%02x", (unsigned int)fixed[0], (unsigned int)fixed[1]);
             break;
         }
         case HubPropertyType::SECONDARY_MAC_ADDRESS:
         case HubPropertyType::PRIMARY_MAC_ADDRESS:
         {
-            prop.resize(6);
-            str = Utils::byte_to_hexString(prop[0]) + ":" +
-                  Utils::byte_to_hexString(prop[1]) + ":" +
-                  Utils::byte_to_hexString(prop[2]) + ":" +
-                  Utils::byte_to_hexString(prop[3]) + ":" +
-                  Utils::byte_to_hexString(prop[4]) + ":" +
-                  Utils::byte_to_hexString(prop[5]);
-            break;
-        }
-        case HubPropertyType::RADIO_FIRMWARE_VERSION:
-        {
-            str.insert(str.begin(), prop.begin(), prop.end());
+            out.printf("0x%02x:0x%02x:0x%02x:0x%02x:0x%02x:0x%02x",
+                       fixed[0], fixed[1], fixed[2], fixed[3], fixed[4], fixed[5]);
             break;
         }
         case HubPropertyType::RSSI:
         {
-            prop.resize(1);
-            str = std::to_string((int8_t)prop[0]);
-            break;
-        }
-        case HubPropertyType::SYSTEM_TYPE_ID:
-        {
-            prop.resize(1);
-            str = Utils::bytes_to_hexString(prop);
+            out.printf("%d", (int)(int8_t)fixed[0]);
             break;
         }
 
         default:
             break;
         }
-        return str;
+        return out.length();
     }
 
     std::string Hub::getName()
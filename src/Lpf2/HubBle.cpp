@@ -0,0 +1,380 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *  Copyright (C) 2020 - Cornelius Munz
+ * 
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#if !defined(LPF2_NATIVE)
+
+#include "Lpf2/Hub.hpp"
+#include "Lpf2/Util/Values.hpp"
+#include "Lpf2/log/log.h"
+
+namespace Lpf2
+{
+    /**
+     * Derived class which could be added as an instance to the BLEClient for callback handling
+     * The current hub is given as a parameter in the constructor to be able to set the
+     * status flags on a disconnect event accordingly
+     */
+    class HubClientCallback : public BLEClientCallbacks
+    {
+
+        Hub *_lpf2Hub;
+
+    public:
+        HubClientCallback(Hub *lpf2Hub) : BLEClientCallbacks()
+        {
+            _lpf2Hub = lpf2Hub;
+        }
+
+        void onConnect(BLEClient *bleClient) override
+        {
+        }
+
+        void onDisconnect(BLEClient *bleClient, int reason) override
+        {
+            // Runs on the NimBLE task: update() detaches on the task that
+            // owns the hub's state.
+            _lpf2Hub->m_connecting = false;
+            _lpf2Hub->m_linkLost.store(true, std::memory_order_release);
+            LPF2_LOG_D("Disconnected client, reason: %i", reason);
+        }
+    };
+
+    /**
+     * Scan for BLE servers and find the first one that advertises the service we are looking for.
+     */
+    class Lpf2HubAdvertisedDeviceCallbacks : public BLEAdvertisedDeviceCallbacks
+    {
+        Hub *_lpf2Hub;
+
+    public:
+        Lpf2HubAdvertisedDeviceCallbacks(Hub *lpf2Hub) : BLEAdvertisedDeviceCallbacks()
+        {
+            _lpf2Hub = lpf2Hub;
+        }
+
+        void onScanEnd(const NimBLEScanResults &results, int reason) override
+        {
+            LPF2_LOG_D("Scan Ended reason: %d\nNumber of devices: %d", reason, results.getCount());
+            for (int i = 0; i < results.getCount(); i++)
+            {
+                LPF2_LOG_D("device[%d]: %s", i, results.getDevice(i)->toString().c_str());
+            }
+        }
+
+        void onResult(const NimBLEAdvertisedDevice *advertisedDevice) override
+        {
+            // Found a device, check if the service is contained and optional if address fits requested address
+            LPF2_LOG_D("advertised device: %s", advertisedDevice->toString().c_str());
+
+            if (_lpf2Hub->matchAdvertisement(advertisedDevice))
+            {
+                advertisedDevice->getScan()->stop();
+                _lpf2Hub->acceptAdvertisement(advertisedDevice);
+                _lpf2Hub->m_connecting = true;
+            }
+        }
+    };
+
+    bool Hub::matchAdvertisement(const NimBLEAdvertisedDevice *advertisedDevice) const
+    {
+        return advertisedDevice->haveServiceUUID() && advertisedDevice->getServiceUUID().equals(m_bleHubServiceUuid) &&
+               (m_bleRequestedDeviceAddress == nullptr || advertisedDevice->getAddress().equals(*m_bleRequestedDeviceAddress));
+    }
+
+    void Hub::acceptAdvertisement(const NimBLEAdvertisedDevice *advertisedDevice)
+    {
+        delete m_bleServerAddress;
+        m_bleServerAddress = new BLEAddress(advertisedDevice->getAddress());
+        setHubNameProp(advertisedDevice->getName());
+
+        if (advertisedDevice->haveManufacturerData())
+        {
+            LPF2_LOG_D("advertisement payload: %s", Utils::bytes_to_hexString(advertisedDevice->getPayload()).c_str());
+            LPF2_LOG_D("manufacturer data: %s", Utils::bytes_to_hexString(advertisedDevice->getManufacturerData()).c_str());
+            uint8_t *manufacturerData = (uint8_t *)advertisedDevice->getManufacturerData().data();
+            uint8_t manufacturerDataLength = advertisedDevice->getManufacturerData().length();
+            if (manufacturerDataLength >= 3)
+            {
+                LPF2_LOG_D("manufacturer data hub type: %x", manufacturerData[3]);
+                // check device type ID
+                switch (manufacturerData[3])
+                {
+                case DUPLO_TRAIN_HUB_ID:
+                    m_hubType = HubType::DUPLO_TRAIN_HUB;
+                    break;
+                case BOOST_MOVE_HUB_ID:
+                    m_hubType = HubType::BOOST_MOVE_HUB;
+                    break;
+                case POWERED_UP_HUB_ID:
+                    m_hubType = HubType::POWERED_UP_HUB;
+                    break;
+                case POWERED_UP_REMOTE_ID:
+                    m_hubType = HubType::POWERED_UP_REMOTE;
+                    break;
+                case CONTROL_PLUS_HUB_ID:
+                    m_hubType = HubType::CONTROL_PLUS_HUB;
+                    break;
+                case MARIO_HUB_ID:
+                    m_hubType = HubType::MARIO_HUB;
+                    break;
+                default:
+                    m_hubType = HubType::UNKNOWNHUB;
+                    break;
+                }
+            }
+        }
+    }
+
+    void Hub::setupBle()
+    {
+        handleLinkLoss();
+        resetDiscovery();
+        m_connected = false;
+        m_connecting = false;
+        m_bleHubServiceUuid = BLEUUID(LPF2_UUID);
+        m_bleHubCharachteristicUuid = BLEUUID(LPF2_CHARACHTERISTIC);
+        m_hubType = HubType::UNKNOWNHUB;
+    }
+
+    /**
+     * @brief Init function set the UUIDs and scan for the Hub
+     */
+    void Hub::init()
+    {
+        setupBle();
+
+        BLEDevice::init("");
+        m_bleScan = BLEDevice::getScan();
+
+        m_bleAdvertiseDeviceCallback = new Lpf2HubAdvertisedDeviceCallbacks(this);
+
+        if (m_bleAdvertiseDeviceCallback == nullptr)
+        {
+            LPF2_LOG_E("failed to create advertise device callback");
+            return;
+        }
+
+        m_bleScan->setScanCallbacks(m_bleAdvertiseDeviceCallback);
+
+        m_bleScan->setActiveScan(true);
+        // start method with callback function to enforce the non blocking scan. If no callback function is used,
+        // the scan starts in a blocking manner
+        m_bleScan->start(m_bleScanDuration);
+    }
+
+    /**
+     * @brief Init function set the UUIDs and scan for the Hub
+     * @param [in] deviceAddress to which the arduino should connect represented by a hex string of the format: 00:00:00:00:00:00
+     */
+    void Hub::init(std::string deviceAddress)
+    {
+        m_bleRequestedDeviceAddress = new BLEAddress(deviceAddress, 0);
+        init();
+    }
+
+    /**
+     * @brief Init function set the BLE scan duration (default value 5s)
+     * @param [in] BLE scan durtation in unit seconds
+     */
+    void Hub::init(uint32_t scanDuration)
+    {
+        m_bleScanDuration = scanDuration;
+        init();
+    }
+
+    /**
+     * @brief Init function set the BLE scan duration (default value 5s)
+     * @param [in] deviceAddress to which the arduino should connect represented by a hex string of the format: 00:00:00:00:00:00
+     * @param [in] BLE scan durtation in unit seconds
+     */
+    void Hub::init(std::string deviceAddress, uint32_t scanDuration)
+    {
+        m_bleRequestedDeviceAddress = new BLEAddress(deviceAddress, 0);
+        m_bleScanDuration = scanDuration;
+        init();
+    }
+
+    /**
+     * @brief Get the address of the HUB (server address)
+     * @return HUB Address
+     */
+    NimBLEAddress Hub::getHubAddress()
+    {
+        if (!m_bleServerAddress)
+        {
+            return NimBLEAddress();
+        }
+        NimBLEAddress pAddress = *m_bleServerAddress;
+        return pAddress;
+    }
+
+    /**
+     * @brief Connect to the HUB, get a reference to the characteristic and register for notifications
+     */
+    bool Hub::connectHub()
+    {
+        NimBLEClient *pClient = connectClient(false);
+        if (!pClient || !setupClient(pClient))
+            return false;
+        vTaskDelay(200);
+        return true;
+    }
+
+    NimBLEClient *Hub::connectClient(bool async)
+    {
+        if (!m_bleServerAddress)
+        {
+            LPF2_LOG_W("connectHub: no hub discovered yet");
+            return nullptr;
+        }
+        BLEAddress pAddress = *m_bleServerAddress;
+        NimBLEClient *pClient = nullptr;
+        bool initiated = false;
+
+        LPF2_LOG_D("number of ble clients: %d", NimBLEDevice::getCreatedClientCount());
+
+        /** Check if we have a client we should reuse first **/
+        if (NimBLEDevice::getCreatedClientCount())
+        {
+            /** Special case when we already know this device, we send false as the
+             *  second argument in connect() to prevent refreshing the service database.
+             *  This saves considerable time and power.
+             */
+            pClient = NimBLEDevice::getClientByPeerAddress(pAddress);
+            if (pClient)
+            {
+                if (!pClient->connect(pAddress, false, async))
+                {
+                    LPF2_LOG_E("reconnect failed");
+                    return nullptr;
+                }
+                initiated = true;
+                LPF2_LOG_D("reconnect client");
+            }
+            /** We don't already have a client that knows this device,
+             *  we will check for a client that is disconnected that we can use.
+             */
+            else
+            {
+                pClient = NimBLEDevice::getDisconnectedClient();
+            }
+        }
+
+        /** No client to reuse? Create a new one. */
+        if (!pClient)
+        {
+            if (NimBLEDevice::getCreatedClientCount() >= MYNEWT_VAL(BLE_MAX_CONNECTIONS))
+            {
+                LPF2_LOG_W("max clients reached - no more connections available: %d", NimBLEDevice::getCreatedClientCount());
+                return nullptr;
+            }
+
+            pClient = NimBLEDevice::createClient();
+        }
+
+        if (!initiated && !pClient->isConnected())
+        {
+            if (!pClient->connect(pAddress, true, async))
+            {
+                LPF2_LOG_E("failed to connect");
+                return nullptr;
+            }
+        }
+        return pClient;
+    }
+
+    bool Hub::setupClient(NimBLEClient *pClient)
+    {
+        LPF2_LOG_D("connected to: %s, RSSI: %d", pClient->getPeerAddress().toString().c_str(), pClient->getRssi());
+        BLERemoteService *pRemoteService = pClient->getService(m_bleHubServiceUuid);
+        if (pRemoteService == nullptr)
+        {
+            LPF2_LOG_E("failed to get ble client");
+            return false;
+        }
+
+        BLERemoteCharacteristic *characteristic = pRemoteService->getCharacteristic(m_bleHubCharachteristicUuid);
+        if (characteristic == nullptr)
+        {
+            LPF2_LOG_E("failed to get ble service");
+            return false;
+        }
+
+        // A disconnect of the previous link not seen by update() yet.
+        handleLinkLoss();
+
+        // Attach first: the discovery cache is loaded and the receiver set
+        // before the hub sends its HUB_ATTACHED_IO messages.
+        setHubId(pClient->getPeerAddress().toString());
+        attach(&m_bleTransport);
+
+        // register notifications (callback function) for the characteristic
+        m_bleTransport.begin(characteristic);
+
+        // add callback instance to get notified if a disconnect event appears
+        pClient->setClientCallbacks(new HubClientCallback(this));
+
+        m_connecting = false;
+        return true;
+    }
+
+    bool BleHubTransport::begin(NimBLERemoteCharacteristic *characteristic)
+    {
+        m_characteristic = characteristic;
+        if (!characteristic->canNotify())
+            return false;
+        return characteristic->subscribe(true, [this](NimBLERemoteCharacteristic *, uint8_t *pData, size_t length, bool)
+                                         { deliver(pData, length); }, true);
+    }
+
+    void BleHubTransport::end()
+    {
+        m_characteristic = nullptr;
+    }
+
+    bool BleHubTransport::write(const uint8_t *data, size_t length)
+    {
+        if (!m_characteristic)
+            return false;
+        return m_characteristic->writeValue(data, length, false);
+    }
+
+    void BleHubTransport::idle(uint32_t ms)
+    {
+        vTaskDelay(pdMS_TO_TICKS(ms));
+    }
+
+    uint32_t BleHubTransport::connectionIntervalUs()
+    {
+        if (!m_characteristic)
+            return 0;
+        // In units of 1.25 ms.
+        return m_characteristic->getRemoteService()->getClient()->getConnInfo().getConnInterval() * 1250u;
+    }
+
+    /**
+     * @brief Determine the scanning status
+     * @return Scanning status
+     */
+    bool Hub::isScanning()
+    {
+        return m_bleScan->isScanning();
+    }
+}; // namespace Lpf2
+
+#endif // !LPF2_NATIVE
@@ -23,6 +23,7 @@
 #include "Lpf2/Virtual/Device.hpp"
 #include "Lpf2/DeviceDescLib.hpp"
 #include <algorithm>
+#include <cmath>
 
 namespace Lpf2
 {
@@ -398,12 +399,13 @@ namespace Lpf2
     void HubEmulation::handlePortInformationRequestMessage(std::vector<uint8_t> message)
     {
         PortNum portNum = (PortNum)message[(uint8_t)MessageByte::PORT_ID];
-        if (m_attachedPorts.find(portNum) == m_attachedPorts.end())
+        PortState *state = attachedPort(portNum);
+        if (!state)
         {
             LPF2_LOG_W("Port information request for unattached port %d", portNum);
             return;
         }
-        Port *port = m_attachedPorts[portNum];
+        Port *port = state->port;
         // DeviceType deviceType = port->getDeviceType();
         uint8_t informationType = message[(uint8_t)MessageByte::OPERATION];
 
@@ -447,12 +449,13 @@ namespace Lpf2
     void HubEmulation::handlePortModeInformationRequestMessage(std::vector<uint8_t> message)
     {
         PortNum portNum = (PortNum)message[(uint8_t)MessageByte::PORT_ID];
-        if (m_attachedPorts.find(portNum) == m_attachedPorts.end())
+        PortState *state = attachedPort(portNum);
+        if (!state)
         {
             LPF2_LOG_W("Port information request for unattached port %d", portNum);
             return;
         }
-        Port *port = m_attachedPorts[portNum];
+        Port *port = state->port;
         // DeviceType deviceType = port->getDeviceType();
         uint8_t modeNum = message[(uint8_t)MessageByte::OPERATION];
         ModeInfoType modeInfoType = (ModeInfoType)message[(uint8_t)MessageByte::SUB_COMMAND];
@@ -542,15 +545,25 @@ namespace Lpf2
     void HubEmulation::handlePortInputFormatSetupSingleMessage(std::vector<uint8_t> message)
     {
         PortNum portNum = (PortNum)message[(uint8_t)MessageByte::PORT_ID];
-        if (m_attachedPorts.find(portNum) == m_attachedPorts.end())
+        PortState *state = attachedPort(portNum);
+        if (!state)
         {
             LPF2_LOG_W("Port input format setup (single) for unattached port %d", portNum);
             return;
         }
-        Port *port = m_attachedPorts[portNum];
+        Port *port = state->port;
         uint8_t modeNum = message[(uint8_t)MessageByte::OPERATION];
+        if (modeNum >= 16)
+        {
+            LPF2_LOG_E("Invalid mode number: %i", modeNum);
+            return;
+        }
 
-        PortInputSetupSingle setup;
+        auto &setup = state->single[modeNum];
+        state->singleModes |= (uint16_t)(1u << modeNum);
+        unsubscribeAll(port, setup.subscriptions);
+        setup.polled = false;
+        setup.polledLast.clear();
         setup.portNum = portNum;
         setup.mode = modeNum;
         message.resize(10);
@@ -559,11 +572,36 @@ namespace Lpf2
 
         LPF2_LOG_D("Single set: port 0x%02X, mode %d, delta %d, notify %d", (uint8_t)portNum, modeNum, setup.delta, setup.notify);
 
-        m_portSetupSingle[portNum][modeNum] = setup;
+        PortValuePending *pending = &state->pending;
+        if (modeNum < port->getModeCount())
+        {
+            for (uint8_t dataSet = 0; dataSet < port->getModes()[modeNum].data_sets; dataSet++)
+            {
+                int id = port->subscribe(modeNum, dataSet, (float)setup.delta, 0,
+                    [pending, modeNum](uint8_t, uint8_t, float)
+                    {
+                        pending->singleModes.fetch_or((uint16_t)(1u << modeNum));
+                    });
+                if (id < 0)
+                {
+                    setup.polled = true;
+                    break;
+                }
+                setup.subscriptions.push_back(id);
+            }
+            if (setup.polled)
+            {
+                // The table is shared with the application's subscriptions.
+                LPF2_LOG_W("Port 0x%02X mode %d: no free subscription slot, polling it.", (uint8_t)portNum, modeNum);
+                unsubscribeAll(port, setup.subscriptions);
+                for (uint8_t dataSet = 0; dataSet < port->getModes()[modeNum].data_sets; dataSet++)
+                    setup.polledLast.push_back(port->getValue(modeNum, dataSet));
+            }
+            // Report the current value right away, like a real hub does.
+            pending->singleModes.fetch_or((uint16_t)(1u << modeNum));
+        }
 
-        auto combinedIt = m_portSetupCombined.find(portNum);
-        bool locked = combinedIt != m_portSetupCombined.end() && combinedIt->second.locked;
-        if (!locked)
+        if (!(state->hasCombined && state->combined.locked))
             port->setMode(modeNum);
 
         message.erase(message.begin(), message.begin() + 3);
@@ -579,16 +617,19 @@ namespace Lpf2
             return;
         }
         PortNum portNum = (PortNum)message[(uint8_t)MessageByte::PORT_ID];
-        if (m_attachedPorts.find(portNum) == m_attachedPorts.end())
+        PortState *state = attachedPort(portNum);
+        if (!state)
         {
             LPF2_LOG_W("Port input format setup (combined) for unattached port %d", portNum);
             return;
         }
-        Port *port = m_attachedPorts[portNum];
+        Port *port = state->port;
         uint8_t subCmd = message[(uint8_t)MessageByte::OPERATION];
 
-        auto &setup = m_portSetupCombined[portNum];
+        auto &setup = state->combined;
         setup.portNum = portNum;
+        state->hasCombined = true;
+        PortValuePending *pending = &state->pending;
 
         switch (subCmd)
         {
@@ -606,6 +647,8 @@ namespace Lpf2
         }
         case 0x02: // Lock for Setup
             LPF2_LOG_D("Combined lock: port 0x%02X", (uint8_t)portNum);
+            unsubscribeAll(port, setup.subscriptions);
+            setup.polled = false;
             setup.locked = true;
             setup.active = false;
             setup.multiUpdateEnabled = false;
@@ -617,14 +660,39 @@ namespace Lpf2
             setup.active = true;
             setup.multiUpdateEnabled = true;
             setup.deltas.clear();
+            unsubscribeAll(port, setup.subscriptions);
+            setup.polled = false;
+            setup.polledLast.clear();
             for (uint8_t nibblePair : setup.modeDatasetPairs)
             {
                 uint8_t mn = (nibblePair >> 4) & 0x0F;
                 float d = 1.0f;
-                if (m_portSetupSingle[portNum].count(mn))
-                    d = (float)m_portSetupSingle[portNum][mn].delta;
+                if (state->singleModes & (1u << mn))
+                    d = (float)state->single[mn].delta;
                 setup.deltas.push_back(d);
+                if (setup.polled)
+                    continue;
+                int id = port->subscribe(mn, nibblePair & 0x0F, d, 0,
+                    [pending](uint8_t, uint8_t, float)
+                    {
+                        pending->combined = true;
+                    });
+                if (id < 0)
+                    setup.polled = true;
+                else
+                    setup.subscriptions.push_back(id);
             }
+            if (setup.polled)
+            {
+                LPF2_LOG_W("Port 0x%02X combo %d: no free subscription slot, polling it.", (uint8_t)portNum, setup.comboIndex);
+                unsubscribeAll(port, setup.subscriptions);
+                for (uint8_t nibblePair : setup.modeDatasetPairs)
+                {
+                    uint8_t mn = (nibblePair >> 4) & 0x0F;
+                    setup.polledLast.push_back(mn < port->getModeCount() ? port->getValue(mn, nibblePair & 0x0F) : 0.0f);
+                }
+            }
+            pending->combined = true;
             port->setModeCombo(setup.comboIndex, setup.deltas);
             sendCombinedModeFormat(setup);
             break;
@@ -635,12 +703,14 @@ namespace Lpf2
             setup.active = true;
             setup.multiUpdateEnabled = false;
             setup.deltas.clear();
+            unsubscribeAll(port, setup.subscriptions);
+            setup.polled = false;
             for (uint8_t nibblePair : setup.modeDatasetPairs)
             {
                 uint8_t mn = (nibblePair >> 4) & 0x0F;
                 float d = 1.0f;
-                if (m_portSetupSingle[portNum].count(mn))
-                    d = (float)m_portSetupSingle[portNum][mn].delta;
+                if (state->singleModes & (1u << mn))
+                    d = (float)state->single[mn].delta;
                 setup.deltas.push_back(d);
             }
             port->setModeCombo(setup.comboIndex, setup.deltas);
@@ -651,7 +721,8 @@ namespace Lpf2
             LPF2_LOG_D("Combined reset: port 0x%02X", (uint8_t)portNum);
             setup.modeDatasetPairs.clear();
             setup.deltas.clear();
-            setup.lastRawPerMode.clear();
+            unsubscribeAll(port, setup.subscriptions);
+            setup.polled = false;
             setup.comboIndex = 0;
             setup.locked = false;
             setup.active = false;
@@ -675,41 +746,32 @@ namespace Lpf2
         writeResponse(MessageType::PORT_INPUT_FORMAT_COMBINEDMODE, response);
     }
 
-    void HubEmulation::checkPortModeValueCombined(PortInputSetupCombined &setup, Port *port)
+    void HubEmulation::checkPortModeValueCombined(PortState &state)
     {
+        auto &setup = state.combined;
         if (!setup.multiUpdateEnabled || setup.modeDatasetPairs.empty())
             return;
 
-        bool shouldSend = false;
-        for (size_t i = 0; i < setup.modeDatasetPairs.size(); i++)
+        if (setup.polled)
         {
-            uint8_t nibblePair = setup.modeDatasetPairs[i];
-            uint8_t modeNum = (nibblePair >> 4) & 0x0F;
-            uint8_t dataSet = nibblePair & 0x0F;
-            if (modeNum >= port->getModeCount())
-                continue;
-
-            float delta = (i < setup.deltas.size()) ? setup.deltas[i] : 1.0f;
-            auto &lastRaw = setup.lastRawPerMode[modeNum];
-            if (std::abs(port->getValue(modeNum, dataSet) - port->getValue(modeNum, lastRaw, dataSet)) >= delta)
+            bool moved = false;
+            for (size_t i = 0; i < setup.modeDatasetPairs.size() && i < setup.polledLast.size(); i++)
             {
-                shouldSend = true;
-                break;
+                uint8_t mn = (setup.modeDatasetPairs[i] >> 4) & 0x0F;
+                if (mn < state.port->getModeCount() &&
+                    pollMoved(state.port, mn, setup.modeDatasetPairs[i] & 0x0F, setup.deltas[i], setup.polledLast[i]))
+                    moved = true;
             }
+            if (moved)
+                state.pending.combined = true;
         }
 
-        if (shouldSend)
-        {
-            for (uint8_t nibblePair : setup.modeDatasetPairs)
-            {
-                uint8_t modeNum = (nibblePair >> 4) & 0x0F;
-                if (modeNum >= port->getModeCount())
-                    continue;
-                setup.lastRawPerMode[modeNum] = port->getModes()[modeNum].rawData;
-            }
-            sendPortValueCombined(setup, port);
-            vTaskDelay(1);
-        }
+        // Set by the port's subscriptions when any pair moved by its delta.
+        if (!state.pending.combined.exchange(false))
+            return;
+
+        sendPortValueCombined(setup, state.port);
+        vTaskDelay(1);
     }
 
     void HubEmulation::sendPortValueCombined(PortInputSetupCombined &setup, Port *port)
@@ -742,12 +804,13 @@ namespace Lpf2
             return;
         }
         PortNum portNum = (PortNum)message[(uint8_t)MessageByte::PORT_ID];
-        if (m_attachedPorts.find(portNum) == m_attachedPorts.end())
+        PortState *state = attachedPort(portNum);
+        if (!state)
         {
             LPF2_LOG_W("Port output command for unattached port %d", portNum);
             return;
         }
-        Port *port = m_attachedPorts[portNum];
+        Port *port = state->port;
         // uint8_t startupAndCompletion = message[(uint8_t)MessageByte::OPERATION];
         PortOutputSubCommand subcommand = (PortOutputSubCommand)message[(uint8_t)MessageByte::SUB_COMMAND];
         std::vector<uint8_t> payload(message.begin() + 6, message.end());
@@ -803,14 +866,31 @@ namespace Lpf2
         writeResponse(MessageType::PORT_OUTPUT_COMMAND_FEEDBACK, {(uint8_t)portNum, 0x0A});
     }
 
-    void HubEmulation::checkPort(PortNum portNum, Port *port)
+    HubEmulation::PortState *HubEmulation::attachedPort(PortNum portNum) const
+    {
+        PortState *state = m_ports.find(portNum);
+        return state && state->port ? state : nullptr;
+    }
+
+    void HubEmulation::clearPortSetups(PortState &state)
+    {
+        for (auto &setup : state.single)
+            unsubscribeAll(state.port, setup.subscriptions);
+        state.singleModes = 0;
+        unsubscribeAll(state.port, state.combined.subscriptions);
+        state.combined = PortInputSetupCombined();
+        state.hasCombined = false;
+    }
+
+    void HubEmulation::checkPort(PortNum portNum, PortState &state)
     {
+        Port *port = state.port;
         port->ensureRawDataSize();
-        if (m_connectedDevices[portNum] != port->isDeviceConnected())
+        if (state.deviceConnected != port->isDeviceConnected())
         {
-            m_connectedDevices[portNum] = port->isDeviceConnected();
+            state.deviceConnected = port->isDeviceConnected();
 
-            if (m_connectedDevices[portNum])
+            if (state.deviceConnected)
             {
                 LPF2_LOG_I("Device connected to port %d", portNum);
                 std::vector<uint8_t> payload;
@@ -827,8 +907,9 @@ namespace Lpf2
             else
             {
                 LPF2_LOG_I("Device disconnected from port %d", portNum);
-                m_portSetupSingle[portNum].clear();
-                m_portSetupCombined.erase(portNum);
+                clearPortSetups(state);
+                state.pending.singleModes = 0;
+                state.pending.combined = false;
                 std::vector<uint8_t> payload;
                 payload.push_back((char)portNum);
                 payload.push_back((char)IOEvent::DETACHED_IO);
@@ -837,38 +918,54 @@ namespace Lpf2
             vTaskDelay(1);
         }
 
-        auto combinedIt = m_portSetupCombined.find(portNum);
-        bool combinedActive = combinedIt != m_portSetupCombined.end() &&
-                              (combinedIt->second.locked || combinedIt->second.active);
+        bool combinedActive = state.hasCombined && (state.combined.locked || state.combined.active);
 
         if (!combinedActive)
         {
-            std::for_each(m_portSetupSingle[portNum].begin(), m_portSetupSingle[portNum].end(),
-                [this, port](auto &pair)
-                {
-                    checkPortModeValueSingle(pair.second, port);
-                });
+            for (uint16_t modes = state.singleModes; modes; modes &= modes - 1)
+                checkPortModeValueSingle(state, state.single[__builtin_ctz(modes)]);
         }
 
-        if (combinedIt != m_portSetupCombined.end() && !combinedIt->second.locked)
-            checkPortModeValueCombined(combinedIt->second, port);
+        if (state.hasCombined && !state.combined.locked)
+            checkPortModeValueCombined(state);
     }
 
-    void HubEmulation::checkPortModeValueSingle(PortInputSetupSingle &setup, Port *port)
+    void HubEmulation::checkPortModeValueSingle(PortState &state, PortInputSetupSingle &setup)
     {
-        uint8_t mode = setup.mode;
-        uint8_t dataSets = port->getModes()[mode].data_sets;
-        auto &raw = port->getModes()[mode].rawData;
-        for (uint8_t dataSet = 0; dataSet < dataSets; dataSet++)
+        const uint16_t bit = (uint16_t)(1u << setup.mode);
+        if (setup.polled)
         {
-            if (std::abs(port->getValue(mode, dataSet) - port->getValue(mode, setup.lastRaw, dataSet)) >= setup.delta)
+            bool moved = false;
+            for (uint8_t dataSet = 0; dataSet < setup.polledLast.size(); dataSet++)
             {
-                setup.lastRaw.assign(raw.begin(), raw.end());
-                sendPortValueSingle(setup, port);
-                vTaskDelay(1);
-                break;
+                if (pollMoved(state.port, setup.mode, dataSet, (float)setup.delta, setup.polledLast[dataSet]))
+                    moved = true;
             }
+            if (moved)
+                state.pending.singleModes.fetch_or(bit);
         }
+        // Set by the port's subscriptions when a dataset moved by the delta.
+        if (!(state.pending.singleModes.fetch_and((uint16_t)~bit) & bit))
+            return;
+
+        sendPortValueSingle(setup, state.port);
+        vTaskDelay(1);
+    }
+
+    void HubEmulation::unsubscribeAll(Port *port, std::vector<int> &subscriptions)
+    {
+        for (int id : subscriptions)
+            port->unsubscribe(id);
+        subscriptions.clear();
+    }
+
+    bool HubEmulation::pollMoved(Port *port, uint8_t modeNum, uint8_t dataSet, float delta, float &last)
+    {
+        float value = port->getValue(modeNum, dataSet);
+        if (value == last || std::fabs(value - last) < delta)
+            return false;
+        last = value;
+        return true;
     }
 
     void Lpf2::HubEmulation::sendPortValueSingle(PortInputSetupSingle &setup, Port *port)
@@ -1060,6 +1157,11 @@ namespace Lpf2
     HubEmulation::~HubEmulation()
     {
         stop();
+        // Subscriptions capture the ports' pending flags, drop them before those go away.
+        m_ports.forEach([this](PortNum, PortState &state)
+                        {
+            if (state.port)
+                clearPortSetups(state); });
         destroyBuiltIn();
         if (m_bleCharCallbacks)
         {
@@ -1081,7 +1183,7 @@ namespace Lpf2
 
     void HubEmulation::attachPort(PortNum portNum, Port *port)
     {
-        if (m_attachedPorts.find(portNum) != m_attachedPorts.end())
+        if (attachedPort(portNum))
         {
             LPF2_LOG_W("Port %d is already attached, overwriting!", portNum);
         }
@@ -1090,8 +1192,13 @@ namespace Lpf2
             LPF2_LOG_E("Cannot attach null port to port %d", portNum);
             return;
         }
-        m_connectedDevices[portNum] = false;
-        m_attachedPorts[portNum] = port;
+        PortState &state = m_ports.get(portNum);
+        if (state.port)
+            clearPortSetups(state);
+        state.pending.singleModes = 0;
+        state.pending.combined = false;
+        state.port = port;
+        state.deviceConnected = false;
     }
 
     void HubEmulation::writeResponse(MessageType messageType, std::vector<uint8_t> payload)
@@ -1164,11 +1271,8 @@ namespace Lpf2
             }
         }
 
-        std::for_each(m_attachedPorts.begin(), m_attachedPorts.end(),
-                      [this](auto &pair)
-                      {
-                          this->checkPort(pair.first, pair.second);
-                      });
+        m_ports.forEach([this](PortNum portNum, PortState &state)
+                        { checkPort(portNum, state); });
 
         if (now - m_lastRssiUpdate >= 5000)
         {
@@ -0,0 +1,207 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#include "Lpf2/HubPool.hpp"
+#include "Lpf2/log/log.h"
+#include <algorithm>
+
+namespace Lpf2
+{
+    HubPool::~HubPool()
+    {
+#if !defined(LPF2_NATIVE)
+        stopTask();
+        if (m_scanCallbacks)
+        {
+            NimBLEDevice::getScan()->stop();
+            NimBLEDevice::getScan()->setScanCallbacks(nullptr);
+            delete m_scanCallbacks;
+        }
+#endif
+    }
+
+    int HubPool::addHub(Hub &hub, HubTransport *transport)
+    {
+        if (m_size >= LPF2_HUB_POOL_SIZE || !transport)
+            return -1;
+        Slot &slot = m_slots[m_size];
+        slot.hub = &hub;
+        slot.transport = transport;
+        slot.state.store(SlotState::WAITING, std::memory_order_release);
+        return (int)m_size++;
+    }
+
+    void HubPool::begin(uint32_t scanMs)
+    {
+        m_beginUs = LPF2_GET_TIME_US();
+        m_stats.bringUpMs = 0;
+        bool ble = false;
+        for (size_t i = 0; i < m_size; i++)
+        {
+            Slot &slot = m_slots[i];
+            slot.sinceUs = m_beginUs;
+            if (!slot.transport)
+            {
+                ble = true;
+                continue;
+            }
+            slot.hub->attach(slot.transport);
+            slot.stats.connects++;
+            slot.stats.connectMs = 0;
+            slot.state.store(SlotState::CONNECTED, std::memory_order_release);
+        }
+#if !defined(LPF2_NATIVE)
+        m_scanMs = scanMs;
+        if (ble)
+        {
+            BLEDevice::init("");
+            for (size_t i = 0; i < m_size; i++)
+            {
+                if (!m_slots[i].transport)
+                    m_slots[i].hub->setupBle();
+            }
+            startScan();
+        }
+#else
+        (void)scanMs;
+        (void)ble;
+#endif
+        LPF2_LOG_D("Hub pool: %u hubs.", (unsigned)m_size);
+    }
+
+    void HubPool::service()
+    {
+        uint64_t start = LPF2_GET_TIME_US();
+#if !defined(LPF2_NATIVE)
+        serviceBle();
+#endif
+        for (size_t i = 0; i < m_size; i++)
+            serviceSlot((m_next + i) % m_size);
+        if (m_size)
+            m_next = (m_next + 1) % m_size;
+
+        uint64_t now = LPF2_GET_TIME_US();
+        m_stats.passes++;
+        m_stats.maxPassUs = std::max(m_stats.maxPassUs, (uint32_t)(now - start));
+        if (!m_stats.bringUpMs && m_size && allReady())
+        {
+            m_stats.bringUpMs = std::max<uint32_t>(1, (uint32_t)((now - m_beginUs) / 1000));
+            LPF2_LOG_I("Hub pool: %u hubs ready in %u ms.", (unsigned)m_size, (unsigned)m_stats.bringUpMs);
+        }
+    }
+
+    void HubPool::serviceSlot(size_t i)
+    {
+        Slot &slot = m_slots[i];
+        SlotState state = slot.state.load(std::memory_order_acquire);
+        uint64_t now = LPF2_GET_TIME_US();
+        switch (state)
+        {
+        case SlotState::WAITING:
+            // A transport hub the application attached again.
+            if (slot.transport && slot.hub->isConnected())
+                slot.state.store(SlotState::CONNECTED, std::memory_order_release);
+            return;
+        case SlotState::MATCHED:
+            return;
+        case SlotState::CONNECTING:
+#if !defined(LPF2_NATIVE)
+            checkConnect(i);
+#endif
+            return;
+        case SlotState::CONNECTED:
+        case SlotState::READY:
+            break;
+        }
+
+        // update() first: it detaches a hub whose link went down.
+        slot.hub->update();
+        uint32_t took = (uint32_t)(LPF2_GET_TIME_US() - now);
+        slot.stats.serviceUs += took;
+        slot.stats.maxServiceUs = std::max(slot.stats.maxServiceUs, took);
+
+        if (!slot.hub->isConnected())
+        {
+            LPF2_LOG_W("Hub pool: hub %u disconnected.", (unsigned)i);
+            slot.stats.disconnects++;
+            slot.sinceUs = now;
+            // A BLE hub reconnects to the address it was found at.
+            slot.state.store(slot.transport ? SlotState::WAITING : SlotState::MATCHED, std::memory_order_release);
+            return;
+        }
+
+        if (state == SlotState::CONNECTED && slot.hub->infoReady())
+        {
+            slot.stats.readyMs = (uint32_t)((LPF2_GET_TIME_US() - slot.sinceUs) / 1000);
+            slot.state.store(SlotState::READY, std::memory_order_release);
+            LPF2_LOG_D("Hub pool: hub %u ready in %u ms.", (unsigned)i, (unsigned)slot.stats.readyMs);
+        }
+    }
+
+    bool HubPool::allReady() const
+    {
+        for (size_t i = 0; i < m_size; i++)
+        {
+            if (getState(i) != SlotState::READY)
+                return false;
+        }
+        return true;
+    }
+
+    void HubPool::resetStats()
+    {
+        m_stats = Stats();
+        for (size_t i = 0; i < m_size; i++)
+            m_slots[i].stats = SlotStats();
+#if !defined(LPF2_NATIVE)
+        m_advertisements.store(0, std::memory_order_relaxed);
+        m_matched.store(0, std::memory_order_relaxed);
+#endif
+    }
+
+    Hub::DiscoveryStats HubPool::getDiscoveryStats() const
+    {
+        Hub::DiscoveryStats sum;
+        for (size_t i = 0; i < m_size; i++)
+        {
+            const Hub::DiscoveryStats &s = m_slots[i].hub->getDiscoveryStats();
+            sum.portsDiscovered += s.portsDiscovered;
+            sum.infoRequests += s.infoRequests;
+            sum.portsFromDescriptor += s.portsFromDescriptor;
+            sum.portsFromCache += s.portsFromCache;
+            sum.requestsAvoided += s.requestsAvoided;
+            sum.descriptorChecks += s.descriptorChecks;
+            sum.descriptorMismatches += s.descriptorMismatches;
+        }
+        return sum;
+    }
+
+    Hub::OutputStats HubPool::getOutputStats() const
+    {
+        Hub::OutputStats sum;
+        for (size_t i = 0; i < m_size; i++)
+        {
+            const Hub::OutputStats &s = m_slots[i].hub->getOutputStats();
+            sum.commands += s.commands;
+            sum.sent += s.sent;
+            sum.coalesced += s.coalesced;
+            sum.dropped += s.dropped;
+            sum.flushes += s.flushes;
+        }
+        return sum;
+    }
+}; // namespace Lpf2
@@ -0,0 +1,249 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#if !defined(LPF2_NATIVE)
+
+#include "Lpf2/HubPool.hpp"
+#include "Lpf2/log/log.h"
+#include <algorithm>
+
+namespace Lpf2
+{
+    // Wait after a failed connection attempt before the hub's next one.
+    static constexpr uint64_t RETRY_US = 1000000;
+
+    /**
+     * Hands the advertisements of the pool's scan to the pool.
+     */
+    class HubPoolScanCallbacks : public NimBLEScanCallbacks
+    {
+        HubPool *_pool;
+
+    public:
+        HubPoolScanCallbacks(HubPool *pool) : NimBLEScanCallbacks(), _pool(pool) {}
+
+        void onResult(const NimBLEAdvertisedDevice *advertisedDevice) override
+        {
+            _pool->onAdvertisement(advertisedDevice);
+        }
+
+        void onScanEnd(const NimBLEScanResults &results, int reason) override
+        {
+            LPF2_LOG_D("Hub pool: scan ended, reason: %d, %d devices", reason, results.getCount());
+        }
+    };
+
+    int HubPool::addHub(Hub &hub, const std::string &address)
+    {
+        if (m_size >= LPF2_HUB_POOL_SIZE)
+            return -1;
+        if (!address.empty())
+        {
+            delete hub.m_bleRequestedDeviceAddress;
+            hub.m_bleRequestedDeviceAddress = new BLEAddress(address, 0);
+        }
+        Slot &slot = m_slots[m_size];
+        slot.hub = &hub;
+        slot.transport = nullptr;
+        slot.state.store(SlotState::WAITING, std::memory_order_release);
+        return (int)m_size++;
+    }
+
+    void HubPool::onAdvertisement(const NimBLEAdvertisedDevice *device)
+    {
+        if (!device->haveServiceUUID() || !device->getServiceUUID().equals(BLEUUID(LPF2_UUID)))
+            return;
+        m_advertisements.fetch_add(1, std::memory_order_relaxed);
+
+        // Taken by another slot already (MATCHED and later are not changed
+        // by the service task).
+        for (size_t i = 0; i < m_size; i++)
+        {
+            const Slot &slot = m_slots[i];
+            if (!slot.transport && getState(i) != SlotState::WAITING && slot.hub->m_bleServerAddress &&
+                slot.hub->m_bleServerAddress->equals(device->getAddress()))
+                return;
+        }
+
+        // Slots asking for this address first, then those taking any hub.
+        Slot *match = nullptr;
+        for (int pass = 0; pass < 2 && !match; pass++)
+        {
+            for (size_t i = 0; i < m_size; i++)
+            {
+                Slot &slot = m_slots[i];
+                bool byAddress = slot.hub->m_bleRequestedDeviceAddress != nullptr;
+                if (!slot.transport && byAddress == (pass == 0) && getState(i) == SlotState::WAITING &&
+                    slot.hub->matchAdvertisement(device))
+                {
+                    match = &slot;
+                    break;
+                }
+            }
+        }
+        if (!match)
+            return;
+
+        match->hub->acceptAdvertisement(device);
+        match->state.store(SlotState::MATCHED, std::memory_order_release);
+        m_matched.fetch_add(1, std::memory_order_relaxed);
+        LPF2_LOG_D("Hub pool: matched %s", device->getAddress().toString().c_str());
+
+        for (size_t i = 0; i < m_size; i++)
+        {
+            if (!m_slots[i].transport && getState(i) == SlotState::WAITING)
+                return;
+        }
+        device->getScan()->stop();
+    }
+
+    void HubPool::startScan()
+    {
+        BLEScan *scan = NimBLEDevice::getScan();
+        if (!m_scanCallbacks)
+            m_scanCallbacks = new HubPoolScanCallbacks(this);
+        scan->setScanCallbacks(m_scanCallbacks);
+        scan->setActiveScan(true);
+        if (scan->start(m_scanMs))
+            m_stats.scans++;
+    }
+
+    void HubPool::serviceBle()
+    {
+        m_stats.advertisements = m_advertisements.load(std::memory_order_relaxed);
+        m_stats.matched = m_matched.load(std::memory_order_relaxed);
+
+        // NimBLE sets up one connection at a time: the next hub connects
+        // once the link of the one before is up, while the connected ones
+        // run their discovery.
+        bool connecting = false;
+        bool waiting = false;
+        for (size_t i = 0; i < m_size; i++)
+        {
+            if (m_slots[i].transport)
+                continue;
+            SlotState state = getState(i);
+            connecting |= state == SlotState::CONNECTING;
+            waiting |= state == SlotState::WAITING;
+        }
+        if (!connecting)
+        {
+            uint64_t now = LPF2_GET_TIME_US();
+            for (size_t n = 0; n < m_size; n++)
+            {
+                size_t i = (m_next + n) % m_size;
+                const Slot &slot = m_slots[i];
+                if (!slot.transport && getState(i) == SlotState::MATCHED && now - slot.connectUs >= RETRY_US)
+                {
+                    startConnect(i);
+                    connecting = getState(i) == SlotState::CONNECTING;
+                    break;
+                }
+            }
+        }
+        if (!connecting && waiting && !NimBLEDevice::getScan()->isScanning())
+            startScan();
+    }
+
+    void HubPool::startConnect(size_t i)
+    {
+        Slot &slot = m_slots[i];
+        slot.connectUs = LPF2_GET_TIME_US();
+        slot.hub->m_connecting = true;
+        slot.client = slot.hub->connectClient(true);
+        if (!slot.client)
+        {
+            connectFailed(i);
+            return;
+        }
+        slot.state.store(SlotState::CONNECTING, std::memory_order_release);
+    }
+
+    void HubPool::checkConnect(size_t i)
+    {
+        Slot &slot = m_slots[i];
+        if (slot.client->isConnected())
+        {
+            if (!slot.hub->setupClient(slot.client))
+            {
+                slot.client->disconnect();
+                connectFailed(i);
+                return;
+            }
+            slot.stats.connects++;
+            slot.stats.connectMs = (uint32_t)((LPF2_GET_TIME_US() - slot.sinceUs) / 1000);
+            slot.state.store(SlotState::CONNECTED, std::memory_order_release);
+            LPF2_LOG_D("Hub pool: hub %u connected in %u ms.", (unsigned)i, (unsigned)slot.stats.connectMs);
+            return;
+        }
+        if (LPF2_GET_TIME_US() - slot.connectUs >= CONNECT_TIMEOUT_MS * 1000ull)
+        {
+            slot.client->cancelConnect();
+            connectFailed(i);
+        }
+    }
+
+    void HubPool::connectFailed(size_t i)
+    {
+        Slot &slot = m_slots[i];
+        LPF2_LOG_W("Hub pool: connecting hub %u failed.", (unsigned)i);
+        slot.stats.connectFailures++;
+        slot.hub->m_connecting = false;
+        slot.client = nullptr;
+        slot.connectUs = LPF2_GET_TIME_US();
+        slot.state.store(SlotState::MATCHED, std::memory_order_release);
+    }
+
+    void HubPool::startTask(uint32_t periodMs)
+    {
+        if (m_taskHandle)
+            return;
+        m_taskPeriodMs = std::max<uint32_t>(periodMs, 1);
+        m_taskShouldQuit = false;
+        xTaskCreate(taskEntry, "hubPool", 8192, (void *)this, HUB_POOL_TASK_PRIORITY, &m_taskHandle);
+    }
+
+    void HubPool::stopTask()
+    {
+        if (!m_taskHandle)
+            return;
+        m_taskShouldQuit = true;
+        while (eTaskGetState(m_taskHandle) != eDeleted)
+        {
+            vTaskDelay(1);
+        }
+        m_taskHandle = nullptr;
+    }
+
+    void HubPool::taskLoop()
+    {
+        TickType_t period = std::max<TickType_t>(pdMS_TO_TICKS(m_taskPeriodMs), 1);
+        while (!m_taskShouldQuit)
+        {
+            service();
+            vTaskDelay(period);
+        }
+    }
+
+    void HubPool::taskEntry(void *param)
+    {
+        static_cast<HubPool *>(param)->taskLoop();
+        vTaskDelete(NULL);
+    }
+}; // namespace Lpf2
+
+#endif // !LPF2_NATIVE
@@ -0,0 +1,334 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#include "Lpf2/Local/AutoTune.hpp"
+#include "Lpf2/Local/Port.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Lpf2::Local
+{
+    // Displacement that counts as "started to turn" on the friction ramp.
+    static constexpr int64_t MOVE_MDEG = 2000;
+
+    // Stopped = less than STOP_MDEG of travel in STOP_WINDOW_MS (10 deg/s).
+    static constexpr int64_t STOP_MDEG = 1000;
+    static constexpr uint32_t STOP_WINDOW_MS = 100;
+
+    // Coast between phases so every ramp starts from standstill.
+    static constexpr uint32_t REST_MS = 300;
+
+    // Smallest usable speed change of the step response, pct of rated.
+    static constexpr float MIN_STEP_PCT = 5.0f;
+
+    // Margins over the measured friction when the values are used: the
+    // breakaway was measured with the load still inside the backlash, and the
+    // kinetic floor is the power at which the motor stopped, so both need a
+    // bit more to reliably start / keep it turning.
+    static constexpr float BREAKAWAY_MARGIN = 1.1f;
+    static constexpr float KINETIC_MARGIN = 1.25f;
+
+    // Phase margin target: crossover at most 0.5 / dead time (about 60 deg).
+    static constexpr float DEAD_TIME_CROSSOVER = 0.5f;
+
+    static constexpr float TWO_PI = 6.28318531f;
+
+    void AutoTuner::start(const AutoTuneConfig &config, int32_t ratedMaxSpeed, uint64_t nowMs, int64_t angleMdeg)
+    {
+        m_config = config;
+        m_config.stepMs = std::min<uint32_t>(m_config.stepMs, SAMPLE_MS * MAX_SAMPLES);
+        m_ratedMaxSpeed = ratedMaxSpeed;
+        m_result = AutoTuneResult();
+        m_dir = 1;
+        m_ramps = 0;
+        m_steps = 0;
+        m_lowPower = 0.0f;
+        m_supplySum = 0;
+        m_supplyCount = 0;
+        m_startAngleMdeg = angleMdeg;
+        m_phaseAngleMdeg = angleMdeg;
+        m_state = State::RUNNING;
+        enterPhase(Phase::RAMP_UP, nowMs);
+        LPF2_LOG_I("Auto-tune started");
+    }
+
+    void AutoTuner::abort()
+    {
+        if (m_state == State::RUNNING)
+            fail("aborted");
+    }
+
+    void AutoTuner::fail(const char *reason)
+    {
+        LPF2_LOG_E("Auto-tune failed: %s", reason);
+        m_state = State::FAILED;
+        m_power = 0.0f;
+    }
+
+    void AutoTuner::enterPhase(Phase phase, uint64_t nowMs)
+    {
+        m_phase = phase;
+        m_phaseStartMs = nowMs;
+        m_windowStartMs = nowMs;
+        m_windowAngleMdeg = m_phaseAngleMdeg;
+        if (phase == Phase::REST)
+        {
+            m_power = 0.0f;
+        }
+        else if (phase == Phase::STEP_LOW)
+        {
+            m_lowSpeedSum = 0.0f;
+            m_lowSpeedCount = 0;
+        }
+        else if (phase == Phase::STEP_HIGH)
+        {
+            m_sampleCount = 0;
+            m_nextSampleMs = nowMs;
+        }
+    }
+
+    float AutoTuner::step(uint64_t nowMs, int64_t angleMdeg, float speedPct, uint16_t supplyMv)
+    {
+        if (m_state != State::RUNNING)
+            return 0.0f;
+
+        if (m_config.travelLimitDeg > 0 &&
+            std::abs(angleMdeg - m_startAngleMdeg) > (int64_t)m_config.travelLimitDeg * 1000)
+        {
+            fail("travel limit reached");
+            return 0.0f;
+        }
+        if (supplyMv > 0)
+        {
+            m_supplySum += supplyMv;
+            m_supplyCount++;
+        }
+
+        uint32_t elapsed = (uint32_t)(nowMs - m_phaseStartMs);
+        int idx = (m_dir > 0) ? 0 : 1;
+
+        switch (m_phase)
+        {
+        case Phase::RAMP_UP:
+        {
+            m_power = m_config.rampPctPerS * elapsed / 1000.0f;
+            if (std::abs(angleMdeg - m_phaseAngleMdeg) >= MOVE_MDEG)
+            {
+                m_breakaway[idx] = m_power;
+                m_phaseAngleMdeg = angleMdeg;
+                enterPhase(Phase::RAMP_DOWN, nowMs);
+            }
+            else if (m_power > m_config.maxPower)
+            {
+                fail("motor did not move below maxPower");
+                return 0.0f;
+            }
+            break;
+        }
+        case Phase::RAMP_DOWN:
+        {
+            m_power = m_breakaway[idx] - m_config.rampPctPerS * elapsed / 1000.0f;
+            if (nowMs - m_windowStartMs >= STOP_WINDOW_MS)
+            {
+                if (std::abs(angleMdeg - m_windowAngleMdeg) < STOP_MDEG || m_power <= 0.0f)
+                {
+                    // Stopped somewhere inside the window, take its middle.
+                    m_kinetic[idx] = std::max(0.0f, m_power + m_config.rampPctPerS * STOP_WINDOW_MS / 2000.0f);
+                    m_ramps++;
+                    m_dir = -m_dir;
+                    enterPhase(Phase::REST, nowMs);
+                    break;
+                }
+                m_windowStartMs = nowMs;
+                m_windowAngleMdeg = angleMdeg;
+            }
+            break;
+        }
+        case Phase::REST:
+        {
+            m_power = 0.0f;
+            if (elapsed < REST_MS)
+                break;
+            m_phaseAngleMdeg = angleMdeg;
+            if (m_ramps < 2)
+            {
+                enterPhase(Phase::RAMP_UP, nowMs);
+                break;
+            }
+            if (m_steps == 0)
+            {
+                float kinetic = (m_kinetic[0] + m_kinetic[1]) / 2.0f;
+                if (m_config.maxPower < kinetic + 3.0f * MIN_STEP_PCT)
+                {
+                    fail("maxPower too close to the kinetic floor");
+                    return 0.0f;
+                }
+                m_lowPower = kinetic + (m_config.maxPower - kinetic) / 3.0f;
+                m_dir = 1;
+            }
+            if (m_steps < 2)
+            {
+                enterPhase(Phase::STEP_LOW, nowMs);
+                break;
+            }
+            computeGains();
+            m_state = State::DONE;
+            m_power = 0.0f;
+            return 0.0f;
+        }
+        case Phase::STEP_LOW:
+        {
+            m_power = m_lowPower;
+            // The low power may be under the breakaway, kick until it turns
+            // (the reverse step starts while still coasting the other way).
+            if (speedPct * m_dir < 1.0f)
+                m_power = std::max(m_power, std::max(m_breakaway[0], m_breakaway[1]) * BREAKAWAY_MARGIN);
+            if (elapsed >= m_config.stepMs * 3 / 4)
+            {
+                m_lowSpeedSum += speedPct * m_dir;
+                m_lowSpeedCount++;
+            }
+            if (elapsed >= m_config.stepMs)
+                enterPhase(Phase::STEP_HIGH, nowMs);
+            break;
+        }
+        case Phase::STEP_HIGH:
+        {
+            m_power = m_config.maxPower;
+            while (nowMs >= m_nextSampleMs && m_sampleCount < MAX_SAMPLES)
+            {
+                m_samples[m_sampleCount++] = (int16_t)std::lround(speedPct * m_dir * 10.0f);
+                m_nextSampleMs += SAMPLE_MS;
+            }
+            if (elapsed >= m_config.stepMs)
+            {
+                if (!analyseStep())
+                    return 0.0f;
+                m_steps++;
+                m_dir = -m_dir;
+                enterPhase(Phase::REST, nowMs);
+            }
+            break;
+        }
+        }
+        return m_power * m_dir;
+    }
+
+    bool AutoTuner::analyseStep()
+    {
+        int idx = (m_dir > 0) ? 0 : 1;
+        if (m_lowSpeedCount == 0 || m_sampleCount < 8)
+        {
+            fail("step response too short");
+            return false;
+        }
+        float low = m_lowSpeedSum / m_lowSpeedCount;
+        float high = 0.0f;
+        size_t tail = m_sampleCount / 4;
+        for (size_t i = m_sampleCount - tail; i < m_sampleCount; i++)
+            high += m_samples[i] / 10.0f;
+        high /= tail;
+
+        float delta = high - low;
+        if (delta < MIN_STEP_PCT)
+        {
+            fail("no speed response to the power step");
+            return false;
+        }
+
+        // Time at which the response first crosses low + frac * delta, interpolated.
+        auto crossing = [&](float frac) -> float
+        {
+            float level = low + frac * delta;
+            float prev = low;
+            for (size_t i = 0; i < m_sampleCount; i++)
+            {
+                float v = m_samples[i] / 10.0f;
+                if (v >= level)
+                {
+                    float t = (v > prev) ? (level - prev) / (v - prev) : 1.0f;
+                    return ((float)i - 1.0f + t) * SAMPLE_MS;
+                }
+                prev = v;
+            }
+            return -1.0f;
+        };
+        float t28 = crossing(0.283f);
+        float t63 = crossing(0.632f);
+        if (t28 < 0.0f || t63 < 0.0f)
+        {
+            fail("step response did not settle, raise stepMs");
+            return false;
+        }
+
+        float tau = 1.5f * (t63 - t28);
+        m_gain[idx] = delta / (m_config.maxPower - m_lowPower);
+        m_tauMs[idx] = std::max(tau, (float)SAMPLE_MS);
+        m_deadMs[idx] = std::max(t63 - tau, 0.0f);
+        LPF2_LOG_D("Auto-tune step %d: low %.1f high %.1f pct, gain %.3f, tau %.1f ms, dead %.1f ms",
+                   m_dir, low, high, m_gain[idx], m_tauMs[idx], m_deadMs[idx]);
+        if (4.0f * m_tauMs[idx] + m_deadMs[idx] > m_config.stepMs)
+            LPF2_LOG_W("Auto-tune: step shorter than 4 time constants, raise stepMs");
+        return true;
+    }
+
+    void AutoTuner::computeGains()
+    {
+        AutoTuneResult &r = m_result;
+        r.breakaway_pct = std::max(m_breakaway[0], m_breakaway[1]);
+        r.kinetic_floor_pct = (m_kinetic[0] + m_kinetic[1]) / 2.0f;
+        r.gain = (m_gain[0] + m_gain[1]) / 2.0f;
+        r.timeConstantMs = (m_tauMs[0] + m_tauMs[1]) / 2.0f;
+        r.deadTimeMs = (m_deadMs[0] + m_deadMs[1]) / 2.0f;
+        r.supplyMv = m_supplyCount ? (uint16_t)(m_supplySum / m_supplyCount) : 0;
+
+        float tau = r.timeConstantMs / 1000.0f;
+        float dead = r.deadTimeMs / 1000.0f;
+        float omega = TWO_PI * m_config.bandwidthHz;
+        if (dead > 0.0f)
+            omega = std::min(omega, DEAD_TIME_CROSSOVER / dead);
+
+        // Speed: IMC PI on K / (tau s + 1) e^(-dead s), closed-loop time constant 1 / omega.
+        float lambda = 1.0f / omega;
+        r.speed_ksp = tau / (r.gain * (lambda + dead));
+        r.speed_ksi = 1.0f / (r.gain * (lambda + dead));
+
+        // Position: plant Kdeg / (s (tau s + 1)), Kdeg in deg/s per power pct.
+        // kd / kp = tau cancels the pole, leaving crossover at kp * Kdeg.
+        float gainDeg = r.gain * m_ratedMaxSpeed / 100.0f;
+        r.pos_kp = (gainDeg > 0.0f) ? omega / gainDeg : 0.0f;
+        r.pos_kd = r.pos_kp * tau;
+
+        LPF2_LOG_I("Auto-tune done: breakaway %.1f%% kinetic %.1f%% gain %.3f tau %.1f ms dead %.1f ms",
+                   r.breakaway_pct, r.kinetic_floor_pct, r.gain, r.timeConstantMs, r.deadTimeMs);
+        LPF2_LOG_I("Auto-tune gains: speed_ksp %.3f speed_ksi %.3f pos_kp %.3f pos_kd %.4f",
+                   r.speed_ksp, r.speed_ksi, r.pos_kp, r.pos_kd);
+    }
+
+    bool AutoTuner::apply(MotorSettings &settings) const
+    {
+        if (m_state != State::DONE)
+            return false;
+        settings.breakaway_pct = m_result.breakaway_pct * BREAKAWAY_MARGIN;
+        settings.kinetic_floor_pct = std::min(m_result.kinetic_floor_pct * KINETIC_MARGIN, m_result.breakaway_pct);
+        settings.speed_ksp = m_result.speed_ksp;
+        settings.speed_ksi = m_result.speed_ksi;
+        settings.pos_kp = m_result.pos_kp;
+        settings.pos_kd = m_result.pos_kd;
+        return true;
+    }
+}; // namespace Lpf2::Local
@@ -143,6 +143,11 @@ namespace Lpf2::Local
             m_serial->flush();
             m_hostType = HostType::LPF2;
             m_status = STATUS::HOST_DETECTED;
+            // The host expects the whole info sequence (starting with SYNC +
+            // CMD_TYPE) at the new speed.
+            m_infoState = InfoState::CMD;
+            m_infoNum = 0;
+            m_infoSubNum = 0;
             LPF2_LOG_D("Detected LPF2 host, with speed: %i", m_baud);
         }
         else if (msg.msg == MESSAGE_CMD && msg.cmd == CMD_SELECT)
@@ -0,0 +1,155 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#include "Lpf2/Local/FrictionEstimator.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Lpf2::Local
+{
+    // Staircase steps, as shifts of the current value: up 1/16, down 1/64.
+    static constexpr int RAISE_SHIFT = 4;
+    static constexpr int LOWER_SHIFT = 6;
+
+    static int32_t toQ(float pct)
+    {
+        return (int32_t)std::lround(pct * (float)(1 << FrictionEstimator::Q_SHIFT));
+    }
+
+    void FrictionEstimator::reset(float breakawayPct, float kineticFloorPct)
+    {
+        m_breakaway = toQ(breakawayPct);
+        m_kineticFloor = std::min(toQ(kineticFloorPct), m_breakaway);
+        m_breakawayMin = m_breakaway / 2;
+        m_breakawayMax = m_breakaway + m_breakaway / 2;
+        m_floorMin = m_kineticFloor / 2;
+        m_floorMax = m_kineticFloor + m_kineticFloor / 2;
+        m_kickDir = 0;
+        m_kickMs = 0;
+        m_floorDir = 0;
+        m_floorMs = 0;
+        m_lastRunDir = 0;
+        m_raised = 0;
+        m_lowered = 0;
+    }
+
+    void FrictionEstimator::raise(int32_t &value, int32_t max)
+    {
+        value = std::min(value + std::max(value >> RAISE_SHIFT, 1), max);
+        m_raised++;
+    }
+
+    void FrictionEstimator::lower(int32_t &value, int32_t min)
+    {
+        value = std::max(value - std::max(value >> LOWER_SHIFT, 1), min);
+        m_lowered++;
+    }
+
+    void FrictionEstimator::step(Comp comp, int32_t dir, int64_t encoderDeg, int32_t dtMs)
+    {
+        // Breakaway: did the kick move the encoder within BREAKAWAY_WAIT_MS?
+        if (comp == Comp::KICK && m_kickDir != dir)
+        {
+            m_kickDir = (int8_t)dir;
+            m_kickMs = 0;
+            m_kickStartDeg = encoderDeg;
+        }
+        else if (m_kickDir != 0)
+        {
+            if (dir != m_kickDir)
+            {
+                m_kickDir = 0;
+            }
+            else if ((encoderDeg - m_kickStartDeg) * m_kickDir > 0)
+            {
+                lower(m_breakaway, std::max(m_breakawayMin, m_kineticFloor));
+                m_kickDir = 0;
+            }
+            else if ((m_kickMs += dtMs) >= BREAKAWAY_WAIT_MS)
+            {
+                if (comp == Comp::KICK)
+                    raise(m_breakaway, m_breakawayMax);
+                m_kickMs = 0;
+            }
+        }
+
+        // Kinetic floor: does the encoder keep counting while the output
+        // sits on the floor? A kick the same way on the way (the controller
+        // saw the speed drop between counts) does not end the run.
+        if (dir != 0 && (comp == Comp::FLOOR || (comp == Comp::KICK && m_floorDir == dir)))
+        {
+            if (m_floorDir != dir)
+            {
+                endFloorRun();
+                // The previous run moved and the controller now pushes back:
+                // the floor carried the motor past the target.
+                if (comp == Comp::FLOOR && m_lastRunDir == -dir)
+                    lower(m_kineticFloor, m_floorMin);
+                m_lastRunDir = 0;
+                m_floorDir = (int8_t)dir;
+                m_floorMs = 0;
+                m_floorIdleMs = 0;
+                m_floorMoved = false;
+                m_floorDeg = encoderDeg;
+                return;
+            }
+            if ((encoderDeg - m_floorDeg) * m_floorDir > 0)
+            {
+                m_floorDeg = encoderDeg;
+                m_floorIdleMs = 0;
+                m_floorMoved = true;
+            }
+            else if ((m_floorIdleMs += dtMs) >= FLOOR_STALL_MS)
+            {
+                raise(m_kineticFloor, std::min(m_floorMax, m_breakaway));
+                m_floorDir = 0;
+                return;
+            }
+            if (comp == Comp::FLOOR && (m_floorMs += dtMs) >= FLOOR_RUN_MS)
+            {
+                lower(m_kineticFloor, m_floorMin);
+                m_floorMs = 0;
+            }
+        }
+        else
+        {
+            endFloorRun();
+            // Only a reversal right after the run counts as an overshoot.
+            if (dir != 0 || (m_lastRunMs += dtMs) >= FLOOR_STALL_MS)
+                m_lastRunDir = 0;
+        }
+    }
+
+    void FrictionEstimator::endFloorRun()
+    {
+        if (m_floorDir == 0)
+            return;
+        m_lastRunDir = m_floorMoved ? m_floorDir : 0;
+        m_lastRunMs = 0;
+        m_floorDir = 0;
+    }
+
+    FrictionEstimator::Estimate FrictionEstimator::estimate() const
+    {
+        Estimate e;
+        e.breakawayPct = (float)m_breakaway / (float)(1 << Q_SHIFT);
+        e.kineticFloorPct = (float)m_kineticFloor / (float)(1 << Q_SHIFT);
+        e.raised = m_raised;
+        e.lowered = m_lowered;
+        return e;
+    }
+}; // namespace Lpf2::Local
@@ -0,0 +1,165 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#include "Lpf2/Local/MotionGroup.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Lpf2::Local
+{
+    // Profile limits of one axis. Without S-curve settings (pos_jerk_mdps3,
+    // pos_accel_mdps2) it moves on a trapezoid that accelerates as fast as
+    // it decelerates: the group needs a finite acceleration to scale.
+    static SCurve::Limits axisLimits(const MotorSettings &s, uint8_t speed)
+    {
+        float decel = (float)s.pos_decel_mdps2;
+        return {
+            .speed = (float)speed * s.rated_max_speed * 10.0f,
+            .accel = (s.pos_accel_mdps2 > 0.0) ? (float)s.pos_accel_mdps2 : decel,
+            .decel = decel,
+            .jerk = (s.pos_jerk_mdps3 > 0.0) ? (float)s.pos_jerk_mdps3 : 0.0f,
+        };
+    }
+
+    MotionGroup::~MotionGroup()
+    {
+        clear();
+    }
+
+    int MotionGroup::add(Port &port)
+    {
+        if (port.m_motionGroup != nullptr)
+        {
+            LPF2_LOG_E("MotionGroup: port already in a group");
+            return -1;
+        }
+        port.m_motionGroup = this;
+        m_axes.push_back(&port);
+        return 0;
+    }
+
+    void MotionGroup::remove(Port &port)
+    {
+        auto it = std::find(m_axes.begin(), m_axes.end(), &port);
+        if (it == m_axes.end())
+            return;
+        port.m_motionGroup = nullptr;
+        m_axes.erase(it);
+    }
+
+    void MotionGroup::clear()
+    {
+        for (Port *port : m_axes)
+            port->m_motionGroup = nullptr;
+        m_axes.clear();
+    }
+
+    int MotionGroup::moveTo(const std::vector<int32_t> &targetsDeg, uint8_t speed, uint8_t maxPower,
+                            BrakingStyle endState)
+    {
+        if (targetsDeg.size() != m_axes.size())
+        {
+            LPF2_LOG_E("MotionGroup: %u targets for %u axes",
+                       (unsigned)targetsDeg.size(), (unsigned)m_axes.size());
+            return -1;
+        }
+        if (speed == 0)
+            return -1;
+        for (Port *port : m_axes)
+        {
+            if (!port->m_settings || !port->m_obsInit)
+            {
+                LPF2_LOG_E("MotionGroup: axis without a motor");
+                return -1;
+            }
+        }
+
+        // One profile for all axes, per unit of distance: each limit is the
+        // smallest any axis allows per mdeg of its move. Every axis runs it
+        // scaled to its own distance, so all are the same fraction of the way
+        // at any time and none exceeds its own limits. For axes with the same
+        // settings this is the longest move's own profile.
+        SCurve::Limits unit = {0.0f, 0.0f, 0.0f, 0.0f};
+        bool moving = false;
+        for (size_t i = 0; i < m_axes.size(); i++)
+        {
+            Port &port = *m_axes[i];
+            float dist = (float)std::abs((int64_t)targetsDeg[i] * 1000 - port.m_obsAngleMdeg);
+            if (dist < 1.0f)
+                continue;
+            SCurve::Limits limits = axisLimits(*port.m_settings, speed).scaled(1.0f / dist);
+            if (!moving)
+            {
+                unit = limits;
+                moving = true;
+                continue;
+            }
+            unit.speed = std::min(unit.speed, limits.speed);
+            unit.accel = std::min(unit.accel, limits.accel);
+            unit.decel = std::min(unit.decel, limits.decel);
+            // 0 = no jerk limit
+            if (limits.jerk > 0.0f && (unit.jerk == 0.0f || limits.jerk < unit.jerk))
+                unit.jerk = limits.jerk;
+        }
+
+        float duration = 0.0f;
+        uint64_t now = LPF2_GET_TIME();
+        for (size_t i = 0; i < m_axes.size(); i++)
+        {
+            Port &port = *m_axes[i];
+            int64_t final = (int64_t)targetsDeg[i] * 1000;
+            float dist = (float)std::abs(final - port.m_obsAngleMdeg);
+            SCurve::Limits limits = (moving && dist >= 1.0f) ? unit.scaled(dist)
+                                                             : axisLimits(*port.m_settings, speed);
+
+            port.discardMotion();
+            port.startPosition(final, (int32_t)limits.speed, maxPower, endState);
+            if (moving && dist >= 1.0f)
+            {
+                port.m_pidPlan.plan(port.m_obsAngleMdeg, final, limits);
+                port.m_pidPlanStartMs = now;
+                duration = std::max(duration, port.m_pidPlan.durationMs());
+            }
+            else
+            {
+                port.m_pidPlan.clear();
+            }
+        }
+        m_durationMs = (uint32_t)std::ceil(duration);
+        return 0;
+    }
+
+    void MotionGroup::update()
+    {
+        uint64_t now = LPF2_GET_TIME();
+        for (Port *port : m_axes)
+        {
+            if (port->isDeviceConnected())
+                port->updateMotorPID(now);
+        }
+    }
+
+    bool MotionGroup::busy() const
+    {
+        for (const Port *port : m_axes)
+        {
+            if (port->m_pidMode == Port::PidMode::POSITION)
+                return true;
+        }
+        return false;
+    }
+}; // namespace Lpf2::Local
@@ -35,6 +35,22 @@ namespace Lpf2::Local
     // considered stationary and the breakaway kick is applied.
     static constexpr int32_t STUCK_SPEED_MDPS = 100; // 0.1 deg/s
 
+    // pos_kp and pos_kd factor while a MotionGroup axis tracks its profile.
+    // The fine gains are set for settling at rest against stiction; on the
+    // move only kinetic friction is left, and at 1x the axis runs several
+    // degrees off the path (behind it while accelerating, ahead while
+    // braking) and crawls the rest at the kinetic floor after the planned end.
+    static constexpr int32_t TRACKING_GAIN = 5;
+
+    // Start of a relative move: the angle rounded to whole degrees, so the
+    // target lands on an encoder count. A target between two counts can
+    // miss POSITION_TOLERANCE_MDEG at rest on both of them.
+    static int64_t relativeBaseMdeg(int64_t angleMdeg)
+    {
+        int64_t half = (angleMdeg >= 0) ? 500 : -500;
+        return (angleMdeg + half) / 1000 * 1000;
+    }
+
     // ---- Per-motor settings table -------------------------------------------
     //
     // Tune each motor independently. Calibration procedure documented in
@@ -53,10 +69,15 @@ namespace Lpf2::Local
         .pos_kd            = 0.2f,
         .pos_int_clamp     = 200.0f,
         .pos_deadband_deg  = 0.3f,
+        .pos_accel_mdps2   = 0.0,
         .pos_decel_mdps2   = 3.0e6,
+        .pos_jerk_mdps3    = 0.0,
         .pos_handoff_deg   = 90.0f,
         .breakaway_pct     = 32.0f,
         .kinetic_floor_pct = 21.0f,
+        .ff_ke_mv_per_dps  = 0.0f,
+        .ff_resistance_ohm = 0.0f,
+        .ff_friction_ma    = 0.0f,
     };
     MotorSettings MS_TECHNIC_LARGE_LINEAR_MOTOR = {
         .id                = DeviceType::TECHNIC_LARGE_LINEAR_MOTOR,
@@ -71,10 +92,15 @@ namespace Lpf2::Local
         .pos_kd            = 0.1f,
         .pos_int_clamp     = 200.0f,
         .pos_deadband_deg  = 0.3f,
+        .pos_accel_mdps2   = 0.0,
         .pos_decel_mdps2   = 3.0e6,
+        .pos_jerk_mdps3    = 0.0,
         .pos_handoff_deg   = 90.0f,
         .breakaway_pct     = 21.0f,
         .kinetic_floor_pct = 17.0f,
+        .ff_ke_mv_per_dps  = 0.0f,
+        .ff_resistance_ohm = 0.0f,
+        .ff_friction_ma    = 0.0f,
     };
     MotorSettings MS_TECHNIC_XLARGE_LINEAR_MOTOR = {
         .id                = DeviceType::TECHNIC_XLARGE_LINEAR_MOTOR,
@@ -89,10 +115,15 @@ namespace Lpf2::Local
         .pos_kd            = 0.2f,
         .pos_int_clamp     = 200.0f,
         .pos_deadband_deg  = 0.3f,
+        .pos_accel_mdps2   = 0.0,
         .pos_decel_mdps2   = 3.0e6,
+        .pos_jerk_mdps3    = 0.0,
         .pos_handoff_deg   = 90.0f,
         .breakaway_pct     = 30.0f,
         .kinetic_floor_pct = 16.0f,
+        .ff_ke_mv_per_dps  = 0.0f,
+        .ff_resistance_ohm = 0.0f,
+        .ff_friction_ma    = 0.0f,
     };
     MotorSettings MS_TECHNIC_MEDIUM_ANGULAR_MOTOR = {
         .id                = DeviceType::TECHNIC_MEDIUM_ANGULAR_MOTOR,
@@ -107,10 +138,15 @@ namespace Lpf2::Local
         .pos_kd            = 0.1f,
         .pos_int_clamp     = 200.0f,
         .pos_deadband_deg  = 0.5f,
+        .pos_accel_mdps2   = 0.0,
         .pos_decel_mdps2   = 3.0e6,
+        .pos_jerk_mdps3    = 0.0,
         .pos_handoff_deg   = 90.0f,
         .breakaway_pct     = 38.0f,
         .kinetic_floor_pct = 20.0f,
+        .ff_ke_mv_per_dps  = 0.0f,
+        .ff_resistance_ohm = 0.0f,
+        .ff_friction_ma    = 0.0f,
     };
     MotorSettings MS_TECHNIC_LARGE_ANGULAR_MOTOR = {
         .id                = DeviceType::TECHNIC_LARGE_ANGULAR_MOTOR,
@@ -122,13 +158,18 @@ namespace Lpf2::Local
         .speed_deadband_pct= 1.0f,
         .pos_kp            = 2.0f,
         .pos_ki            = 0.0f,
-        .pos_kd            = 0.5f,
+        .pos_kd            = 0.1f,
         .pos_int_clamp     = 200.0f,
         .pos_deadband_deg  = 0.3f,
+        .pos_accel_mdps2   = 0.0,
         .pos_decel_mdps2   = 3.0e6,
+        .pos_jerk_mdps3    = 0.0,
         .pos_handoff_deg   = 90.0f,
         .breakaway_pct     = 26.0f,
         .kinetic_floor_pct = 18.0f,
+        .ff_ke_mv_per_dps  = 0.0f,
+        .ff_resistance_ohm = 0.0f,
+        .ff_friction_ma    = 0.0f,
     };
     MotorSettings MS_TECHNIC_MEDIUM_ANGULAR_MOTOR_GREY = {
         .id                = DeviceType::TECHNIC_MEDIUM_ANGULAR_MOTOR_GREY,
@@ -143,10 +184,15 @@ namespace Lpf2::Local
         .pos_kd            = 0.1f,
         .pos_int_clamp     = 200.0f,
         .pos_deadband_deg  = 0.5f,
+        .pos_accel_mdps2   = 0.0,
         .pos_decel_mdps2   = 3.0e6,
+        .pos_jerk_mdps3    = 0.0,
         .pos_handoff_deg   = 90.0f,
         .breakaway_pct     = 38.0f,
         .kinetic_floor_pct = 20.0f,
+        .ff_ke_mv_per_dps  = 0.0f,
+        .ff_resistance_ohm = 0.0f,
+        .ff_friction_ma    = 0.0f,
     };
     MotorSettings MS_TECHNIC_LARGE_ANGULAR_MOTOR_GREY = {
         .id                = DeviceType::TECHNIC_LARGE_ANGULAR_MOTOR_GREY,
@@ -158,13 +204,18 @@ namespace Lpf2::Local
         .speed_deadband_pct= 1.0f,
         .pos_kp            = 2.0f,
         .pos_ki            = 0.0f,
-        .pos_kd            = 0.5f,
+        .pos_kd            = 0.1f,
         .pos_int_clamp     = 200.0f,
         .pos_deadband_deg  = 0.3f,
+        .pos_accel_mdps2   = 0.0,
         .pos_decel_mdps2   = 3.0e6,
+        .pos_jerk_mdps3    = 0.0,
         .pos_handoff_deg   = 90.0f,
         .breakaway_pct     = 26.0f,
         .kinetic_floor_pct = 18.0f,
+        .ff_ke_mv_per_dps  = 0.0f,
+        .ff_resistance_ohm = 0.0f,
+        .ff_friction_ma    = 0.0f,
     };
 
     static MotorSettings *SETTINGS_TABLE[] = {
@@ -177,7 +228,7 @@ namespace Lpf2::Local
         &MS_TECHNIC_LARGE_ANGULAR_MOTOR_GREY,
     };
 
-    static const MotorSettings *lookupSettings(DeviceType id)
+    const MotorSettings *lookupMotorSettings(DeviceType id)
     {
         for (MotorSettings *s : SETTINGS_TABLE)
         {
@@ -187,72 +238,105 @@ namespace Lpf2::Local
         return nullptr;
     }
 
-    // Stiction + kinetic-floor compensation. Returns adjusted power.
-    static float applyFrictionComp(float pid_out,
-                                   float err_for_sign,
-                                   int32_t speed_mdps,
-                                   const MotorSettings &s)
+    // ---- Observer -----------------------------------------------------------
+    //
+    // Alpha-beta filter on the motor frames, at their receive time: predict
+    // the angle to the new frame with the estimated speed, correct angle and
+    // speed by the residual, and pull the speed toward the motor's own SPEED
+    // reading when the combo has one. Each tick then extrapolates to the tick
+    // time, so the controller acts on where the motor is now, not where it
+    // was when the last frame left it (up to a frame period earlier).
+    // Integer only, shared by the float and fixed-point controllers.
+
+    // Gains, Q8: alpha on the angle, beta on the speed (residual / dt), gamma
+    // toward the reported speed.
+    static constexpr int32_t OBS_ALPHA_Q8 = 64;
+    static constexpr int32_t OBS_BETA_Q8 = 32;
+    static constexpr int32_t OBS_GAMMA_Q8 = 240;
+
+    // Frames further apart than this restart the filter from the reading.
+    static constexpr uint32_t OBS_MAX_GAP_US = 100000;
+
+    // speed (mdeg/s) * us / 1e6 as a multiply and a shift (4295 / 2^32 =
+    // 1.0000003e-6), for |us| <= OBS_MAX_GAP_US.
+    static int64_t mdegIn(int32_t speedMdegps, int32_t us)
     {
-        if (std::abs(err_for_sign) <= 0.0f)
-            return pid_out;
-        float sign_err = (err_for_sign > 0) ? 1.0f : -1.0f;
-        if (std::abs(speed_mdps) < STUCK_SPEED_MDPS &&
-            std::abs(pid_out) < s.breakaway_pct)
-        {
-            return s.breakaway_pct * sign_err;
-        }
-        if (pid_out != 0.0f && std::abs(pid_out) < s.kinetic_floor_pct)
+        return ((int64_t)speedMdegps * us * 4295) >> 32;
+    }
+
+    // One motor frame: @p measured_mdeg received @p gap_us after the previous
+    // one, @p dv_mdps the speed change expected since then (0 if unknown).
+    static void observerCorrect(int64_t measured_mdeg, uint32_t gap_us, int32_t dv_mdps, bool hasReported,
+                                int32_t reported_mdps, int64_t &sampleMdeg, int32_t &speedMdegps)
+    {
+        if (gap_us == 0 || gap_us > OBS_MAX_GAP_US)
         {
-            float sign_out = (pid_out > 0) ? 1.0f : -1.0f;
-            return s.kinetic_floor_pct * sign_out;
+            sampleMdeg = measured_mdeg;
+            speedMdegps = hasReported ? reported_mdps : 0;
+            return;
         }
-        return pid_out;
-    }
 
-    // ---- Observer -----------------------------------------------------------
-    //
-    // Encoder-driven: angle = measured, speed = first difference with IIR
-    // low-pass. Avoids voltage-feedforward instability of the prior model-
-    // based prediction.
+        int64_t predicted = sampleMdeg + mdegIn(speedMdegps + dv_mdps / 2, (int32_t)gap_us);
+        speedMdegps += dv_mdps;
+        int64_t residual = measured_mdeg - predicted;
+        sampleMdeg = predicted + ((residual * OBS_ALPHA_Q8) >> 8);
+        // Once per frame, not per tick: the 64-bit division is fine here.
+        speedMdegps += (int32_t)(residual * 1000000 * OBS_BETA_Q8 / ((int64_t)gap_us << 8));
+        if (hasReported)
+            speedMdegps += (int32_t)(((int64_t)(reported_mdps - speedMdegps) * OBS_GAMMA_Q8) >> 8);
+    }
 
-    // IIR coefficient: new_estimate = (prev * (N-1) + new_sample) / N.
-    static constexpr int32_t SPEED_IIR_N = 4;
+    // Speed in pct of rated. Exact for the motor's own SPEED reading,
+    // reported * rated_max_speed * 10 mdeg/s.
+    static float speedPct(int32_t speed_mdps, const MotorSettings &s)
+    {
+        if (s.rated_max_speed <= 0)
+            return 0.0f;
+        return (float)speed_mdps / ((float)s.rated_max_speed * 10.0f);
+    }
 
-    static void observerStep(int64_t measured_mdeg,
-                             int32_t dt_ms,
-                             int64_t &angleMdeg,
-                             int32_t &speedMdegps,
-                             int64_t &prevMeasMdeg,
-                             bool &prevValid)
+#if defined(LPF2_PID_PROFILE)
+    // Adds the cycles between construction and destruction to the profile,
+    // once armed.
+    struct PidProfileScope
     {
-        if (dt_ms <= 0)
-            return;
+        Port::PidProfile &profile;
+        uint32_t start = LPF2_GET_CYCLES();
+        bool armed = false;
 
-        if (prevValid)
+        ~PidProfileScope()
         {
-            int64_t delta = measured_mdeg - prevMeasMdeg;
-            int32_t inst_speed = (int32_t)(delta * 1000 / dt_ms);
-            speedMdegps = (speedMdegps * (SPEED_IIR_N - 1) + inst_speed) /
-                          SPEED_IIR_N;
+            if (!armed)
+                return;
+            uint32_t cycles = LPF2_GET_CYCLES() - start;
+            profile.ticks++;
+            profile.cycles += cycles;
+            if (cycles > profile.maxCycles)
+                profile.maxCycles = cycles;
         }
-        angleMdeg = measured_mdeg;
-        prevMeasMdeg = measured_mdeg;
-        prevValid = true;
-    }
+    };
+#endif
 
     // ---- updateMotorPID -----------------------------------------------------
 
-    void Port::updateMotorPID()
+    void Port::updateMotorPID(uint64_t now)
     {
+#if defined(LPF2_PID_PROFILE)
+        PidProfileScope profile{m_pidProfile};
+#endif
         DeviceType dt = getDeviceType();
         if (m_settings == nullptr || m_settings->id != dt)
         {
-            m_settings = lookupSettings(dt);
+            m_settings = (m_hasPortSettings && m_portSettings.id == dt)
+                             ? &m_portSettings
+                             : lookupMotorSettings(dt);
             m_obsInit = false;
-            m_pidIntegral = 0.0;
+            m_pidIntegral = 0;
             m_pidMode = PidMode::NONE;
-            m_pidPrevPosErrValid = false;
             m_pidPosFineActive = false;
+            loadPidGains();
+            resetFrictionEstimate();
+            discardMotion();
         }
         if (m_settings == nullptr)
             return;
@@ -271,7 +355,6 @@ namespace Lpf2::Local
 
         int64_t measured_mdeg = m_currentRelPos * 1000;
 
-        uint64_t now = LPF2_GET_TIME();
         int32_t dt_ms = (int32_t)(now - m_pidLastMs);
         m_pidLastMs = now;
 
@@ -279,8 +362,9 @@ namespace Lpf2::Local
         {
             m_obsAngleMdeg = measured_mdeg;
             m_obsSpeedMdegps = 0;
-            m_obsPrevMeasMdeg = measured_mdeg;
-            m_obsPrevValid = false;
+            m_obsSampleMdeg = measured_mdeg;
+            m_obsSampleUs = m_dataRecUs;
+            m_obsInputMdegps = 0;
             m_lastVoltageMv = 0;
             m_obsInit = true;
             return;
@@ -289,41 +373,514 @@ namespace Lpf2::Local
         if (dt_ms <= 0)
             return;
 
-        observerStep(measured_mdeg, dt_ms,
-                     m_obsAngleMdeg, m_obsSpeedMdegps,
-                     m_obsPrevMeasMdeg, m_obsPrevValid);
-
-        // Prefer motor's self-reported SPEED (mode 1, % of rated, int8).
-        float reported_pct = 0.0f;
-        if (m_activeCombo >= 0)
-        {
-            reported_pct = getValue(1, 0);
-            m_obsSpeedMdegps =
-                (int32_t)(reported_pct * (float)s.rated_max_speed * 10.0f);
-        }
-        else if (s.rated_max_speed > 0)
+        // A MotionGroup axis follows its profile: the profile's speed change
+        // is the model input. Without it the filter trails an accelerating
+        // axis by several degrees (alpha only takes part of each residual)
+        // and the tracking loop drives the axis ahead of its path to make
+        // up for it, and behind it while braking.
+        int32_t input = (m_motionGroup != nullptr && m_pidPlan.active()) ? m_pidSpeedSetpointMdegps : 0;
+        if (m_dataRecUs != m_obsSampleUs)
         {
-            reported_pct = (float)m_obsSpeedMdegps /
-                           ((float)s.rated_max_speed * 10.0f);
+            // The combo has the motor's own SPEED (mode 1, % of rated, int8).
+            bool hasReported = m_activeCombo >= 0;
+            int32_t reported = hasReported ? getRaw<int8_t>(1, 0) * s.rated_max_speed * 10 : 0;
+            observerCorrect(measured_mdeg, (uint32_t)(m_dataRecUs - m_obsSampleUs), input - m_obsInputMdegps,
+                            hasReported, reported, m_obsSampleMdeg, m_obsSpeedMdegps);
+            m_obsSampleUs = m_dataRecUs;
+            m_obsInputMdegps = input;
         }
+        uint64_t age_us = LPF2_GET_TIME_US() - m_obsSampleUs;
+        m_obsAngleMdeg = m_obsSampleMdeg +
+                         mdegIn(m_obsSpeedMdegps + (input - m_obsInputMdegps) / 2,
+                                (int32_t)std::min<uint64_t>(age_us, OBS_MAX_GAP_US));
 
         LPF2_LOG_V("Pos:%d Rel:%lld ObsA:%lld ObsV:%d",
                    pos, (long long)m_currentRelPos,
                    (long long)m_obsAngleMdeg, m_obsSpeedMdegps);
 
+        if (m_autoTune.running() && m_pidMode != PidMode::AUTOTUNE)
+            m_autoTune.abort();
+
         if (m_pidMode == PidMode::NONE)
             return;
+#if defined(LPF2_PID_PROFILE)
+        profile.armed = true;
+#endif
 
         int32_t maxPwr = (int32_t)m_pidMaxPower;
+        int32_t power_pct = 0;
+        // Battery == 0 means no reading yet: the feed-forward assumes the
+        // motor's nominal voltage and the over-voltage cap is off.
+        uint16_t v_batt = Lpf2::Battery::getCurrentVoltage();
+
+        if (m_pidMode == PidMode::AUTOTUNE)
+        {
+            // Float in both builds: it only runs while tuning.
+            float power_f = m_autoTune.step(now, m_obsAngleMdeg,
+                                            speedPct(m_obsSpeedMdegps, s),
+                                            v_batt);
+            if (!m_autoTune.running())
+            {
+                if (m_autoTune.state() == AutoTuner::State::DONE)
+                {
+                    m_portSettings = s;
+                    m_autoTune.apply(m_portSettings);
+                    m_hasPortSettings = true;
+                    m_settings = &m_portSettings;
+                    loadPidGains();
+                    resetFrictionEstimate();
+                }
+                applyEndState(BrakingStyle::BRAKE);
+                return;
+            }
+            power_pct = (int32_t)power_f;
+            m_pidTerms = {};
+        }
+        else if (!pidStep(s, now, dt_ms, (v_batt > 0) ? v_batt : s.max_voltage_mv, power_pct))
+        {
+            return;
+        }
+
+        // Over-voltage cap: when battery > motor nameplate, limit PWM so the
+        // motor never sees above s.max_voltage_mv.
+        int32_t over_v_cap_pct =
+            (v_batt > 0)
+                ? std::min<int32_t>(100,
+                                    (int32_t)s.max_voltage_mv * 100 / v_batt)
+                : 100;
+        int32_t eff_max = std::min(maxPwr, over_v_cap_pct);
+        if (power_pct >  eff_max) power_pct =  eff_max;
+        if (power_pct < -eff_max) power_pct = -eff_max;
+
+        m_lastVoltageMv = (v_batt > 0) ? (power_pct * v_batt / 100)
+                                       : (power_pct * s.max_voltage_mv / 100);
+        applyPower((int8_t)power_pct);
+
+        if (m_trace)
+        {
+            bool speed = m_pidMode == PidMode::SPEED || m_pidMode == PidMode::AUTOTUNE;
+            ControlTrace::Record r = {};
+            r.timeUs = LPF2_GET_TIME_US();
+            r.targetMdeg = speed ? 0 : m_pidPositionFinal;
+            r.rampMdeg = speed ? 0 : m_pidTarget;
+            r.measuredMdeg = measured_mdeg;
+            r.speedMdegps = m_obsSpeedMdegps;
+            r.refSpeedMdegps = m_pidSpeedSetpointMdegps;
+            r.ff = m_pidTerms.ff;
+            r.p = m_pidTerms.p;
+            r.i = m_pidTerms.i;
+            r.d = m_pidTerms.d;
+            r.power = (int16_t)power_pct;
+            r.dtMs = (uint16_t)std::min<int32_t>(dt_ms, UINT16_MAX);
+            r.mode = (ControlTrace::Mode)m_pidMode;
+            r.subMode = m_pidTerms.subMode;
+            m_trace->push(r);
+        }
+    }
+
+#if defined(LPF2_PID_FIXED)
+    // ---- Fixed-point controller ---------------------------------------------
+    //
+    // Same control law as the float version, in integers:
+    //   power and speed in pct: Q16 (1 pct = 65536)
+    //   angle mdeg, speed mdeg/s, time ms, as the observer
+    // Gains are pre-scaled in loadPidGains() so that every term is one
+    // multiply and a shift. No 64-bit divisions on a normal tick.
+
+    static constexpr int Q_SHIFT = 16;
+    static constexpr int KP_SHIFT = 16;  // pos_kp, pos_kd
+    static constexpr int KI_SHIFT = 28;  // speed_ksi
+    static constexpr int KIP_SHIFT = 30; // pos_ki
+    static constexpr int FF_KE_SHIFT = 32; // ff_ke_mv_per_dps
+
+    // Rounding slack of the gain scaling, in Q16 LSBs. Results the float
+    // version gets exactly (kp * err cancelling kd * speed, a whole pct of
+    // feed-forward) land within it here, so outputs this close to 0 count
+    // as 0 for the kinetic floor, and the final truncation allows for it.
+    static constexpr int64_t ZERO_EPS_Q = 4;
+
+    // Position error limit of the fine sub-mode, keeps kp * err in int64.
+    static constexpr int64_t POS_ERR_LIMIT_MDEG = (int64_t)1 << 30;
+
+    static int32_t toFx(double v)
+    {
+        v = std::round(v);
+        if (v > (double)INT32_MAX) return INT32_MAX;
+        if (v < (double)-INT32_MAX) return -INT32_MAX;
+        return (int32_t)v;
+    }
+
+    void Port::loadPidGains()
+    {
+        if (m_settings == nullptr)
+            return;
+        const MotorSettings &s = *m_settings;
+        MotorGainsFx &g = m_gainsFx;
+        constexpr double Q = (double)(1 << Q_SHIFT);
+
+        g.speed_div = s.rated_max_speed * 10;
+        g.speed_ksp = toFx(s.speed_ksp * Q);
+        g.speed_ksi = toFx(s.speed_ksi * (double)(1 << KI_SHIFT) / 1000.0);
+        g.speed_int_clamp = std::llround(s.speed_int_clamp * 1000.0 * Q);
+        g.speed_deadband = toFx(s.speed_deadband_pct * Q);
+        g.pos_kp = toFx(s.pos_kp * Q * (double)(1 << KP_SHIFT) / 1000.0);
+        g.pos_ki = toFx(s.pos_ki * Q * (double)((int64_t)1 << KIP_SHIFT) / 1.0e6);
+        g.pos_kd = toFx(s.pos_kd * Q * (double)(1 << KP_SHIFT) / 1000.0);
+        g.track_kp = toFx(s.pos_kp * TRACKING_GAIN * Q * (double)(1 << KP_SHIFT) / 1000.0);
+        g.track_kd = toFx(s.pos_kd * TRACKING_GAIN * Q * (double)(1 << KP_SHIFT) / 1000.0);
+        g.pos_int_clamp = std::llround(s.pos_int_clamp * 1.0e6);
+        g.pos_deadband_mdeg = toFx(s.pos_deadband_deg * 1000.0);
+        g.pos_handoff_mdeg = toFx(s.pos_handoff_deg * 1000.0);
+        g.pos_decel_x2 = std::llround(2.0 * s.pos_decel_mdps2);
+        g.breakaway = toFx(s.breakaway_pct * Q);
+        g.kinetic_floor = toFx(s.kinetic_floor_pct * Q);
+        g.ff_ke = (s.ff_ke_mv_per_dps > 0.0f)
+                      ? std::max(1, toFx(s.ff_ke_mv_per_dps / 1000.0 * (double)((int64_t)1 << FF_KE_SHIFT)))
+                      : 0;
+        g.ff_friction_mv = toFx(s.ff_resistance_ohm * s.ff_friction_ma);
+    }
+
+    // mdeg/s → pct of rated, Q16, truncated like the float division.
+    // Exact for the motor's own SPEED reading (a multiple of speed_div).
+    static int32_t speedPctFx(int32_t speed_mdps, const MotorGainsFx &g)
+    {
+        int32_t div = g.speed_div;
+        if (div <= 0)
+            return 0;
+        int32_t q = speed_mdps / div;
+        int32_t r = speed_mdps % div;
+        int32_t frac = (div < (1 << (31 - Q_SHIFT)))
+                           ? r * (1 << Q_SHIFT) / div
+                           : (int32_t)((int64_t)r * (1 << Q_SHIFT) / div);
+        return q * (1 << Q_SHIFT) + frac;
+    }
+
+    // v / 1000 for v >= 0, in 32 bits when it fits.
+    static int64_t div1000(int64_t v)
+    {
+        if (v >= 0 && v <= (int64_t)UINT32_MAX)
+            return (uint32_t)v / 1000u;
+        return v / 1000;
+    }
+
+    static uint32_t isqrt64(uint64_t v)
+    {
+        uint64_t res = 0;
+        uint64_t bit = (uint64_t)1 << 62;
+        while (bit > v)
+            bit >>= 2;
+        while (bit != 0)
+        {
+            if (v >= res + bit)
+            {
+                v -= res + bit;
+                res = (res >> 1) + bit;
+            }
+            else
+            {
+                res >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint32_t)res;
+    }
+
+    // P + I on a speed error (Q16 pct), integral in Q16 pct·ms. Returns
+    // the sum, @p p_q / @p i_q are set to the terms.
+    static int64_t speedLoopFx(int32_t err_q, int32_t dt_ms,
+                               const MotorGainsFx &g, int64_t &integral,
+                               int64_t &p_q, int64_t &i_q)
+    {
+        if (std::abs(err_q) < g.speed_deadband)
+            err_q = 0;
+        integral += (int64_t)err_q * dt_ms;
+        integral = std::clamp(integral, -g.speed_int_clamp, g.speed_int_clamp);
+        p_q = ((int64_t)g.speed_ksp * err_q) >> Q_SHIFT;
+        i_q = ((int64_t)g.speed_ksi * integral) >> KI_SHIFT;
+        return p_q + i_q;
+    }
+
+    // Q16 pct → 1/1000 pct, for the control trace.
+    static int32_t milliPctFx(int64_t q)
+    {
+        return (int32_t)((q * 1000) >> Q_SHIFT);
+    }
+
+    // Stiction + kinetic-floor compensation, Q16. Returns adjusted power,
+    // @p comp is set to what it did.
+    // @p supply_scale (Q16, 0 = 1) scales both floors to the battery voltage.
+    static int64_t applyFrictionCompFx(int64_t pid_out,
+                                       int32_t err_sign,
+                                       int32_t speed_mdps,
+                                       int64_t breakaway,
+                                       int64_t kinetic_floor,
+                                       int32_t supply_scale,
+                                       FrictionEstimator::Comp &comp)
+    {
+        comp = FrictionEstimator::Comp::NONE;
+        if (err_sign == 0)
+            return pid_out;
+        if (supply_scale != 0)
+        {
+            breakaway = (breakaway * supply_scale) >> Q_SHIFT;
+            kinetic_floor = (kinetic_floor * supply_scale) >> Q_SHIFT;
+        }
+        if (std::abs(speed_mdps) < STUCK_SPEED_MDPS &&
+            std::abs(pid_out) < breakaway)
+        {
+            comp = FrictionEstimator::Comp::KICK;
+            return breakaway * err_sign;
+        }
+        if (std::abs(pid_out) > ZERO_EPS_Q && std::abs(pid_out) < kinetic_floor)
+        {
+            comp = FrictionEstimator::Comp::FLOOR;
+            return (pid_out > 0) ? kinetic_floor : -kinetic_floor;
+        }
+        return pid_out;
+    }
+
+    static int32_t signOf(int64_t v)
+    {
+        return (v > 0) ? 1 : (v < 0) ? -1 : 0;
+    }
+
+    // Feed-forward duty for @p speed_mdps, Q16 pct, see the float version.
+    // @p scale is 100 pct << 32 / supply, 0 without a model.
+    static int32_t feedForwardFx(int32_t speed_mdps, const MotorGainsFx &g, int64_t scale)
+    {
+        if (scale == 0)
+            return speedPctFx(speed_mdps, g);
+        int64_t mv = (((int64_t)g.ff_ke * speed_mdps) >> FF_KE_SHIFT) + signOf(speed_mdps) * g.ff_friction_mv;
+        return (int32_t)((mv * scale) >> (32 - Q_SHIFT));
+    }
+
+    bool Port::pidStep(const MotorSettings &s, uint64_t now, int32_t dt_ms, int32_t supplyMv, int32_t &power_pct)
+    {
+        const MotorGainsFx &g = m_gainsFx;
+        // Supply scales, one division per change of the battery reading.
+        if (g.ff_ke == 0 || supplyMv <= 0)
+        {
+            m_ffSupplyMv = 0;
+            m_ffScale = 0;
+        }
+        else if (supplyMv != m_ffSupplyMv)
+        {
+            m_ffSupplyMv = supplyMv;
+            m_ffScale = ((int64_t)100 << 32) / supplyMv;
+            m_ffFrictionScale = (int32_t)(((int64_t)s.max_voltage_mv << Q_SHIFT) / supplyMv);
+        }
+        int32_t reported_q = speedPctFx(m_obsSpeedMdegps, g);
+        int64_t power_q = 0;
+        int32_t err_sign = 0;
+        int64_t ff_t = 0, p_t = 0, i_t = 0, d_t = 0; // terms, Q16 pct
+        ControlTrace::SubMode sub = ControlTrace::SubMode::NONE;
+
+        if (m_pidMode == PidMode::SPEED)
+        {
+            if (m_pidEndTime != 0 && now >= m_pidEndTime)
+            {
+                finishCommand();
+                return false;
+            }
+            int32_t setpoint_q = (int32_t)m_pidSpeed * (1 << Q_SHIFT);
+            int32_t err_q = setpoint_q - reported_q;
+            err_sign = signOf(err_q);
+            int32_t ff_q = feedForwardFx((int32_t)m_pidSpeed * g.speed_div, g, m_ffScale);
+            power_q = ff_q + speedLoopFx(err_q, dt_ms, g, m_pidIntegral, p_t, i_t);
+            ff_t = ff_q;
+
+            m_pidSpeedSetpointMdegps =
+                (int32_t)m_pidSpeed * s.rated_max_speed * 10;
+        }
+        else
+        {
+            // POSITION / HOLD, see the float version.
+            bool planned = m_pidPlan.active();
+            int32_t step_dir;
+            if (planned)
+            {
+                step_dir = followPlan(now);
+            }
+            else
+            {
+                int64_t remaining_ramp = m_pidPositionFinal - m_pidTarget;
+                step_dir = signOf(remaining_ramp);
+                int64_t abs_rem = std::abs(remaining_ramp);
+
+                // The decel cap sqrt(2 * decel * remaining + junction^2) only
+                // matters once it is below the ramp speed, compare the squares
+                // first.
+                int32_t cur_ramp = m_pidPositionRampMdegps;
+                int64_t v_cap_sq;
+                if (!__builtin_mul_overflow(g.pos_decel_x2, abs_rem, &v_cap_sq) &&
+                    (v_cap_sq += (int64_t)m_pidJunctionMdegps * m_pidJunctionMdegps) <
+                        (int64_t)cur_ramp * cur_ramp)
+                {
+                    cur_ramp = (int32_t)isqrt64((uint64_t)v_cap_sq);
+                }
+
+                int64_t step_max = div1000((int64_t)cur_ramp * dt_ms);
+                int64_t step =
+                    (abs_rem < step_max) ? remaining_ramp : step_dir * step_max;
+                m_pidTarget += step;
+                m_pidSpeedSetpointMdegps =
+                    (step_dir != 0) ? (step_dir * cur_ramp) : 0;
+            }
+
+            int64_t remaining_real = m_pidPositionFinal - m_obsAngleMdeg;
+
+            if (m_pidMode == PidMode::POSITION)
+            {
+                if (step_dir == 0 &&
+                    (blendPending() ||
+                     (std::abs(remaining_real) < POSITION_TOLERANCE_MDEG &&
+                      std::abs(m_obsSpeedMdegps) < 50000)))
+                {
+                    finishCommand();
+                    return false;
+                }
+            }
+
+            bool tracking = planned && m_motionGroup != nullptr;
+            bool wantFine = (step_dir == 0) || tracking ||
+                            (!planned && m_pidJunctionMdegps == 0 &&
+                             std::abs(remaining_real) <= g.pos_handoff_mdeg);
+
+            if (wantFine != m_pidPosFineActive)
+            {
+                m_pidIntegral = 0;
+                m_pidPosFineActive = wantFine;
+            }
+
+            err_sign = signOf(remaining_real);
+            if (!wantFine)
+            {
+                // Coarse sub-mode: speed loop tracking ramp velocity.
+                int32_t setpoint_q = speedPctFx(m_pidSpeedSetpointMdegps, g);
+                int32_t ff_q = feedForwardFx(m_pidSpeedSetpointMdegps, g, m_ffScale);
+                power_q = ff_q + speedLoopFx(setpoint_q - reported_q,
+                                             dt_ms, g, m_pidIntegral, p_t, i_t);
+                ff_t = ff_q;
+                sub = ControlTrace::SubMode::COARSE;
+            }
+            else
+            {
+                // Fine sub-mode: P + I + D on pos error, D from the observer.
+                // Tracking: to the profile, see the float version.
+                int64_t ref_err = remaining_real;
+                int32_t ref_speed = 0;
+                int32_t ff_q = 0;
+                if (tracking)
+                {
+                    ref_err = m_pidTarget - m_obsAngleMdeg;
+                    ref_speed = m_pidSpeedSetpointMdegps;
+                    ff_q = feedForwardFx(ref_speed, g, m_ffScale);
+                    err_sign = signOf(ref_err);
+                }
+                int64_t pos_err = std::clamp(ref_err,
+                                             -POS_ERR_LIMIT_MDEG,
+                                             POS_ERR_LIMIT_MDEG);
+                if (std::abs(pos_err) < g.pos_deadband_mdeg)
+                {
+                    pos_err = 0;
+                    err_sign = 0;
+                }
+
+                m_pidIntegral += pos_err * dt_ms;
+                m_pidIntegral = std::clamp(m_pidIntegral,
+                                           -g.pos_int_clamp, g.pos_int_clamp);
+
+                ff_t = ff_q;
+                p_t = ((int64_t)(tracking ? g.track_kp : g.pos_kp) * pos_err) >> KP_SHIFT;
+                i_t = ((int64_t)g.pos_ki * m_pidIntegral) >> KIP_SHIFT;
+                d_t = ((int64_t)(tracking ? g.track_kd : g.pos_kd) * (ref_speed - m_obsSpeedMdegps)) >> KP_SHIFT;
+                power_q = ff_t + p_t + i_t + d_t;
+                sub = tracking ? ControlTrace::SubMode::TRACKING : ControlTrace::SubMode::FINE;
+            }
+        }
+
+        if (m_trace)
+            m_pidTerms = {milliPctFx(ff_t), milliPctFx(p_t), milliPctFx(i_t), milliPctFx(d_t), sub};
+
+        FrictionEstimator::Comp comp;
+        power_q = applyFrictionCompFx(power_q, err_sign, m_obsSpeedMdegps,
+                                      m_frictionAdapt ? m_friction.breakawayQ() : g.breakaway,
+                                      m_frictionAdapt ? m_friction.kineticFloorQ() : g.kinetic_floor,
+                                      (m_ffScale != 0) ? m_ffFrictionScale : 0, comp);
+        if (m_frictionAdapt)
+        {
+            m_friction.step(comp, signOf(power_q), m_currentRelPos, dt_ms);
+        }
+
+        // Truncates toward zero, as the float version's cast.
+        power_q += signOf(power_q) * ZERO_EPS_Q;
+        power_pct = (int32_t)std::clamp<int64_t>(power_q / (1 << Q_SHIFT),
+                                                 -10000, 10000);
+        return true;
+    }
+#else
+    // ---- Float controller --------------------------------------------------
+
+    // Feed-forward duty for @p speed_mdps, pct: the voltage the model needs
+    // (back-EMF plus the friction current through the winding) over the
+    // supply, so the same speed gets the same duty on a full and a flat
+    // battery. Without a model, the speed in pct of rated.
+    static float feedForwardPct(int32_t speed_mdps, const MotorSettings &s, int32_t supplyMv)
+    {
+        if (s.ff_ke_mv_per_dps <= 0.0f || supplyMv <= 0)
+            return speedPct(speed_mdps, s);
+        float mv = s.ff_ke_mv_per_dps * (float)speed_mdps / 1000.0f;
+        if (speed_mdps != 0)
+            mv += (speed_mdps > 0 ? 1.0f : -1.0f) * s.ff_resistance_ohm * s.ff_friction_ma;
+        return mv * 100.0f / (float)supplyMv;
+    }
+
+    // Stiction + kinetic-floor compensation. Returns adjusted power, @p comp
+    // is set to what it did.
+    // @p supply_scale scales both floors to the battery voltage.
+    static float applyFrictionComp(float pid_out,
+                                   float err_for_sign,
+                                   int32_t speed_mdps,
+                                   float breakaway,
+                                   float kinetic_floor,
+                                   float supply_scale,
+                                   FrictionEstimator::Comp &comp)
+    {
+        comp = FrictionEstimator::Comp::NONE;
+        if (std::abs(err_for_sign) <= 0.0f)
+            return pid_out;
+        float sign_err = (err_for_sign > 0) ? 1.0f : -1.0f;
+        breakaway *= supply_scale;
+        kinetic_floor *= supply_scale;
+        if (std::abs(speed_mdps) < STUCK_SPEED_MDPS &&
+            std::abs(pid_out) < breakaway)
+        {
+            comp = FrictionEstimator::Comp::KICK;
+            return breakaway * sign_err;
+        }
+        if (pid_out != 0.0f && std::abs(pid_out) < kinetic_floor)
+        {
+            float sign_out = (pid_out > 0) ? 1.0f : -1.0f;
+            comp = FrictionEstimator::Comp::FLOOR;
+            return kinetic_floor * sign_out;
+        }
+        return pid_out;
+    }
+
+    bool Port::pidStep(const MotorSettings &s, uint64_t now, int32_t dt_ms, int32_t supplyMv, int32_t &power_pct)
+    {
+        float reported_pct = speedPct(m_obsSpeedMdegps, s);
         float power_f = 0.0f;
         float err_for_sign = 0.0f;
+        float ff_t = 0.0f, p_t = 0.0f, i_t = 0.0f, d_t = 0.0f; // terms, pct
+        ControlTrace::SubMode sub = ControlTrace::SubMode::NONE;
 
         if (m_pidMode == PidMode::SPEED)
         {
             if (m_pidEndTime != 0 && now >= m_pidEndTime)
             {
-                applyEndState(m_pidEndState);
-                return;
+                finishCommand();
+                return false;
             }
             float setpoint_pct = (float)m_pidSpeed;
             float err_pct = setpoint_pct - reported_pct;
@@ -337,61 +894,81 @@ namespace Lpf2::Local
             if (m_pidIntegral < -s.speed_int_clamp)
                 m_pidIntegral = -s.speed_int_clamp;
 
-            float fb_power =
-                s.speed_ksp * err_pct + s.speed_ksi * (float)m_pidIntegral;
-            float ff_power = (float)m_pidSpeed;
-            power_f = ff_power + fb_power;
+            p_t = s.speed_ksp * err_pct;
+            i_t = s.speed_ksi * (float)m_pidIntegral;
+            ff_t = feedForwardPct((int32_t)m_pidSpeed * s.rated_max_speed * 10, s, supplyMv);
+            power_f = ff_t + (p_t + i_t);
 
             m_pidSpeedSetpointMdegps =
                 (int32_t)m_pidSpeed * s.rated_max_speed * 10;
         }
         else
         {
-            // POSITION / HOLD: trapezoidal ramp + dual sub-mode controller.
+            // POSITION / HOLD: S-curve or trapezoidal ramp + dual sub-mode
+            // controller.
             //   Far  → speed sub-mode tracking ramp velocity (P+I on speed).
-            //   Near → fine pos sub-mode (P+I + true D on pos error).
-            int64_t remaining_ramp = m_pidPositionFinal - m_pidTarget;
-            int32_t step_dir = (remaining_ramp > 0) ? 1 :
-                               (remaining_ramp < 0) ? -1 : 0;
-
-            int64_t abs_rem = std::abs(remaining_ramp);
-            int32_t v_cap_mdps =
-                (int32_t)std::sqrt(2.0 * s.pos_decel_mdps2 * (double)abs_rem);
-            int32_t cur_ramp =
-                std::min(m_pidPositionRampMdegps, v_cap_mdps);
-
-            int64_t step_max = (int64_t)cur_ramp * dt_ms / 1000;
-            int64_t step =
-                (abs_rem < (uint64_t)step_max) ? remaining_ramp
-                                                : step_dir * step_max;
-            m_pidTarget += step;
-            m_pidSpeedSetpointMdegps =
-                (step_dir != 0) ? (step_dir * cur_ramp) : 0;
+            //   Near → fine pos sub-mode (P+I+D on pos error).
+            bool planned = m_pidPlan.active();
+            int32_t step_dir;
+            if (planned)
+            {
+                step_dir = followPlan(now);
+            }
+            else
+            {
+                int64_t remaining_ramp = m_pidPositionFinal - m_pidTarget;
+                step_dir = (remaining_ramp > 0) ? 1 :
+                           (remaining_ramp < 0) ? -1 : 0;
+
+                int64_t abs_rem = std::abs(remaining_ramp);
+                // Decelerate to the junction speed: 0, or the speed the
+                // next segment continues with when blending into it.
+                int32_t v_cap_mdps =
+                    (int32_t)std::sqrt(2.0 * s.pos_decel_mdps2 * (double)abs_rem +
+                                       (double)m_pidJunctionMdegps * m_pidJunctionMdegps);
+                int32_t cur_ramp =
+                    std::min(m_pidPositionRampMdegps, v_cap_mdps);
+
+                int64_t step_max = (int64_t)cur_ramp * dt_ms / 1000;
+                int64_t step =
+                    (abs_rem < (uint64_t)step_max) ? remaining_ramp
+                                                    : step_dir * step_max;
+                m_pidTarget += step;
+                m_pidSpeedSetpointMdegps =
+                    (step_dir != 0) ? (step_dir * cur_ramp) : 0;
+            }
 
             int64_t remaining_real = m_pidPositionFinal - m_obsAngleMdeg;
             float rem_deg = (float)((double)remaining_real / 1000.0);
 
             if (m_pidMode == PidMode::POSITION)
             {
-                if (std::abs(remaining_real) < POSITION_TOLERANCE_MDEG &&
-                    std::abs(m_obsSpeedMdegps) < 50000 &&
-                    step_dir == 0)
+                if (step_dir == 0 &&
+                    (blendPending() ||
+                     (std::abs(remaining_real) < POSITION_TOLERANCE_MDEG &&
+                      std::abs(m_obsSpeedMdegps) < 50000)))
                 {
-                    applyEndState(m_pidEndState);
-                    return;
+                    finishCommand();
+                    return false;
                 }
             }
 
             // Sub-mode selection. Fine engages when ramp is finished OR
             // we are inside the handoff band. step_dir==0 is a one-way
-            // gate (ramp can't restart) so no hysteresis needed.
-            bool wantFine = (step_dir == 0) ||
-                            (std::abs(rem_deg) <= s.pos_handoff_deg);
+            // gate (ramp can't restart) so no hysteresis needed. An S-curve
+            // keeps the speed sub-mode to its end: its deceleration is the
+            // part a heavy load needs. So does a segment blending into the
+            // next one, it does not stop at its end. A MotionGroup move
+            // tracks its profile on the fine sub-mode instead, the axes
+            // have to stay on the path, not only arrive together.
+            bool tracking = planned && m_motionGroup != nullptr;
+            bool wantFine = (step_dir == 0) || tracking ||
+                            (!planned && m_pidJunctionMdegps == 0 &&
+                             std::abs(rem_deg) <= s.pos_handoff_deg);
 
             if (wantFine != m_pidPosFineActive)
             {
-                m_pidIntegral = 0.0;
-                m_pidPrevPosErrValid = false;
+                m_pidIntegral = 0;
                 m_pidPosFineActive = wantFine;
             }
 
@@ -414,25 +991,38 @@ namespace Lpf2::Local
                 if (m_pidIntegral < -s.speed_int_clamp)
                     m_pidIntegral = -s.speed_int_clamp;
 
-                float fb_power = s.speed_ksp * err_pct
-                               + s.speed_ksi * (float)m_pidIntegral;
-                float ff_power = setpoint_pct;
-                power_f = ff_power + fb_power;
+                p_t = s.speed_ksp * err_pct;
+                i_t = s.speed_ksi * (float)m_pidIntegral;
+                ff_t = feedForwardPct(m_pidSpeedSetpointMdegps, s, supplyMv);
+                power_f = ff_t + (p_t + i_t);
+                sub = ControlTrace::SubMode::COARSE;
             }
             else
             {
-                // Fine sub-mode: P + I + true D on pos error.
+                // Fine sub-mode: P + I + D on pos error, to the profile
+                // position with its speed as feed-forward and
+                // TRACKING_GAIN on P and D when tracking.
                 float pos_err_deg = rem_deg;
+                int32_t ref_speed = 0;
+                float ff_power = 0.0f;
+                if (tracking)
+                {
+                    pos_err_deg = (float)((double)(m_pidTarget - m_obsAngleMdeg) / 1000.0);
+                    ref_speed = m_pidSpeedSetpointMdegps;
+                    ff_power = feedForwardPct(ref_speed, s, supplyMv);
+                }
                 err_for_sign = pos_err_deg;
                 if (std::abs(pos_err_deg) < s.pos_deadband_deg)
+                {
                     pos_err_deg = 0.0f;
+                    err_for_sign = 0.0f;
+                }
 
-                float d_err_dps = 0.0f;
-                if (m_pidPrevPosErrValid && dt_ms > 0)
-                    d_err_dps = (pos_err_deg - m_pidPrevPosErrDeg) *
-                                1000.0f / (float)dt_ms;
-                m_pidPrevPosErrDeg = pos_err_deg;
-                m_pidPrevPosErrValid = true;
+                // d(err)/dt = reference speed - speed (0 for a fixed final
+                // position). Taken from the observer: differencing the error
+                // per tick spikes once per data frame, the encoder only
+                // moves on frames.
+                float d_err_dps = (float)(ref_speed - m_obsSpeedMdegps) / 1000.0f;
 
                 m_pidIntegral += (double)pos_err_deg * (double)dt_ms / 1000.0;
                 if (m_pidIntegral > s.pos_int_clamp)
@@ -440,34 +1030,87 @@ namespace Lpf2::Local
                 if (m_pidIntegral < -s.pos_int_clamp)
                     m_pidIntegral = -s.pos_int_clamp;
 
-                power_f = s.pos_kp * pos_err_deg
-                        + s.pos_ki * (float)m_pidIntegral
-                        + s.pos_kd * d_err_dps;
+                float gain = tracking ? (float)TRACKING_GAIN : 1.0f;
+                ff_t = ff_power;
+                p_t = gain * s.pos_kp * pos_err_deg;
+                i_t = s.pos_ki * (float)m_pidIntegral;
+                d_t = gain * s.pos_kd * d_err_dps;
+                power_f = ff_t + p_t + i_t + d_t;
+                sub = tracking ? ControlTrace::SubMode::TRACKING : ControlTrace::SubMode::FINE;
             }
         }
 
-        // Stiction kick + kinetic floor.
-        power_f = applyFrictionComp(power_f, err_for_sign,
-                                    m_obsSpeedMdegps, s);
+        if (m_trace)
+        {
+            m_pidTerms = {(int32_t)(ff_t * 1000.0f), (int32_t)(p_t * 1000.0f),
+                          (int32_t)(i_t * 1000.0f), (int32_t)(d_t * 1000.0f), sub};
+        }
+
+        // Stiction kick + kinetic floor (the auto-tune measures them).
+        float friction_scale = (s.ff_ke_mv_per_dps > 0.0f && supplyMv > 0)
+                                   ? (float)s.max_voltage_mv / (float)supplyMv
+                                   : 1.0f;
+        float breakaway = s.breakaway_pct;
+        float kinetic_floor = s.kinetic_floor_pct;
+        if (m_frictionAdapt)
+        {
+            breakaway = (float)m_friction.breakawayQ() / (float)(1 << FrictionEstimator::Q_SHIFT);
+            kinetic_floor = (float)m_friction.kineticFloorQ() / (float)(1 << FrictionEstimator::Q_SHIFT);
+        }
+        FrictionEstimator::Comp comp;
+        power_f = applyFrictionComp(power_f, err_for_sign, m_obsSpeedMdegps,
+                                    breakaway, kinetic_floor, friction_scale, comp);
+        if (m_frictionAdapt)
+        {
+            m_friction.step(comp, (power_f > 0.0f) ? 1 : (power_f < 0.0f) ? -1 : 0,
+                            m_currentRelPos, dt_ms);
+        }
 
-        int32_t power_pct = (int32_t)power_f;
+        power_pct = (int32_t)power_f;
+        return true;
+    }
+#endif // LPF2_PID_FIXED
 
-        // Over-voltage cap: when battery > motor nameplate, limit PWM so the
-        // motor never sees above s.max_voltage_mv. Battery == 0 means no
-        // reading yet; treat as unrestricted.
-        uint16_t v_batt = Lpf2::Battery::getCurrentVoltage();
-        int32_t over_v_cap_pct =
-            (v_batt > 0)
-                ? std::min<int32_t>(100,
-                                    (int32_t)s.max_voltage_mv * 100 / v_batt)
-                : 100;
-        int32_t eff_max = std::min(maxPwr, over_v_cap_pct);
-        if (power_pct >  eff_max) power_pct =  eff_max;
-        if (power_pct < -eff_max) power_pct = -eff_max;
+    void Port::planPosition()
+    {
+        const MotorSettings &s = *m_settings;
+        if (s.pos_accel_mdps2 <= 0.0 || s.pos_jerk_mdps3 <= 0.0)
+        {
+            m_pidPlan.clear();
+            return;
+        }
+        SCurve::Limits limits = {
+            .speed = (float)m_pidPositionRampMdegps,
+            .accel = (float)s.pos_accel_mdps2,
+            .decel = (float)s.pos_decel_mdps2,
+            .jerk = (float)s.pos_jerk_mdps3,
+        };
+        // Moves inside the handoff band run on the fine sub-mode from the
+        // start, as with the trapezoid.
+        if (std::abs(m_pidPositionFinal - m_obsAngleMdeg) <= (int64_t)(s.pos_handoff_deg * 1000.0f))
+        {
+            m_pidPlan.clear();
+            return;
+        }
+        // Planned from rest: a move that starts while the motor turns
+        // begins with the speed reference at 0, as the trapezoid did.
+        m_pidPlan.plan(m_obsAngleMdeg, m_pidPositionFinal, limits);
+        m_pidPlanStartMs = LPF2_GET_TIME();
+    }
 
-        m_lastVoltageMv = (v_batt > 0) ? (power_pct * v_batt / 100)
-                                       : (power_pct * s.max_voltage_mv / 100);
-        applyPower((int8_t)power_pct);
+    int32_t Port::followPlan(uint64_t now)
+    {
+        SCurve::Sample ref = m_pidPlan.sample((uint32_t)(now - m_pidPlanStartMs));
+        m_pidTarget = ref.positionMdeg;
+        m_pidSpeedSetpointMdegps = ref.speedMdegps;
+        if (ref.done)
+        {
+            // m_pidTarget == m_pidPositionFinal, the trapezoid takes over
+            // with nothing left to ramp.
+            m_pidPlan.clear();
+            return 0;
+        }
+        return (m_pidPositionFinal >= m_pidTarget) ? 1 : -1;
     }
 
     void Port::applyPower(int8_t pw)
@@ -485,9 +1128,10 @@ namespace Lpf2::Local
 
     void Port::applyEndState(BrakingStyle style)
     {
-        m_pidIntegral = 0.0;
+        m_pidPlan.clear();
+        m_pidIntegral = 0;
         m_pidSpeedSetpointMdegps = 0;
-        m_pidPrevPosErrValid = false;
+        m_pidJunctionMdegps = 0;
         m_pidPosFineActive = false;
         if (style == BrakingStyle::HOLD)
         {
@@ -512,6 +1156,7 @@ namespace Lpf2::Local
 
     void Port::startPower(int8_t pw)
     {
+        discardMotion();
         m_pidMode = PidMode::NONE;
         bool forward = pw >= 0;
         pw = std::abs(pw);
@@ -538,6 +1183,7 @@ namespace Lpf2::Local
 
     void Port::startSpeed(int8_t speed, uint8_t maxPower, uint8_t useProfile)
     {
+        discardMotion();
         if (speed == 0)
         {
             startPower(0);
@@ -549,13 +1195,15 @@ namespace Lpf2::Local
         m_pidMaxPower = maxPower;
         m_pidTarget = m_obsAngleMdeg;
         m_pidEndTime = 0;
-        m_pidIntegral = 0.0;
+        m_pidIntegral = 0;
         m_pidLastMs = LPF2_GET_TIME();
         m_pidMode = PidMode::SPEED;
+        loadPidGains();
     }
 
     void Port::startSpeedForTime(uint16_t time, int8_t speed, uint8_t maxPower, BrakingStyle endState, uint8_t useProfile)
     {
+        discardMotion();
         uint64_t newEndTime = LPF2_GET_TIME() + time;
         if (m_pidMode == PidMode::SPEED && m_pidSpeed == speed && m_pidMaxPower == maxPower && m_pidEndState == endState)
         {
@@ -567,17 +1215,19 @@ namespace Lpf2::Local
         m_pidTarget = m_obsAngleMdeg;
         m_pidEndTime = newEndTime;
         m_pidEndState = endState;
-        m_pidIntegral = 0.0;
+        m_pidIntegral = 0;
         m_pidLastMs = LPF2_GET_TIME();
         m_pidMode = PidMode::SPEED;
+        loadPidGains();
     }
 
     void Port::startSpeedForDegrees(uint32_t degrees, int8_t speed, uint8_t maxPower, BrakingStyle endState, uint8_t useProfile)
     {
+        discardMotion();
         if (!m_settings)
             return;
         int64_t signedDegMdeg = (int64_t)degrees * 1000 * (speed >= 0 ? 1 : -1);
-        int64_t newFinal = m_obsAngleMdeg + signedDegMdeg;
+        int64_t newFinal = relativeBaseMdeg(m_obsAngleMdeg) + signedDegMdeg;
         int32_t absSpeed = std::abs((int)speed);
         int32_t ramp =
             (int32_t)absSpeed * m_settings->rated_max_speed * 1000 / 100;
@@ -588,21 +1238,13 @@ namespace Lpf2::Local
             m_pidEndState == endState &&
             m_pidEndTime == 0)
             return;
-        m_pidPositionFinal = newFinal;
-        m_pidPositionRampMdegps = ramp;
-        m_pidTarget = m_obsAngleMdeg;
-        m_pidMaxPower = maxPower;
-        m_pidEndState = endState;
-        m_pidEndTime = 0;
-        m_pidIntegral = 0.0;
-        m_pidPrevPosErrValid = false;
-        m_pidPosFineActive = false;
-        m_pidLastMs = LPF2_GET_TIME();
-        m_pidMode = PidMode::POSITION;
+        startPosition(newFinal, ramp, maxPower, endState);
+        planPosition();
     }
 
     void Port::gotoAbsPosition(int32_t absPos, uint8_t speed, uint8_t maxPower, BrakingStyle endState, uint8_t useProfile)
     {
+        discardMotion();
         if (!m_settings)
             return;
         int64_t newFinal = (int64_t)absPos * 1000;
@@ -617,32 +1259,314 @@ namespace Lpf2::Local
             m_pidEndState == endState &&
             m_pidEndTime == 0)
             return;
-        m_pidPositionFinal = newFinal;
-        m_pidPositionRampMdegps = ramp;
+        startPosition(newFinal, ramp, newMaxPower, endState);
+        planPosition();
+    }
+
+    void Port::startPosition(int64_t finalMdeg, int32_t rampMdegps, uint8_t maxPower, BrakingStyle endState)
+    {
+        m_pidPositionFinal = finalMdeg;
+        m_pidPositionRampMdegps = rampMdegps;
         m_pidTarget = m_obsAngleMdeg;
-        m_pidMaxPower = newMaxPower;
+        m_pidMaxPower = maxPower;
         m_pidEndState = endState;
         m_pidEndTime = 0;
-        m_pidIntegral = 0.0;
-        m_pidPrevPosErrValid = false;
+        m_pidIntegral = 0;
+        m_pidJunctionMdegps = 0;
         m_pidPosFineActive = false;
         m_pidLastMs = LPF2_GET_TIME();
         m_pidMode = PidMode::POSITION;
+        loadPidGains();
+    }
+
+    // ---- Motion queue -------------------------------------------------------
+
+    int Port::queueMotion(const MotionSegment &segment, uint8_t startupAndCompletion)
+    {
+        if (!m_settings || !m_obsInit)
+        {
+            LPF2_LOG_E("Motion queue: no motor attached");
+            return -1;
+        }
+        if (startupAndCompletion & STARTUP_IMMEDIATE)
+            discardMotion();
+        if (!m_motionQueue.push(segment, (startupAndCompletion & COMPLETION_FEEDBACK) != 0))
+        {
+            LPF2_LOG_W("Motion queue full");
+            return -2;
+        }
+        if (!motionBusy())
+            startNextMotion(false);
+        else
+            updateJunctionSpeed();
+        return 0;
+    }
+
+    void Port::clearMotionQueue()
+    {
+        MotionQueue pending;
+        pending.swap(m_motionQueue);
+        updateJunctionSpeed();
+        while (!pending.empty())
+        {
+            MotionQueue::Entry e = pending.pop();
+            if (e.feedback && e.segment.onDone)
+                e.segment.onDone(e.segment, MotionResult::DISCARDED);
+        }
+    }
+
+    uint8_t Port::getMotionFeedback() const
+    {
+        if (m_motionQueue.full())
+            return FEEDBACK_BUSY_FULL;
+        if (!motionBusy())
+            return FEEDBACK_BUFFER_EMPTY_COMPLETED | FEEDBACK_IDLE;
+        return m_motionQueue.empty() ? FEEDBACK_BUFFER_EMPTY_IN_PROGRESS : 0;
+    }
+
+    bool Port::motionBusy() const
+    {
+        // HOLD counts as idle, and an auto-tune is aborted by the next
+        // command like by any direct one.
+        return m_motionActive || m_pidMode == PidMode::SPEED || m_pidMode == PidMode::POSITION;
+    }
+
+    void Port::discardMotion()
+    {
+        if (!m_motionActive && m_motionQueue.empty())
+            return;
+        MotionSegment current;
+        bool feedback = false;
+        if (m_motionActive)
+        {
+            current = std::move(m_motionCurrent);
+            feedback = m_motionFeedback;
+            m_motionActive = false;
+        }
+        m_pidJunctionMdegps = 0;
+        if (feedback && current.onDone)
+            current.onDone(current, MotionResult::DISCARDED);
+        clearMotionQueue();
+    }
+
+    void Port::finishCommand()
+    {
+        bool blended = blendPending();
+        if (!blended)
+            applyEndState(m_pidEndState);
+
+        MotionSegment done;
+        bool feedback = false;
+        if (m_motionActive)
+        {
+            done = std::move(m_motionCurrent);
+            feedback = m_motionFeedback;
+            m_motionActive = false;
+        }
+        if (!m_motionQueue.empty())
+            startNextMotion(blended);
+        // Last: the callback may queue or start commands.
+        if (feedback && done.onDone)
+            done.onDone(done, MotionResult::COMPLETED);
+    }
+
+    void Port::startNextMotion(bool blended)
+    {
+        MotionQueue::Entry e = m_motionQueue.pop();
+        m_motionCurrent = std::move(e.segment);
+        m_motionFeedback = e.feedback;
+        m_motionActive = true;
+        startSegment(m_motionCurrent, blended);
+        updateJunctionSpeed();
+    }
+
+    void Port::startSegment(const MotionSegment &seg, bool blended)
+    {
+        const MotorSettings &s = *m_settings;
+        uint64_t now = LPF2_GET_TIME();
+        int32_t absSpeed = std::abs((int)seg.speed);
+        int32_t ramp = absSpeed * s.rated_max_speed * 1000 / 100;
+
+        if (seg.type == MotionSegment::Type::SPEED_FOR_TIME)
+        {
+            // Blending from a speed command or the coarse sub-mode keeps the
+            // speed integral, the fine sub-mode's is in other units.
+            if (!blended || m_pidPosFineActive)
+                m_pidIntegral = 0;
+            m_pidSpeed = seg.speed;
+            m_pidMaxPower = seg.maxPower;
+            m_pidTarget = m_obsAngleMdeg;
+            m_pidEndTime = now + (uint32_t)std::max<int32_t>(seg.value, 1);
+            m_pidEndState = seg.endState;
+            m_pidPlan.clear();
+            m_pidPosFineActive = false;
+            m_pidJunctionMdegps = 0;
+            if (!blended)
+                m_pidLastMs = now;
+            m_pidMode = PidMode::SPEED;
+            loadPidGains();
+            return;
+        }
+
+        // A position segment blended into from the trapezoid continues its
+        // ramp reference: relative moves add up without drift and the speed
+        // setpoint carries on.
+        bool fromRamp = blended && m_pidMode == PidMode::POSITION && !m_pidPlan.active();
+        int64_t final;
+        uint8_t maxPower = seg.maxPower;
+        if (seg.type == MotionSegment::Type::SPEED_FOR_DEGREES)
+        {
+            int64_t base = fromRamp ? m_pidPositionFinal : relativeBaseMdeg(m_obsAngleMdeg);
+            final = base + (int64_t)std::max<int32_t>(seg.value, 0) * 1000 * (seg.speed >= 0 ? 1 : -1);
+        }
+        else
+        {
+            final = (int64_t)seg.value * 1000;
+            maxPower = (uint8_t)std::min<int32_t>(absSpeed, maxPower);
+        }
+
+        if (fromRamp)
+        {
+            m_pidPositionFinal = final;
+            m_pidPositionRampMdegps = ramp;
+            m_pidMaxPower = maxPower;
+            m_pidEndState = seg.endState;
+            m_pidEndTime = 0;
+            m_pidJunctionMdegps = 0;
+            loadPidGains();
+            return;
+        }
+        startPosition(final, ramp, maxPower, seg.endState);
+        // Blended segments stay on the trapezoid: the S-curve is planned
+        // from rest.
+        if (!blended)
+            planPosition();
+    }
+
+    void Port::updateJunctionSpeed()
+    {
+        m_pidJunctionMdegps = 0;
+        if (!blendPending() || m_pidMode != PidMode::POSITION || m_pidPlan.active())
+            return;
+        int64_t dir = m_pidPositionFinal - m_pidTarget;
+        if (dir == 0)
+            return;
+
+        const MotorSettings &s = *m_settings;
+        const MotionSegment &next = m_motionQueue.front().segment;
+        int32_t nextSpeed = std::abs((int)next.speed) * s.rated_max_speed * 1000 / 100;
+        int64_t dist;
+        switch (next.type)
+        {
+        case MotionSegment::Type::SPEED_FOR_TIME:
+            if ((next.speed > 0) == (dir > 0))
+                m_pidJunctionMdegps = std::min(nextSpeed, m_pidPositionRampMdegps);
+            return;
+        case MotionSegment::Type::SPEED_FOR_DEGREES:
+            dist = (int64_t)std::max<int32_t>(next.value, 0) * 1000 * (next.speed >= 0 ? 1 : -1);
+            break;
+        default:
+            dist = (int64_t)next.value * 1000 - m_pidPositionFinal;
+            break;
+        }
+        if (dist == 0 || (dist > 0) != (dir > 0))
+            return;
+        // Slow enough to stop within the next segment, it does not look
+        // further ahead. Runs once per segment, not per tick.
+        double stop = std::sqrt(2.0 * s.pos_decel_mdps2 * (double)std::abs(dist));
+        m_pidJunctionMdegps = (int32_t)std::min<double>({(double)nextSpeed, stop,
+                                                         (double)m_pidPositionRampMdegps});
+    }
+
+    void Port::setMotorSettings(const MotorSettings &settings)
+    {
+        m_portSettings = settings;
+        m_hasPortSettings = true;
+        if (m_settings && m_settings->id == settings.id)
+        {
+            m_settings = &m_portSettings;
+            loadPidGains();
+            resetFrictionEstimate();
+        }
+    }
+
+    void Port::resetMotorSettings()
+    {
+        m_hasPortSettings = false;
+        if (m_settings == &m_portSettings)
+        {
+            m_settings = lookupMotorSettings(m_portSettings.id);
+            loadPidGains();
+            resetFrictionEstimate();
+        }
+    }
+
+    void Port::setFrictionAdaptation(bool enable)
+    {
+        m_frictionAdapt = enable;
+        resetFrictionEstimate();
+    }
+
+    FrictionEstimator::Estimate Port::getFrictionEstimate() const
+    {
+        if (!m_frictionAdapt && m_settings)
+        {
+            FrictionEstimator::Estimate e;
+            e.breakawayPct = m_settings->breakaway_pct;
+            e.kineticFloorPct = m_settings->kinetic_floor_pct;
+            return e;
+        }
+        return m_friction.estimate();
+    }
+
+    void Port::resetFrictionEstimate()
+    {
+        if (m_settings)
+            m_friction.reset(m_settings->breakaway_pct, m_settings->kinetic_floor_pct);
+    }
+
+    int Port::enableControlTrace(size_t capacity)
+    {
+        if (capacity == 0)
+            return 1;
+        if (m_trace && m_trace->capacity() == capacity)
+            return 0;
+        m_trace = std::make_unique<ControlTrace>(capacity);
+        return 0;
+    }
+
+    int Port::startAutoTune(const AutoTuneConfig &config)
+    {
+        if (!m_settings || !m_obsInit)
+        {
+            LPF2_LOG_E("Auto-tune: no motor attached");
+            return -1;
+        }
+        discardMotion();
+        m_autoTune.start(config, m_settings->rated_max_speed, LPF2_GET_TIME(), m_obsAngleMdeg);
+        m_pidMaxPower = 100;
+        m_pidEndTime = 0;
+        m_pidIntegral = 0;
+        m_pidLastMs = LPF2_GET_TIME();
+        m_pidMode = PidMode::AUTOTUNE;
+        return 0;
     }
 
     void Port::presetEncoder(int32_t pos)
     {
+        discardMotion();
         m_currentRelPos = (int64_t)pos;
         m_obsAngleMdeg = (int64_t)pos * 1000;
         m_obsSpeedMdegps = 0;
-        m_obsPrevMeasMdeg = m_obsAngleMdeg;
-        m_obsPrevValid = false;
+        m_obsSampleMdeg = m_obsAngleMdeg;
+        m_obsSampleUs = m_dataRecUs;
+        m_obsInputMdegps = 0;
         m_obsInit = true;
         m_pidTarget = m_obsAngleMdeg;
         m_pidPositionFinal = m_obsAngleMdeg;
         m_pidPositionRampMdegps = 0;
+        m_pidPlan.clear();
         m_pidMode = PidMode::NONE;
-        m_pidPrevPosErrValid = false;
         m_pidPosFineActive = false;
         m_lastVoltageMv = 0;
         setPower(0, 0);
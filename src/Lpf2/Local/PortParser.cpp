@@ -81,6 +81,7 @@ namespace Lpf2::Local
                 m_status = STATUS::STATUS_DATA_RECEIVED;
             }
             m_startRec = LPF2_GET_TIME();
+            m_dataRecUs = LPF2_GET_TIME_US();
 
             if (m_activeCombo >= 0 && (size_t)m_activeCombo < m_modeCombos.size())
             {
@@ -100,6 +101,7 @@ namespace Lpf2::Local
                         m_modeData[m].rawData.resize(readLen);
                     for (int i = 0; i < readLen; i++)
                         m_modeData[m].rawData[i] = msg.data[offset + i];
+                    publishModeData(m);
                     fireValueChangeCallback(m);
                     offset += size;
                 }
@@ -137,6 +139,7 @@ namespace Lpf2::Local
                 m_modeData[mode].rawData[i] = msg.data[i];
             }
 
+            publishModeData(mode);
             fireValueChangeCallback(mode);
             break;
         }
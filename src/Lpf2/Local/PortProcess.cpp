@@ -16,11 +16,18 @@
  *  */
 
 #include "Lpf2/Local/Port.hpp"
+#include "Lpf2/Local/MotionGroup.hpp"
 #include <string>
 #include <cstring>
 
 namespace Lpf2::Local
 {
+    Port::~Port()
+    {
+        if (m_motionGroup)
+            m_motionGroup->remove(*this);
+    }
+
     void Port::init(
 #if defined(LPF2_USE_FREERTOS)
         bool useFreeRTOSTask,
@@ -125,7 +132,7 @@ namespace Lpf2::Local
             return;
         }
 
-        if (isDeviceConnected())
+        if (isDeviceConnected() && m_motionGroup == nullptr)
         {
             updateMotorPID();
         }
@@ -0,0 +1,162 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#include "Lpf2/Local/SCurve.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Lpf2::Local
+{
+    // Bisection steps for the peak speed of a move that never cruises.
+    static constexpr int PEAK_SPEED_ITERATIONS = 32;
+
+    // Time to get from rest to speed v with acceleration limit a and jerk j
+    // (0 = no jerk limit): jerk time (tj) and total time (t).
+    static void accelTimes(float v, float a, float j, float &tj, float &t)
+    {
+        if (j <= 0.0f)
+        {
+            tj = 0.0f;
+            t = v / a;
+        }
+        else if (v * j >= a * a)
+        {
+            tj = a / j;
+            t = tj + v / a;
+        }
+        else
+        {
+            // Never reaches a: jerk up, straight jerk down.
+            tj = std::sqrt(v / j);
+            t = 2.0f * tj;
+        }
+    }
+
+    // Peak acceleration of a ramp to speed v, see accelTimes().
+    static float peakAccel(float v, float tj, float t)
+    {
+        if (t <= 0.0f)
+            return 0.0f;
+        return (tj > 0.0f && t <= 2.0f * tj) ? v / tj : v / (t - tj);
+    }
+
+    // Distance of a rest-to-v-to-rest move without cruise.
+    static float rampDistance(float v, const SCurve::Limits &l)
+    {
+        float tj, ta, td;
+        accelTimes(v, l.accel, l.jerk, tj, ta);
+        accelTimes(v, l.decel, l.jerk, tj, td);
+        return v * (ta + td) / 2.0f;
+    }
+
+    SCurve::Limits SCurve::Limits::scaled(float r) const
+    {
+        return {speed * r, accel * r, decel * r, jerk * r};
+    }
+
+    bool SCurve::plan(int64_t startMdeg, int64_t endMdeg, const Limits &limits)
+    {
+        m_active = false;
+        if (limits.speed <= 0.0f || limits.accel <= 0.0f ||
+            limits.decel <= 0.0f || limits.jerk < 0.0f)
+            return false;
+
+        m_startMdeg = startMdeg;
+        m_endMdeg = endMdeg;
+        m_dir = (endMdeg >= startMdeg) ? 1 : -1;
+        float dist = (float)std::abs(endMdeg - startMdeg);
+
+        // Peak speed: the limit if there is room to cruise, otherwise the
+        // speed whose ramps cover the distance exactly.
+        float v = limits.speed;
+        float cruise = 0.0f; // s
+        float ramps = rampDistance(v, limits);
+        if (ramps <= dist)
+        {
+            cruise = (dist - ramps) / v;
+        }
+        else
+        {
+            float lo = 0.0f;
+            float hi = v;
+            for (int i = 0; i < PEAK_SPEED_ITERATIONS; i++)
+            {
+                float mid = (lo + hi) / 2.0f;
+                if (rampDistance(mid, limits) > dist)
+                    hi = mid;
+                else
+                    lo = mid;
+            }
+            v = lo;
+        }
+
+        float tj1, ta, tj2, td;
+        accelTimes(v, limits.accel, limits.jerk, tj1, ta);
+        accelTimes(v, limits.decel, limits.jerk, tj2, td);
+        float a1 = peakAccel(v, tj1, ta);
+        float a2 = peakAccel(v, tj2, td);
+
+        // Segment lengths (s), jerks (mdeg/s³) and accelerations at their
+        // start (mdeg/s²).
+        const float len[SEGMENTS] = {tj1, ta - 2.0f * tj1, tj1, cruise,
+                                     tj2, td - 2.0f * tj2, tj2};
+        const float jerk[SEGMENTS] = {limits.jerk, 0.0f, -limits.jerk, 0.0f,
+                                      -limits.jerk, 0.0f, limits.jerk};
+        const float accel[SEGMENTS] = {0.0f, a1, a1, 0.0f, 0.0f, -a2, -a2};
+
+        // Integrate in ms units: v in mdeg/ms, a in mdeg/ms², j in mdeg/ms³.
+        float t = 0.0f, p = 0.0f, vel = 0.0f;
+        for (int i = 0; i < SEGMENTS; i++)
+        {
+            float dt = std::max(len[i], 0.0f) * 1000.0f;
+            float acc = accel[i] * 1.0e-6f;
+            float j = jerk[i] * 1.0e-9f;
+            m_seg[i] = {t, p, vel, acc, j};
+            p += vel * dt + acc * dt * dt / 2.0f + j * dt * dt * dt / 6.0f;
+            vel += acc * dt + j * dt * dt / 2.0f;
+            t += dt;
+        }
+        m_lastDuration = std::max(len[SEGMENTS - 1], 0.0f) * 1000.0f;
+
+        m_active = true;
+        return true;
+    }
+
+    float SCurve::durationMs() const
+    {
+        return m_seg[SEGMENTS - 1].t0 + m_lastDuration;
+    }
+
+    SCurve::Sample SCurve::sample(uint32_t tMs) const
+    {
+        float t = (float)tMs;
+        const Segment &last = m_seg[SEGMENTS - 1];
+        if (!m_active || t >= last.t0 + m_lastDuration)
+            return {m_endMdeg, 0, true};
+
+        int i = SEGMENTS - 1;
+        while (i > 0 && t < m_seg[i].t0)
+            i--;
+        const Segment &s = m_seg[i];
+        float dt = t - s.t0;
+        float p = s.p0 + s.v0 * dt + s.a0 * dt * dt / 2.0f + s.j * dt * dt * dt / 6.0f;
+        float v = s.v0 + s.a0 * dt + s.j * dt * dt / 2.0f;
+
+        return {m_startMdeg + m_dir * (int64_t)std::lround(p),
+                m_dir * (int32_t)std::lround(v * 1000.0f), false};
+    }
+}; // namespace Lpf2::Local
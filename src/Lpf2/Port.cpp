@@ -19,71 +19,82 @@
 #include "Lpf2/LWPConst.hpp"
 #include "Lpf2/DeviceDescLib.hpp"
 #include "Lpf2/DeviceFactory.hpp"
+#include "Lpf2/Util/Format.hpp"
 #include <string>
 #include <cstring>
-#include <sstream>
-#include <iomanip>
 #include <cmath>
+#include <algorithm>
+#include <climits>
+#if defined(LPF2_NATIVE)
+#include <thread>
+#else
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
 
 namespace Lpf2
 {
     std::string Port::getInfoStr()
     {
-        std::ostringstream oss;
-        oss << std::hex << std::uppercase;
+        // About 500 bytes per mode, so most devices are formatted in one pass.
+        return Utils::formatToString([this](char *buf, size_t size)
+                                     { return getInfoStr(buf, size); },
+                                     256 + 512 * getModes().size());
+    }
+
+    size_t Port::getInfoStr(char *buf, size_t size) const
+    {
+        Utils::StrBuf out(buf, size);
 
-        oss << "Device: 0x" << std::setw(2) << std::setfill('0') << static_cast<unsigned int>(getDeviceType()) << "\n";
-        oss << std::dec << "InModes: 0x" << std::hex << std::setw(4) << std::setfill('0') << getInputModes() << "\n";
-        oss << "OutModes: 0x" << std::hex << std::setw(4) << std::setfill('0') << getOutputModes() << "\n";
-        oss << "Caps: 0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<unsigned int>(getCapabilities()) << "\n";
-        oss << "Combos:";
+        out.printf("Device: 0x%02X\n", static_cast<unsigned int>(getDeviceType()));
+        out.printf("InModes: 0x%04X\n", getInputModes());
+        out.printf("OutModes: 0x%04X\n", getOutputModes());
+        out.printf("Caps: 0x%02X\n", static_cast<unsigned int>(getCapabilities()));
+        out.append("Combos:");
         for (uint8_t i = 0; i < getModeComboCount(); i++)
         {
-            oss << "\t0x" << std::hex << std::setw(4) << std::setfill('0') << getModeCombo(i);
+            out.printf("\t0x%04X", getModeCombo(i));
         }
         auto fw = getFwVersion();
-        oss << std::dec << "\n" << "FW Version: " << fw.Major << "." << fw.Minor << "." << fw.Bugfix << "." << fw.Build << "\n";
+        out.printf("\nFW Version: %d.%d.%d.%d\n", fw.Major, fw.Minor, fw.Bugfix, fw.Build);
         auto hw = getHwVersion();
-        oss << "HW Version: " << hw.Major << "." << hw.Minor << "." << hw.Bugfix << "." << hw.Build << "\n";
+        out.printf("HW Version: %d.%d.%d.%d\n", hw.Major, hw.Minor, hw.Bugfix, hw.Build);
         for (size_t i = 0; i < getModes().size(); i++)
         {
             auto &mode = getModes()[i];
-            oss << std::dec << "Mode " << i << ":\n";
-            oss << "\tname: " << mode.name << "\n";
-            oss << "\tunit: " << mode.unit << "\n";
-            oss << std::fixed << std::setprecision(6) << "\tmin: " << static_cast<double>(mode.min) << "\n";
-            oss << "\tmax: " << static_cast<double>(mode.max) << "\n";
-            oss << "\tPCT min: " << mode.PCTmin << "\n";
-            oss << "\tPCT max: " << mode.PCTmax << "\n";
-            oss << "\tSI min: " << static_cast<double>(mode.SImin) << "\n";
-            oss << "\tSI max: " << static_cast<double>(mode.SImax) << "\n";
-            oss << std::dec << "\tData sets: " << static_cast<int>(mode.data_sets) << "\n";
-            oss << "\tformat: 0x" << std::hex << std::setw(2) << std::setfill('0')
-                << static_cast<unsigned int>(mode.format) << "\n";
-            oss << std::dec << "\tFigures: " << static_cast<int>(mode.figures) << "\n";
-            oss << "\tDecimals: " << static_cast<int>(mode.decimals) << "\n";
+            out.printf("Mode %u:\n", (unsigned int)i);
+            out.printf("\tname: %s\n", mode.name.c_str());
+            out.printf("\tunit: %s\n", mode.unit.c_str());
+            out.printf("\tmin: %f\n", static_cast<double>(mode.min));
+            out.printf("\tmax: %f\n", static_cast<double>(mode.max));
+            out.printf("\tPCT min: %f\n", static_cast<double>(mode.PCTmin));
+            out.printf("\tPCT max: %f\n", static_cast<double>(mode.PCTmax));
+            out.printf("\tSI min: %f\n", static_cast<double>(mode.SImin));
+            out.printf("\tSI max: %f\n", static_cast<double>(mode.SImax));
+            out.printf("\tData sets: %d\n", static_cast<int>(mode.data_sets));
+            out.printf("\tformat: 0x%02X\n", static_cast<unsigned int>(mode.format));
+            out.printf("\tFigures: %d\n", static_cast<int>(mode.figures));
+            out.printf("\tDecimals: %d\n", static_cast<int>(mode.decimals));
             auto in = mode.in;
-            oss << "\tin: 0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<unsigned int>(in.val)
-                << " (null: " << in.nullSupport() << ", mapping 2.0: " << in.mapping2() << ", m_abs: " << in.m_abs()
-                << ", m_rel: " << in.m_rel() << ", m_dis: " << in.m_dis() << ")\n";
-            auto out = mode.out;
-            oss << "\tout: 0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<unsigned int>(out.val)
-                << " (null: " << out.nullSupport() << ", mapping 2.0: " << out.mapping2() << ", m_abs: " << out.m_abs()
-                << ", m_rel: " << out.m_rel() << ", m_dis: " << out.m_dis() << ")\n";
-            auto flags = mode.flags;
-            oss << std::hex << std::setw(2) << std::setfill('0') << "\tFlags: 0x" << (int)flags.bytes[0] << ", 0x" << (int)flags.bytes[1] << ", 0x" << (int)flags.bytes[2] << ", 0x" << (int)flags.bytes[3] << ", 0x" << (int)flags.bytes[4] << ", 0x" << (int)flags.bytes[5]
-                << " (speed: " << flags.speed()
-                << ", apos: " << flags.apos() << ", power: " << flags.power() << ", motor: " << flags.motor()
-                << ", pin1: " << flags.pin1() << ", pin2: " << flags.pin2() << ", calib: " << flags.calib()
-                << ", power12: " << flags.power12() << ")\n";
-            oss << "\tRaw:";
-            for (int n = 0; n < mode.rawData.size(); n++)
+            out.printf("\tin: 0x%02X (null: %d, mapping 2.0: %d, m_abs: %d, m_rel: %d, m_dis: %d)\n",
+                       static_cast<unsigned int>(in.val), in.nullSupport(), in.mapping2(), in.m_abs(), in.m_rel(), in.m_dis());
+            auto outMap = mode.out;
+            out.printf("\tout: 0x%02X (null: %d, mapping 2.0: %d, m_abs: %d, m_rel: %d, m_dis: %d)\n",
+                       static_cast<unsigned int>(outMap.val), outMap.nullSupport(), outMap.mapping2(), outMap.m_abs(), outMap.m_rel(), outMap.m_dis());
+            auto &flags = mode.flags;
+            out.printf("\tFlags: 0x%X, 0x%X, 0x%X, 0x%X, 0x%X, 0x%X",
+                       flags.bytes[0], flags.bytes[1], flags.bytes[2], flags.bytes[3], flags.bytes[4], flags.bytes[5]);
+            out.printf(" (speed: %d, apos: %d, power: %d, motor: %d, pin1: %d, pin2: %d, calib: %d, power12: %d)\n",
+                       flags.speed(), flags.apos(), flags.power(), flags.motor(),
+                       flags.pin1(), flags.pin2(), flags.calib(), flags.power12());
+            out.append("\tRaw:");
+            for (size_t n = 0; n < mode.rawData.size(); n++)
             {
-                oss << " 0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<unsigned int>(mode.rawData[n]);
+                out.printf(" 0x%02X", static_cast<unsigned int>(mode.rawData[n]));
             }
-            oss << "\n";
+            out.append("\n");
         }
-        return oss.str();
+        return out.length();
     }
 
     uint8_t Port::getDataSize(uint8_t format)
@@ -107,13 +118,11 @@ namespace Lpf2
         return 0;
     }
 
-    float Port::getValue(const Mode &modeData, const std::vector<uint8_t> &raw, uint8_t dataSet)
+    float Port::getValue(const Mode &modeData, const uint8_t *raw, size_t len, uint8_t dataSet)
     {
         if (dataSet >= modeData.data_sets)
             return 0.0f;
 
-        std::string result;
-
         const size_t bytesPerDataset = getDataSize(modeData.format);
         if (!bytesPerDataset)
             return 0.0f;
@@ -121,10 +130,10 @@ namespace Lpf2
         // Check that rawData contains enough bytes
         size_t offset = bytesPerDataset * dataSet;
 
-        if (raw.size() < offset + bytesPerDataset)
+        if (len < offset + bytesPerDataset)
             return 0.0f;
 
-        const uint8_t *ptr = raw.data() + offset;
+        const uint8_t *ptr = raw + offset;
         float value = 0.0f;
 
         static constexpr float pow10lut[] = {
@@ -156,6 +165,11 @@ namespace Lpf2
         return value;
     }
 
+    float Port::getValue(const Mode &modeData, const std::vector<uint8_t> &raw, uint8_t dataSet)
+    {
+        return getValue(modeData, raw.data(), raw.size(), dataSet);
+    }
+
     float Lpf2::Port::getValue(const Mode &modeData, uint8_t dataSet)
     {
         return getValue(modeData, modeData.rawData, dataSet);
@@ -175,48 +189,149 @@ namespace Lpf2
         return getValue(m_modeData[modeNum], dataSet);
     }
 
-    std::string Port::formatValue(float value, const Mode &modeData)
+    int32_t Port::getRawValue(const Mode &modeData, const uint8_t *raw, size_t len, uint8_t dataSet)
     {
-        std::string str;
+        if (dataSet >= modeData.data_sets)
+            return 0;
 
-        str += std::to_string(value);
+        const size_t bytesPerDataset = getDataSize(modeData.format);
+        const size_t offset = bytesPerDataset * dataSet;
+        if (!bytesPerDataset || len < offset + bytesPerDataset)
+            return 0;
 
-        // Append unit if present
-        if (!modeData.unit.empty())
+        const uint8_t *ptr = raw + offset;
+        switch (modeData.format)
         {
-            str += " " + modeData.unit;
+        case DATA8:
+            return static_cast<int8_t>(*ptr);
+        case DATA16:
+        {
+            int16_t val;
+            std::memcpy(&val, ptr, sizeof(int16_t));
+            return val;
+        }
+        case DATA32:
+        {
+            int32_t val;
+            std::memcpy(&val, ptr, sizeof(int32_t));
+            return val;
+        }
+        case DATAF:
+        {
+            float val = parseDataF(ptr);
+            if (!(val > (float)INT32_MIN))
+                return val != val ? 0 : INT32_MIN; // NaN -> 0
+            if (val >= (float)INT32_MAX)
+                return INT32_MAX;
+            return (int32_t)val;
         }
+        }
+        return 0;
+    }
 
-        return str;
+    int32_t Port::getScaled(uint8_t modeNum, uint8_t dataSet, uint8_t decimals) const
+    {
+        if (modeNum >= m_modeData.size())
+            return 0;
+        const Mode &mode = m_modeData[modeNum];
+
+        static constexpr int64_t pow10lut[] = {
+            1, 10, 100, 1000, 10000, 100000,
+            1000000, 10000000, 100000000, 1000000000
+        };
+        constexpr int maxExp = (int)std::size(pow10lut) - 1;
+
+        int64_t value;
+        if (mode.format == DATAF)
+        {
+            float f = getValue(mode, dataSet) * (float)pow10lut[std::min<int>(decimals, maxExp)];
+            value = (f != f) ? 0 : (int64_t)std::clamp(f, (float)INT32_MIN, (float)INT32_MAX);
+        }
+        else
+        {
+            const auto &raw = mode.rawData;
+            value = getRawValue(mode, raw.data(), raw.size(), dataSet);
+            int shift = (int)decimals - (int)mode.decimals;
+            if (shift > 0)
+                value *= pow10lut[std::min(shift, maxExp)];
+            else if (shift < 0)
+                value /= pow10lut[std::min(-shift, maxExp)];
+        }
+        return (int32_t)std::clamp<int64_t>(value, INT32_MIN, INT32_MAX);
+    }
+
+    size_t Port::getRawBatch(uint8_t modeNum, int32_t *out, size_t maxCount) const
+    {
+        if (modeNum >= m_modeData.size() || !out)
+            return 0;
+        const Mode &mode = m_modeData[modeNum];
+        size_t count = std::min<size_t>(mode.data_sets, maxCount);
+        for (size_t i = 0; i < count; i++)
+            out[i] = getRawValue(mode, mode.rawData.data(), mode.rawData.size(), (uint8_t)i);
+        return count;
+    }
+
+    std::string Port::formatValue(float value, const Mode &modeData)
+    {
+        return Utils::formatToString([&](char *buf, size_t size)
+                                     { return formatValue(buf, size, value, modeData); });
     }
 
     std::string Port::getValueStr(const Mode& modeData)
     {
-        std::string result;
+        return Utils::formatToString([&](char *buf, size_t size)
+                                     { return getValueStr(buf, size, modeData); });
+    }
 
-        for (uint8_t i = 0; i < modeData.data_sets; ++i)
+    std::string Port::getValueStr(uint8_t modeNum) const
+    {
+        if (modeNum >= m_modeData.size())
         {
-            // Format to string
-            std::string part = formatValue(getValue(modeData, i), modeData);
+            return "<mode not found>";
+        }
+        return getValueStr(m_modeData[modeNum]);
+    }
+
+    size_t Port::formatValue(char *buf, size_t size, float value, const Mode &modeData)
+    {
+        Utils::StrBuf out(buf, size);
+        out.printf("%f", static_cast<double>(value));
 
+        // Append unit if present
+        if (!modeData.unit.empty())
+        {
+            out.append(" ");
+            out.append(modeData.unit.c_str(), modeData.unit.size());
+        }
+        return out.length();
+    }
+
+    size_t Port::getValueStr(char *buf, size_t size, const Mode &modeData)
+    {
+        Utils::StrBuf out(buf, size);
+        for (uint8_t i = 0; i < modeData.data_sets; ++i)
+        {
             // Append with separator
-            if (result.length())
+            if (i > 0)
             {
-                result += "; ";
+                out.append("; ", 2);
             }
-            result += part;
+            size_t len = out.length();
+            char *tail = len < size ? buf + len : nullptr;
+            out.skip(formatValue(tail, tail ? size - len : 0, getValue(modeData, i), modeData));
         }
-
-        return result;
+        return out.length();
     }
 
-    std::string Port::getValueStr(uint8_t modeNum) const
+    size_t Port::getValueStr(char *buf, size_t size, uint8_t modeNum) const
     {
         if (modeNum >= m_modeData.size())
         {
-            return "<mode not found>";
+            Utils::StrBuf out(buf, size);
+            out.append("<mode not found>");
+            return out.length();
         }
-        return getValueStr(m_modeData[modeNum]);
+        return getValueStr(buf, size, m_modeData[modeNum]);
     }
 
     float Port::parseData8(const uint8_t *ptr)
@@ -343,6 +458,163 @@ namespace Lpf2
         m_valueChangeCallback(modeNum);
     }
 
+    int Port::enableHistory(uint8_t modeNum, size_t capacity)
+    {
+        if (modeNum >= m_history.size() || capacity == 0)
+            return 1;
+        if (m_history[modeNum] && m_history[modeNum]->capacity() == capacity)
+            return 0;
+        m_history[modeNum] = std::make_unique<Utils::SampleRing>(capacity);
+        return 0;
+    }
+
+    void Port::disableHistory(uint8_t modeNum)
+    {
+        if (modeNum < m_history.size())
+            m_history[modeNum].reset();
+    }
+
+    void Port::publishModeData(uint8_t modeNum)
+    {
+        recordSample(modeNum);
+        notifySubscribers(modeNum);
+    }
+
+    void Port::recordSample(uint8_t modeNum)
+    {
+        if (modeNum >= m_history.size() || !m_history[modeNum] || modeNum >= m_modeData.size())
+            return;
+        const auto &raw = m_modeData[modeNum].rawData;
+        m_history[modeNum]->push(raw.data(), raw.size(), LPF2_GET_TIME_US());
+    }
+
+    int Port::subscribe(uint8_t modeNum, uint8_t dataSet, float delta, uint32_t minIntervalMs, ValueSubscriber callback)
+    {
+        if (modeNum >= m_subsByMode.size() || dataSet >= 32 || !callback)
+            return -1;
+        for (int i = 0; i < LPF2_MAX_SUBSCRIBERS; i++)
+        {
+            uint32_t bit = 1u << i;
+            if (m_subUsed.fetch_or(bit) & bit)
+                continue; // taken
+            Subscription &sub = m_subs[i];
+            sub.callback = std::move(callback);
+            sub.delta = delta;
+            sub.minIntervalMs = minIntervalMs;
+            sub.mode = modeNum;
+            sub.dataSet = dataSet;
+            sub.hasLast = false;
+            m_subsByMode[modeNum].fetch_or(bit, std::memory_order_release);
+            return i;
+        }
+        LPF2_LOG_W("No free subscription slot (max %d)", LPF2_MAX_SUBSCRIBERS);
+        return -1;
+    }
+
+    void Port::unsubscribe(int id)
+    {
+        if (id < 0 || id >= LPF2_MAX_SUBSCRIBERS)
+            return;
+        uint32_t bit = 1u << id;
+        if (!(m_subUsed.load() & bit))
+            return;
+        m_subsByMode[m_subs[id].mode].fetch_and(~bit);
+        // A notifySubscribers() that read the mask before it changed may
+        // still call the callback: wait for it, unless it is the caller.
+        uint32_t seq = m_notifySeq.load();
+        if ((seq & 1) && t_notifyingPort != this)
+        {
+            while (m_notifySeq.load(std::memory_order_acquire) == seq)
+            {
+#if defined(LPF2_NATIVE)
+                std::this_thread::yield();
+#else
+                vTaskDelay(1);
+#endif
+            }
+        }
+        m_subUsed.fetch_and(~bit);
+    }
+
+    // The port whose subscribers the current thread is calling.
+    thread_local const Port *Port::t_notifyingPort = nullptr;
+
+    void Port::notifySubscribers(uint8_t modeNum)
+    {
+        if (modeNum >= m_subsByMode.size() || modeNum >= m_modeData.size())
+            return;
+        // Unsubscribed modes cost this one load. A call that sees no bits
+        // runs no callback, so unsubscribe() need not wait for it.
+        if (!m_subsByMode[modeNum].load(std::memory_order_relaxed))
+            return;
+        // Odd before the mask is read: unsubscribe() clears the mask, then
+        // waits while the count it reads stays odd (sequentially consistent).
+        m_notifySeq.fetch_add(1);
+        uint32_t slots = m_subsByMode[modeNum].load();
+        if (!slots)
+        {
+            m_notifySeq.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        const Port *outer = t_notifyingPort;
+        t_notifyingPort = this;
+
+        const Mode &mode = m_modeData[modeNum];
+        const uint64_t now = LPF2_GET_TIME();
+
+        // Each dataset is decoded at most once per frame, shared by all its subscribers.
+        float values[32];
+        uint32_t decoded = 0;
+
+        for (uint8_t i = 0; slots; i++, slots >>= 1)
+        {
+            if (!(slots & 1))
+                continue;
+            Subscription &sub = m_subs[i];
+            const uint32_t dsBit = 1u << sub.dataSet;
+            if (!(decoded & dsBit))
+            {
+                values[sub.dataSet] = getValue(mode, sub.dataSet);
+                decoded |= dsBit;
+            }
+            const float value = values[sub.dataSet];
+            if (sub.hasLast)
+            {
+                if (std::abs(value - sub.lastValue) < sub.delta)
+                    continue;
+                if (now - sub.lastTime < sub.minIntervalMs)
+                    continue;
+            }
+            sub.hasLast = true;
+            sub.lastValue = value;
+            sub.lastTime = now;
+            sub.callback(modeNum, sub.dataSet, value);
+        }
+        t_notifyingPort = outer;
+        m_notifySeq.fetch_add(1, std::memory_order_release);
+    }
+
+    bool Port::getValueAt(uint8_t modeNum, uint8_t dataSet, uint64_t timeUs, float &value) const
+    {
+        const Utils::SampleRing *ring = getHistory(modeNum);
+        if (!ring || modeNum >= m_modeData.size())
+            return false;
+        Utils::SampleRing::Sample before, after;
+        if (!ring->bracket(timeUs, before, after))
+            return false;
+        const Mode &mode = m_modeData[modeNum];
+        float v0 = getValue(mode, before.raw, before.len, dataSet);
+        if (after.timeUs <= before.timeUs)
+        {
+            value = v0;
+            return true;
+        }
+        float v1 = getValue(mode, after.raw, after.len, dataSet);
+        float t = (float)(timeUs - before.timeUs) / (float)(after.timeUs - before.timeUs);
+        value = v0 + (v1 - v0) * t;
+        return true;
+    }
+
     void Lpf2::Port::ensureRawDataSize()
     {
         if (m_rawDataSizeEnsured)
@@ -17,11 +17,14 @@
 
 #include "Lpf2/Remote/Port.hpp"
 #include "Lpf2/Hub.hpp"
+#include "Lpf2/log/log.h"
+#include <algorithm>
 
 namespace Lpf2::Remote
 {
     void Port::_update()
     {
+        updateMotion();
         if (m_lastDevType != m_deviceType)
         {
             m_rawDataSizeEnsured = false;
@@ -37,10 +40,10 @@ namespace Lpf2::Remote
     {
         if (!m_remote || !isDeviceConnected())
             return 1;
+        discardMotion();
         std::vector<uint8_t> payload = {m_portNum, startupAndCompletion, 0x51, modeNum};
         payload.insert(payload.end(), data.begin(), data.end());
-        m_remote->writeValue(MessageType::PORT_OUTPUT_COMMAND, payload);
-        return 0;
+        return m_remote->writeOutput(payload);
     }
 
     bool Port::isDeviceConnected()
@@ -95,7 +98,7 @@ namespace Lpf2::Remote
         payload.push_back(accTime & 0xFF);
         payload.push_back((accTime >> 8) & 0xFF);
         payload.push_back((uint8_t)accProfile);
-        m_remote->writeValue(MessageType::PORT_OUTPUT_COMMAND, payload);
+        m_remote->writeOutput(payload);
     }
 
     void Port::setDecTime(uint16_t decTime, AccelerationProfile decProfile)
@@ -106,61 +109,55 @@ namespace Lpf2::Remote
         payload.push_back(decTime & 0xFF);
         payload.push_back((decTime >> 8) & 0xFF);
         payload.push_back((uint8_t)decProfile);
-        m_remote->writeValue(MessageType::PORT_OUTPUT_COMMAND, payload);
+        m_remote->writeOutput(payload);
     }
 
     void Port::startSpeed(int8_t speed, uint8_t maxPower, uint8_t useProfile)
     {
         if (!m_remote || !isDeviceConnected())
             return;
+        discardMotion();
         std::vector<uint8_t> payload = {m_portNum, startupAndCompletion, 0x07};
         payload.push_back(speedToRaw(speed));
         payload.push_back(maxPower);
         payload.push_back(useProfile);
-        m_remote->writeValue(MessageType::PORT_OUTPUT_COMMAND, payload);
+        m_remote->writeOutput(payload);
     }
 
     void Port::startSpeedForTime(uint16_t time, int8_t speed, uint8_t maxPower, BrakingStyle endState, uint8_t useProfile)
     {
-        if (!m_remote || !isDeviceConnected())
-            return;
-        std::vector<uint8_t> payload = {m_portNum, startupAndCompletion, 0x09};
-        payload.push_back(time & 0xFF);
-        payload.push_back((time >> 8) & 0xFF);
-        payload.push_back(speedToRaw(speed));
-        payload.push_back(maxPower);
-        payload.push_back(useProfile);
-        m_remote->writeValue(MessageType::PORT_OUTPUT_COMMAND, payload);
+        Local::MotionSegment segment;
+        segment.type = Local::MotionSegment::Type::SPEED_FOR_TIME;
+        segment.value = time;
+        segment.speed = speed;
+        segment.maxPower = maxPower;
+        segment.endState = endState;
+        discardMotion();
+        sendMotion(segment, startupAndCompletion, useProfile);
     }
 
     void Port::startSpeedForDegrees(uint32_t degrees, int8_t speed, uint8_t maxPower, BrakingStyle endState, uint8_t useProfile)
     {
-        if (!m_remote || !isDeviceConnected())
-            return;
-        std::vector<uint8_t> payload = {m_portNum, startupAndCompletion, 0x0B};
-        payload.push_back(degrees & 0xFF);
-        payload.push_back((degrees >> 8) & 0xFF);
-        payload.push_back((degrees >> 16) & 0xFF);
-        payload.push_back((degrees >> 24) & 0xFF);
-        payload.push_back(speedToRaw(speed));
-        payload.push_back(maxPower);
-        payload.push_back(useProfile);
-        m_remote->writeValue(MessageType::PORT_OUTPUT_COMMAND, payload);
+        Local::MotionSegment segment;
+        segment.type = Local::MotionSegment::Type::SPEED_FOR_DEGREES;
+        segment.value = (int32_t)degrees;
+        segment.speed = speed;
+        segment.maxPower = maxPower;
+        segment.endState = endState;
+        discardMotion();
+        sendMotion(segment, startupAndCompletion, useProfile);
     }
 
     void Port::gotoAbsPosition(int32_t absPos, uint8_t speed, uint8_t maxPower, BrakingStyle endState, uint8_t useProfile)
     {
-        if (!m_remote || !isDeviceConnected())
-            return;
-        std::vector<uint8_t> payload = {m_portNum, startupAndCompletion, 0x0D};
-        payload.push_back(absPos & 0xFF);
-        payload.push_back((absPos >> 8) & 0xFF);
-        payload.push_back((absPos >> 16) & 0xFF);
-        payload.push_back((absPos >> 24) & 0xFF);
-        payload.push_back(speedToRaw(speed));
-        payload.push_back(maxPower);
-        payload.push_back(useProfile);
-        m_remote->writeValue(MessageType::PORT_OUTPUT_COMMAND, payload);
+        Local::MotionSegment segment;
+        segment.type = Local::MotionSegment::Type::GOTO_ABS_POS;
+        segment.value = absPos;
+        segment.speed = (int8_t)speed;
+        segment.maxPower = maxPower;
+        segment.endState = endState;
+        discardMotion();
+        sendMotion(segment, startupAndCompletion, useProfile);
     }
 
     void Port::presetEncoder(int32_t pos)
@@ -170,4 +167,236 @@ namespace Lpf2::Remote
                       uint8_t((pos >> 16) & 0xFF),
                       uint8_t((pos >> 14) & 0xFF)});
     }
+
+    int Port::sendMotion(const Local::MotionSegment &segment, uint8_t startupAndCompletion, uint8_t useProfile)
+    {
+        if (!m_remote || !isDeviceConnected())
+            return 1;
+        std::vector<uint8_t> payload = {m_portNum, startupAndCompletion};
+        auto put32 = [&payload](uint32_t value)
+        {
+            for (int shift = 0; shift < 32; shift += 8)
+                payload.push_back((value >> shift) & 0xFF);
+        };
+        switch (segment.type)
+        {
+        case Local::MotionSegment::Type::SPEED_FOR_TIME:
+            payload.push_back((uint8_t)PortOutputSubCommand::START_SPEED_FOR_TIME_SINGLE);
+            payload.push_back(segment.value & 0xFF);
+            payload.push_back((segment.value >> 8) & 0xFF);
+            break;
+        case Local::MotionSegment::Type::SPEED_FOR_DEGREES:
+            payload.push_back((uint8_t)PortOutputSubCommand::START_SPEED_FOR_DEG_SINGLE);
+            put32((uint32_t)segment.value);
+            break;
+        case Local::MotionSegment::Type::GOTO_ABS_POS:
+            payload.push_back((uint8_t)PortOutputSubCommand::GOTO_ABS_POS_SINGLE);
+            put32((uint32_t)segment.value);
+            break;
+        }
+        payload.push_back(speedToRaw(segment.speed));
+        payload.push_back(segment.maxPower);
+        payload.push_back((uint8_t)segment.endState);
+        payload.push_back(useProfile);
+        return m_remote->writeOutput(payload);
+    }
+
+    CommandHandle Port::queueMotion(const Local::MotionSegment &segment, uint8_t startupAndCompletion)
+    {
+        if (!m_remote || !isDeviceConnected())
+        {
+            LPF2_LOG_E("Motion queue: no device attached");
+            return CommandHandle();
+        }
+        if (startupAndCompletion & STARTUP_IMMEDIATE)
+            discardMotion();
+        else if (m_motionQueue.full())
+        {
+            LPF2_LOG_W("Motion queue full");
+            return CommandHandle();
+        }
+        // Ids of the waiting commands run up to m_nextCommandId.
+        if (!m_motionQueue.push(segment, (startupAndCompletion & COMPLETION_FEEDBACK) != 0))
+            return CommandHandle();
+        CommandHandle handle(this, m_nextCommandId++);
+        if (startupAndCompletion & STARTUP_IMMEDIATE)
+        {
+            // Nothing is in flight any more, it goes out at once.
+            Local::MotionQueue::Entry e = m_motionQueue.pop();
+            uint32_t id = handle.m_id;
+            if (sendMotion(e.segment, startupAndCompletion) != 0)
+                finishMotion(e.segment, id, e.feedback, CommandState::DISCARDED);
+            else if (e.feedback)
+                m_inFlight[m_inFlightCount++] = {e.segment, id, false, true, false};
+            else
+                m_history[id % HISTORY] = CommandState::SENT;
+        }
+        else
+        {
+            updateMotion();
+        }
+        return handle;
+    }
+
+    void Port::clearMotionQueue()
+    {
+        Local::MotionQueue pending;
+        pending.swap(m_motionQueue);
+        uint32_t id = m_nextCommandId - (uint32_t)pending.size();
+        while (!pending.empty())
+        {
+            Local::MotionQueue::Entry e = pending.pop();
+            finishMotion(e.segment, id++, e.feedback, CommandState::DISCARDED);
+        }
+    }
+
+    void Port::discardMotion()
+    {
+        clearMotionQueue();
+        finishInFlight(m_inFlightCount, CommandState::DISCARDED);
+    }
+
+    void Port::finishMotion(const Local::MotionSegment &segment, uint32_t id, bool feedback, CommandState state)
+    {
+        m_history[id % HISTORY] = state;
+        if (feedback && segment.onDone)
+            segment.onDone(segment, state == CommandState::COMPLETED ? Local::MotionResult::COMPLETED : Local::MotionResult::DISCARDED);
+    }
+
+    void Port::finishInFlight(uint8_t count, CommandState state)
+    {
+        // Copied out first: onDone may queue further commands.
+        InFlight done[HUB_BUFFER];
+        count = std::min(count, m_inFlightCount);
+        for (uint8_t i = 0; i < count; i++)
+            done[i] = std::move(m_inFlight[i]);
+        for (uint8_t i = count; i < m_inFlightCount; i++)
+            m_inFlight[i - count] = std::move(m_inFlight[i]);
+        m_inFlightCount -= count;
+        for (uint8_t i = 0; i < count; i++)
+            finishMotion(done[i].segment, done[i].id, done[i].feedback, state);
+    }
+
+    void Port::onFeedback(uint8_t feedback)
+    {
+        m_lastFeedback.store(feedback, std::memory_order_relaxed);
+        uint8_t head = m_feedbackHead.load(std::memory_order_relaxed);
+        if ((uint8_t)(head - m_feedbackTail.load(std::memory_order_acquire)) >= sizeof(m_feedbackRing))
+        {
+            LPF2_LOG_W("Port 0x%02X: feedback dropped.", (int)m_portNum);
+            return;
+        }
+        m_feedbackRing[head % sizeof(m_feedbackRing)] = feedback;
+        m_feedbackHead.store(head + 1, std::memory_order_release);
+    }
+
+    void Port::applyFeedback(uint8_t feedback)
+    {
+        if (!m_inFlightCount)
+            return;
+        // The newest command caused a discard, or it waits behind the
+        // discarded ones.
+        if (feedback & FEEDBACK_DISCARDED)
+            finishInFlight(m_inFlightCount - 1, CommandState::DISCARDED);
+        if (feedback & FEEDBACK_BUSY_FULL)
+        {
+            // The buffer was full, the newest command did not get in.
+            if (m_inFlightCount)
+                m_inFlight[m_inFlightCount - 1].refused = true;
+            LPF2_LOG_W("Port 0x%02X: hub buffer full, command sent again later.", (int)m_portNum);
+        }
+        bool ended = false;
+        if (feedback & FEEDBACK_BUFFER_EMPTY_IN_PROGRESS)
+        {
+            // The hub started the next command: the running one ended.
+            if (m_inFlightCount && m_inFlight[0].running)
+                finishInFlight(1, CommandState::COMPLETED);
+            if (m_inFlightCount && !m_inFlight[0].refused)
+                m_inFlight[0].running = true;
+            ended = true;
+        }
+        else if (feedback & (FEEDBACK_BUFFER_EMPTY_COMPLETED | FEEDBACK_IDLE))
+        {
+            // The running one ended; a command still on its way is not
+            // known to the hub yet and completes with a later feedback.
+            if (m_inFlightCount && !m_inFlight[0].refused)
+                finishInFlight(1, CommandState::COMPLETED);
+            ended = true;
+        }
+        if (!ended)
+            return;
+        // A slot on the hub is free: send the refused commands again.
+        for (uint8_t i = 0; i < m_inFlightCount; i++)
+        {
+            if (!m_inFlight[i].refused)
+                continue;
+            m_inFlight[i].refused = false;
+            if (sendMotion(m_inFlight[i].segment, STARTUP_BUFFER | COMPLETION_FEEDBACK) != 0)
+            {
+                InFlight lost = std::move(m_inFlight[i]);
+                for (uint8_t j = i + 1; j < m_inFlightCount; j++)
+                    m_inFlight[j - 1] = std::move(m_inFlight[j]);
+                m_inFlightCount--;
+                i--;
+                finishMotion(lost.segment, lost.id, lost.feedback, CommandState::DISCARDED);
+            }
+        }
+    }
+
+    void Port::updateMotion()
+    {
+        if (m_motionReset.exchange(false, std::memory_order_acquire))
+        {
+            m_feedbackTail.store(m_feedbackHead.load(std::memory_order_acquire), std::memory_order_release);
+            discardMotion();
+        }
+
+        uint8_t head = m_feedbackHead.load(std::memory_order_acquire);
+        uint8_t tail = m_feedbackTail.load(std::memory_order_relaxed);
+        while (tail != head)
+        {
+            uint8_t feedback = m_feedbackRing[tail % sizeof(m_feedbackRing)];
+            m_feedbackTail.store(++tail, std::memory_order_release);
+            applyFeedback(feedback);
+        }
+
+        while (!m_motionQueue.empty() && m_inFlightCount < HUB_BUFFER && isDeviceConnected())
+        {
+            uint32_t id = m_nextCommandId - (uint32_t)m_motionQueue.size();
+            Local::MotionQueue::Entry e = m_motionQueue.pop();
+            // Always with feedback: the next one is only sent when the hub
+            // has room for it.
+            if (sendMotion(e.segment, STARTUP_BUFFER | COMPLETION_FEEDBACK) != 0)
+                finishMotion(e.segment, id, e.feedback, CommandState::DISCARDED);
+            else
+                m_inFlight[m_inFlightCount++] = {e.segment, id, false, e.feedback, false};
+        }
+    }
+
+    CommandState Port::commandState(uint32_t id) const
+    {
+        if (id == 0 || id >= m_nextCommandId)
+            return CommandState::UNKNOWN;
+        if (id >= m_nextCommandId - (uint32_t)m_motionQueue.size())
+            return CommandState::QUEUED;
+        for (uint8_t i = 0; i < m_inFlightCount; i++)
+        {
+            if (m_inFlight[i].id == id)
+                return m_inFlight[i].running ? CommandState::IN_PROGRESS : CommandState::SENT;
+        }
+        if (m_nextCommandId - id > HISTORY)
+            return CommandState::UNKNOWN;
+        return m_history[id % HISTORY];
+    }
+
+    CommandState CommandHandle::state() const
+    {
+        return m_port ? m_port->commandState(m_id) : CommandState::UNKNOWN;
+    }
+
+    bool CommandHandle::done() const
+    {
+        CommandState s = state();
+        return s == CommandState::COMPLETED || s == CommandState::DISCARDED;
+    }
 }; // namespace Lpf2::Remote
\ No newline at end of file
@@ -0,0 +1,59 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#if defined(LPF2_NATIVE)
+
+#include "Lpf2/Sim/Clock.hpp"
+#include <chrono>
+
+namespace Lpf2::Sim
+{
+    static uint64_t s_nowUs = 0;
+
+    uint64_t Clock::nowUs()
+    {
+        return s_nowUs;
+    }
+
+    void Clock::setUs(uint64_t us)
+    {
+        s_nowUs = us;
+    }
+
+    void Clock::advanceUs(uint64_t us)
+    {
+        s_nowUs += us;
+    }
+}; // namespace Lpf2::Sim
+
+extern "C" uint64_t lpf2_host_time_us(void)
+{
+    return Lpf2::Sim::Clock::nowUs();
+}
+
+extern "C" uint32_t lpf2_host_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__builtin_ia32_rdtsc();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+#endif // LPF2_NATIVE
@@ -0,0 +1,81 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#if defined(LPF2_NATIVE)
+
+#include "Lpf2/Sim/HubLoopback.hpp"
+#include "Lpf2/Sim/Clock.hpp"
+
+namespace Lpf2::Sim
+{
+    HubLoopback::HubLoopback(ScriptedHub &hub, uint32_t latencyUs)
+        : m_hub(hub), m_latencyUs(latencyUs)
+    {
+        m_hub.setSender([this](const uint8_t *data, size_t length)
+                        { queue(m_toClient, data, length); });
+    }
+
+    void HubLoopback::queue(std::deque<Frame> &queue, const uint8_t *data, size_t length)
+    {
+        uint64_t arrival = LPF2_GET_TIME_US() + m_latencyUs;
+        // Keep the order even if the latency was lowered in between.
+        if (!queue.empty() && queue.back().arrivalUs > arrival)
+            arrival = queue.back().arrivalUs;
+        queue.push_back({arrival, std::vector<uint8_t>(data, data + length)});
+    }
+
+    bool HubLoopback::write(const uint8_t *data, size_t length)
+    {
+        queue(m_toHub, data, length);
+        m_framesWritten++;
+        m_bytesWritten += length;
+        return true;
+    }
+
+    void HubLoopback::poll()
+    {
+        uint64_t now = LPF2_GET_TIME_US();
+        m_hub.tick(now);
+        // Either side may send while handling a message, so take the frame
+        // off its queue first.
+        while (!m_toHub.empty() && m_toHub.front().arrivalUs <= now)
+        {
+            Frame frame = std::move(m_toHub.front());
+            m_toHub.pop_front();
+            m_hub.receive(frame.data.data(), frame.data.size());
+        }
+        while (!m_toClient.empty() && m_toClient.front().arrivalUs <= now)
+        {
+            Frame frame = std::move(m_toClient.front());
+            m_toClient.pop_front();
+            m_framesDelivered++;
+            m_bytesDelivered += frame.data.size();
+            deliver(frame.data.data(), frame.data.size());
+        }
+    }
+
+    void HubLoopback::idle(uint32_t ms)
+    {
+        for (uint32_t i = 0; i < ms; i++)
+        {
+            Clock::advanceUs(1000);
+            poll();
+        }
+    }
+}; // namespace Lpf2::Sim
+
+#endif // LPF2_NATIVE
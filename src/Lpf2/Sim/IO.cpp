@@ -0,0 +1,103 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#if defined(LPF2_NATIVE)
+
+#include "Lpf2/Sim/IO.hpp"
+
+namespace Lpf2::Sim
+{
+    UartLink::UartLink()
+    {
+        m_host.m_peer = &m_device;
+        m_device.m_peer = &m_host;
+    }
+
+    size_t Uart::write(const uint8_t *data, size_t length)
+    {
+        if (!m_peer)
+        {
+            return 0;
+        }
+        // 10 bits per byte (start + 8 data + stop), rounded up to whole µs.
+        uint64_t byteUs = (10000000ull + m_baud - 1) / m_baud;
+        uint64_t now = LPF2_GET_TIME_US();
+        for (size_t i = 0; i < length; i++)
+        {
+            uint64_t start = m_txFreeUs > now ? m_txFreeUs : now;
+            m_txFreeUs = start + byteUs;
+            // A receiver with its UART pins released (analog ID) does not see the data.
+            if (!m_peer->m_highZ)
+                m_peer->m_rx.push_back({m_txFreeUs, data[i]});
+        }
+        m_bytesWritten += length;
+        return length;
+    }
+
+    int Uart::available()
+    {
+        uint64_t now = LPF2_GET_TIME_US();
+        int count = 0;
+        for (const auto &b : m_rx)
+        {
+            if (b.arrivalUs > now)
+            {
+                break;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    int Uart::read()
+    {
+        if (m_rx.empty() || m_rx.front().arrivalUs > LPF2_GET_TIME_US())
+        {
+            return -1;
+        }
+        uint8_t b = m_rx.front().value;
+        m_rx.pop_front();
+        return b;
+    }
+
+    size_t Uart::read(uint8_t *data, size_t length)
+    {
+        size_t n = 0;
+        while (n < length)
+        {
+            int b = read();
+            if (b < 0)
+            {
+                break;
+            }
+            data[n++] = (uint8_t)b;
+        }
+        return n;
+    }
+
+    float Uart::readCh(uint8_t ch)
+    {
+        if (ch == 0)
+        {
+            return 0.0f;
+        }
+        m_idToggle = !m_idToggle;
+        return m_idToggle ? 3.3f : 0.0f;
+    }
+}; // namespace Lpf2::Sim
+
+#endif // LPF2_NATIVE
@@ -0,0 +1,262 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#if defined(LPF2_NATIVE)
+
+#include "Lpf2/Sim/MotorBench.hpp"
+#include "Lpf2/Sim/Clock.hpp"
+#include "Lpf2/DeviceDescLib.hpp"
+#include "Lpf2/Battery.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Lpf2::Sim
+{
+    // Motor speed that counts as moving for MoveResult::reversals, deg/s.
+    static constexpr double REVERSAL_SPEED_DPS = 2.0;
+
+    MotorBench::MotorBench(const Config &config)
+        : m_config(config),
+          m_settings(Local::lookupMotorSettings(config.type)),
+          m_io(m_link.host()),
+          m_port(m_io),
+          m_emulated(m_link.device()),
+          m_plant(config.model ? *config.model
+                               : (m_settings ? MotorModel::fromSettings(*m_settings) : MotorModel{})),
+          m_startUs(Clock::nowUs())
+    {
+        if (!m_settings)
+        {
+            LPF2_LOG_E("No MotorSettings for device type 0x%02X", (int)config.type);
+        }
+        auto desc = DeviceDescRegistry::instance().getDescriptor(config.type);
+        if (!desc)
+        {
+            LPF2_LOG_E("No descriptor for device type 0x%02X (call DeviceDescRegistry::registerDefault())", (int)config.type);
+            return;
+        }
+        m_device = std::make_unique<Virtual::GenericDevice>(*desc);
+
+        Battery::setCurrentVoltage(config.supplyMv);
+        m_emulated.attachDevice(*m_device);
+        m_emulated.init();
+        m_port.init(
+#if defined(LPF2_USE_FREERTOS)
+            false
+#endif
+        );
+    }
+
+    MotorBench::~MotorBench()
+    {
+        m_emulated.detachDevice();
+    }
+
+    uint64_t MotorBench::timeMs() const
+    {
+        return (Clock::nowUs() - m_startUs) / 1000;
+    }
+
+    float MotorBench::speedPct() const
+    {
+        return m_reportedPct;
+    }
+
+    void MotorBench::step()
+    {
+        Clock::advanceUs(m_config.physicsStepUs);
+        tick();
+    }
+
+    void MotorBench::tick()
+    {
+        if (!m_device)
+            return; // not set up, see the constructor
+        uint64_t now = Clock::nowUs();
+
+        const PWM &pwm = m_io.pwm();
+        float volts = pwm.duty() * Battery::getCurrentVoltage() / 1000.0f;
+        m_plant.step(volts, pwm.coasting(), m_config.physicsStepUs * 1e-6f);
+
+        if (now >= m_nextFrameUs)
+        {
+            m_nextFrameUs = now + m_config.framePeriodUs;
+            publishFrame();
+        }
+        if (now >= m_nextControlUs)
+        {
+            m_nextControlUs = now + m_config.controlPeriodUs;
+            m_emulated.update();
+            m_port.update();
+        }
+    }
+
+    void MotorBench::publishFrame()
+    {
+        double angle = m_plant.angleDeg();
+        double speedDps = (angle - m_frameAngleDeg) * 1e6 / m_config.framePeriodUs;
+        m_frameAngleDeg = angle;
+
+        int32_t rated = m_settings ? m_settings->rated_max_speed : 1000;
+        m_reportedPct = (float)std::clamp(speedDps * 100.0 / rated, -127.0, 127.0);
+
+        if (!m_device || !m_emulated.isHostConnected())
+            return;
+
+        // Combo 0 of the encoder motors: SPEED (DATA8), POS (DATA32), APOS (DATA16).
+        int8_t speed = (int8_t)std::lround(m_reportedPct);
+        int32_t pos = (int32_t)std::floor(angle);
+        int16_t apos = (int16_t)(((pos % 360) + 540) % 360 - 180);
+
+        std::vector<uint8_t> raw(1);
+        std::memcpy(raw.data(), &speed, 1);
+        m_device->setModeData(1, raw, false);
+        raw.resize(4);
+        std::memcpy(raw.data(), &pos, 4);
+        m_device->setModeData(2, raw, false);
+        raw.resize(2);
+        std::memcpy(raw.data(), &apos, 2);
+        m_device->setModeData(3, raw); // sends the frame
+    }
+
+    void MotorBench::run(uint32_t ms)
+    {
+        uint64_t end = Clock::nowUs() + (uint64_t)ms * 1000;
+        while (Clock::nowUs() < end)
+        {
+            step();
+        }
+    }
+
+    bool MotorBench::connect(uint32_t timeoutMs)
+    {
+        if (!m_device)
+            return false;
+        uint64_t end = Clock::nowUs() + (uint64_t)timeoutMs * 1000;
+        while (Clock::nowUs() < end)
+        {
+            step();
+            if (m_port.isDeviceConnected() && m_port.getDeviceType() == m_config.type &&
+                m_emulated.isHostConnected())
+            {
+                // Let the combo selection settle and the first frames arrive.
+                run(100);
+                return m_port.isDeviceConnected();
+            }
+        }
+        return false;
+    }
+
+    bool MotorBench::autoTune(const Local::AutoTuneConfig &config, uint32_t timeoutMs)
+    {
+        if (m_port.startAutoTune(config) != 0)
+            return false;
+        uint64_t end = Clock::nowUs() + (uint64_t)timeoutMs * 1000;
+        while (Clock::nowUs() < end &&
+               m_port.getAutoTuneState() == Local::AutoTuner::State::RUNNING)
+        {
+            step();
+        }
+        if (m_port.getAutoTuneState() == Local::AutoTuner::State::RUNNING)
+        {
+            // Timed out: any other command aborts the run.
+            m_port.startPower(0);
+            run(1);
+        }
+        return m_port.getAutoTuneState() == Local::AutoTuner::State::DONE;
+    }
+
+    MotorBench::MoveResult MotorBench::runMove(const Move &move)
+    {
+        MoveResult result;
+        bool position = move.type == Move::Type::POSITION;
+        double start = position ? m_plant.angleDeg() : m_reportedPct;
+        double dir = (move.target >= start) ? 1.0 : -1.0;
+
+        if (position)
+            m_port.gotoAbsPosition(move.target, move.speed, move.maxPower, BrakingStyle::HOLD);
+        else
+            m_port.startSpeed((int8_t)move.target, move.maxPower);
+
+        uint64_t startUs = Clock::nowUs();
+        uint64_t endUs = startUs + (uint64_t)move.durationMs * 1000;
+        uint64_t tailUs = endUs - std::min<uint64_t>(100000, endUs - startUs);
+        uint64_t lastOutsideUs = startUs;
+        double peak = 0.0;
+        double tailSum = 0.0;
+        uint32_t tailCount = 0;
+        // Observer: least-squares fit of angle error = lag * speed.
+        double errSpeedSum = 0.0;
+        double speedSqSum = 0.0;
+        double speedErrSqSum = 0.0;
+        uint32_t samples = 0;
+        int32_t rated = m_settings ? m_settings->rated_max_speed : 1000;
+        double offsetMdeg = m_plant.angleDeg() * 1000.0 - (double)m_port.getObservedAngleMdeg();
+        bool reached = false;
+        int moveDir = 0;
+
+        // Sample once per control period.
+        while (Clock::nowUs() < endUs)
+        {
+            uint64_t next = Clock::nowUs() + m_config.controlPeriodUs;
+            while (Clock::nowUs() < next)
+                step();
+
+            double value = position ? m_plant.angleDeg() : (double)m_reportedPct;
+            double err = move.target - value;
+            if (std::abs(err) > move.band)
+                lastOutsideUs = Clock::nowUs();
+            peak = std::max(peak, -err * dir);
+            if (Clock::nowUs() >= tailUs)
+            {
+                tailSum += err;
+                tailCount++;
+            }
+
+            double speed = m_plant.speedDps();
+            reached = reached || std::abs(err) <= move.band;
+            if (position && reached && std::abs(speed) > REVERSAL_SPEED_DPS)
+            {
+                int d = speed > 0 ? 1 : -1;
+                if (moveDir != 0 && d != moveDir)
+                    result.reversals++;
+                moveDir = d;
+            }
+            double angleErr = m_plant.angleDeg() - ((double)m_port.getObservedAngleMdeg() + offsetMdeg) / 1000.0;
+            double speedErr = speed - m_port.getObservedSpeedMdegps() / 1000.0;
+            errSpeedSum += angleErr * speed;
+            speedSqSum += speed * speed;
+            speedErrSqSum += speedErr * speedErr;
+            samples++;
+        }
+
+        result.settled = lastOutsideUs < endUs - m_config.controlPeriodUs;
+        result.settleMs = (uint32_t)((lastOutsideUs - startUs) / 1000);
+        result.overshoot = (float)peak;
+        result.steadyStateError = tailCount ? (float)std::abs(tailSum / tailCount) : 0.0f;
+        if (position)
+            result.loadError = (float)std::abs(move.target - m_plant.loadAngleDeg());
+        if (speedSqSum > 0.0)
+            result.observerLagMs = (float)(errSpeedSum / speedSqSum * 1000.0);
+        if (samples)
+            result.observerSpeedError = (float)(std::sqrt(speedErrSqSum / samples) * 100.0 / rated);
+        return result;
+    }
+}; // namespace Lpf2::Sim
+
+#endif // LPF2_NATIVE
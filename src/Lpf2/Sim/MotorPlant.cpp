@@ -0,0 +1,149 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#if defined(LPF2_NATIVE)
+
+#include "Lpf2/Sim/MotorPlant.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Lpf2::Sim
+{
+    static constexpr double DEG_PER_RAD = 180.0 / M_PI;
+
+    // Below this speed (rad/s) a body is considered stopped and held by stiction.
+    static constexpr double STOP_SPEED = 1e-3;
+
+    MotorModel MotorModel::fromSettings(const Local::MotorSettings &s)
+    {
+        float volts = s.max_voltage_mv / 1000.0f;
+        float noLoadSpeed = s.rated_max_speed * 1.3f / (float)DEG_PER_RAD;
+
+        MotorModel m = {};
+        m.resistance_ohm = 6.0f;
+        m.ke_vs_per_rad = volts / noLoadSpeed;
+        float stallTorque = m.ke_vs_per_rad * volts / m.resistance_ohm;
+        // tau_mech = J * R / ke^2 = 50 ms
+        m.inertia_kgm2 = 0.05f * m.ke_vs_per_rad * m.ke_vs_per_rad / m.resistance_ohm;
+        m.viscous_nms = 0.02f * stallTorque / noLoadSpeed;
+        m.coulomb_nm = 0.8f * s.kinetic_floor_pct / 100.0f * stallTorque;
+        m.stiction_nm = std::max(m.coulomb_nm, 0.9f * s.breakaway_pct / 100.0f * stallTorque);
+        m.backlash_deg = 1.5f;
+        m.load_inertia_kgm2 = m.inertia_kgm2;
+        m.load_friction_nm = 0.02f * stallTorque;
+        m.load_torque_nm = 0.0f;
+        return m;
+    }
+
+    void MotorModel::applyFeedForward(Local::MotorSettings &s) const
+    {
+        // At steady speed w: V = ke * w + R * (viscous * w + friction) / ke.
+        float friction = coulomb_nm + (load_inertia_kgm2 > 0.0f ? load_friction_nm : 0.0f);
+        float keEff = ke_vs_per_rad + resistance_ohm * viscous_nms / ke_vs_per_rad;
+        s.ff_ke_mv_per_dps = keEff * 1000.0f / (float)DEG_PER_RAD;
+        s.ff_resistance_ohm = resistance_ohm;
+        s.ff_friction_ma = friction / ke_vs_per_rad * 1000.0f;
+    }
+
+    // One semi-implicit Euler step of a body with Coulomb friction and stiction.
+    // Returns the new speed.
+    static double frictionStep(double speed, double torque, double inertia,
+                               double coulomb, double stiction, double dt)
+    {
+        if (std::abs(speed) < STOP_SPEED)
+        {
+            if (std::abs(torque) <= stiction)
+                return 0.0;
+            double sign = torque > 0 ? 1.0 : -1.0;
+            return speed + (torque - coulomb * sign) / inertia * dt;
+        }
+        double sign = speed > 0 ? 1.0 : -1.0;
+        double next = speed + (torque - coulomb * sign) / inertia * dt;
+        // Friction can stop the body but not reverse it.
+        if ((next > 0) != (speed > 0))
+            return 0.0;
+        return next;
+    }
+
+    void MotorPlant::step(float volts, bool open, float dt)
+    {
+        const MotorModel &m = m_model;
+        double ke = m.ke_vs_per_rad;
+
+        m_current = open ? 0.0f : (float)((volts - ke * m_speed) / m.resistance_ohm);
+        double motorTorque = ke * m_current - m.viscous_nms * m_speed;
+
+        if (m.load_inertia_kgm2 <= 0.0f)
+        {
+            // Rigid, no load.
+            m_speed = frictionStep(m_speed, motorTorque, m.inertia_kgm2,
+                                   m.coulomb_nm, m.stiction_nm, dt);
+            m_angle += m_speed * dt;
+            m_loadAngle = m_angle;
+            m_loadSpeed = m_speed;
+            return;
+        }
+
+        // Backlash: no torque inside the gap, a stiff spring-damper at either
+        // end that can only push. The spring is scaled to the step so the
+        // contact stays stable (natural frequency 0.2 / dt).
+        double jr = (double)m.inertia_kgm2 * m.load_inertia_kgm2 /
+                    ((double)m.inertia_kgm2 + m.load_inertia_kgm2);
+        double wn = 0.2 / dt;
+        double k = wn * wn * jr;
+        double c = 2.0 * 0.7 * std::sqrt(k * jr);
+
+        double half = m.backlash_deg / 2.0 / DEG_PER_RAD;
+        double gap = m_angle - m_loadAngle;
+        double contact = 0.0;
+        if (gap > half)
+            contact = std::max(0.0, k * (gap - half) + c * (m_speed - m_loadSpeed));
+        else if (gap < -half)
+            contact = std::min(0.0, k * (gap + half) + c * (m_speed - m_loadSpeed));
+
+        m_speed = frictionStep(m_speed, motorTorque - contact, m.inertia_kgm2,
+                               m.coulomb_nm, m.stiction_nm, dt);
+        m_loadSpeed = frictionStep(m_loadSpeed, contact - m.load_torque_nm, m.load_inertia_kgm2,
+                                   m.load_friction_nm, m.load_friction_nm, dt);
+        m_angle += m_speed * dt;
+        m_loadAngle += m_loadSpeed * dt;
+    }
+
+    void MotorPlant::reset(double angleDeg)
+    {
+        m_angle = m_loadAngle = angleDeg / DEG_PER_RAD;
+        m_speed = m_loadSpeed = 0.0;
+        m_current = 0.0f;
+    }
+
+    double MotorPlant::angleDeg() const
+    {
+        return m_angle * DEG_PER_RAD;
+    }
+
+    double MotorPlant::speedDps() const
+    {
+        return m_speed * DEG_PER_RAD;
+    }
+
+    double MotorPlant::loadAngleDeg() const
+    {
+        return m_loadAngle * DEG_PER_RAD;
+    }
+}; // namespace Lpf2::Sim
+
+#endif // LPF2_NATIVE
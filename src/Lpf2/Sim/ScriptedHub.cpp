@@ -0,0 +1,643 @@
+/**
+ *  Copyright (C) 2026 - Rbel12b
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *  */
+
+#if defined(LPF2_NATIVE)
+
+#include "Lpf2/Sim/ScriptedHub.hpp"
+#include "Lpf2/Util/Values.hpp"
+#include "Lpf2/Port.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace Lpf2::Sim
+{
+    // Remainder of @p line after "@p key: ", nullptr if it does not start with it
+    // (leading whitespace ignored).
+    static const char *field(const std::string &line, const char *key)
+    {
+        const char *p = line.c_str();
+        while (*p == ' ' || *p == '\t')
+            p++;
+        size_t n = std::strlen(key);
+        if (std::strncmp(p, key, n) != 0 || p[n] != ':')
+            return nullptr;
+        p += n + 1;
+        if (*p == ' ')
+            p++;
+        return p;
+    }
+
+    static Version parseVersion(const char *s)
+    {
+        Version v;
+        std::sscanf(s, "%d.%d.%d.%d", &v.Major, &v.Minor, &v.Bugfix, &v.Build);
+        return v;
+    }
+
+    static std::vector<uint8_t> parseBytes(const char *s)
+    {
+        std::vector<uint8_t> bytes;
+        while (*s)
+        {
+            char *end;
+            unsigned long b = std::strtoul(s, &end, 0);
+            if (end == s)
+            {
+                s++;
+                continue;
+            }
+            bytes.push_back((uint8_t)b);
+            s = end;
+        }
+        return bytes;
+    }
+
+    static void parseProperty(const char *s, HubPropertyType propId, std::vector<uint8_t> &prop)
+    {
+        switch (propId)
+        {
+        case HubPropertyType::ADVERTISING_NAME:
+        case HubPropertyType::MANUFACTURER_NAME:
+        case HubPropertyType::RADIO_FIRMWARE_VERSION:
+            prop.assign(s, s + std::strlen(s));
+            break;
+        case HubPropertyType::FW_VERSION:
+        case HubPropertyType::HW_VERSION:
+            prop = Utils::packVersion(parseVersion(s));
+            break;
+        case HubPropertyType::BATTERY_TYPE:
+            prop = {(uint8_t)(std::strncmp(s, "Normal", 6) == 0 ? BatteryType::NORMAL : BatteryType::RECHARGEABLE)};
+            break;
+        case HubPropertyType::BUTTON:
+            if (std::strncmp(s, "Down", 4) == 0)
+                prop = {(uint8_t)ButtonState::DOWN};
+            else if (std::strncmp(s, "Up", 2) == 0)
+                prop = {(uint8_t)ButtonState::UP};
+            else if (std::strncmp(s, "Stop", 4) == 0)
+                prop = {(uint8_t)ButtonState::STOP};
+            else
+                prop = {(uint8_t)ButtonState::RELEASED};
+            break;
+        case HubPropertyType::BATTERY_VOLTAGE:
+        case HubPropertyType::RSSI:
+            prop = {(uint8_t)std::strtol(s, nullptr, 0)};
+            break;
+        default:
+            prop = parseBytes(s);
+            break;
+        }
+    }
+
+    int ScriptedHub::load(const char *path)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return -1;
+        return load(in);
+    }
+
+    int ScriptedHub::load(std::istream &in)
+    {
+        // Labels of Hub::getAllInfoStr().
+        static const struct
+        {
+            const char *label;
+            HubPropertyType propId;
+        } props[] = {
+            {"Advertising Name", HubPropertyType::ADVERTISING_NAME},
+            {"Manufacturer Name", HubPropertyType::MANUFACTURER_NAME},
+            {"HW version", HubPropertyType::HW_VERSION},
+            {"FW version", HubPropertyType::FW_VERSION},
+            {"LWP version", HubPropertyType::LEGO_WIRELESS_PROTOCOL_VERSION},
+            {"Radio FW version", HubPropertyType::RADIO_FIRMWARE_VERSION},
+            {"Primary MAC", HubPropertyType::PRIMARY_MAC_ADDRESS},
+            {"Secondary MAC", HubPropertyType::SECONDARY_MAC_ADDRESS},
+            {"HW network id", HubPropertyType::HW_NETWORK_ID},
+            {"System type ID", HubPropertyType::SYSTEM_TYPE_ID},
+            {"HW network family", HubPropertyType::HARDWARE_NETWORK_FAMILY},
+            {"RSSI", HubPropertyType::RSSI},
+            {"Battery type", HubPropertyType::BATTERY_TYPE},
+            {"Battery voltage", HubPropertyType::BATTERY_VOLTAGE},
+            {"Button state", HubPropertyType::BUTTON},
+        };
+
+        struct Attached
+        {
+            PortNum port;
+            DeviceType type;
+            Version hw, fw;
+        };
+        std::vector<Attached> attached;
+
+        DeviceInfo *dev = nullptr;
+        ModeInfo *mode = nullptr;
+        bool inCombos = false;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            if (const char *p = std::strstr(line.c_str(), "Attached IO:"))
+            {
+                Attached a;
+                unsigned port, type;
+                if (std::sscanf(p, "Attached IO: HWRew: %d.%d.%d.%d, FWRew: %d.%d.%d.%d, Port: 0x%x, DevType: 0x%x",
+                                &a.hw.Major, &a.hw.Minor, &a.hw.Bugfix, &a.hw.Build,
+                                &a.fw.Major, &a.fw.Minor, &a.fw.Bugfix, &a.fw.Build, &port, &type) == 10)
+                {
+                    a.port = (PortNum)port;
+                    a.type = (DeviceType)type;
+                    attached.push_back(a);
+                }
+                continue;
+            }
+
+            const char *v;
+            if ((v = field(line, "Device")))
+            {
+                m_devices.emplace_back();
+                dev = &m_devices.back();
+                dev->type = (DeviceType)std::strtoul(v, nullptr, 0);
+                mode = nullptr;
+                inCombos = false;
+                continue;
+            }
+            if (!dev)
+            {
+                for (const auto &prop : props)
+                {
+                    if ((v = field(line, prop.label)))
+                        parseProperty(v, prop.propId, m_props[(unsigned int)prop.propId]);
+                }
+                continue;
+            }
+
+            if ((v = field(line, "Combos")))
+            {
+                inCombos = true;
+            }
+            else if (inCombos && line.find("0x") != std::string::npos && line.find(':') == std::string::npos)
+            {
+                v = line.c_str();
+            }
+            else
+            {
+                inCombos = false;
+            }
+            if (inCombos)
+            {
+                for (char *end; *v; v = end)
+                {
+                    unsigned long c = std::strtoul(v, &end, 0);
+                    if (end == v)
+                    {
+                        end = (char *)v + 1;
+                        continue;
+                    }
+                    if (c)
+                        dev->combos.push_back((uint16_t)c);
+                }
+                continue;
+            }
+
+            if ((v = field(line, "InModes")))
+                dev->inModes = (uint16_t)std::strtoul(v, nullptr, 0);
+            else if ((v = field(line, "OutModes")))
+                dev->outModes = (uint16_t)std::strtoul(v, nullptr, 0);
+            else if ((v = field(line, "Caps")))
+                dev->caps = (uint8_t)std::strtoul(v, nullptr, 0);
+            else if (std::strncmp(line.c_str(), "Mode ", 5) == 0)
+            {
+                dev->modes.emplace_back();
+                mode = &dev->modes.back();
+            }
+            else if (!mode)
+                continue;
+            else if ((v = field(line, "name")))
+                mode->name = v;
+            else if ((v = field(line, "unit")))
+                mode->unit = v;
+            else if ((v = field(line, "min")))
+                mode->raw[0] = std::strtof(v, nullptr);
+            else if ((v = field(line, "max")))
+                mode->raw[1] = std::strtof(v, nullptr);
+            else if ((v = field(line, "PCT min")))
+                mode->pct[0] = std::strtof(v, nullptr);
+            else if ((v = field(line, "PCT max")))
+                mode->pct[1] = std::strtof(v, nullptr);
+            else if ((v = field(line, "SI min")))
+                mode->si[0] = std::strtof(v, nullptr);
+            else if ((v = field(line, "SI max")))
+                mode->si[1] = std::strtof(v, nullptr);
+            else if ((v = field(line, "Data sets")))
+                mode->dataSets = (uint8_t)std::strtoul(v, nullptr, 0);
+            else if ((v = field(line, "format")))
+                mode->format = (uint8_t)std::strtoul(v, nullptr, 0);
+            else if ((v = field(line, "Figures")))
+                mode->figures = (uint8_t)std::strtoul(v, nullptr, 0);
+            else if ((v = field(line, "Decimals")))
+                mode->decimals = (uint8_t)std::strtoul(v, nullptr, 0);
+            else if ((v = field(line, "in")))
+                mode->in = (uint8_t)std::strtoul(v, nullptr, 0);
+            else if ((v = field(line, "out")))
+                mode->out = (uint8_t)std::strtoul(v, nullptr, 0);
+            else if ((v = field(line, "Flags")))
+            {
+                // Current dumps list bytes[0..5], older ones one 48-bit
+                // number with bytes[0] as the lowest byte.
+                std::string list(v, std::strcspn(v, "("));
+                if (list.find(',') != std::string::npos)
+                {
+                    auto bytes = parseBytes(list.c_str());
+                    for (size_t i = 0; i < bytes.size() && i < 6; i++)
+                        mode->flags[i] = bytes[i];
+                }
+                else
+                {
+                    uint64_t flags = std::strtoull(v, nullptr, 0);
+                    for (int i = 0; i < 6; i++)
+                        mode->flags[i] = (uint8_t)(flags >> (8 * i));
+                }
+            }
+        }
+
+        if (m_devices.empty())
+            return -2;
+        for (const auto &a : attached)
+            attachIO(a.port, a.type, a.hw, a.fw);
+        return 0;
+    }
+
+    const ScriptedHub::DeviceInfo *ScriptedHub::findDevice(DeviceType type) const
+    {
+        for (const auto &dev : m_devices)
+        {
+            if (dev.type == type)
+                return &dev;
+        }
+        return nullptr;
+    }
+
+    int ScriptedHub::attachIO(PortNum port, DeviceType type, Version hw, Version fw)
+    {
+        const DeviceInfo *dev = findDevice(type);
+        if (!dev)
+            return -1;
+        PortState &state = m_ports[port];
+        if (!state.device)
+            m_portOrder.push_back(port);
+        state = PortState();
+        state.device = dev;
+        state.hw = hw;
+        state.fw = fw;
+        return 0;
+    }
+
+    void ScriptedHub::send(MessageType type, const std::vector<uint8_t> &payload)
+    {
+        std::vector<uint8_t> msg = {(uint8_t)(payload.size() + 3), 0x00, (uint8_t)type};
+        msg.insert(msg.end(), payload.begin(), payload.end());
+        m_stats.sent++;
+        if (m_sender)
+            m_sender(msg.data(), msg.size());
+    }
+
+    void ScriptedHub::sendError(MessageType type, GenericErrorType error)
+    {
+        m_stats.errors++;
+        send(MessageType::GENERIC_ERROR_MESSAGES, {(uint8_t)type, (uint8_t)error});
+    }
+
+    void ScriptedHub::connect()
+    {
+        for (PortNum port : m_portOrder)
+        {
+            const PortState &state = m_ports[port];
+            std::vector<uint8_t> payload = {port, (uint8_t)IOEvent::ATTACHED_IO,
+                                            (uint8_t)state.device->type, (uint8_t)((unsigned)state.device->type >> 8)};
+            auto hw = Utils::packVersion(state.hw);
+            auto fw = Utils::packVersion(state.fw);
+            payload.insert(payload.end(), hw.begin(), hw.end());
+            payload.insert(payload.end(), fw.begin(), fw.end());
+            send(MessageType::HUB_ATTACHED_IO, payload);
+        }
+    }
+
+    void ScriptedHub::receive(const uint8_t *data, size_t length)
+    {
+        m_stats.received++;
+        if (length < 3)
+            return;
+        switch ((MessageType)data[2])
+        {
+        case MessageType::HUB_PROPERTIES:
+            handleProperty(data, length);
+            break;
+        case MessageType::PORT_INFORMATION_REQUEST:
+            handlePortInfo(data, length);
+            break;
+        case MessageType::PORT_MODE_INFORMATION_REQUEST:
+            handleModeInfo(data, length);
+            break;
+        case MessageType::PORT_INPUT_FORMAT_SETUP_SINGLE:
+            handleInputFormat(data, length);
+            break;
+        case MessageType::PORT_INPUT_FORMAT_SETUP_COMBINEDMODE:
+            if (length >= 4)
+                send(MessageType::PORT_INPUT_FORMAT_COMBINEDMODE, {data[3], 0x00, 0x00, 0x00});
+            break;
+        case MessageType::PORT_OUTPUT_COMMAND:
+            handleOutputCommand(data, length);
+            break;
+        case MessageType::HUB_ALERTS:
+        case MessageType::HUB_ACTIONS:
+            break;
+        default:
+            sendError((MessageType)data[2], GenericErrorType::CMD_NOT_RECOGNIZED);
+            break;
+        }
+    }
+
+    void ScriptedHub::handleProperty(const uint8_t *msg, size_t length)
+    {
+        if (length < 5 || msg[3] >= (uint8_t)HubPropertyType::END)
+        {
+            sendError(MessageType::HUB_PROPERTIES, GenericErrorType::INVALID_USE);
+            return;
+        }
+        auto &prop = m_props[msg[3]];
+        switch ((HubPropertyOperation)msg[4])
+        {
+        case HubPropertyOperation::SET_DOWNSTREAM:
+            prop.assign(msg + 5, msg + length);
+            break;
+        case HubPropertyOperation::ENABLE_UPDATES_DOWNSTREAM: // a hub sends the current value right away
+            m_propUpdates |= 1u << msg[3];
+            sendProperty((HubPropertyType)msg[3]);
+            break;
+        case HubPropertyOperation::DISABLE_UPDATES_DOWNSTREAM:
+            m_propUpdates &= ~(1u << msg[3]);
+            break;
+        case HubPropertyOperation::REQUEST_UPDATE_DOWNSTREAM:
+            sendProperty((HubPropertyType)msg[3]);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void ScriptedHub::handlePortInfo(const uint8_t *msg, size_t length)
+    {
+        m_stats.infoRequests++;
+        const DeviceInfo *dev = length >= 5 ? m_ports[msg[3]].device : nullptr;
+        if (!dev)
+        {
+            sendError(MessageType::PORT_INFORMATION_REQUEST, GenericErrorType::INVALID_USE);
+            return;
+        }
+        std::vector<uint8_t> payload = {msg[3], msg[4]};
+        switch (msg[4])
+        {
+        case 0x01:
+            payload.push_back(dev->caps);
+            payload.push_back((uint8_t)dev->modes.size());
+            payload.push_back((uint8_t)dev->inModes);
+            payload.push_back((uint8_t)(dev->inModes >> 8));
+            payload.push_back((uint8_t)dev->outModes);
+            payload.push_back((uint8_t)(dev->outModes >> 8));
+            break;
+        case 0x02:
+            for (uint16_t combo : dev->combos)
+            {
+                payload.push_back((uint8_t)combo);
+                payload.push_back((uint8_t)(combo >> 8));
+            }
+            break;
+        default:
+            sendError(MessageType::PORT_INFORMATION_REQUEST, GenericErrorType::INVALID_USE);
+            return;
+        }
+        send(MessageType::PORT_INFORMATION, payload);
+    }
+
+    void ScriptedHub::handleModeInfo(const uint8_t *msg, size_t length)
+    {
+        m_stats.infoRequests++;
+        const DeviceInfo *dev = length >= 6 ? m_ports[msg[3]].device : nullptr;
+        if (!dev || msg[4] >= dev->modes.size())
+        {
+            sendError(MessageType::PORT_MODE_INFORMATION_REQUEST, GenericErrorType::INVALID_USE);
+            return;
+        }
+        const ModeInfo &mode = dev->modes[msg[4]];
+        std::vector<uint8_t> payload = {msg[3], msg[4], msg[5]};
+        auto pushRange = [&payload](const float range[2])
+        {
+            uint8_t bytes[8];
+            std::memcpy(bytes, range, sizeof(bytes));
+            payload.insert(payload.end(), bytes, bytes + sizeof(bytes));
+        };
+        switch ((ModeInfoType)msg[5])
+        {
+        case ModeInfoType::NAME:
+            payload.insert(payload.end(), mode.name.begin(), mode.name.end());
+            break;
+        case ModeInfoType::RAW:
+            pushRange(mode.raw);
+            break;
+        case ModeInfoType::PCT:
+            pushRange(mode.pct);
+            break;
+        case ModeInfoType::SI:
+            pushRange(mode.si);
+            break;
+        case ModeInfoType::SYMBOL:
+            payload.insert(payload.end(), mode.unit.begin(), mode.unit.end());
+            break;
+        case ModeInfoType::MAPPING:
+            payload.push_back(mode.in);
+            payload.push_back(mode.out);
+            break;
+        case ModeInfoType::CAPS:
+            for (int i = 5; i >= 0; i--)
+                payload.push_back(mode.flags[i]);
+            break;
+        case ModeInfoType::VALUE:
+            payload.push_back(mode.dataSets);
+            payload.push_back(mode.format);
+            payload.push_back(mode.figures);
+            payload.push_back(mode.decimals);
+            break;
+        default:
+            sendError(MessageType::PORT_MODE_INFORMATION_REQUEST, GenericErrorType::INVALID_USE);
+            return;
+        }
+        send(MessageType::PORT_MODE_INFORMATION, payload);
+    }
+
+    void ScriptedHub::handleInputFormat(const uint8_t *msg, size_t length)
+    {
+        PortState *state = length >= 10 ? &m_ports[msg[3]] : nullptr;
+        if (!state || !state->device || msg[4] >= state->device->modes.size())
+        {
+            sendError(MessageType::PORT_INPUT_FORMAT_SETUP_SINGLE, GenericErrorType::INVALID_USE);
+            return;
+        }
+        state->inputSet = true;
+        state->inputMode = msg[4];
+        send(MessageType::PORT_INPUT_FORMAT_SINGLE, std::vector<uint8_t>(msg + 3, msg + 10));
+    }
+
+    void ScriptedHub::handleOutputCommand(const uint8_t *msg, size_t length)
+    {
+        m_stats.outputCommands++;
+        if (length >= 6)
+            m_outputLog.push_back(msg[5]);
+        if (length < 6 || !m_ports[msg[3]].device)
+        {
+            sendError(MessageType::PORT_OUTPUT_COMMAND, GenericErrorType::INVALID_USE);
+            return;
+        }
+        PortState &state = m_ports[msg[3]];
+        bool feedback = msg[4] & COMPLETION_FEEDBACK;
+        auto sub = (PortOutputSubCommand)msg[5];
+        bool move = sub == PortOutputSubCommand::START_SPEED_FOR_TIME_SINGLE ||
+                    sub == PortOutputSubCommand::START_SPEED_FOR_DEG_SINGLE ||
+                    sub == PortOutputSubCommand::GOTO_ABS_POS_SINGLE;
+        // Any command but a buffered move replaces what the motor does.
+        uint8_t discarded = 0;
+        if (!move || !m_moveUs || (msg[4] & STARTUP_IMMEDIATE))
+        {
+            if ((state.running && state.runningFeedback) || (state.buffered && state.bufferedFeedback))
+                discarded = FEEDBACK_DISCARDED;
+            state.running = state.buffered = false;
+        }
+        if (!move || !m_moveUs)
+        {
+            // Completes at once: buffer empty, command completed, idle.
+            if (feedback || discarded)
+                sendFeedback(msg[3], FEEDBACK_BUFFER_EMPTY_COMPLETED | FEEDBACK_IDLE | discarded);
+        }
+        else if (!state.running)
+        {
+            state.running = true;
+            state.runningFeedback = feedback;
+            state.runningEndUs = m_nowUs + m_moveUs;
+            if (feedback || discarded)
+                sendFeedback(msg[3], FEEDBACK_BUFFER_EMPTY_IN_PROGRESS | discarded);
+        }
+        else if (!state.buffered)
+        {
+            state.buffered = true;
+            state.bufferedFeedback = feedback;
+        }
+        else if (feedback)
+        {
+            sendFeedback(msg[3], FEEDBACK_BUSY_FULL);
+        }
+    }
+
+    void ScriptedHub::sendFeedback(PortNum port, uint8_t feedback)
+    {
+        send(MessageType::PORT_OUTPUT_COMMAND_FEEDBACK, {port, feedback});
+    }
+
+    void ScriptedHub::sendProperty(HubPropertyType propId)
+    {
+        const auto &prop = m_props[(uint8_t)propId];
+        std::vector<uint8_t> payload = {(uint8_t)propId, (uint8_t)HubPropertyOperation::UPDATE_UPSTREAM};
+        payload.insert(payload.end(), prop.begin(), prop.end());
+        send(MessageType::HUB_PROPERTIES, payload);
+    }
+
+    void ScriptedHub::tick(uint64_t nowUs)
+    {
+        m_nowUs = nowUs;
+        if (m_propertyUs && nowUs >= m_nextPropertyUs)
+        {
+            // RSSI wanders by a dBm, the battery drops 1 % every 20 updates.
+            m_nextPropertyUs = nowUs + m_propertyUs;
+            m_propertyTicks++;
+            auto &rssi = m_props[(uint8_t)HubPropertyType::RSSI];
+            auto &battery = m_props[(uint8_t)HubPropertyType::BATTERY_VOLTAGE];
+            rssi = {(uint8_t)(int8_t)(-60 - (int)(m_propertyTicks % 3))};
+            if (m_propertyTicks % 20 == 0 && !battery.empty() && battery[0])
+                battery[0]--;
+            for (HubPropertyType prop : {HubPropertyType::RSSI, HubPropertyType::BATTERY_VOLTAGE})
+            {
+                if (m_propUpdates & (1u << (uint8_t)prop))
+                {
+                    m_stats.propertyUpdates++;
+                    sendProperty(prop);
+                }
+            }
+        }
+        if (!m_moveUs)
+            return;
+        for (PortNum port : m_portOrder)
+        {
+            PortState &state = m_ports[port];
+            if (!state.running || nowUs < state.runningEndUs)
+                continue;
+            bool feedback = state.runningFeedback;
+            state.running = false;
+            if (state.buffered)
+            {
+                // The buffered one starts: buffer empty, command in progress.
+                state.buffered = false;
+                state.running = true;
+                state.runningFeedback = state.bufferedFeedback;
+                state.runningEndUs = nowUs + m_moveUs;
+                if (feedback || state.runningFeedback)
+                    sendFeedback(port, FEEDBACK_BUFFER_EMPTY_IN_PROGRESS);
+            }
+            else if (feedback)
+            {
+                sendFeedback(port, FEEDBACK_BUFFER_EMPTY_COMPLETED | FEEDBACK_IDLE);
+            }
+        }
+    }
+
+    int ScriptedHub::sendValue(PortNum port, int32_t value)
+    {
+        const PortState &state = m_ports[port];
+        if (!state.device || !state.inputSet)
+            return -1;
+        const ModeInfo &mode = state.device->modes[state.inputMode];
+        uint8_t size = Lpf2::Port::getDataSize(mode.format);
+        uint8_t bytes[4];
+        if (mode.format == DATAF)
+        {
+            float f = (float)value;
+            std::memcpy(bytes, &f, 4);
+        }
+        else
+        {
+            std::memcpy(bytes, &value, 4);
+        }
+        std::vector<uint8_t> payload = {port};
+        for (uint8_t i = 0; i < mode.dataSets; i++)
+            payload.insert(payload.end(), bytes, bytes + size);
+        send(MessageType::PORT_VALUE_SINGLE, payload);
+        return 0;
+    }
+}; // namespace Lpf2::Sim
+
+#endif // LPF2_NATIVE
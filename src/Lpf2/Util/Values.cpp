@@ -17,46 +17,39 @@
 
 #include "Lpf2/log/log.h"
 #include "Lpf2/Util/Values.hpp"
-#include <sstream>
-#include <iomanip>
+#include "Lpf2/Util/Format.hpp"
 
 namespace Lpf2::Utils
 {
     std::string bytes_to_hexString(const std::vector<uint8_t> &data)
     {
-        std::ostringstream oss;
-        for (size_t i = 0; i < data.size(); ++i)
-        {
-            if (i > 0)
-                oss << ", ";
-            oss << "0x"
-                << std::hex << std::setw(2) << std::setfill('0')
-                << static_cast<int>(data[i]);
-        }
-        return oss.str();
+        return formatToString([&data](char *buf, size_t size)
+                              { return bytes_to_hexString(buf, size, data.data(), data.size()); },
+                              data.size() * 6);
     }
 
     std::string bytes_to_hexString(const std::string &data)
     {
-        std::ostringstream oss;
-        for (size_t i = 0; i < data.size(); ++i)
-        {
-            if (i > 0)
-                oss << ", ";
-            oss << "0x"
-                << std::hex << std::setw(2) << std::setfill('0')
-                << static_cast<int>(data[i]);
-        }
-        return oss.str();
+        return formatToString([&data](char *buf, size_t size)
+                              { return bytes_to_hexString(buf, size, reinterpret_cast<const uint8_t *>(data.data()), data.size()); },
+                              data.size() * 6);
     }
 
     std::string byte_to_hexString(uint8_t data)
     {
-        std::ostringstream oss;
-        oss << "0x"
-            << std::hex << std::setw(2) << std::setfill('0')
-            << static_cast<int>(data);
-        return oss.str();
+        char buf[5];
+        snprintf(buf, sizeof(buf), "0x%02x", static_cast<int>(data));
+        return buf;
+    }
+
+    size_t bytes_to_hexString(char *buf, size_t size, const uint8_t *data, size_t len)
+    {
+        StrBuf out(buf, size);
+        for (size_t i = 0; i < len; ++i)
+        {
+            out.printf(i > 0 ? ", 0x%02x" : "0x%02x", static_cast<int>(data[i]));
+        }
+        return out.length();
     }
 
     std::vector<uint8_t> packVersion(Version version)
@@ -74,6 +67,11 @@ namespace Lpf2::Utils
         if (version.size() < 4)
             return Version();
 
+        return unPackVersion(version.data());
+    }
+
+    Version unPackVersion(const uint8_t *version)
+    {
         Version v;
         v.Build = version[0] | (version[1] << 8);
         v.Bugfix = version[2];
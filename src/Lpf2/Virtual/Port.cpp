@@ -143,6 +143,7 @@ namespace Lpf2::Virtual
     {
         if (m_emulatedDevice)
             m_modeData = m_emulatedDevice->getModes();
+        publishModeData(modeNum);
         fireValueChangeCallback(modeNum);
     }
 }; // namespace Lpf2::Virtual
\ No newline at end of file
@@ -16,8 +16,10 @@
  *  */
 
 #include "Lpf2/log/log.h"
+#if !defined(LPF2_NATIVE)
 #include "driver/usb_serial_jtag.h"
 #include "freertos/semphr.h"
+#endif
 #include <stdarg.h>
 #include <stdio.h>
 #include <cstring>
@@ -52,6 +54,30 @@ void lpf2_set_runtime_log_level(uint16_t level)
     lpf2_log_runtime_level = level;
 }
 
+#if defined(LPF2_NATIVE)
+
+// Host build: log to stdout.
+
+int lpf2_log_init(void)
+{
+    return 0;
+}
+
+extern "C" int lpf2_log_printf(const char *fmt, ...)
+{
+    if (!fmt || !*fmt)
+    {
+        return 0;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int len = vprintf(fmt, args);
+    va_end(args);
+    return len;
+}
+
+#else
+
 QueueHandle_t logMutex = xSemaphoreCreateMutex();
 
 #if LPF2_USE_ARDUINO_SERIAL == 0
@@ -172,4 +198,6 @@ extern "C" int lpf2_log_printf(const char *fmt, ...)
     return len;
 }
 
-#endif
\ No newline at end of file
+#endif
+
+#endif // LPF2_NATIVE